@@ -148,14 +148,14 @@ AxisEvent::send(UInput& uinput, int value)
 }
 
 void
-AxisEvent::update(UInput& uinput, int msec_delta)
+AxisEvent::update(UInput& uinput, int64_t nsec_delta)
 {
   for(std::vector<AxisFilterPtr>::const_iterator i = m_filters.begin(); i != m_filters.end(); ++i)
   {
-    (*i)->update(msec_delta);
+    (*i)->update(nsec_delta);
   }
 
-  m_handler->update(uinput, msec_delta);
+  m_handler->update(uinput, nsec_delta);
 
   send(uinput, m_last_raw_value);
 }
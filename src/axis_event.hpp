@@ -49,7 +49,7 @@ public:
 
   void init(UInput& uinput, int slot, bool extra_devices);
   void send(UInput& uinput, int value);
-  void update(UInput& uinput, int msec_delta);
+  void update(UInput& uinput, int64_t nsec_delta);
 
   void set_axis_range(int min, int max);
 
@@ -76,7 +76,7 @@ public:
 
   virtual void init(UInput& uinput, int slot, bool extra_devices) =0;
   virtual void send(UInput& uinput, int value) =0;
-  virtual void update(UInput& uinput, int msec_delta) =0;
+  virtual void update(UInput& uinput, int64_t nsec_delta) =0;
 
   virtual void set_axis_range(int min, int max);
 
@@ -26,6 +26,7 @@
 #include "axisfilter/deadzone_axis_filter.hpp"
 #include "axisfilter/invert_axis_filter.hpp"
 #include "axisfilter/log_axis_filter.hpp"
+#include "axisfilter/one_euro_axis_filter.hpp"
 #include "axisfilter/relative_axis_filter.hpp"
 #include "axisfilter/response_curve_axis_filter.hpp"
 #include "axisfilter/sensitivity_axis_filter.hpp"
@@ -68,6 +69,10 @@ AxisFilter::from_string(const std::string& str)
   {
     return AxisFilterPtr(ResponseCurveAxisFilter::from_string(rest));
   }
+  else if (filtername == "oneeuro" || filtername == "euro")
+  {
+    return AxisFilterPtr(OneEuroAxisFilter::from_string(rest));
+  }
   else if (filtername == "log")
   {
     return AxisFilterPtr(LogAxisFilter::from_string(rest));
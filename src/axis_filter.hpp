@@ -20,6 +20,7 @@
 #define HEADER_XBOXDRV_AXIS_FILTER_HPP
 
 #include <boost/shared_ptr.hpp>
+#include <stdint.h>
 #include <string>
 #include <vector>
 
@@ -36,7 +37,14 @@ public:
   AxisFilter() {}
   virtual ~AxisFilter() {}
 
-  virtual void update(int msec_delta) {}
+  virtual void update(int64_t nsec_delta) {}
+
+  /** Called before filter() with the time in nsec of the report the
+      value was taken from, 0 when the device doesn't timestamp its
+      reports. The same time is passed again when an old report is
+      resend on a timeout. */
+  virtual void set_report_time(int64_t nsec) {}
+
   virtual int filter(int value, int min, int max) = 0;
   virtual std::string str() const = 0;
 };
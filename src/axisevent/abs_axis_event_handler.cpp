@@ -92,7 +92,7 @@ AbsAxisEventHandler::send(UInput& uinput, int value)
 }
 
 void
-AbsAxisEventHandler::update(UInput& uinput, int msec_delta)
+AbsAxisEventHandler::update(UInput& uinput, int64_t nsec_delta)
 {
 }
 
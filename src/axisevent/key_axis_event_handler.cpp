@@ -153,7 +153,7 @@ KeyAxisEventHandler::send(UInput& uinput, int value)
 }
 
 void
-KeyAxisEventHandler::update(UInput& uinput, int msec_delta)
+KeyAxisEventHandler::update(UInput& uinput, int64_t nsec_delta)
 {
 }
 
@@ -21,6 +21,7 @@
 #include <boost/tokenizer.hpp>
 #include <math.h>
 
+#include "clock.hpp"
 #include "evdev_helper.hpp"
 #include "helper.hpp"
 #include "uinput.hpp"
@@ -69,7 +70,8 @@ RelAxisEventHandler::RelAxisEventHandler() :
   m_repeat(10),
   m_stick_value(0.0f),
   m_rest_value(0.0f),
-  m_rel_emitter()
+  m_rel_emitter(),
+  m_repeat_handle(-1)
 {
 }
 
@@ -79,7 +81,8 @@ RelAxisEventHandler::RelAxisEventHandler(int device_id, int code, int repeat, fl
   m_repeat(repeat),
   m_stick_value(0.0f),
   m_rest_value(0.0f),
-  m_rel_emitter()
+  m_rel_emitter(),
+  m_repeat_handle(-1)
 {
 }
 
@@ -88,6 +91,11 @@ RelAxisEventHandler::init(UInput& uinput, int slot, bool extra_devices)
 {
   m_code.resolve_device_id(slot, extra_devices);
   m_rel_emitter = uinput.add_rel(m_code.get_device_id(), m_code.code);
+
+  if (m_repeat != -1)
+  {
+    m_repeat_handle = uinput.add_rel_repetitive(m_code.get_device_id(), m_code.code);
+  }
 }
 
 void
@@ -104,20 +112,20 @@ RelAxisEventHandler::send(UInput& uinput, int value)
     float v = m_value * m_stick_value;
 
     if (v == 0)
-      uinput.send_rel_repetitive(m_code, v, -1);
+      uinput.send_rel_repetitive(m_repeat_handle, v, -1);
     else
-      uinput.send_rel_repetitive(m_code, v, m_repeat);
+      uinput.send_rel_repetitive(m_repeat_handle, v, m_repeat);
   }
 }
 
 void
-RelAxisEventHandler::update(UInput& uinput, int msec_delta)
+RelAxisEventHandler::update(UInput& uinput, int64_t nsec_delta)
 {
   if (m_repeat == -1 && m_stick_value != 0.0f)
   {
     // new and improved REL style event sending
 
-    float rel_value = m_stick_value * m_value * static_cast<float>(msec_delta) / 1000.0f;
+    float rel_value = m_stick_value * m_value * nsec2sec(nsec_delta);
 
     // keep track of the rest that we lose when converting to integer
     rel_value += m_rest_value;
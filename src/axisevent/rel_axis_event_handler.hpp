@@ -34,7 +34,7 @@ public:
 
   void init(UInput& uinput, int slot, bool extra_devices);
   void send(UInput& uinput, int value);
-  void update(UInput& uinput, int msec_delta);
+  void update(UInput& uinput, int64_t nsec_delta);
 
   std::string str() const;
 
@@ -47,6 +47,9 @@ private:
   float   m_rest_value;
 
   UIEventEmitterPtr m_rel_emitter;
+
+  /** from UInput::add_rel_repetitive(), -1 without repeat */
+  int m_repeat_handle;
 };
 
 #endif
@@ -22,6 +22,7 @@
 #include <math.h>
 #include <sstream>
 
+#include "clock.hpp"
 #include "evdev_helper.hpp"
 #include "helper.hpp"
 #include "raise_exception.hpp"
@@ -53,7 +54,7 @@ RelRepeatAxisEventHandler::RelRepeatAxisEventHandler(const UIEvent& code, int va
   m_value(value),
   m_repeat(repeat),
   m_stick_value(0),
-  m_timer(0),
+  m_timer(0.0f),
   m_rel_emitter()
 {
 }
@@ -82,15 +83,15 @@ RelRepeatAxisEventHandler::send(UInput& uinput, int value)
   // reset timer when in center position
   if (value == 0)
   {
-    m_timer = 0;
+    m_timer = 0.0f;
   }
 }
 
 void
-RelRepeatAxisEventHandler::update(UInput& uinput, int msec_delta)
+RelRepeatAxisEventHandler::update(UInput& uinput, int64_t nsec_delta)
 {
   // time ticks slower depending on how fr the stick is moved
-  m_timer += msec_delta * fabsf(m_stick_value);
+  m_timer += 1000.0f * nsec2sec(nsec_delta) * fabsf(m_stick_value);
 
   while(m_timer > m_repeat)
   {
@@ -18,14 +18,31 @@
 
 #include "axisfilter/calibration_axis_filter.hpp"
 
+#include <algorithm>
 #include <boost/tokenizer.hpp>
 #include <sstream>
+#include <stdlib.h>
 
 #include "helper.hpp"
+#include "raise_exception.hpp"
+
+namespace {
+
+/** number of samples the axis has to stay close to its center before
+    the resting position is updated, power of two */
+const int kRestSamples = 64;
+const int kRestShift = 6;
+
+} // namespace
 
 CalibrationAxisFilter*
 CalibrationAxisFilter::from_string(const std::string& str)
 {
+  if (str == "learn")
+  {
+    return new CalibrationAxisFilter;
+  }
+
   typedef boost::tokenizer<boost::char_separator<char> > tokenizer;
   tokenizer tokens(str, boost::char_separator<char>(":", "", boost::keep_empty_tokens));
 
@@ -51,17 +68,177 @@ CalibrationAxisFilter::from_string(const std::string& str)
 CalibrationAxisFilter::CalibrationAxisFilter(int min, int center, int max) :
   m_min(min),
   m_center(center),
-  m_max(max)
+  m_max(max),
+  m_learn(false),
+  m_calibrated(true),
+  m_dirty(true),
+  m_range_min(0),
+  m_range_max(0),
+  m_neg_scale(0),
+  m_pos_scale(0),
+  m_rest_window(0),
+  m_rest_count(0),
+  m_rest_sum(0)
+{
+}
+
+CalibrationAxisFilter::CalibrationAxisFilter() :
+  m_min(0),
+  m_center(0),
+  m_max(0),
+  m_learn(true),
+  m_calibrated(false),
+  m_dirty(true),
+  m_range_min(0),
+  m_range_max(0),
+  m_neg_scale(0),
+  m_pos_scale(0),
+  m_rest_window(0),
+  m_rest_count(0),
+  m_rest_sum(0)
+{
+}
+
+void
+CalibrationAxisFilter::set_calibration(int min, int center, int max)
+{
+  // center == min is a trigger, which rests at its minimum
+  if (!(min <= center && center < max))
+  {
+    raise_exception(std::runtime_error, "invalid calibration: " << min << ":" << center << ":" << max);
+  }
+
+  m_min = min;
+  m_center = center;
+  m_max = max;
+  m_calibrated = true;
+  m_dirty = true;
+  m_rest_count = 0;
+  m_rest_sum = 0;
+}
+
+void
+CalibrationAxisFilter::reset()
+{
+  m_calibrated = false;
+  m_dirty = true;
+  m_rest_count = 0;
+  m_rest_sum = 0;
+}
+
+void
+CalibrationAxisFilter::update_scale(int min, int max)
+{
+  if (m_learn && !m_calibrated)
+  {
+    // start out with half the nominal range
+    if (min >= 0)
+    {
+      // triggers and other axes that don't go negative rest at their
+      // minimum, so that is the center, not the middle of the range
+      m_center = min;
+      m_min = min;
+      m_max = min + (max - min) / 2;
+    }
+    else
+    {
+      m_center = (max + min + 1) / 2;
+      m_min = m_center - (m_center - min) / 2;
+      m_max = m_center + (max - m_center) / 2;
+    }
+    m_calibrated = true;
+  }
+
+  m_range_min = min;
+  m_range_max = max;
+  m_rest_window = std::max(1, (max - min) / 32);
+
+  // round the scale up so that the calibrated extremes reach the full
+  // range, the result is clamped anyway
+  if (m_center > m_min)
+  {
+    int64_t range = m_center - m_min;
+    m_neg_scale = ((static_cast<int64_t>(-min) << 16) + range - 1) / range;
+  }
+  else
+  {
+    m_neg_scale = 0;
+  }
+
+  if (m_max > m_center)
+  {
+    int64_t range = m_max - m_center;
+    m_pos_scale = ((static_cast<int64_t>(max) << 16) + range - 1) / range;
+  }
+  else
+  {
+    m_pos_scale = 0;
+  }
+
+  m_dirty = false;
+}
+
+void
+CalibrationAxisFilter::learn(int value)
 {
+  if (value < m_min)
+  {
+    m_min = value;
+    m_dirty = true;
+  }
+  else if (value > m_max)
+  {
+    m_max = value;
+    m_dirty = true;
+  }
+
+  if (abs(value - m_center) <= m_rest_window)
+  {
+    m_rest_sum += value;
+    m_rest_count += 1;
+
+    if (m_rest_count == kRestSamples)
+    {
+      int center = m_rest_sum >> kRestShift;
+      if (center != m_center && m_min < center && center < m_max)
+      {
+        m_center = center;
+        m_dirty = true;
+      }
+
+      m_rest_count = 0;
+      m_rest_sum = 0;
+    }
+  }
+  else
+  {
+    m_rest_count = 0;
+    m_rest_sum = 0;
+  }
 }
 
 int
 CalibrationAxisFilter::filter(int value, int min, int max)
 {
+  if (m_dirty || min != m_range_min || max != m_range_max)
+  {
+    update_scale(min, max);
+  }
+
+  if (m_learn)
+  {
+    learn(value);
+
+    if (m_dirty)
+    {
+      update_scale(min, max);
+    }
+  }
+
   if (value < m_center)
-    value = -min * (value - m_center) / (m_center - m_min);
+    value = -static_cast<int>((static_cast<int64_t>(m_center - value) * m_neg_scale) >> 16);
   else if (value > m_center)
-    value = max * (value - m_center) / (m_max - m_center);
+    value = static_cast<int>((static_cast<int64_t>(value - m_center) * m_pos_scale) >> 16);
   else
     value = 0;
 
@@ -72,7 +249,14 @@ std::string
 CalibrationAxisFilter::str() const
 {
   std::ostringstream out;
-  out << "calibration:" << m_min << ":" << m_center << ":" << m_max;
+  if (m_learn)
+  {
+    out << "calibration:learn:" << m_min << ":" << m_center << ":" << m_max;
+  }
+  else
+  {
+    out << "calibration:" << m_min << ":" << m_center << ":" << m_max;
+  }
   return out.str();
 }
 
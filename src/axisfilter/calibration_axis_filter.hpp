@@ -21,6 +21,14 @@
 
 #include "axis_filter.hpp"
 
+/** Maps MIN:CENTER:MAX of a worn or uncalibrated axis to its full
+    range. The scale factors are precomputed whenever the calibration
+    changes, so filtering a value is a multiplication and a shift.
+
+    In learning mode the calibration starts out with half the nominal
+    range around the center and follows the extremes the axis reaches
+    and the position it rests at. The results are stored per device
+    by CalibrationStore. */
 class CalibrationAxisFilter : public AxisFilter
 {
 public:
@@ -29,13 +37,52 @@ public:
 public:
   CalibrationAxisFilter(int min, int center, int max);
 
+  /** create a filter in learning mode */
+  CalibrationAxisFilter();
+
   int filter(int value, int min, int max);
   std::string str() const;
 
+  bool is_learning() const { return m_learn; }
+
+  /** true when the calibration was learned or set since the filter
+      got created or reset */
+  bool is_calibrated() const { return m_calibrated; }
+
+  int get_min() const { return m_min; }
+  int get_center() const { return m_center; }
+  int get_max() const { return m_max; }
+
+  /** continue learning from the given calibration, \a center may
+      equal \a min for triggers */
+  void set_calibration(int min, int center, int max);
+
+  /** forget what was learned */
+  void reset();
+
+private:
+  void learn(int value);
+  void update_scale(int min, int max);
+
 private:
   int m_min;
   int m_center;
   int m_max;
+
+  bool m_learn;
+  bool m_calibrated;
+
+  // output range and 16.16 scale factors computed from it
+  bool m_dirty;
+  int m_range_min;
+  int m_range_max;
+  int64_t m_neg_scale;
+  int64_t m_pos_scale;
+
+  // resting position detection
+  int m_rest_window;
+  int m_rest_count;
+  int m_rest_sum;
 };
 
 #endif
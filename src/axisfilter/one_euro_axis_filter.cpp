@@ -0,0 +1,191 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "axisfilter/one_euro_axis_filter.hpp"
+
+#include <algorithm>
+#include <boost/tokenizer.hpp>
+#include <sstream>
+#include <stdexcept>
+
+#include "helper.hpp"
+
+namespace {
+
+/** 2 * pi in 16.16 */
+const int64_t kTwoPi = 411775;
+
+/** samples closer together are treated as if they were this far
+    apart, keeps the velocity of a jump in range */
+const int64_t kMinDelta = 100 * 1000;
+
+/** samples further apart are treated as if they were this far apart,
+    keeps the fixed point math in range */
+const int64_t kMaxDelta = 100 * 1000 * 1000;
+
+/** upper limit for the adaptive cutoff, 1kHz */
+const int64_t kMaxCutoff = 1000 * 1000;
+
+int64_t hz2mhz(float hz)
+{
+  return static_cast<int64_t>(hz * 1000.0f + 0.5f);
+}
+
+} // namespace
+
+OneEuroAxisFilter*
+OneEuroAxisFilter::from_string(const std::string& str)
+{
+  float min_cutoff = 1.0f;
+  float beta = 5.0f;
+  float dcutoff = 1.0f;
+
+  typedef boost::tokenizer<boost::char_separator<char> > tokenizer;
+  tokenizer tokens(str, boost::char_separator<char>(":", "", boost::keep_empty_tokens));
+  int idx = 0;
+  for(tokenizer::iterator t = tokens.begin(); t != tokens.end(); ++t, ++idx)
+  {
+    switch(idx)
+    {
+      case 0: min_cutoff = str2float(*t); break;
+      case 1: beta = str2float(*t); break;
+      case 2: dcutoff = str2float(*t); break;
+      default: throw std::runtime_error("to many arguments"); break;
+    }
+  }
+
+  if (min_cutoff <= 0.0f || beta < 0.0f || dcutoff <= 0.0f)
+  {
+    throw std::runtime_error("oneeuro: MINCUTOFF and DCUTOFF must be positive, BETA must not be negative");
+  }
+
+  return new OneEuroAxisFilter(min_cutoff, beta, dcutoff);
+}
+
+OneEuroAxisFilter::OneEuroAxisFilter(float min_cutoff, float beta, float dcutoff) :
+  m_min_cutoff(min_cutoff),
+  m_beta(beta),
+  m_dcutoff(dcutoff),
+  m_min_cutoff_mhz(std::max(static_cast<int64_t>(1), hz2mhz(min_cutoff))),
+  m_beta_mhz(hz2mhz(beta)),
+  m_dcutoff_mhz(std::max(static_cast<int64_t>(1), hz2mhz(dcutoff))),
+  m_report_time(0),
+  m_last_report(0),
+  m_last_time(0),
+  m_nsec(0),
+  m_initialized(false),
+  m_value(0),
+  m_velocity(0),
+  m_output(0)
+{
+}
+
+void
+OneEuroAxisFilter::reset()
+{
+  m_last_report = 0;
+  m_last_time = 0;
+  m_nsec = 0;
+  m_initialized = false;
+  m_value = 0;
+  m_velocity = 0;
+}
+
+void
+OneEuroAxisFilter::update(int64_t nsec_delta)
+{
+  m_nsec += nsec_delta;
+}
+
+void
+OneEuroAxisFilter::set_report_time(int64_t nsec)
+{
+  m_report_time = nsec;
+}
+
+int64_t
+OneEuroAxisFilter::alpha(int64_t nsec, int64_t cutoff_mhz)
+{
+  // alpha = x / (x + 1) with x = 2 * pi * cutoff * dt
+  int64_t x = (nsec * cutoff_mhz / 1000) * kTwoPi / 1000000000;
+  return (x << 16) / (x + (1 << 16));
+}
+
+int
+OneEuroAxisFilter::filter(int value, int min, int max)
+{
+  // a new report is taken at the time it was read, a report that is
+  // send again on a timeout and devices without timestamps advance
+  // by the time that passed in the pipeline
+  int64_t time;
+  if (m_report_time && m_report_time != m_last_report)
+  {
+    time = m_report_time;
+    m_last_report = m_report_time;
+  }
+  else
+  {
+    time = m_last_time + m_nsec;
+  }
+  m_nsec = 0;
+
+  if (m_initialized && time == m_last_time)
+  {
+    return m_output;
+  }
+
+  int64_t nsec = time - m_last_time;
+  m_last_time = time;
+
+  const int64_t x = static_cast<int64_t>(value - min) << 16;
+
+  if (!m_initialized)
+  {
+    m_value = x;
+    m_velocity = 0;
+    m_initialized = true;
+  }
+  else
+  {
+    nsec = Math::clamp(kMinDelta, nsec, kMaxDelta);
+
+    // smoothed velocity, decides how much smoothing the value gets
+    const int64_t velocity = (x - m_value) * 1000000000 / nsec;
+    m_velocity += (alpha(nsec, m_dcutoff_mhz) * (velocity - m_velocity)) >> 16;
+
+    const int64_t range = std::max(1, max - min);
+    const int64_t speed = (m_velocity < 0 ? -m_velocity : m_velocity) / range; // 16.16 range per second
+    const int64_t cutoff = std::min(m_min_cutoff_mhz + ((m_beta_mhz * speed) >> 16), kMaxCutoff);
+
+    m_value += (alpha(nsec, cutoff) * (x - m_value)) >> 16;
+  }
+
+  m_output = Math::clamp(min, min + static_cast<int>((m_value + (1 << 15)) >> 16), max);
+  return m_output;
+}
+
+std::string
+OneEuroAxisFilter::str() const
+{
+  std::ostringstream out;
+  out << "oneeuro:" << m_min_cutoff << ":" << m_beta << ":" << m_dcutoff;
+  return out.str();
+}
+
+/* EOF */
@@ -0,0 +1,86 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef HEADER_XBOXDRV_AXISFILTER_ONE_EURO_AXIS_FILTER_HPP
+#define HEADER_XBOXDRV_AXISFILTER_ONE_EURO_AXIS_FILTER_HPP
+
+#include "axis_filter.hpp"
+
+/** Speed adaptive low pass filter ("1 Euro Filter", Casiez et al.
+    2012). While the stick is still or moves slowly the cutoff
+    frequency stays at \a min_cutoff and jitter gets smoothed away,
+    fast movements raise the cutoff by \a beta per full range per
+    second, so flicks pass through with little added latency.
+
+    All state is kept in 16.16 fixed point relative to the axis
+    minimum. The time between samples is taken from the report
+    timestamps, repeated reports send on timeouts and devices that
+    don't timestamp their reports advance by the pipeline time, so
+    the output settles even when no new reports arrive. */
+class OneEuroAxisFilter : public AxisFilter
+{
+public:
+  static OneEuroAxisFilter* from_string(const std::string& str);
+
+public:
+  /** \a min_cutoff and \a dcutoff are in Hz, \a beta in Hz per full
+      axis range per second */
+  OneEuroAxisFilter(float min_cutoff, float beta, float dcutoff);
+
+  void update(int64_t nsec_delta);
+  void set_report_time(int64_t nsec);
+  int filter(int value, int min, int max);
+  std::string str() const;
+
+  void reset();
+
+private:
+  /** smoothing factor in 16.16 for a sample \a nsec after the
+      previous one and a cutoff frequency of \a cutoff_mhz */
+  static int64_t alpha(int64_t nsec, int64_t cutoff_mhz);
+
+private:
+  float m_min_cutoff;
+  float m_beta;
+  float m_dcutoff;
+
+  // parameters in fixed point, cutoffs in mHz, beta in mHz per full
+  // range per second
+  int64_t m_min_cutoff_mhz;
+  int64_t m_beta_mhz;
+  int64_t m_dcutoff_mhz;
+
+  int64_t m_report_time;
+  int64_t m_last_report;
+  int64_t m_last_time; // time of the last sample
+  int64_t m_nsec;
+
+  bool m_initialized;
+  int64_t m_value;    // 16.16, relative to min
+  int64_t m_velocity; // 16.16 per second
+  int m_output;
+
+private:
+  OneEuroAxisFilter(const OneEuroAxisFilter&);
+  OneEuroAxisFilter& operator=(const OneEuroAxisFilter&);
+};
+
+#endif
+
+/* EOF */
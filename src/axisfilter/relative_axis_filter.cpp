@@ -21,6 +21,7 @@
 #include <boost/tokenizer.hpp>
 #include <sstream>
 
+#include "clock.hpp"
 #include "helper.hpp"
 
 RelativeAxisFilter*
@@ -52,9 +53,9 @@ RelativeAxisFilter::RelativeAxisFilter(int speed) :
 }
 
 void
-RelativeAxisFilter::update(int msec_delta)
+RelativeAxisFilter::update(int64_t nsec_delta)
 {
-  m_state += m_float_speed * m_value * msec_delta / 1000.0f;
+  m_state += m_float_speed * m_value * nsec2sec(nsec_delta);
   m_state = Math::clamp(-1.0f, m_state, 1.0f);
 }
 
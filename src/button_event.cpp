@@ -186,14 +186,14 @@ ButtonEvent::send(UInput& uinput, bool raw_state)
 }
 
 void
-ButtonEvent::update(UInput& uinput, int msec_delta)
+ButtonEvent::update(UInput& uinput, int64_t nsec_delta)
 {
   for(std::vector<ButtonFilterPtr>::const_iterator i = m_filters.begin(); i != m_filters.end(); ++i)
   {
-    (*i)->update(msec_delta);
+    (*i)->update(nsec_delta);
   }
 
-  m_handler->update(uinput, msec_delta);
+  m_handler->update(uinput, nsec_delta);
 
   send(uinput, m_last_raw_state);
 }
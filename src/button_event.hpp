@@ -49,7 +49,7 @@ protected:
 public:
   void init(UInput& uinput, int slot, bool extra_devices);
   void send(UInput& uinput, bool value);
-  void update(UInput& uinput, int msec_delta);
+  void update(UInput& uinput, int64_t nsec_delta);
   std::string str() const;
 
   void add_filters(const std::vector<ButtonFilterPtr>& filters);
@@ -69,7 +69,7 @@ public:
 
   virtual void init(UInput& uinput, int slot, bool extra_devices) =0;
   virtual void send(UInput& uinput, bool value) =0;
-  virtual void update(UInput& uinput, int msec_delta) =0;
+  virtual void update(UInput& uinput, int64_t nsec_delta) =0;
   virtual std::string str() const =0;
 };
 
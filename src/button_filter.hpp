@@ -20,6 +20,7 @@
 #define HEADER_XBOXDRV_BUTTON_FILTER_HPP
 
 #include <boost/shared_ptr.hpp>
+#include <stdint.h>
 #include <string>
 
 class ButtonFilter;
@@ -36,7 +37,7 @@ public:
   virtual ~ButtonFilter() {}
 
   virtual bool filter(bool value) =0;
-  virtual void update(int msec_delta) {}
+  virtual void update(int64_t nsec_delta) {}
   virtual std::string str() const = 0;
 };
 
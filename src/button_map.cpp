@@ -96,7 +96,7 @@ ButtonMap::init(UInput& uinput, int slot, bool extra_devices) const
 }
 
 void
-ButtonMap::update(UInput& uinput, int msec_delta)
+ButtonMap::update(UInput& uinput, int64_t nsec_delta)
 {
   for(int shift_code = 0; shift_code < XBOX_BTN_MAX; ++shift_code)
   {
@@ -104,7 +104,7 @@ ButtonMap::update(UInput& uinput, int msec_delta)
     {
       if (btn_map[shift_code][code])
       {
-        btn_map[shift_code][code]->update(uinput, msec_delta);
+        btn_map[shift_code][code]->update(uinput, nsec_delta);
       }
     }
   }
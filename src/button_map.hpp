@@ -40,7 +40,7 @@ public:
 
   bool send(UInput& uinput, XboxButton code, bool value) const;
   bool send(UInput& uinput, XboxButton shift_code, XboxButton code, bool value) const;
-  void update(UInput& uinput, int msec_delta);
+  void update(UInput& uinput, int64_t nsec_delta);
 
   void clear();
 };
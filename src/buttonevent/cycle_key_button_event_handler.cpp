@@ -191,7 +191,7 @@ CycleKeyButtonEventHandler::send(UInput& uinput, bool value)
 }
 
 void
-CycleKeyButtonEventHandler::update(UInput& uinput, int msec_delta)
+CycleKeyButtonEventHandler::update(UInput& uinput, int64_t nsec_delta)
 {
 }
 
@@ -19,11 +19,8 @@
 #include "exec_button_event_handler.hpp"
 
 #include <boost/tokenizer.hpp>
-#include <errno.h>
-#include <string.h>
-#include <sys/wait.h>
 
-#include "log.hpp"
+#include "launcher.hpp"
 
 ExecButtonEventHandler*
 ExecButtonEventHandler::from_string(const std::string& str)
@@ -57,32 +54,7 @@ ExecButtonEventHandler::send(UInput& uinput, bool value)
     return;
   }
 
-  pid_t tmp_pid = fork();
-  if (tmp_pid == 0)
-  {
-    // Double fork to reap the child and disown the execed process
-    pid_t pid = fork();
-
-    if (pid == 0)
-    {
-      char** argv = static_cast<char**>(malloc(sizeof(char*) * (m_args.size() + 1)));
-      for(size_t i = 0; i < m_args.size(); ++i)
-      {
-        argv[i] = strdup(m_args[i].c_str());
-      }
-      argv[m_args.size()] = NULL;
-
-      if (execvp(m_args[0].c_str(), argv) == -1)
-      {
-        log_error("exec failed: " << strerror(errno));
-        _exit(EXIT_FAILURE);
-      }
-    }
-
-    _exit(EXIT_SUCCESS);
-  }
-
-  waitpid(tmp_pid, NULL, 0);
+  Launcher::launch(m_args);
 }
 
 std::string
@@ -21,6 +21,7 @@
 #include <boost/tokenizer.hpp>
 #include <linux/input.h>
 
+#include "clock.hpp"
 #include "evdev_helper.hpp"
 #include "helper.hpp"
 #include "uinput.hpp"
@@ -114,7 +115,7 @@ KeyButtonEventHandler::send(UInput& uinput, bool value)
     }
     else
     {
-      if (m_hold_counter < m_hold_threshold)
+      if (m_hold_counter < msec2nsec(m_hold_threshold))
       {
         if (m_state)
         {
@@ -149,21 +150,21 @@ KeyButtonEventHandler::send(UInput& uinput, bool value)
 }
 
 void
-KeyButtonEventHandler::update(UInput& uinput, int msec_delta)
+KeyButtonEventHandler::update(UInput& uinput, int64_t nsec_delta)
 {
   if (m_state && m_hold_threshold)
   {
-    if (m_hold_counter < m_hold_threshold &&
-        m_hold_counter + msec_delta >= m_hold_threshold)
+    if (m_hold_counter < msec2nsec(m_hold_threshold) &&
+        m_hold_counter + nsec_delta >= msec2nsec(m_hold_threshold))
     {
       // start sending the secondary events
       m_secondary_codes.send(uinput, true);
       uinput.sync();
     }
 
-    if (m_hold_counter < m_hold_threshold)
+    if (m_hold_counter < msec2nsec(m_hold_threshold))
     {
-      m_hold_counter += msec_delta;
+      m_hold_counter += nsec_delta;
     }
   }
 }
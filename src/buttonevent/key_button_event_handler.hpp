@@ -34,7 +34,7 @@ public:
 
   void init(UInput& uinput, int slot, bool extra_devices);
   void send(UInput& uinput, bool value);
-  void update(UInput& uinput, int msec_delta);
+  void update(UInput& uinput, int64_t nsec_delta);
 
   std::string str() const;
 
@@ -43,7 +43,7 @@ private:
   UIEventSequence m_codes;
   UIEventSequence m_secondary_codes;
   int m_hold_threshold;
-  int m_hold_counter;
+  int64_t m_hold_counter;
 };
 
 #endif
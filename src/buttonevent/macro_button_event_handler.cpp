@@ -19,8 +19,15 @@
 #include "buttonevent/macro_button_event_handler.hpp"
 
 #include <boost/tokenizer.hpp>
+#include <errno.h>
 #include <fstream>
 #include <linux/input.h>
+#include <map>
+#include <sstream>
+#include <stdint.h>
+#include <string.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
 #include <vector>
 
 #include "evdev_helper.hpp"
@@ -28,12 +35,32 @@
 #include "log.hpp"
 #include "raise_exception.hpp"
 #include "uinput.hpp"
-
+
+namespace {
+
+struct OpenLoop
+{
+  int  target;
+  bool forever;
+  bool has_wait;
+};
+
+std::string event_name(const UIEvent& ev)
+{
+  switch(ev.type)
+  {
+    case EV_KEY: return key2str(ev.code);
+    case EV_REL: return rel2str(ev.code);
+    case EV_ABS: return abs2str(ev.code);
+    default:     return "unknown";
+  }
+}
+
+} // namespace
+
 MacroButtonEventHandler*
 MacroButtonEventHandler::from_string(const std::string& filename)
 {
-  std::vector<MacroEvent> events;
-
   std::ifstream in(filename.c_str());
   if (!in)
   {
@@ -41,241 +68,581 @@ MacroButtonEventHandler::from_string(const std::string& filename)
   }
   else
   {
-    std::string line;
-    while(std::getline(in, line))
-    {
-      MacroEvent ev = macro_event_from_string(line);
-      if (ev.type != MacroEvent::kNull)
-      {
-        events.push_back(ev);
-      }
-    }
-    return new MacroButtonEventHandler(events);
+    return from_stream(in, filename);
   }
 }
 
-MacroButtonEventHandler::MacroEvent
-MacroButtonEventHandler::macro_event_from_string(const std::string& str)
+MacroButtonEventHandler*
+MacroButtonEventHandler::from_stream(std::istream& in, const std::string& filename)
 {
-  boost::tokenizer<boost::char_separator<char> > tokens(str, boost::char_separator<char>(" "));
-  std::vector<std::string> args(tokens.begin(), tokens.end());
+  std::vector<AbsInfo> inits;
+  std::vector<UIEvent> events;
+  std::vector<int> code;
+  bool cancel_on_release = false;
 
-  if (args.size() >= 1)
+  // events are referenced by index from the bytecode, the same
+  // event name always maps to the same slot
+  std::map<std::string, int> event_slots;
+  std::vector<OpenLoop> loops;
+
+  std::string line;
+  int line_no = 0;
+  while(std::getline(in, line))
   {
-    if (!args[0].empty() && args[0][0] == '#')
+    line_no += 1;
+
+    boost::tokenizer<boost::char_separator<char> > tokens(line, boost::char_separator<char>(" \t"));
+    std::vector<std::string> args(tokens.begin(), tokens.end());
+
+    if (args.empty() || args[0][0] == '#')
     {
-      // ignore '#' comments
-      MacroEvent event;
-      event.type = MacroEvent::kNull;
-      return event;
+      // ignore empty lines and '#' comments
     }
     else if (args[0] == "init")
     {
       // FIXME: generalize this for EV_KEY and EV_REL
       if (args.size() < 4)
       {
-        raise_exception(std::runtime_error, "'init' requires at least three arguments: " << str);
+        raise_exception(std::runtime_error, filename << ":" << line_no
+                        << ": 'init' requires at least three arguments: " << line);
       }
       else
       {
-        MacroEvent event;
-        event.type = MacroEvent::kInitOp;
-        event.init.event = UIEvent::from_string(args[1]);
-        event.init.minimum = str2int(args[2]);
-        event.init.maximum = str2int(args[3]);
-        event.init.fuzz = 0;
-        event.init.flat = 0;
-        if (args.size() > 4) event.init.fuzz = str2int(args[4]);
-        if (args.size() > 5) event.init.flat = str2int(args[5]);
-
-        return event;
+        AbsInfo info;
+        info.event = UIEvent::from_string(args[1]);
+        info.minimum = str2int(args[2]);
+        info.maximum = str2int(args[3]);
+        info.fuzz = 0;
+        info.flat = 0;
+        if (args.size() > 4) info.fuzz = str2int(args[4]);
+        if (args.size() > 5) info.flat = str2int(args[5]);
+        inits.push_back(info);
       }
     }
     else if (args[0] == "send")
     {
       if (args.size() != 3)
       {
-        raise_exception(std::runtime_error, "'send' requires two arguments: " << str);
+        raise_exception(std::runtime_error, filename << ":" << line_no
+                        << ": 'send' requires two arguments: " << line);
       }
       else
       {
-        MacroEvent event;
-        event.type  = MacroEvent::kSendOp;
-        event.send.event = UIEvent::from_string(args[1]);
-        event.send.value = str2int(args[2]);
-        return event;
+        std::map<std::string, int>::iterator it = event_slots.find(args[1]);
+        if (it == event_slots.end())
+        {
+          events.push_back(UIEvent::from_string(args[1]));
+          it = event_slots.insert(std::make_pair(args[1], static_cast<int>(events.size() - 1))).first;
+        }
+
+        code.push_back(kOpSend);
+        code.push_back(it->second);
+        code.push_back(str2int(args[2]));
       }
     }
     else if (args[0] == "wait")
     {
       if (args.size() != 2)
       {
-        raise_exception(std::runtime_error, "'wait' requires one arguments: " << str);
+        raise_exception(std::runtime_error, filename << ":" << line_no
+                        << ": 'wait' requires one argument: " << line);
       }
       else
       {
-        MacroEvent event;
-        event.type = MacroEvent::kWaitOp;
-        event.wait.msec = str2int(args[1]);
-        return event;
+        // fractional milliseconds are allowed, i.e. 'wait 2.5'
+        float msec = str2float(args[1]);
+        if (msec < 0.0f)
+        {
+          raise_exception(std::runtime_error, filename << ":" << line_no
+                          << ": 'wait' must not be negative: " << line);
+        }
+
+        int usec = static_cast<int>(msec * 1000.0f + 0.5f);
+        if (usec > 0)
+        {
+          code.push_back(kOpWait);
+          code.push_back(usec);
+
+          if (!loops.empty())
+          {
+            loops.back().has_wait = true;
+          }
+        }
+      }
+    }
+    else if (args[0] == "repeat" || args[0] == "loop")
+    {
+      int count = 0;
+      if (args[0] == "repeat")
+      {
+        if (args.size() != 2)
+        {
+          raise_exception(std::runtime_error, filename << ":" << line_no
+                          << ": 'repeat' requires one argument: " << line);
+        }
+
+        count = str2int(args[1]);
+        if (count <= 0)
+        {
+          raise_exception(std::runtime_error, filename << ":" << line_no
+                          << ": 'repeat' count must be positive: " << line);
+        }
+      }
+      else if (args.size() != 1)
+      {
+        raise_exception(std::runtime_error, filename << ":" << line_no
+                        << ": 'loop' takes no arguments: " << line);
+      }
+
+      if (loops.size() >= static_cast<size_t>(kMaxLoopDepth))
+      {
+        raise_exception(std::runtime_error, filename << ":" << line_no
+                        << ": loops nested deeper than " << static_cast<int>(kMaxLoopDepth));
+      }
+
+      code.push_back(kOpRepeat);
+      code.push_back(count);
+
+      OpenLoop loop;
+      loop.target   = static_cast<int>(code.size());
+      loop.forever  = (count == 0);
+      loop.has_wait = false;
+      loops.push_back(loop);
+    }
+    else if (args[0] == "end")
+    {
+      if (loops.empty())
+      {
+        raise_exception(std::runtime_error, filename << ":" << line_no
+                        << ": 'end' without 'repeat' or 'loop'");
+      }
+
+      OpenLoop loop = loops.back();
+      loops.pop_back();
+
+      if (loop.forever && !loop.has_wait)
+      {
+        raise_exception(std::runtime_error, filename << ":" << line_no
+                        << ": 'loop' body requires a 'wait'");
+      }
+
+      if (!loops.empty() && loop.has_wait)
+      {
+        loops.back().has_wait = true;
       }
+
+      code.push_back(kOpEnd);
+      code.push_back(loop.target);
+    }
+    else if (args[0] == "cancel-on-release")
+    {
+      cancel_on_release = true;
     }
     else
     {
-      raise_exception(std::runtime_error, "unknown macro command: " << str);
+      raise_exception(std::runtime_error, filename << ":" << line_no
+                      << ": unknown macro command: " << line);
     }
   }
-  else
+
+  if (!loops.empty())
   {
-    // no args, aka an empty line, just ignore it
-    MacroEvent event;
-    event.type = MacroEvent::kNull;
-    return event;
+    raise_exception(std::runtime_error, filename << ": 'repeat' or 'loop' without 'end'");
   }
+
+  code.push_back(kOpHalt);
+
+  return new MacroButtonEventHandler(inits, events, code, cancel_on_release);
 }
-
-MacroButtonEventHandler::MacroButtonEventHandler(const std::vector<MacroEvent>& events) :
+
+MacroButtonEventHandler::MacroButtonEventHandler(const std::vector<AbsInfo>& inits,
+                                                 const std::vector<UIEvent>& events,
+                                                 const std::vector<int>& code,
+                                                 bool cancel_on_release) :
+  m_inits(inits),
   m_events(events),
+  m_code(code),
+  m_cancel_on_release(cancel_on_release),
+  m_uinput(),
+  m_send_callback(),
+  m_timer_fd(-1),
+  m_io_channel(),
+  m_source_id(),
   m_send_in_progress(false),
-  m_countdown(0),
-  m_event_counter()
+  m_released(false),
+  m_pc(0),
+  m_deadline(0),
+  m_loop_stack(),
+  m_loop_depth(0),
+  m_key_down(events.size(), false)
 {
 }
 
+MacroButtonEventHandler::~MacroButtonEventHandler()
+{
+  if (m_source_id)
+  {
+    g_source_remove(m_source_id);
+  }
+
+  if (m_io_channel)
+  {
+    g_io_channel_unref(m_io_channel);
+  }
+
+  if (m_timer_fd >= 0)
+  {
+    close(m_timer_fd);
+  }
+}
+
 void
 MacroButtonEventHandler::init(UInput& uinput, int slot, bool extra_devices)
 {
-  for(std::vector<MacroEvent>::iterator i = m_events.begin(); i != m_events.end(); ++i)
+  m_uinput = &uinput;
+
+  for(std::vector<AbsInfo>::iterator i = m_inits.begin(); i != m_inits.end(); ++i)
+  {
+    switch(i->event.type)
+    {
+      case EV_ABS:
+        i->event.resolve_device_id(slot, extra_devices);
+        uinput.add_abs(i->event.get_device_id(), i->event.code,
+                       i->minimum, i->maximum,
+                       i->fuzz, i->flat);
+        break;
+
+      default:
+        assert(!"not implemented");
+    }
+  }
+
+  for(std::vector<UIEvent>::iterator i = m_events.begin(); i != m_events.end(); ++i)
   {
     switch(i->type)
     {
-      case MacroEvent::kInitOp:
-        switch(i->init.event.type)
-        {
-          case EV_REL:
-            assert(!"not implemented");
-            break;
-
-          case EV_KEY:
-            assert(!"not implemented");
-            break;
-
-          case EV_ABS:
-            i->init.event.resolve_device_id(slot, extra_devices);
-            uinput.add_abs(i->init.event.get_device_id(), i->init.event.code,
-                           i->init.minimum, i->init.maximum,
-                           i->init.fuzz, i->init.flat);
-            break;
-
-          default:
-            assert(!"not implemented");
-        }
+      case EV_REL:
+        i->resolve_device_id(slot, extra_devices);
+        uinput.add_rel(i->get_device_id(), i->code);
         break;
 
-      case MacroEvent::kSendOp:
-        switch(i->send.event.type)
-        {
-          case EV_REL:
-            i->send.event.resolve_device_id(slot, extra_devices),
-            uinput.add_rel(i->send.event.get_device_id(), i->send.event.code);
-            break;
-
-          case EV_KEY:
-            i->send.event.resolve_device_id(slot, extra_devices),
-            uinput.add_key(i->send.event.get_device_id(), i->send.event.code);
-            break;
-
-          case EV_ABS:
-            i->send.event.resolve_device_id(slot, extra_devices);
-            // not doing a add_abs() here, its the users job to use a
-            // init command for that
-            break;
-
-          default:
-            assert(!"not implemented");
-            break;
-        }
+      case EV_KEY:
+        i->resolve_device_id(slot, extra_devices);
+        uinput.add_key(i->get_device_id(), i->code);
+        break;
+
+      case EV_ABS:
+        i->resolve_device_id(slot, extra_devices);
+        // not doing a add_abs() here, its the users job to use a
+        // init command for that
         break;
 
       default:
-        // nothing to do
+        assert(!"not implemented");
         break;
     }
   }
+
+  create_timer();
+}
+
+void
+MacroButtonEventHandler::create_timer()
+{
+  if (m_timer_fd < 0)
+  {
+    m_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (m_timer_fd < 0)
+    {
+      raise_exception(std::runtime_error, "timerfd_create() failed: " << strerror(errno));
+    }
+
+    m_io_channel = g_io_channel_unix_new(m_timer_fd);
+
+    // set encoding to binary
+    GError* error = NULL;
+    if (g_io_channel_set_encoding(m_io_channel, NULL, &error) != G_IO_STATUS_NORMAL)
+    {
+      log_error(error->message);
+      g_error_free(error);
+    }
+
+    g_io_channel_set_buffered(m_io_channel, false);
+
+    m_source_id = g_io_add_watch(m_io_channel, G_IO_IN,
+                                 &MacroButtonEventHandler::on_timer_wrap, this);
+  }
 }
 
 void
 MacroButtonEventHandler::send(UInput& uinput, bool value)
 {
-  if (value && !m_send_in_progress)
+  if (value)
   {
-    m_send_in_progress = true;
-    m_event_counter = 0;
-    m_countdown = 0;
+    if (!m_send_in_progress)
+    {
+      start();
+    }
+    else
+    {
+      // pressed again before a 'loop' ran out, keep it looping
+      m_released = false;
+    }
+  }
+  else if (m_send_in_progress)
+  {
+    if (m_cancel_on_release)
+    {
+      stop();
+    }
+    else
+    {
+      // let 'loop' blocks run out at their next 'end'
+      m_released = true;
+    }
   }
 }
 
 void
-MacroButtonEventHandler::update(UInput& uinput, int msec_delta)
+MacroButtonEventHandler::update(UInput& uinput, int64_t nsec_delta)
 {
-  if (m_send_in_progress)
+  // nothing to do, playback is driven by m_timer_fd
+}
+
+void
+MacroButtonEventHandler::set_send_callback(const boost::function<void (const UIEvent&, int)>& callback)
+{
+  m_send_callback = callback;
+}
+
+void
+MacroButtonEventHandler::emit(const UIEvent& ev, int value)
+{
+  if (m_send_callback)
+  {
+    m_send_callback(ev, value);
+  }
+  else
+  {
+    m_uinput->send(ev.get_device_id(), ev.type, ev.code, value);
+  }
+}
+
+void
+MacroButtonEventHandler::start()
+{
+  create_timer();
+
+  m_send_in_progress = true;
+  m_released = false;
+  m_pc = 0;
+  m_loop_depth = 0;
+  m_deadline = g_get_monotonic_time();
+
+  // events up to the first wait are send right away and go out with
+  // the sync of the current frame
+  run();
+}
+
+void
+MacroButtonEventHandler::stop()
+{
+  disarm_timer();
+  release_keys();
+  m_send_in_progress = false;
+  m_released = false;
+  m_pc = 0;
+  m_loop_depth = 0;
+}
+
+void
+MacroButtonEventHandler::run()
+{
+  const gint64 now = g_get_monotonic_time();
+
+  while(m_send_in_progress)
   {
-    m_countdown -= msec_delta;
-    if (m_countdown <= 0)
+    switch(m_code[m_pc])
     {
-      while(true)
-      {
-        switch(m_events[m_event_counter].type)
+      case kOpSend:
         {
-          case MacroEvent::kInitOp:
-            break;
-
-          case MacroEvent::kSendOp:
-            uinput.send(m_events[m_event_counter].send.event.get_device_id(),
-                        m_events[m_event_counter].send.event.type,
-                        m_events[m_event_counter].send.event.code,
-                        m_events[m_event_counter].send.value);
-            break;
-
-          case MacroEvent::kWaitOp:
-            m_countdown = m_events[m_event_counter].wait.msec;
-            if (m_countdown > 0)
-            {
-              m_event_counter += 1;
-              if (m_event_counter >= m_events.size())
-              {
-                m_send_in_progress = false;
-                m_event_counter = 0;
-                m_countdown = 0;
-                return;
-              }
-              return;
-            }
-            break;
-
-          default:
-            assert(!"never reached");
-            break;
-        }
+          const int slot = m_code[m_pc+1];
+          const int value = m_code[m_pc+2];
+          const UIEvent& ev = m_events[slot];
 
-        m_event_counter += 1;
+          emit(ev, value);
+          if (ev.type == EV_KEY)
+          {
+            m_key_down[slot] = (value != 0);
+          }
+          m_pc += 3;
+        }
+        break;
 
-        if (m_event_counter >= m_events.size())
+      case kOpWait:
+        // deadlines are absolute, a late wakeup shortens the next
+        // wait instead of shifting the whole macro
+        m_deadline += m_code[m_pc+1];
+        m_pc += 2;
+        if (m_deadline > now)
         {
-          m_send_in_progress = false;
-          m_event_counter = 0;
-          m_countdown = 0;
+          arm_timer();
           return;
         }
-      }
+        break;
+
+      case kOpRepeat:
+        m_loop_stack[m_loop_depth].count = m_code[m_pc+1];
+        m_loop_depth += 1;
+        m_pc += 2;
+        break;
+
+      case kOpEnd:
+        {
+          LoopFrame& frame = m_loop_stack[m_loop_depth-1];
+          bool again;
+          if (frame.count == 0)
+          {
+            again = !m_released;
+          }
+          else
+          {
+            frame.count -= 1;
+            again = (frame.count > 0);
+          }
+
+          if (again)
+          {
+            m_pc = m_code[m_pc+1];
+          }
+          else
+          {
+            m_loop_depth -= 1;
+            m_pc += 2;
+          }
+        }
+        break;
+
+      case kOpHalt:
+        m_send_in_progress = false;
+        m_released = false;
+        m_pc = 0;
+        m_loop_depth = 0;
+        break;
+
+      default:
+        assert(!"never reached");
+        break;
     }
   }
 }
 
+void
+MacroButtonEventHandler::arm_timer()
+{
+  struct itimerspec spec;
+  memset(&spec, 0, sizeof(spec));
+  spec.it_value.tv_sec  = m_deadline / G_USEC_PER_SEC;
+  spec.it_value.tv_nsec = (m_deadline % G_USEC_PER_SEC) * 1000;
+
+  if (timerfd_settime(m_timer_fd, TFD_TIMER_ABSTIME, &spec, NULL) < 0)
+  {
+    log_error("timerfd_settime() failed: " << strerror(errno));
+  }
+}
+
+void
+MacroButtonEventHandler::disarm_timer()
+{
+  struct itimerspec spec;
+  memset(&spec, 0, sizeof(spec));
+  timerfd_settime(m_timer_fd, 0, &spec, NULL);
+}
+
+void
+MacroButtonEventHandler::release_keys()
+{
+  for(std::vector<bool>::size_type i = 0; i < m_key_down.size(); ++i)
+  {
+    if (m_key_down[i])
+    {
+      emit(m_events[i], 0);
+      m_key_down[i] = false;
+    }
+  }
+}
+
+gboolean
+MacroButtonEventHandler::on_timer(GIOChannel* source, GIOCondition condition)
+{
+  uint64_t expirations;
+  if (read(m_timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+  {
+    // spurious wakeup, timer was disarmed or rearmed in the meantime
+    return TRUE;
+  }
+
+  if (m_send_in_progress)
+  {
+    run();
+    if (m_uinput)
+    {
+      m_uinput->sync();
+    }
+  }
+
+  return TRUE;
+}
+
 std::string
 MacroButtonEventHandler::str() const
 {
   return "macro";
 }
-
+
+std::string
+MacroButtonEventHandler::dump_code() const
+{
+  std::ostringstream out;
+  std::vector<int>::size_type pc = 0;
+  while (pc < m_code.size())
+  {
+    out << pc << ": ";
+    switch(m_code[pc])
+    {
+      case kOpSend:
+        out << "send " << event_name(m_events[m_code[pc+1]]) << " " << m_code[pc+2];
+        pc += 3;
+        break;
+
+      case kOpWait:
+        out << "wait " << m_code[pc+1];
+        pc += 2;
+        break;
+
+      case kOpRepeat:
+        out << "repeat " << m_code[pc+1];
+        pc += 2;
+        break;
+
+      case kOpEnd:
+        out << "end " << m_code[pc+1];
+        pc += 2;
+        break;
+
+      case kOpHalt:
+        out << "halt";
+        pc += 1;
+        break;
+
+      default:
+        out << "??? " << m_code[pc];
+        pc += 1;
+        break;
+    }
+    out << '\n';
+  }
+  return out.str();
+}
+
 /* EOF */
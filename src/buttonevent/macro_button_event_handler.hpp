@@ -19,11 +19,20 @@
 #ifndef HEADER_XBOXDRV_BUTTONEVENT_MACRO_BUTTON_EVENT_HANDLER_HPP
 #define HEADER_XBOXDRV_BUTTONEVENT_MACRO_BUTTON_EVENT_HANDLER_HPP
 
+#include <boost/function.hpp>
+#include <glib.h>
+#include <iosfwd>
+
 #include "button_event.hpp"
 
+/** Plays back a macro file. The file is compiled into a flat
+    bytecode program on load, playback is driven by a timerfd armed
+    to absolute CLOCK_MONOTONIC deadlines, so waits neither depend on
+    the controller timeout nor accumulate drift. Every handler owns
+    its own timer and preallocated playback state, so any number of
+    macros can run concurrently without allocating while they play. */
 class MacroButtonEventHandler : public ButtonEventHandler
 {
-public:
 private:
   struct AbsInfo {
     UIEvent event;
@@ -33,45 +42,98 @@ private:
     int flat;
   };
 
-  struct Event {
-    UIEvent event;
-    int     value;
-  };
-
-  struct Time {
-    int msec;
-  };
+  /** Instruction layout in m_code, operands follow the opcode:
 
-  struct MacroEvent {
-    enum { kInitOp, kSendOp, kWaitOp, kNull } type;
+      kOpSend   EVENT VALUE  - send m_events[EVENT] with VALUE
+      kOpWait   USEC         - advance the deadline by USEC
+      kOpRepeat COUNT        - open a loop, COUNT == 0 loops until release
+      kOpEnd    TARGET       - close a loop, jump back to TARGET
+      kOpHalt                - end of program */
+  enum Opcode { kOpSend, kOpWait, kOpRepeat, kOpEnd, kOpHalt };
 
-    union {
-      AbsInfo init;
-      Event send;
-      Time wait;
-    };
+  struct LoopFrame {
+    int count;
   };
 
+  enum { kMaxLoopDepth = 8 };
+
 public:
   static MacroButtonEventHandler* from_string(const std::string& filename);
 
+  /** compile the macro read from \a in, \a filename is only used in
+      error messages */
+  static MacroButtonEventHandler* from_stream(std::istream& in, const std::string& filename);
+
 public:
-  MacroButtonEventHandler(const std::vector<MacroEvent>& events);
+  MacroButtonEventHandler(const std::vector<AbsInfo>& inits,
+                          const std::vector<UIEvent>& events,
+                          const std::vector<int>& code,
+                          bool cancel_on_release);
+  ~MacroButtonEventHandler();
 
   void init(UInput& uinput, int slot, bool extra_devices);
   void send(UInput& uinput, bool value);
-  void update(UInput& uinput, int msec_delta);
+  void update(UInput& uinput, int64_t nsec_delta);
 
   std::string str() const;
 
+  /** send events to \a callback instead of the UInput passed to
+      init(), used by the tests */
+  void set_send_callback(const boost::function<void (const UIEvent&, int)>& callback);
+
+  bool is_playing() const { return m_send_in_progress; }
+
+  /** the compiled program, one instruction per line */
+  std::string dump_code() const;
+
 private:
-  static MacroEvent macro_event_from_string(const std::string& str);
+  void create_timer();
+  void emit(const UIEvent& ev, int value);
+
+  void start();
+  void stop();
+
+  /** execute instructions until the next deadline lies in the future
+      or the program halts */
+  void run();
+  void arm_timer();
+  void disarm_timer();
+
+  /** release every key the macro pressed but didn't release */
+  void release_keys();
+
+  gboolean on_timer(GIOChannel* source, GIOCondition condition);
+  static gboolean on_timer_wrap(GIOChannel* source,
+                                GIOCondition condition,
+                                gpointer userdata)
+  {
+    return static_cast<MacroButtonEventHandler*>(userdata)->on_timer(source, condition);
+  }
 
 private:
-  std::vector<MacroEvent> m_events;
+  std::vector<AbsInfo> m_inits;
+  std::vector<UIEvent> m_events;
+  std::vector<int> m_code;
+  bool m_cancel_on_release;
+
+  UInput* m_uinput;
+  boost::function<void (const UIEvent&, int)> m_send_callback;
+  int m_timer_fd;
+  GIOChannel* m_io_channel;
+  guint m_source_id;
+
+  // playback state
   bool m_send_in_progress;
-  int m_countdown;
-  std::vector<MacroEvent>::size_type m_event_counter;
+  bool m_released;
+  std::vector<int>::size_type m_pc;
+  gint64 m_deadline;
+  LoopFrame m_loop_stack[kMaxLoopDepth];
+  int m_loop_depth;
+  std::vector<bool> m_key_down;
+
+private:
+  MacroButtonEventHandler(const MacroButtonEventHandler&);
+  MacroButtonEventHandler& operator=(const MacroButtonEventHandler&);
 };
 
 #endif
@@ -58,7 +58,8 @@ RelButtonEventHandler::RelButtonEventHandler(const UIEvent& code) :
   m_code(code),
   m_value(3),
   m_repeat(100),
-  m_rel_emitter()
+  m_rel_emitter(),
+  m_repeat_handle(-1)
 {
 }
 
@@ -67,6 +68,11 @@ RelButtonEventHandler::init(UInput& uinput, int slot, bool extra_devices)
 {
   m_code.resolve_device_id(slot, extra_devices);
   m_rel_emitter = uinput.add_rel(m_code.get_device_id(), m_code.code);
+
+  if (m_repeat != -1)
+  {
+    m_repeat_handle = uinput.add_rel_repetitive(m_code.get_device_id(), m_code.code);
+  }
 }
 
 void
@@ -83,11 +89,11 @@ RelButtonEventHandler::send(UInput& uinput, bool value)
   {
     if (value)
     {
-      uinput.send_rel_repetitive(m_code, m_value, m_repeat);
+      uinput.send_rel_repetitive(m_repeat_handle, m_value, m_repeat);
     }
     else
     {
-      uinput.send_rel_repetitive(m_code, m_value, -1);
+      uinput.send_rel_repetitive(m_repeat_handle, m_value, -1);
     }
   }
 }
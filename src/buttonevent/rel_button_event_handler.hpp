@@ -33,7 +33,7 @@ public:
 
   void init(UInput& uinput, int slot, bool extra_devices);
   void send(UInput& uinput, bool value);
-  void update(UInput& uinput, int msec_delta) {}
+  void update(UInput& uinput, int64_t nsec_delta) {}
 
   std::string str() const;
 
@@ -44,6 +44,9 @@ private:
   int  m_repeat;
 
   UIEventEmitterPtr m_rel_emitter;
+
+  /** from UInput::add_rel_repetitive(), -1 without repeat */
+  int m_repeat_handle;
 };
 
 #endif
@@ -21,6 +21,7 @@
 #include <boost/tokenizer.hpp>
 #include <sstream>
 
+#include "clock.hpp"
 #include "helper.hpp"
 
 AutofireButtonFilter*
@@ -55,13 +56,13 @@ AutofireButtonFilter::AutofireButtonFilter(int rate, int delay) :
 }
 
 void
-AutofireButtonFilter::update(int msec_delta)
+AutofireButtonFilter::update(int64_t nsec_delta)
 {
   if (m_state)
   {
-    m_counter += msec_delta;
+    m_counter += nsec_delta;
 
-    if (m_counter > m_delay)
+    if (m_counter > msec2nsec(m_delay))
     {
       m_autofire = true;
     }
@@ -83,9 +84,16 @@ AutofireButtonFilter::filter(bool value)
   { // auto fire
     if (m_autofire)
     {
-      if (m_counter > m_rate)
+      const int64_t rate = msec2nsec(m_rate);
+      if (m_counter > rate)
       {
-        m_counter = 0;
+        // keep the remainder so the rate doesn't drift, but don't
+        // try to catch up on shots that were missed completely
+        m_counter -= rate;
+        if (m_counter > rate)
+        {
+          m_counter = 0;
+        }
         return true;
       }
       else
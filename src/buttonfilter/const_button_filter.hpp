@@ -29,10 +29,12 @@ public:
 public:
   ConstButtonFilter(bool value);
 
-  void update(int msec_delta) {}
+  void update(int64_t nsec_delta) {}
   bool filter(bool value);
   std::string str() const;
 
+  bool get_value() const { return m_value; }
+
 private:
   bool m_value;
 
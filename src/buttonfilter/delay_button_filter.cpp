@@ -20,6 +20,7 @@
 
 #include <sstream>
 
+#include "clock.hpp"
 #include "helper.hpp"
 
 DelayButtonFilter*
@@ -39,7 +40,7 @@ DelayButtonFilter::filter(bool value)
 {
   if (value)
   {
-    if (m_time < m_delay)
+    if (m_time < msec2nsec(m_delay))
     {
       return false;
     }
@@ -56,9 +57,9 @@ DelayButtonFilter::filter(bool value)
 }
 
 void
-DelayButtonFilter::update(int msec_delta)
+DelayButtonFilter::update(int64_t nsec_delta)
 {
-  m_time += msec_delta;
+  m_time += nsec_delta;
 }
 
 std::string
@@ -33,13 +33,13 @@ public:
   DelayButtonFilter(int delay);
 
   bool filter(bool value);
-  void update(int msec_delta);
+  void update(int64_t nsec_delta);
 
   std::string str() const;
 
 private:
   int m_delay;
-  int m_time;
+  int64_t m_time;
 };
 
 #endif
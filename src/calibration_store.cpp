@@ -0,0 +1,278 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "calibration_store.hpp"
+
+#include <boost/tokenizer.hpp>
+#include <ctype.h>
+#include <errno.h>
+#include <fstream>
+#include <stdexcept>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <utility>
+#include <vector>
+
+#include "axisfilter/calibration_axis_filter.hpp"
+#include "controller.hpp"
+#include "controller_config.hpp"
+#include "controller_slot_config.hpp"
+#include "helper.hpp"
+#include "log.hpp"
+#include "modifier/axismap_modifier.hpp"
+#include "path.hpp"
+
+namespace {
+
+typedef boost::shared_ptr<CalibrationAxisFilter> CalibrationAxisFilterPtr;
+typedef std::vector<std::pair<XboxAxis, CalibrationAxisFilterPtr> > Filters;
+
+/** all calibration filters in learning mode */
+Filters find_filters(const ControllerSlotConfig& config)
+{
+  Filters filters;
+
+  for(int n = 0; n < config.config_count(); ++n)
+  {
+    std::vector<ModifierPtr>& modifier = config.get_config(n)->get_modifier();
+    for(std::vector<ModifierPtr>::iterator i = modifier.begin(); i != modifier.end(); ++i)
+    {
+      boost::shared_ptr<AxismapModifier> axismap = boost::dynamic_pointer_cast<AxismapModifier>(*i);
+      if (axismap)
+      {
+        for(std::vector<AxisMapping>::iterator j = axismap->m_axismap.begin(); j != axismap->m_axismap.end(); ++j)
+        {
+          for(std::vector<AxisFilterPtr>::iterator k = j->filters.begin(); k != j->filters.end(); ++k)
+          {
+            CalibrationAxisFilterPtr filter = boost::dynamic_pointer_cast<CalibrationAxisFilter>(*k);
+            if (filter && filter->is_learning())
+            {
+              filters.push_back(std::make_pair(j->lhs, filter));
+            }
+          }
+        }
+      }
+    }
+  }
+
+  return filters;
+}
+
+/** mkdir -p */
+bool make_directories(const std::string& directory)
+{
+  for(std::string::size_type i = 1; i <= directory.size(); ++i)
+  {
+    if (i == directory.size() || directory[i] == '/')
+    {
+      std::string dir = directory.substr(0, i);
+      if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+      {
+        log_error(dir << ": couldn't create directory: " << strerror(errno));
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+std::string
+CalibrationStore::default_directory()
+{
+  const char* state_home = getenv("XDG_STATE_HOME");
+  if (state_home && *state_home)
+  {
+    return path::join(state_home, "xboxdrv/calibration");
+  }
+  else
+  {
+    const char* home = getenv("HOME");
+    return path::join(home ? home : "/", ".local/state/xboxdrv/calibration");
+  }
+}
+
+std::string
+CalibrationStore::device_key(const Controller& controller)
+{
+  std::string key = controller.get_usbid();
+  for(std::string::iterator i = key.begin(); i != key.end(); ++i)
+  {
+    if (*i == ':')
+    {
+      *i = '-';
+    }
+  }
+
+  // the serial ends up in a filename
+  std::string serial = controller.get_serial();
+  if (!serial.empty())
+  {
+    key += "-";
+    for(std::string::const_iterator i = serial.begin(); i != serial.end(); ++i)
+    {
+      key += isalnum(static_cast<unsigned char>(*i)) ? *i : '_';
+    }
+  }
+
+  return key;
+}
+
+CalibrationStore::CalibrationStore(const std::string& directory) :
+  m_directory(directory.empty() ? default_directory() : directory)
+{
+}
+
+std::string
+CalibrationStore::get_filename(const std::string& key) const
+{
+  return path::join(m_directory, key + ".ini");
+}
+
+void
+CalibrationStore::load(const std::string& key, const ControllerSlotConfig& config) const
+{
+  Filters filters = find_filters(config);
+  if (filters.empty())
+  {
+    return;
+  }
+
+  for(Filters::iterator i = filters.begin(); i != filters.end(); ++i)
+  {
+    i->second->reset();
+  }
+
+  const std::string filename = get_filename(key);
+  std::ifstream in(filename.c_str());
+  if (!in)
+  {
+    log_info(filename << ": no stored calibration, learning from scratch");
+    return;
+  }
+
+  std::string line;
+  while(std::getline(in, line))
+  {
+    if (line.empty() || line[0] == '#' || line[0] == '[')
+    {
+      continue;
+    }
+
+    std::string::size_type eq = line.find('=');
+    if (eq == std::string::npos)
+    {
+      log_warn(filename << ": ignoring line: " << line);
+      continue;
+    }
+
+    typedef boost::tokenizer<boost::char_separator<char> > tokenizer;
+    std::string value = line.substr(eq + 1);
+    tokenizer tokens(value, boost::char_separator<char>(":", "", boost::keep_empty_tokens));
+    std::vector<std::string> args(tokens.begin(), tokens.end());
+
+    try
+    {
+      XboxAxis axis = string2axis(line.substr(0, eq));
+      if (args.size() != 3)
+      {
+        throw std::runtime_error("expected MIN:CENTER:MAX");
+      }
+
+      for(Filters::iterator i = filters.begin(); i != filters.end(); ++i)
+      {
+        if (i->first == axis)
+        {
+          i->second->set_calibration(str2int(args[0]), str2int(args[1]), str2int(args[2]));
+        }
+      }
+    }
+    catch(const std::exception& err)
+    {
+      log_warn(filename << ": ignoring line: " << line << ": " << err.what());
+    }
+  }
+
+  log_info(filename << ": loaded calibration");
+}
+
+void
+CalibrationStore::save(const std::string& key, const ControllerSlotConfig& config) const
+{
+  Filters filters = find_filters(config);
+
+  // an axis can appear in multiple configs, the first one that
+  // learned something wins
+  std::vector<std::pair<XboxAxis, CalibrationAxisFilterPtr> > axes;
+  for(Filters::iterator i = filters.begin(); i != filters.end(); ++i)
+  {
+    bool found = false;
+    for(Filters::iterator j = axes.begin(); j != axes.end(); ++j)
+    {
+      found = found || (j->first == i->first);
+    }
+
+    if (!found && i->second->is_calibrated())
+    {
+      axes.push_back(*i);
+    }
+  }
+
+  if (axes.empty() || !make_directories(m_directory))
+  {
+    return;
+  }
+
+  // write to a temporary file first, so a crash doesn't leave a
+  // truncated profile behind
+  const std::string filename = get_filename(key);
+  const std::string tmpname = filename + ".tmp";
+  {
+    std::ofstream out(tmpname.c_str());
+    out << "# calibration learned by xboxdrv for " << key << "\n"
+        << "[calibration]\n";
+    for(Filters::iterator i = axes.begin(); i != axes.end(); ++i)
+    {
+      out << axis2string(i->first) << "="
+          << i->second->get_min() << ":"
+          << i->second->get_center() << ":"
+          << i->second->get_max() << "\n";
+    }
+
+    out.close();
+    if (!out)
+    {
+      log_error(tmpname << ": couldn't write calibration: " << strerror(errno));
+      return;
+    }
+  }
+
+  if (rename(tmpname.c_str(), filename.c_str()) != 0)
+  {
+    log_error(filename << ": couldn't write calibration: " << strerror(errno));
+  }
+  else
+  {
+    log_info(filename << ": saved calibration");
+  }
+}
+
+/* EOF */
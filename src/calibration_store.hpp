@@ -0,0 +1,59 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_XBOXDRV_CALIBRATION_STORE_HPP
+#define HEADER_XBOXDRV_CALIBRATION_STORE_HPP
+
+#include <string>
+
+class Controller;
+class ControllerSlotConfig;
+
+/** Keeps the results of calibration=learn per device. Each device
+    gets a file in INI format in the store directory, which can also
+    be passed to --config. */
+class CalibrationStore
+{
+public:
+  /** $XDG_STATE_HOME/xboxdrv/calibration or
+      ~/.local/state/xboxdrv/calibration */
+  static std::string default_directory();
+
+  /** VENDOR-PRODUCT-SERIAL, serial is left out if the device has none */
+  static std::string device_key(const Controller& controller);
+
+public:
+  CalibrationStore(const std::string& directory);
+
+  /** hand the stored calibration of the device \a key to the learning
+      filters in \a config, the others start learning from scratch */
+  void load(const std::string& key, const ControllerSlotConfig& config) const;
+
+  /** store what the learning filters in \a config found out, does
+      nothing if there are no such filters */
+  void save(const std::string& key, const ControllerSlotConfig& config) const;
+
+  std::string get_filename(const std::string& key) const;
+
+private:
+  std::string m_directory;
+};
+
+#endif
+
+/* EOF */
@@ -19,11 +19,13 @@
 #include "chatpad.hpp"
 
 #include <algorithm>
+#include <boost/bind.hpp>
 
 #include "helper.hpp"
 #include "linux_uinput.hpp"
 #include "raise_exception.hpp"
 #include "usb_helper.hpp"
+#include "usb_read_queue.hpp"
 
 struct USBControlMsg
 {
@@ -44,16 +46,22 @@ struct USBControlMsg
   bInterfaceProtocol      2
 */
 Chatpad::Chatpad(libusb_device_handle* handle, uint16_t bcdDevice,
-                 bool no_init, bool debug) :
+                 bool no_init, bool debug, int read_queue_depth) :
   m_init_state(kStateInit1),
+  m_retries(0),
+  m_timeout_id(0),
   m_handle(handle),
   m_bcdDevice(bcdDevice),
   m_no_init(no_init),
   m_debug(debug),
-  m_quit_thread(false),
   m_uinput(),
   m_led_state(0),
-  m_read_transfer(0)
+  m_led_device_state(0),
+  m_led_pending(0),
+  m_led_pending_state(false),
+  m_led_retries(0),
+  m_read_queue(),
+  m_transfers()
 {
   if (m_bcdDevice != 0x0110 && m_bcdDevice != 0x0114)
   {
@@ -115,29 +123,46 @@ Chatpad::Chatpad(libusb_device_handle* handle, uint16_t bcdDevice,
 
   init_uinput();
 
+  m_read_queue.reset(new USBReadQueue(m_handle, (m_bcdDevice == 0x0110) ? 6 : 4, 32,
+                                      read_queue_depth,
+                                      boost::bind(&Chatpad::on_read_data, this, _1, _2, _3)));
+
   if (no_init)
   {
-    m_init_state = kStateKeepAlive_1e;
+    enter_state(kStateKeepAlive_1f, kKeepAliveInterval);
   }
+  else
+  {
+    enter_state(kStateInit1, 0);
+  }
+}
 
-  send_command();
+Chatpad::~Chatpad()
+{
+  stop();
 
-  if (m_bcdDevice == 0x0110)
+  if (m_timeout_id)
   {
-    usb_submit_read(6, 32);
+    g_source_remove(m_timeout_id);
   }
-  else if (m_bcdDevice == 0x0114)
+
+  // cancels the read transfers and waits for them
+  m_read_queue.reset();
+
+  // cancel all control transfers
+  for(std::set<libusb_transfer*>::iterator it = m_transfers.begin(); it != m_transfers.end(); ++it)
   {
-    usb_submit_read(4, 32);
+    libusb_cancel_transfer(*it);
   }
-}
 
-Chatpad::~Chatpad()
-{
-  if (m_read_transfer)
+  // wait for cancel to succeed
+  while (!m_transfers.empty())
   {
-    libusb_cancel_transfer(m_read_transfer);
-    libusb_free_transfer(m_read_transfer);
+    int ret = libusb_handle_events(NULL);
+    if (ret != 0)
+    {
+      log_error("libusb_handle_events() failure: " << ret);
+    }
   }
 }
 
@@ -163,41 +188,22 @@ Chatpad::init_uinput()
   m_uinput->finish();
 }
 
-void
-Chatpad::usb_submit_read(int endpoint, int len)
-{
-  assert(!m_read_transfer);
-
-  m_read_transfer = libusb_alloc_transfer(0);
-
-  uint8_t* data = static_cast<uint8_t*>(malloc(sizeof(uint8_t) * len));
-  m_read_transfer->flags |= LIBUSB_TRANSFER_FREE_BUFFER;
-  libusb_fill_interrupt_transfer(m_read_transfer, m_handle,
-                                 endpoint | LIBUSB_ENDPOINT_IN,
-                                 data, len,
-                                 &Chatpad::on_read_data_wrap, this,
-                                 0); // timeout
-  int ret;
-  ret = libusb_submit_transfer(m_read_transfer);
-  if (ret != LIBUSB_SUCCESS)
-  {
-    raise_exception(std::runtime_error, "libusb_submit_transfer(): " << usb_strerror(ret));
-  }
-}
-
-void
-Chatpad::on_read_data(libusb_transfer* transfer)
+bool
+Chatpad::on_read_data(libusb_transfer* transfer, uint32_t seq, int64_t nsec)
 {
   assert(transfer);
 
   if (transfer->status != LIBUSB_TRANSFER_COMPLETED)
   {
     log_error("usb transfer failed: " << usb_transfer_strerror(transfer->status));
+    return false;
   }
   else
   {
-    //log_tmp("chatpad data: " << usb_transfer_strerror(transfer->status) << " "
-    //        << raw2str(transfer->buffer, transfer->actual_length));
+    if (m_debug)
+    {
+      log_debug("chatpad data: " << raw2str(transfer->buffer, transfer->actual_length));
+    }
 
     if (transfer->actual_length == 5 && transfer->buffer[0] == 0x00)
     {
@@ -206,192 +212,260 @@ Chatpad::on_read_data(libusb_transfer* transfer)
       process(msg);
     }
 
-    int ret;
-    ret = libusb_submit_transfer(transfer);
-    if (ret != LIBUSB_SUCCESS)
-    {
-      log_error("failed to resubmit USB transfer: " << usb_strerror(ret));
-      libusb_free_transfer(transfer);
-    }
+    return true;
   }
 }
 
 void
-Chatpad::send_timeout(int msec)
+Chatpad::enter_state(State state, int delay)
 {
-  // FIMXE: must keep track of sources and destroy them in ~Chatpad()
-  //assert(m_timeout_id == -1);
-  //m_timeout_id =
-  g_timeout_add(1000, &Chatpad::on_timeout_wrap, this);
+  m_init_state = state;
+  m_retries = 0;
+  schedule(delay);
 }
 
 void
-Chatpad::send_command()
+Chatpad::stop()
 {
-  //log_tmp("send_command: " << m_init_state);
-
-  // default init code for m_bcdDevice == 0x0110
-  uint8_t code[2] = { 0x01, 0x02 };
+  m_init_state = kStateStopped;
 
-  if (m_bcdDevice == 0x0114)
-  {
-    code[0] = 0x09;
-    code[1] = 0x00;
-  }
+  // finish_ctrl() drops the result of a LED request still in flight,
+  // so it has to be forgotten here or sync_leds() would wait on it
+  // forever
+  m_led_pending = 0;
+  m_led_retries = 0;
+}
 
+void
+Chatpad::next_state()
+{
   switch(m_init_state)
   {
     case kStateInit1:
-      send_ctrl(0x40, 0xa9, 0xa30c, 0x4423, NULL, 0,
-                &Chatpad::on_control_wrap, this);
-      break;
-
     case kStateInit2:
-      send_ctrl(0x40, 0xa9, 0x2344, 0x7f03, NULL, 0,
-                &Chatpad::on_control_wrap, this);
-      break;
-
     case kStateInit3:
-      send_ctrl(0x40, 0xa9, 0x5839, 0x6832, NULL, 0,
-                &Chatpad::on_control_wrap, this);
-      break;
-
     case kStateInit4:
-      send_ctrl(0xc0, 0xa1, 0x0000, 0xe416, code, 2,
-                &Chatpad::on_control_wrap, this);
-      break;
-
     case kStateInit5:
-      send_ctrl(0x40, 0xa1, 0x0000, 0xe416, code, 2,
-                &Chatpad::on_control_wrap, this);
+      enter_state(static_cast<State>(m_init_state + 1), 0);
       break;
 
     case kStateInit6:
-      send_ctrl(0xc0, 0xa1, 0x0000, 0xe416, code, 2,
-                &Chatpad::on_control_wrap, this);
-      break;
-
-    case kStateInit_1e:
-      send_timeout(1000);
+      enter_state(kStateInit_1f, kKeepAliveInterval);
       break;
 
     case kStateInit_1f:
-      send_timeout(1000);
+      enter_state(kStateInit_1e, kKeepAliveInterval);
       break;
 
-    case kStateInit_1b:
-      send_ctrl(0x41, 0x0, 0x1b, 0x02, NULL, 0,
-                &Chatpad::on_control_wrap, this);
+    case kStateInit_1e:
+      // can't send 1b before 1f before one rotation
+      enter_state(kStateInit_1b, 0);
       break;
 
+    case kStateInit_1b:
     case kStateKeepAlive_1e:
-      send_timeout(1000);
+      enter_state(kStateKeepAlive_1f, kKeepAliveInterval);
       break;
 
     case kStateKeepAlive_1f:
-      send_timeout(1000);
+      enter_state(kStateKeepAlive_1e, kKeepAliveInterval);
       break;
 
-    default:
-      assert(!"unknown state");
+    case kStateStopped:
       break;
   }
 }
 
 void
-Chatpad::on_control(libusb_transfer* transfer)
+Chatpad::schedule(int delay)
 {
-  //log_tmp(m_init_state << " " << usb_transfer_strerror(transfer->status) << " len: " << transfer->actual_length);
-  if (transfer->actual_length != 0)
+  assert(m_timeout_id == 0);
+
+  if (delay == 0)
   {
-    //log_tmp(" PAYLOAD: " << raw2str(transfer->buffer, transfer->actual_length));
+    send_command();
   }
+  else
+  {
+    m_timeout_id = g_timeout_add(delay, &Chatpad::on_timeout_wrap, this);
+  }
+}
 
+bool
+Chatpad::on_timeout()
+{
+  m_timeout_id = 0;
+  send_command();
+  return false;
+}
+
+void
+Chatpad::send_command()
+{
+  if (m_debug)
+  {
+    log_debug("send_command: " << m_init_state);
+  }
+
+  // default init code for m_bcdDevice == 0x0110
+  uint8_t code[2] = { 0x01, 0x02 };
+
+  if (m_bcdDevice == 0x0114)
+  {
+    code[0] = 0x09;
+    code[1] = 0x00;
+  }
+
+  bool ok = true;
   switch(m_init_state)
   {
     case kStateInit1:
+      ok = send_ctrl(0x40, 0xa9, 0xa30c, 0x4423, NULL, 0, &Chatpad::on_control_wrap);
+      break;
+
     case kStateInit2:
+      ok = send_ctrl(0x40, 0xa9, 0x2344, 0x7f03, NULL, 0, &Chatpad::on_control_wrap);
+      break;
+
     case kStateInit3:
-      // fail ok
-      m_init_state = static_cast<State>(m_init_state + 1);
-      send_command();
+      ok = send_ctrl(0x40, 0xa9, 0x5839, 0x6832, NULL, 0, &Chatpad::on_control_wrap);
       break;
 
     case kStateInit4:
+      ok = send_ctrl(0xc0, 0xa1, 0x0000, 0xe416, code, 2, &Chatpad::on_control_wrap);
+      break;
+
     case kStateInit5:
+      ok = send_ctrl(0x40, 0xa1, 0x0000, 0xe416, code, 2, &Chatpad::on_control_wrap);
+      break;
+
     case kStateInit6:
-    case kStateInit_1e:
+      ok = send_ctrl(0xc0, 0xa1, 0x0000, 0xe416, code, 2, &Chatpad::on_control_wrap);
+      break;
+
     case kStateInit_1f:
-    case kStateInit_1b:
-    case kStateKeepAlive_1e:
     case kStateKeepAlive_1f:
-      if (transfer->status != LIBUSB_TRANSFER_COMPLETED)
-      {
-        log_error("stuff went wrong");
-      }
-      else
-      {
-        m_init_state = static_cast<State>(m_init_state + 1);
-        if (m_init_state == kStateLoop)
-        {
-          m_init_state = kStateKeepAlive_1e;
-        }
-        send_command();
-      }
+      ok = send_ctrl(0x41, 0x0, 0x1f, 0x02, NULL, 0, &Chatpad::on_control_wrap);
+      break;
+
+    case kStateInit_1e:
+    case kStateKeepAlive_1e:
+      ok = send_ctrl(0x41, 0x0, 0x1e, 0x02, NULL, 0, &Chatpad::on_control_wrap);
+      break;
+
+    case kStateInit_1b:
+      ok = send_ctrl(0x41, 0x0, 0x1b, 0x02, NULL, 0, &Chatpad::on_control_wrap);
       break;
 
-    default:
-      assert(!"unknown state");
+    case kStateStopped:
       break;
   }
+
+  if (!ok)
+  {
+    log_error("chatpad stopped");
+    stop();
+  }
 }
 
-bool
-Chatpad::on_timeout()
+void
+Chatpad::on_control(libusb_transfer* transfer)
 {
-  //m_timeout_id = -1;
-  switch(m_init_state)
+  if (!finish_ctrl(transfer))
   {
-    case kStateInit_1e:
-    case kStateKeepAlive_1e:
-      send_ctrl(0x41, 0x0, 0x1f, 0x02, NULL, 0,
-                &Chatpad::on_control_wrap, this);
-      return false;
+    return;
+  }
 
-    case kStateInit_1f:
-    case kStateKeepAlive_1f:
-      send_ctrl(0x41, 0x0, 0x1e, 0x02, NULL, 0,
-                &Chatpad::on_control_wrap, this);
-      return false;
+  if (m_debug)
+  {
+    log_debug(m_init_state << " " << usb_transfer_strerror(transfer->status)
+              << " len: " << transfer->actual_length);
+  }
 
-    default:
-      assert(!"invalid state");
-      break;
+  if (transfer->status == LIBUSB_TRANSFER_NO_DEVICE)
+  {
+    stop();
+  }
+  else if (transfer->status == LIBUSB_TRANSFER_COMPLETED ||
+           m_init_state == kStateInit1 ||
+           m_init_state == kStateInit2 ||
+           m_init_state == kStateInit3)
+  {
+    next_state();
+  }
+  else if (m_retries < kMaxRetries)
+  {
+    m_retries += 1;
+    log_debug("chatpad request " << m_init_state << " failed: "
+              << usb_transfer_strerror(transfer->status) << ", retry " << m_retries);
+    schedule(kRetryDelay);
+  }
+  else
+  {
+    log_warn("chatpad not responding: " << usb_transfer_strerror(transfer->status)
+             << ", reinitializing");
+    if (m_no_init)
+    {
+      enter_state(kStateKeepAlive_1f, kKeepAliveInterval);
+    }
+    else
+    {
+      enter_state(kStateInit1, kKeepAliveInterval);
+    }
   }
+
+  libusb_free_transfer(transfer);
 }
 
-void
+bool
 Chatpad::send_ctrl(uint8_t request_type, uint8_t request, uint16_t value, uint16_t index,
                    uint8_t* data_in, uint16_t length,
-                   libusb_transfer_cb_fn callback, void* userdata)
+                   libusb_transfer_cb_fn callback)
 {
   libusb_transfer* transfer = libusb_alloc_transfer(0);
   transfer->flags |= LIBUSB_TRANSFER_FREE_BUFFER;
-  transfer->flags |= LIBUSB_TRANSFER_FREE_TRANSFER;
 
   // create and fill control buffer
   uint8_t* data = static_cast<uint8_t*>(malloc(length + 8));
   libusb_fill_control_setup(data, request_type, request, value, index, length);
-  memcpy(data + 8, data_in, length);
+  if (data_in)
+  {
+    memcpy(data + 8, data_in, length);
+  }
   libusb_fill_control_transfer(transfer, m_handle, data,
-                               callback, userdata,
-                               0);
+                               callback, this,
+                               kControlTimeout);
 
   int ret;
   ret = libusb_submit_transfer(transfer);
   if (ret != LIBUSB_SUCCESS)
   {
-    raise_exception(std::runtime_error, "libusb_submit_transfer(): " << usb_strerror(ret));
+    // this runs from within libusb callbacks, so don't throw
+    log_error("libusb_submit_transfer(): " << usb_strerror(ret));
+    libusb_free_transfer(transfer);
+    return false;
+  }
+  else
+  {
+    m_transfers.insert(transfer);
+    return true;
+  }
+}
+
+bool
+Chatpad::finish_ctrl(libusb_transfer* transfer)
+{
+  m_transfers.erase(transfer);
+
+  if (m_init_state == kStateStopped ||
+      transfer->status == LIBUSB_TRANSFER_CANCELLED)
+  {
+    libusb_free_transfer(transfer);
+    return false;
+  }
+  else
+  {
+    return true;
   }
 }
 
@@ -407,50 +481,115 @@ Chatpad::set_led(unsigned int led, bool state)
   if (state)
   {
     m_led_state |= led;
-
-    if (led == CHATPAD_LED_PEOPLE)
-    {
-      send_ctrl(0x41, 0x00, 0x000b, 0x0002, NULL, 0);
-    }
-    else if (led == CHATPAD_LED_ORANGE)
-    {
-      send_ctrl(0x41, 0x00, 0x000a, 0x0002, NULL, 0);
-    }
-    else if (led == CHATPAD_LED_GREEN)
-    {
-      send_ctrl(0x41, 0x00, 0x0009, 0x0002, NULL, 0);
-    }
-    else if (led == CHATPAD_LED_SHIFT)
-    {
-      send_ctrl(0x41, 0x00, 0x0008, 0x0002, NULL, 0);
-    }
   }
   else
   {
     m_led_state &= ~led;
+  }
 
-    if (led == CHATPAD_LED_PEOPLE)
-    {
-      send_ctrl(0x41, 0x00, 0x0003, 0x0002, NULL, 0);
-    }
-    else if (led == CHATPAD_LED_ORANGE)
+  sync_leds();
+}
+
+void
+Chatpad::sync_leds()
+{
+  static const unsigned int leds[] = {
+    CHATPAD_LED_PEOPLE,
+    CHATPAD_LED_ORANGE,
+    CHATPAD_LED_GREEN,
+    CHATPAD_LED_SHIFT,
+    CHATPAD_LED_BACKLIGHT
+  };
+
+  // the on and off requests for each of the above
+  static const int led_on[]  = { 0x000b, 0x000a, 0x0009, 0x0008, -1 };
+  static const int led_off[] = { 0x0003, 0x0002, 0x0001, 0x0000, 0x0004 };
+
+  if (m_init_state == kStateStopped)
+  {
+    return;
+  }
+
+  if (m_led_pending)
+  {
+    // sync_leds() is called again once the request is done
+    return;
+  }
+
+  for(int i = 0; i < 5; ++i)
+  {
+    unsigned int led = leds[i];
+    if ((m_led_state ^ m_led_device_state) & led)
     {
-      send_ctrl(0x41, 0x00, 0x0002, 0x0002, NULL, 0);
+      bool state = m_led_state & led;
+      int value = state ? led_on[i] : led_off[i];
+
+      if (value < 0)
+      {
+        // backlight goes on automatically, so we only provide a switch to disable it
+        m_led_device_state |= led;
+      }
+      else
+      {
+        if (send_ctrl(0x41, 0x00, static_cast<uint16_t>(value), 0x0002, NULL, 0,
+                      &Chatpad::on_led_control_wrap))
+        {
+          m_led_pending = led;
+          m_led_pending_state = state;
+          return;
+        }
+        else
+        {
+          // give up on this LED
+          m_led_device_state ^= led;
+        }
+      }
     }
-    else if (led == CHATPAD_LED_GREEN)
+  }
+}
+
+void
+Chatpad::on_led_control(libusb_transfer* transfer)
+{
+  if (!finish_ctrl(transfer))
+  {
+    return;
+  }
+
+  unsigned int led = m_led_pending;
+  m_led_pending = 0;
+
+  if (transfer->status == LIBUSB_TRANSFER_NO_DEVICE)
+  {
+    // nothing left to sync with
+    m_led_device_state = m_led_state;
+  }
+  else if (transfer->status == LIBUSB_TRANSFER_COMPLETED || m_led_retries >= kMaxRetries)
+  {
+    if (transfer->status != LIBUSB_TRANSFER_COMPLETED)
     {
-      send_ctrl(0x41, 0x00, 0x0001, 0x0002, NULL, 0);
+      log_warn("chatpad LED request failed: " << usb_transfer_strerror(transfer->status));
     }
-    else if (led == CHATPAD_LED_SHIFT)
+
+    m_led_retries = 0;
+    if (m_led_pending_state)
     {
-      send_ctrl(0x41, 0x00, 0x0000, 0x0002, NULL, 0);
+      m_led_device_state |= led;
     }
-    else if (led == CHATPAD_LED_BACKLIGHT)
+    else
     {
-      // backlight goes on automatically, so we only provide a switch to disable it
-      send_ctrl(0x41, 0x00, 0x0004, 0x0002, NULL, 0);
+      m_led_device_state &= ~led;
     }
   }
+  else
+  {
+    // leaving m_led_device_state untouched makes sync_leds() resend it
+    m_led_retries += 1;
+  }
+
+  libusb_free_transfer(transfer);
+
+  sync_leds();
 }
 
 void
@@ -502,141 +641,4 @@ Chatpad::process(const ChatpadKeyMsg& msg)
   m_uinput->sync();
 }
 
-#if 0
-
-void
-Chatpad::read_thread()
-{
-  try
-  {
-    uint8_t data[5];
-    while(!m_quit_thread)
-    {
-      int len = 0;
-      int ret = libusb_interrupt_transfer(m_handle, LIBUSB_ENDPOINT_IN | 6,
-                                          data, sizeof(data), &len, 0);
-      if (ret != LIBUSB_SUCCESS)
-      {
-        raise_exception(std::runtime_error, "libusb_interrupt_transfer() failed: " << usb_strerror(ret));
-      }
-      else
-      {
-        if (g_logger.get_log_level() > Logger::kDebug)
-        {
-          log_debug("read: " << len << "/5: data: " << raw2str(data, len));
-        }
-
-        if (data[0] == 0x00)
-        {
-          struct ChatpadKeyMsg msg;
-          memcpy(&msg, data, sizeof(msg));
-          process(msg);
-        }
-      }
-    }
-  }
-  catch(const std::exception& err)
-  {
-    log_error(err.what());
-  }
-}
-
-void
-Chatpad::keep_alive_thread()
-{
-  try
-  {
-    // loop and send keep alives
-    while(!m_quit_thread)
-    {
-      send_ctrl(0x41, 0x0, 0x1f, 0x02, NULL, 0);
-      log_debug("0x1f");
-      sleep(1);
-
-      send_ctrl(0x41, 0x0, 0x1e, 0x02, NULL, 0);
-      log_debug("0x1e");
-      sleep(1);
-    }
-  }
-  catch(const std::exception& err)
-  {
-    log_error(err.what());
-  }
-}
-
-void
-Chatpad::send_init()
-{
-  if (!m_no_init)
-  {
-    int ret;
-    uint8_t buf[2];
-
-    // these three will fail, but are necessary to have the later ones succeed
-    ret = libusb_control_transfer(m_handle, 0x40, 0xa9, 0xa30c, 0x4423, NULL, 0, 0);
-    log_debug("ret: " << usb_strerror(ret));
-
-    ret = libusb_control_transfer(m_handle, 0x40, 0xa9, 0x2344, 0x7f03, NULL, 0, 0);
-    log_debug("ret: " << usb_strerror(ret));
-
-    ret = libusb_control_transfer(m_handle, 0x40, 0xa9, 0x5839, 0x6832, NULL, 0, 0);
-    log_debug("ret: " << usb_strerror(ret));
-
-    // make chatpad ready
-    ret = libusb_control_transfer(m_handle, 0xc0, 0xa1, 0x0000, 0xe416, buf, 2, 0); // (read 2 bytes, will return a mode)
-    log_debug("ret: " << usb_strerror(ret) << " " << static_cast<int>(buf[0]) << " " << static_cast<int>(buf[1]));
-
-    if (buf[1] & 2)
-    {
-      // chatpad already ready
-      // FIXME: doesn't work
-    }
-    else
-    {
-      if (m_bcdDevice == 0x0110)
-      {
-        buf[0] = 0x01;
-        buf[1] = 0x02;
-      }
-      else if (m_bcdDevice == 0x0114)
-      {
-        buf[0] = 0x09;
-        buf[1] = 0x00;
-      }
-      else
-      {
-        assert(!"never reached");
-      }
-
-      ret = libusb_control_transfer(m_handle, 0x40, 0xa1, 0x0000, 0xe416, buf, 2, 0); // (send 2 bytes, data must be 0x09 0x00)
-      log_debug("ret: " << usb_strerror(ret));
-
-      ret = libusb_control_transfer(m_handle, 0xc0, 0xa1, 0x0000, 0xe416, buf, 2, 0); // (read 2 bytes, this should return the NEW mode)
-      log_debug("ret: " << usb_strerror(ret) << " " << static_cast<int>(buf[0]) << " " << static_cast<int>(buf[1]));
-
-      /* FIXME: not proper way to check if the chatpad is alive
-         if (!(buf[1] & 2)) // FIXME: check for {9,0} for bcdDevice==0x114
-         {
-         throw std::runtime_error("chatpad init failure");
-         }
-      */
-      // chatpad is enabled, so start with keep alive
-    }
-  }
-
-  // only when we get "01 02" back is the chatpad ready
-  libusb_control_transfer(m_handle, 0x41, 0x0, 0x1f, 0x02, 0, 0, 0);
-  log_debug("0x1f");
-  sleep(1);
-
-  libusb_control_transfer(m_handle, 0x41, 0x0, 0x1e, 0x02, 0, 0, 0);
-  log_debug("0x1e");
-
-  // can't send 1b before 1f before one rotation
-  libusb_control_transfer(m_handle, 0x41, 0x0, 0x1b, 0x02, 0, 0, 0);
-  log_debug("0x1b");
-}
-
-#endif
-
 /* EOF */
@@ -22,8 +22,10 @@
 #include <libusb.h>
 #include <glib.h>
 #include <memory>
+#include <set>
 
 class LinuxUinput;
+class USBReadQueue;
 
 enum {
   CHATPAD_KEY_1 = 0x17,
@@ -92,25 +94,40 @@ enum {
   CHATPAD_LED_STATUS_BACKLIGHT = (1<<7)
 };
 
+/** The chatpad is initialized and kept alive with a sequence of
+    control transfers, which is run as an asynchronous state machine
+    on the main loop. Every transfer has a timeout and gets retried, a
+    chatpad that stops responding gets initialized again, so it never
+    blocks the controller it is attached to. */
 class Chatpad
 {
 private:
+  /** each state is named after the control request it sends */
   enum State {
-    kStateInit1,
+    kStateInit1, // Init1-3 fail, but are needed for the later ones to succeed
     kStateInit2,
     kStateInit3,
-    kStateInit4,
-    kStateInit5,
-    kStateInit6,
-    kStateInit_1e,
+    kStateInit4, // read the mode
+    kStateInit5, // set the mode
+    kStateInit6, // read the new mode
     kStateInit_1f,
+    kStateInit_1e,
     kStateInit_1b,
-    kStateKeepAlive_1e,
     kStateKeepAlive_1f,
-    kStateLoop
+    kStateKeepAlive_1e,
+    kStateStopped
+  };
+
+  enum {
+    kControlTimeout    = 1000, // msec
+    kKeepAliveInterval = 1000, // msec
+    kRetryDelay        = 250,  // msec
+    kMaxRetries        = 3
   };
 
   State m_init_state;
+  int m_retries;
+  guint m_timeout_id;
 
   struct ChatpadMsg
   {
@@ -151,23 +168,31 @@ private:
   bool m_no_init;
   bool m_debug;
 
-
-  bool m_quit_thread;
-  //std::auto_ptr<boost::thread> m_read_thread;
-  //std::auto_ptr<boost::thread> m_keep_alive_thread;
   std::auto_ptr<LinuxUinput> m_uinput;
   int m_keymap[256];
   bool m_state[256];
+
+  /** LED state as requested by the user */
   unsigned int m_led_state;
-  libusb_transfer* m_read_transfer;
+
+  /** LED state as last confirmed by the chatpad */
+  unsigned int m_led_device_state;
+
+  /** the LED that has a request in flight, 0 if none */
+  unsigned int m_led_pending;
+  bool m_led_pending_state;
+  int m_led_retries;
+
+  std::auto_ptr<USBReadQueue> m_read_queue;
+
+  /** control transfers currently in flight */
+  std::set<libusb_transfer*> m_transfers;
 
 public:
   Chatpad(libusb_device_handle* handle, uint16_t bcdDevice,
-          bool no_init, bool debug);
+          bool no_init, bool debug, int read_queue_depth);
   ~Chatpad();
 
-  void send_init();
-
   void set_led(unsigned int led, bool state);
   bool get_led(unsigned int led);
 
@@ -175,13 +200,26 @@ public:
   void init_uinput();
 
 private:
+  /** switch to \a state and send its request after \a delay msec */
+  void enter_state(State state, int delay);
+  void next_state();
+
+  /** give up on the chatpad, results of requests still in flight are
+      ignored from here on */
+  void stop();
+  void schedule(int delay);
   void send_command();
-  void send_timeout(int msec);
-  void send_ctrl(uint8_t request_type, uint8_t request, uint16_t value, uint16_t index,
-                 uint8_t* data_in = NULL, uint16_t length = 0,
-                 libusb_transfer_cb_fn callback = NULL, void* userdata = NULL);
 
-  void usb_submit_read(int endpoint, int len);
+  /** send the next LED change that isn't confirmed by the chatpad yet */
+  void sync_leds();
+
+  bool send_ctrl(uint8_t request_type, uint8_t request, uint16_t value, uint16_t index,
+                 uint8_t* data_in, uint16_t length,
+                 libusb_transfer_cb_fn callback);
+
+  /** free a finished control transfer, returns false when the
+      Chatpad is shutting down and the result must be ignored */
+  bool finish_ctrl(libusb_transfer* transfer);
 
 private:
   bool on_timeout();
@@ -195,12 +233,14 @@ private:
     static_cast<Chatpad*>(transfer->user_data)->on_control(transfer);
   }
 
-  void on_read_data(libusb_transfer* transfer);
-  static void on_read_data_wrap(libusb_transfer* transfer)
+  void on_led_control(libusb_transfer* transfer);
+  static void on_led_control_wrap(libusb_transfer* transfer)
   {
-    static_cast<Chatpad*>(transfer->user_data)->on_read_data(transfer);
+    static_cast<Chatpad*>(transfer->user_data)->on_led_control(transfer);
   }
 
+  bool on_read_data(libusb_transfer* transfer, uint32_t seq, int64_t nsec);
+
 private:
   Chatpad(const Chatpad&);
   Chatpad& operator=(const Chatpad&);
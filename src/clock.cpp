@@ -0,0 +1,57 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "clock.hpp"
+
+#include <time.h>
+
+namespace {
+
+MonotonicClock g_monotonic_clock;
+Clock* g_clock = &g_monotonic_clock;
+
+} // namespace
+
+int64_t
+Clock::now()
+{
+  return g_clock->get_nsec();
+}
+
+void
+Clock::set(Clock* clock)
+{
+  if (clock)
+  {
+    g_clock = clock;
+  }
+  else
+  {
+    g_clock = &g_monotonic_clock;
+  }
+}
+
+int64_t
+MonotonicClock::get_nsec() const
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+/* EOF */
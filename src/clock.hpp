@@ -0,0 +1,89 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_XBOXDRV_CLOCK_HPP
+#define HEADER_XBOXDRV_CLOCK_HPP
+
+#include <stdint.h>
+
+/** Source of monotonic time in nanoseconds. All update() functions
+    in the event pipeline receive time deltas in nanoseconds that are
+    derived from this clock, so they can be accumulated without
+    rounding errors. The clock can be replaced to run tests and
+    benchmarks faster than real time. */
+class Clock
+{
+public:
+  /** current time of the active clock */
+  static int64_t now();
+
+  /** replace the active clock, NULL restores the monotonic clock, the
+      caller keeps ownership */
+  static void set(Clock* clock);
+
+public:
+  virtual ~Clock() {}
+  virtual int64_t get_nsec() const =0;
+};
+
+/** CLOCK_MONOTONIC */
+class MonotonicClock : public Clock
+{
+public:
+  MonotonicClock() {}
+  int64_t get_nsec() const;
+};
+
+/** Clock that only advances when told to */
+class ManualClock : public Clock
+{
+public:
+  ManualClock(int64_t nsec = 0) : m_nsec(nsec) {}
+
+  int64_t get_nsec() const { return m_nsec; }
+
+  void set_nsec(int64_t nsec) { m_nsec = nsec; }
+  void advance(int64_t nsec_delta) { m_nsec += nsec_delta; }
+
+private:
+  int64_t m_nsec;
+};
+
+inline int64_t msec2nsec(int msec)
+{
+  return static_cast<int64_t>(msec) * 1000000;
+}
+
+inline int64_t usec2nsec(int64_t usec)
+{
+  return usec * 1000;
+}
+
+inline float nsec2sec(int64_t nsec)
+{
+  return static_cast<float>(nsec) / 1.0e9f;
+}
+
+inline int nsec2msec(int64_t nsec)
+{
+  return static_cast<int>(nsec / 1000000);
+}
+
+#endif
+
+/* EOF */
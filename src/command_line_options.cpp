@@ -57,6 +57,8 @@ enum {
   OPTION_RUMBLE,
   OPTION_FF_DEVICE,
   OPTION_PRIORITY,
+  OPTION_TRACE,
+  OPTION_TRACE_SIZE,
   OPTION_QUIT,
   OPTION_NO_UINPUT,
   OPTION_MIMIC_XPAD,
@@ -92,6 +94,7 @@ enum {
   OPTION_TRIGGER_AS_ZAXIS,
   OPTION_AUTOFIRE,
   OPTION_CALIBRARIOTION,
+  OPTION_CALIBRATION_DIR,
   OPTION_RELATIVE_AXIS,
   OPTION_SQUARE_AXIS,
   OPTION_FOUR_WAY_RESTRICTOR,
@@ -101,6 +104,8 @@ enum {
   OPTION_DEVICE_BY_ID,
   OPTION_DEVICE_BY_PATH,
   OPTION_GENERIC_USB_SPEC,
+  OPTION_HID_ABSMAP,
+  OPTION_HID_KEYMAP,
   OPTION_LIST_SUPPORTED_DEVICES,
   OPTION_LIST_SUPPORTED_DEVICES_XPAD,
   OPTION_LIST_CONTROLLER,
@@ -111,20 +116,28 @@ enum {
   OPTION_EVDEV_DEBUG,
   OPTION_EVDEV_ABSMAP,
   OPTION_EVDEV_KEYMAP,
+  OPTION_EVDEV_PASSTHROUGH,
+  OPTION_EVDEV_REMAP,
+  OPTION_MERGE_EVDEV,
+  OPTION_MERGE_LATENCY,
   OPTION_CHATPAD,
   OPTION_CHATPAD_NO_INIT,
   OPTION_CHATPAD_DEBUG,
   OPTION_TIMEOUT,
+  OPTION_OUTPUT_RATE,
   OPTION_HEADSET,
   OPTION_HEADSET_DUMP,
   OPTION_HEADSET_PLAY,
   OPTION_DETACH_KERNEL_DRIVER,
+  OPTION_USB_READ_DEPTH,
   OPTION_DAEMON_DETACH,
   OPTION_DAEMON_PID_FILE,
   OPTION_DAEMON_MATCH,
   OPTION_DAEMON_MATCH_GROUP,
   OPTION_DAEMON_NO_DBUS,
   OPTION_DAEMON_DBUS,
+  OPTION_DAEMON_DBUS_SIGNAL_RATE,
+  OPTION_DAEMON_RUMBLE_PATTERN,
   OPTION_HELP_DEVICES,
   OPTION_LIST_ALL,
   OPTION_LIST_ABS,
@@ -134,7 +147,9 @@ enum {
   OPTION_LIST_AXIS,
   OPTION_LIST_BUTTON,
   OPTION_DAEMON_ON_CONNECT,
-  OPTION_DAEMON_ON_DISCONNECT
+  OPTION_DAEMON_ON_DISCONNECT,
+  OPTION_DAEMON_HANDOVER_SOCKET,
+  OPTION_DAEMON_TAKEOVER
 };
 
 CommandLineParser::CommandLineParser() :
@@ -163,6 +178,8 @@ CommandLineParser::init_argp()
     .add_option(OPTION_QUIET,         0,  "quiet",   "",  "do not display startup text")
     .add_option(OPTION_USB_DEBUG,     0,  "usb-debug", "",  "enable log messages from libusb")
     .add_option(OPTION_PRIORITY,      0,  "priority", "PRI", "increases process priority (default: normal)")
+    .add_option(OPTION_TRACE,         0,  "trace", "FILE", "record pipeline timings, written to FILE as Chrome trace on SIGUSR1 and exit")
+    .add_option(OPTION_TRACE_SIZE,    0,  "trace-size", "N", "keep the last N spans per thread (default: 65536)")
     .add_newline()
 
     .add_text("List Options: ")
@@ -192,8 +209,12 @@ CommandLineParser::init_argp()
     .add_option(OPTION_DAEMON_PID_FILE, 0, "pid-file",    "FILE", "Write daemon pid to FILE")
     .add_option(OPTION_DAEMON_NO_DBUS,  0, "no-dbus",    "", "Disables D-Bus support in the daemon", false)
     .add_option(OPTION_DAEMON_DBUS,     0, "dbus",    "MODE", "Set D-Bus mode (auto, system, session, disabled)")
+    .add_option(OPTION_DAEMON_DBUS_SIGNAL_RATE, 0, "dbus-signal-rate", "HZ", "Emit slot StateChanged signals at most HZ times a second, 0 disables signals (default: 10)")
     .add_option(OPTION_DAEMON_ON_CONNECT,    0, "on-connect", "FILE", "Launch EXE when a new controller is connected")
     .add_option(OPTION_DAEMON_ON_DISCONNECT, 0, "on-disconnect", "FILE", "Launch EXE when a controller is disconnected")
+    .add_option(OPTION_DAEMON_HANDOVER_SOCKET, 0, "handover-socket", "PATH", "Hand the uinput devices to a successor connecting on PATH")
+    .add_option(OPTION_DAEMON_TAKEOVER,  0, "takeover", "", "Take over the uinput devices of the daemon listening on --handover-socket")
+    .add_option(OPTION_DAEMON_RUMBLE_PATTERN, 0, "rumble-pattern", "NAME=PATTERN", "Define a rumble pattern that can be played via D-Bus")
     .add_newline()
 
     .add_text("Device Options: ")
@@ -205,6 +226,9 @@ CommandLineParser::init_argp()
     .add_option(OPTION_TYPE,           0, "type",    "TYPE", "Ignore autodetection and enforce controller type (xbox, xbox-mat, xbox360, xbox360-wireless, xbox360-guitar)")
     .add_option(OPTION_DETACH_KERNEL_DRIVER, 'd', "detach-kernel-driver", "", "Detaches the kernel driver currently associated with the device")
     .add_option(OPTION_GENERIC_USB_SPEC, 0, "generic-usb-spec", "SPEC", "Specification for generic USB device")
+    .add_option(OPTION_HID_ABSMAP,     0, "hid-absmap", "MAP", "Map HID usages of generic USB devices to Xbox360 axis")
+    .add_option(OPTION_HID_KEYMAP,     0, "hid-keymap", "MAP", "Map HID usages of generic USB devices to Xbox360 buttons")
+    .add_option(OPTION_USB_READ_DEPTH, 0, "usb-read-depth", "N", "Keep N USB read transfers queued per endpoint (default: 2)")
     .add_newline()
 
     .add_text("Evdev Options: ")
@@ -213,6 +237,10 @@ CommandLineParser::init_argp()
     .add_option(OPTION_EVDEV_NO_GRAB,  0, "evdev-no-grab", "", "Do not grab the event device, allow other apps to receive events")
     .add_option(OPTION_EVDEV_ABSMAP,   0, "evdev-absmap", "MAP", "Map evdev key events to Xbox360 button events")
     .add_option(OPTION_EVDEV_KEYMAP,   0, "evdev-keymap", "MAP", "Map evdev abs events to Xbox360 axis events")
+    .add_option(OPTION_EVDEV_PASSTHROUGH, 0, "evdev-passthrough", "", "Forward the evdev device directly to uinput, keeping all its axes and buttons")
+    .add_option(OPTION_EVDEV_REMAP,    0, "evdev-remap", "MAP", "Remap and filter evdev events in passthrough mode")
+    .add_option(OPTION_MERGE_EVDEV,    0, "merge-evdev", "DEVICE", "Merge the evdev device into the controller, can be given multiple times")
+    .add_option(OPTION_MERGE_LATENCY,  0, "merge-latency", "MSEC", "Collect input of merged devices for up to MSEC before sending it (default: 2)")
     .add_newline()
 
     .add_text("Status Options: ")
@@ -258,6 +286,7 @@ CommandLineParser::init_argp()
     .add_text("Configuration Options:")
     .add_option(OPTION_MODIFIER,          'm', "modifier",       "MOD=ARG:..", "Add a modifier to the modifier spec")
     .add_option(OPTION_TIMEOUT,            0, "timeout",         "INT",  "Amount of time to wait fo a device event before processing autofire, etc. (default: 25)")
+    .add_option(OPTION_OUTPUT_RATE,        0, "output-rate",     "HZ",   "Rate at which relative motion is send, up to 1000, motion lags by up to one interval (default: 100)")
     .add_option(OPTION_BUTTONMAP,         'b', "buttonmap",      "MAP",   "Remap the buttons as specified by MAP (example: B=A,X=A,Y=A)")
     .add_option(OPTION_AXISMAP,           'a', "axismap",        "MAP",   "Remap the axis as specified by MAP (example: -Y1=Y1,X1=X2)")
     .add_newline()
@@ -265,7 +294,8 @@ CommandLineParser::init_argp()
     .add_text("Modifier Preset Options: ")
     .add_option(OPTION_AUTOFIRE,           0, "autofire",         "MAP",  "Cause the given buttons to act as autofire (example: A=250)")
     .add_option(OPTION_AXIS_SENSITIVITY,   0, "axis-sensitivity", "MAP",  "Adjust the axis sensitivity (example: X1=2.0,Y1=1.0)")
-    .add_option(OPTION_CALIBRARIOTION,     0, "calibration",      "MAP",  "Changes the calibration for the given axis (example: X2=-32768:0:32767)")
+    .add_option(OPTION_CALIBRARIOTION,     0, "calibration",      "MAP",  "Changes the calibration for the given axis (example: X2=-32768:0:32767 or X2=learn)")
+    .add_option(OPTION_CALIBRATION_DIR,    0, "calibration-dir",  "DIR",  "Store learned calibrations in DIR (default: ~/.local/state/xboxdrv/calibration)")
     .add_option(OPTION_DEADZONE,           0, "deadzone",         "INT",  "Threshold under which axis events are ignored (default: 0)")
     .add_option(OPTION_DEADZONE_TRIGGER,   0, "deadzone-trigger", "INT",  "Threshold under which trigger events are ignored (default: 0)")
     .add_option(OPTION_DPAD_ROTATION,      0, "dpad-rotation",    "DEGREE", "Rotate the dpad by the given DEGREE, must be a multiple of 45")
@@ -300,10 +330,12 @@ CommandLineParser::init_argp()
 
     .add_text("Axis Filter:")
     .add_pseudo("  cal, calibration MIN:CENTER:MAX", "Set the calibration values for the axis")
+    .add_pseudo("  cal, calibration learn", "Learn the calibration values of the axis while it is used")
     .add_pseudo("  sen, sensitivity:SENSITIVITY", "Set the axis sensitivity")
     .add_pseudo("  dead:VALUE, dead:MIN:CENTER:MAX", "Set the axis deadzone")
     .add_pseudo("  rel, relative:SPEED", "Turn axis into a relative-axis")
     .add_pseudo("  resp, response:VALUES:...", "Set values of the response curve")
+    .add_pseudo("  euro, oneeuro:MINCUTOFF:BETA:DCUTOFF", "Smooth jitter depending on stick speed")
     .add_pseudo("  log:STRING", "Print axis value to stdout")
     .add_newline()
 
@@ -320,6 +352,7 @@ CommandLineParser::init_argp()
     .add_pseudo("  4wayrest, four-way-restrictor=XAXIS:YAXIS", "Restrict the given stick to four directions")
     .add_pseudo("  square, square-axis=XAXIS:YAXIS", "Convert the circular motion range of the given stick to a square one")
     .add_pseudo("  rotate=XAXIS:YAXIS:DEGREE[:MIRROR]", "Rotate the given stick by DEGREE, optionally also mirror it")
+    .add_pseudo("  radial-deadzone=XAXIS:YAXIS:THRESHOLD", "Ignore stick movement closer than THRESHOLD to the center")
     .add_newline()
 
     .add_text("See README for more documentation and examples.")
@@ -353,10 +386,18 @@ CommandLineParser::init_ini(Options* opts)
     ("evdev", &opts->evdev_device)
     ("evdev-grab", &opts->evdev_grab)
     ("evdev-debug", &opts->evdev_debug)
+    ("evdev-passthrough", &opts->evdev_passthrough)
+    ("merge-evdev", boost::bind(&Options::add_merge_evdev, opts, _1))
+    ("merge-latency", boost::bind(&Options::set_merge_latency, opts, _1))
     ("config", boost::bind(&CommandLineParser::read_config_file, this, _1))
     ("alt-config", boost::bind(&CommandLineParser::read_alt_config_file, this, _1))
     ("timeout", &opts->timeout)
+    ("output-rate", boost::bind(&Options::set_output_rate, opts, _1))
+    ("usb-read-depth", boost::bind(&Options::set_usb_read_depth, opts, _1))
     ("priority", boost::bind(&Options::set_priority, opts, _1))
+    ("trace", &opts->trace_file)
+    ("trace-size", boost::bind(&Options::set_trace_size, opts, _1))
+    ("calibration-dir", &opts->calibration_dir)
     ("next", boost::bind(&Options::next_config, opts), boost::function<void ()>())
     ("next-controller", boost::bind(&Options::next_controller, opts), boost::function<void ()>())
     ("extra-devices", &opts->extra_devices)
@@ -399,11 +440,15 @@ CommandLineParser::init_ini(Options* opts)
      boost::bind(&Options::set_daemon_detach, opts, true),
      boost::bind(&Options::set_daemon_detach, opts, false))
     ("dbus", boost::bind(&Options::set_dbus_mode, opts, _1))
+    ("dbus-signal-rate", boost::bind(&Options::set_dbus_signal_rate, opts, _1))
     ("pid-file",      &opts->pid_file)
     ("on-connect",    &opts->on_connect)
     ("on-disconnect", &opts->on_disconnect)
+    ("handover-socket", &opts->handover_socket)
     ;
 
+  m_ini.section("rumble-pattern", boost::bind(&Options::add_rumble_pattern, opts, _1, _2));
+
   m_ini.section("modifier",     boost::bind(&CommandLineParser::set_modifier,     this, _1, _2));
   m_ini.section("ui-buttonmap", boost::bind(&CommandLineParser::set_ui_buttonmap, this, _1, _2));
   m_ini.section("ui-axismap",   boost::bind(&CommandLineParser::set_ui_axismap,   this, _1, _2));
@@ -447,6 +492,9 @@ CommandLineParser::init_ini(Options* opts)
 
   m_ini.section("evdev-absmap", boost::bind(&CommandLineParser::set_evdev_absmap, this, _1, _2));
   m_ini.section("evdev-keymap", boost::bind(&CommandLineParser::set_evdev_keymap, this, _1, _2));
+  m_ini.section("hid-absmap", boost::bind(&CommandLineParser::set_hid_absmap, this, _1, _2));
+  m_ini.section("hid-keymap", boost::bind(&CommandLineParser::set_hid_keymap, this, _1, _2));
+  m_ini.section("evdev-remap", boost::bind(&CommandLineParser::set_evdev_remap, this, _1, _2));
 }
 
 void
@@ -522,6 +570,14 @@ CommandLineParser::apply_opt(ArgParser::ParsedOption const& opt, Options& opts)
       opts.set_priority(opt.argument);
       break;
 
+    case OPTION_TRACE:
+      opts.trace_file = opt.argument;
+      break;
+
+    case OPTION_TRACE_SIZE:
+      opts.set_trace_size(opt.argument);
+      break;
+
     case OPTION_DAEMON:
       opts.set_daemon();
       break;
@@ -600,6 +656,10 @@ CommandLineParser::apply_opt(ArgParser::ParsedOption const& opt, Options& opts)
       opts.timeout = str2int(opt.argument);
       break;
 
+    case OPTION_OUTPUT_RATE:
+      opts.set_output_rate(opt.argument);
+      break;
+
     case OPTION_NO_UINPUT:
       opts.no_uinput = true;
       break;
@@ -776,6 +836,10 @@ CommandLineParser::apply_opt(ArgParser::ParsedOption const& opt, Options& opts)
       opts.detach_kernel_driver = true;
       break;
 
+    case OPTION_USB_READ_DEPTH:
+      opts.set_usb_read_depth(opt.argument);
+      break;
+
     case OPTION_EVDEV:
       opts.evdev_device = opt.argument;
       break;
@@ -796,6 +860,22 @@ CommandLineParser::apply_opt(ArgParser::ParsedOption const& opt, Options& opts)
       process_name_value_string(opt.argument, boost::bind(&CommandLineParser::set_evdev_keymap, this, _1, _2));
       break;
 
+    case OPTION_EVDEV_PASSTHROUGH:
+      opts.evdev_passthrough = true;
+      break;
+
+    case OPTION_EVDEV_REMAP:
+      process_name_value_string(opt.argument, boost::bind(&CommandLineParser::set_evdev_remap, this, _1, _2));
+      break;
+
+    case OPTION_MERGE_EVDEV:
+      opts.add_merge_evdev(opt.argument);
+      break;
+
+    case OPTION_MERGE_LATENCY:
+      opts.set_merge_latency(opt.argument);
+      break;
+
     case OPTION_ID:
       opts.controller_id = str2int(opt.argument);
       break;
@@ -859,6 +939,10 @@ CommandLineParser::apply_opt(ArgParser::ParsedOption const& opt, Options& opts)
       process_name_value_string(opt.argument, boost::bind(&CommandLineParser::set_calibration, this, _1, _2));
       break;
 
+    case OPTION_CALIBRATION_DIR:
+      opts.calibration_dir = opt.argument;
+      break;
+
     case OPTION_RELATIVE_AXIS:
       process_name_value_string(opt.argument, boost::bind(&CommandLineParser::set_relative_axis, this, _1, _2));
       break;
@@ -899,10 +983,26 @@ CommandLineParser::apply_opt(ArgParser::ParsedOption const& opt, Options& opts)
       opts.on_disconnect = opt.argument;
       break;
 
+    case OPTION_DAEMON_HANDOVER_SOCKET:
+      opts.handover_socket = opt.argument;
+      break;
+
+    case OPTION_DAEMON_TAKEOVER:
+      opts.takeover = true;
+      break;
+
     case OPTION_DAEMON_DBUS:
       opts.set_dbus_mode(opt.argument);
       break;
 
+    case OPTION_DAEMON_DBUS_SIGNAL_RATE:
+      opts.set_dbus_signal_rate(opt.argument);
+      break;
+
+    case OPTION_DAEMON_RUMBLE_PATTERN:
+      opts.add_rumble_pattern_spec(opt.argument);
+      break;
+
     case OPTION_DAEMON_NO_DBUS:
       opts.dbus = Options::kDBusDisabled;
       break;
@@ -944,6 +1044,14 @@ CommandLineParser::apply_opt(ArgParser::ParsedOption const& opt, Options& opts)
       set_generic_usb_spec(opt.argument);
       break;
 
+    case OPTION_HID_ABSMAP:
+      process_name_value_string(opt.argument, boost::bind(&CommandLineParser::set_hid_absmap, this, _1, _2));
+      break;
+
+    case OPTION_HID_KEYMAP:
+      process_name_value_string(opt.argument, boost::bind(&CommandLineParser::set_hid_keymap, this, _1, _2));
+      break;
+
     case OPTION_LIST_SUPPORTED_DEVICES:
       opts.mode = Options::RUN_LIST_SUPPORTED_DEVICES;
       break;
@@ -1239,6 +1347,24 @@ CommandLineParser::set_evdev_keymap(const std::string& name, const std::string&
   m_options->evdev_keymap[str2key(name)] = string2btn(value);
 }
 
+void
+CommandLineParser::set_hid_absmap(const std::string& name, const std::string& value)
+{
+  m_options->hid_map.bind_axis(name, value);
+}
+
+void
+CommandLineParser::set_hid_keymap(const std::string& name, const std::string& value)
+{
+  m_options->hid_map.bind_button(name, value);
+}
+
+void
+CommandLineParser::set_evdev_remap(const std::string& name, const std::string& value)
+{
+  m_options->evdev_remap.add(name, value);
+}
+
 void
 CommandLineParser::set_relative_axis(const std::string& name, const std::string& value)
 {
@@ -1260,9 +1386,14 @@ CommandLineParser::set_calibration(const std::string& name, const std::string& v
   tokenizer tokens(value, boost::char_separator<char>(":", "", boost::keep_empty_tokens));
   std::vector<std::string> args(tokens.begin(), tokens.end());
 
-  if (args.size() != 3)
+  if (value == "learn")
+  {
+    m_options->get_controller_options().calibration_map[string2axis(name)]
+      = AxisFilterPtr(new CalibrationAxisFilter);
+  }
+  else if (args.size() != 3)
   {
-    throw std::runtime_error("calibration requires MIN:CENTER:MAX as argument");
+    throw std::runtime_error("calibration requires MIN:CENTER:MAX or 'learn' as argument");
   }
   else
   {
@@ -0,0 +1,128 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "command_queue.hpp"
+
+#include <errno.h>
+#include <stdexcept>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "log.hpp"
+#include "raise_exception.hpp"
+
+CommandQueue::CommandQueue(GMainContext* context, int capacity) :
+  m_buffer(capacity * static_cast<int>(sizeof(Command*))),
+  m_event_fd(-1),
+  m_io_channel(),
+  m_source()
+{
+  m_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (m_event_fd < 0)
+  {
+    raise_exception(std::runtime_error, "eventfd() failed: " << strerror(errno));
+  }
+
+  m_io_channel = g_io_channel_unix_new(m_event_fd);
+
+  // set encoding to binary
+  GError* error = NULL;
+  if (g_io_channel_set_encoding(m_io_channel, NULL, &error) != G_IO_STATUS_NORMAL)
+  {
+    log_error(error->message);
+    g_error_free(error);
+  }
+  g_io_channel_set_buffered(m_io_channel, false);
+
+  // g_io_add_watch() only knows the default context, the detour
+  // over void(*)() is how GIOFunc is passed as GSourceFunc
+  m_source = g_io_create_watch(m_io_channel, G_IO_IN);
+  g_source_set_callback(m_source,
+                        reinterpret_cast<GSourceFunc>(reinterpret_cast<void (*)()>(&CommandQueue::on_event_wrap)),
+                        this, NULL);
+  g_source_attach(m_source, context);
+}
+
+CommandQueue::~CommandQueue()
+{
+  g_source_destroy(m_source);
+  g_source_unref(m_source);
+  g_io_channel_unref(m_io_channel);
+  close(m_event_fd);
+
+  Command* command;
+  while (m_buffer.read(reinterpret_cast<uint8_t*>(&command), sizeof(command)) == sizeof(command))
+  {
+    delete command;
+  }
+}
+
+bool
+CommandQueue::push(const Command& command)
+{
+  if (m_buffer.get_write_space() < static_cast<int>(sizeof(Command*)))
+  {
+    return false;
+  }
+  else
+  {
+    // the consumer takes ownership and deletes it after running it
+    Command* ptr = new Command(command);
+    m_buffer.write(reinterpret_cast<const uint8_t*>(&ptr), sizeof(ptr));
+    eventfd_write(m_event_fd, 1);
+    return true;
+  }
+}
+
+int
+CommandQueue::process()
+{
+  int count = 0;
+  Command* command;
+  while (m_buffer.read(reinterpret_cast<uint8_t*>(&command), sizeof(command)) == sizeof(command))
+  {
+    try
+    {
+      (*command)();
+    }
+    catch(const std::exception& err)
+    {
+      log_error("command failed: " << err.what());
+    }
+    delete command;
+    count += 1;
+  }
+  return count;
+}
+
+gboolean
+CommandQueue::on_event(GIOChannel* source, GIOCondition condition)
+{
+  // reset the counter before processing, so a push racing with
+  // process() leaves the eventfd readable and isn't lost
+  eventfd_t value;
+  eventfd_read(m_event_fd, &value);
+
+  process();
+
+  return TRUE;
+}
+
+/* EOF */
@@ -0,0 +1,74 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef HEADER_XBOXDRV_COMMAND_QUEUE_HPP
+#define HEADER_XBOXDRV_COMMAND_QUEUE_HPP
+
+#include <boost/function.hpp>
+#include <glib.h>
+
+#include "ring_buffer.hpp"
+
+/** Lock-free queue of function calls from exactly one producer
+    thread to the thread running the GMainContext given to the
+    constructor. The producer never waits, the calls are run from an
+    eventfd watch in the consumer's main loop, in the order they were
+    pushed. */
+class CommandQueue
+{
+public:
+  typedef boost::function<void ()> Command;
+
+private:
+  RingBuffer m_buffer;
+  int m_event_fd;
+  GIOChannel* m_io_channel;
+  GSource* m_source;
+
+public:
+  /** \a capacity is the number of commands that can be pending */
+  CommandQueue(GMainContext* context, int capacity);
+
+  /** Commands still pending are dropped without being run, the
+      queue must not be in use by either thread anymore. */
+  ~CommandQueue();
+
+  /** Queue \a command, returns false if the queue is full. Must only
+      be called from the producer thread. */
+  bool push(const Command& command);
+
+  /** Run all pending commands, returns the number run. Must only be
+      called from the consumer thread. */
+  int process();
+
+private:
+  gboolean on_event(GIOChannel* source, GIOCondition condition);
+  static gboolean on_event_wrap(GIOChannel* source, GIOCondition condition, gpointer userdata)
+  {
+    return static_cast<CommandQueue*>(userdata)->on_event(source, condition);
+  }
+
+private:
+  CommandQueue(const CommandQueue&);
+  CommandQueue& operator=(const CommandQueue&);
+};
+
+#endif
+
+/* EOF */
@@ -32,7 +32,9 @@ Controller::Controller() :
   m_udev_device(),
   m_led_status(0),
   m_rumble_left(0),
-  m_rumble_right(0)
+  m_rumble_right(0),
+  m_msg_count(0),
+  m_error_count(0)
 {
 }
 
@@ -44,6 +46,8 @@ Controller::~Controller()
 void
 Controller::submit_msg(const XboxGenericMsg& msg)
 {
+  m_msg_count += 1;
+
   if (m_msg_cb)
   {
     m_msg_cb(msg);
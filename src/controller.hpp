@@ -45,6 +45,9 @@ protected:
   uint8_t m_rumble_left;
   uint8_t m_rumble_right;
 
+  uint64_t m_msg_count;
+  uint64_t m_error_count;
+
 public:
   Controller();
   virtual ~Controller();
@@ -74,6 +77,15 @@ public:
   virtual std::string get_usbpath() const { return "-1:-1"; }
   virtual std::string get_usbid() const   { return "-1:-1"; }
   virtual std::string get_name() const    { return "<not implemented>"; }
+  virtual std::string get_serial() const  { return std::string(); }
+
+  /** battery level as reported by the controller, -1 if unknown */
+  virtual int get_battery_status() const { return -1; }
+
+  /** number of messages submitted and of failed transfers since the
+      controller was created */
+  uint64_t get_msg_count() const { return m_msg_count; }
+  uint64_t get_error_count() const { return m_error_count; }
 
   void set_message_cb(const boost::function<void(const XboxGenericMsg&)>& msg_cb);
 
@@ -82,6 +94,10 @@ public:
 
   void submit_msg(const XboxGenericMsg& msg);
 
+  /** count a failed transfer, for controllers whose transfers are
+      done by someone else, like the WirelessReceiver */
+  void submit_error() { m_error_count += 1; }
+
 private:
   Controller (const Controller&);
   Controller& operator= (const Controller&);
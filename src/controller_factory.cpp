@@ -25,6 +25,7 @@
 #include "playstation3_usb_controller.hpp"
 #include "saitek_p2500_controller.hpp"
 #include "saitek_p3600_controller.hpp"
+#include "wireless_receiver.hpp"
 #include "xbox360_controller.hpp"
 #include "xbox360_wireless_controller.hpp"
 #include "xbox_controller.hpp"
@@ -44,7 +45,7 @@ ControllerFactory::create(const XPadDevice& dev_type, libusb_device* dev, const
 
     case GAMEPAD_XBOX:
     case GAMEPAD_XBOX_MAT:
-      return ControllerPtr(new XboxController(dev, opts.detach_kernel_driver));
+      return ControllerPtr(new XboxController(dev, opts.detach_kernel_driver, opts.usb_read_depth));
 
     case GAMEPAD_XBOX360:
     case GAMEPAD_XBOX360_GUITAR:
@@ -54,32 +55,37 @@ ControllerFactory::create(const XPadDevice& dev_type, libusb_device* dev, const
                                                  opts.headset_debug,
                                                  opts.headset_dump,
                                                  opts.headset_play,
-                                                 opts.detach_kernel_driver));
+                                                 opts.detach_kernel_driver,
+                                                 opts.usb_read_depth));
       break;
 
     case GAMEPAD_XBOX360_WIRELESS:
-      return ControllerPtr(new Xbox360WirelessController(dev, opts.wireless_id, opts.detach_kernel_driver));
+      {
+        boost::shared_ptr<WirelessReceiver> receiver(new WirelessReceiver(dev, opts.detach_kernel_driver, opts.usb_read_depth));
+        return ControllerPtr(new Xbox360WirelessController(receiver, opts.wireless_id));
+      }
 
     case GAMEPAD_FIRESTORM:
-      return ControllerPtr(new FirestormDualController(dev, false, opts.detach_kernel_driver));
+      return ControllerPtr(new FirestormDualController(dev, false, opts.detach_kernel_driver, opts.usb_read_depth));
 
     case GAMEPAD_FIRESTORM_VSB:
-      return ControllerPtr(new FirestormDualController(dev, true, opts.detach_kernel_driver));
+      return ControllerPtr(new FirestormDualController(dev, true, opts.detach_kernel_driver, opts.usb_read_depth));
 
     case GAMEPAD_SAITEK_P2500:
-      return ControllerPtr(new SaitekP2500Controller(dev, opts.detach_kernel_driver));
+      return ControllerPtr(new SaitekP2500Controller(dev, opts.detach_kernel_driver, opts.usb_read_depth));
 
     case GAMEPAD_SAITEK_P3600:
-      return ControllerPtr(new SaitekP3600Controller(dev, opts.detach_kernel_driver));
+      return ControllerPtr(new SaitekP3600Controller(dev, opts.detach_kernel_driver, opts.usb_read_depth));
 
     case GAMEPAD_PLAYSTATION3_USB:
-      return ControllerPtr(new Playstation3USBController(dev, opts.detach_kernel_driver));
+      return ControllerPtr(new Playstation3USBController(dev, opts.detach_kernel_driver, opts.usb_read_depth));
 
     case GAMEPAD_GENERIC_USB:
       {
         Options::GenericUSBSpec spec = opts.find_generic_usb_spec(dev_type.idVendor, dev_type.idProduct);
         return ControllerPtr(new GenericUSBController(dev, spec.m_interface, spec.m_endpoint,
-                                                      opts.detach_kernel_driver));
+                                                      opts.detach_kernel_driver, opts.hid_map,
+                                                      opts.usb_read_depth));
       }
 
     default:
@@ -104,7 +110,7 @@ ControllerFactory::create_multiple(const XPadDevice& dev_type, libusb_device* de
 
     case GAMEPAD_XBOX:
     case GAMEPAD_XBOX_MAT:
-      lst.push_back(ControllerPtr(new XboxController(dev, opts.detach_kernel_driver)));
+      lst.push_back(ControllerPtr(new XboxController(dev, opts.detach_kernel_driver, opts.usb_read_depth)));
       break;
 
     case GAMEPAD_XBOX360:
@@ -115,41 +121,47 @@ ControllerFactory::create_multiple(const XPadDevice& dev_type, libusb_device* de
                                                         opts.headset_debug,
                                                         opts.headset_dump,
                                                         opts.headset_play,
-                                                        opts.detach_kernel_driver)));
+                                                        opts.detach_kernel_driver,
+                                                        opts.usb_read_depth)));
       break;
 
     case GAMEPAD_XBOX360_WIRELESS:
-      for(int wireless_id = 0; wireless_id < 4; ++wireless_id)
       {
-        lst.push_back(ControllerPtr(new Xbox360WirelessController(dev, wireless_id, opts.detach_kernel_driver)));
+        // all ports share a single handle to the receiver
+        boost::shared_ptr<WirelessReceiver> receiver(new WirelessReceiver(dev, opts.detach_kernel_driver, opts.usb_read_depth));
+        for(int wireless_id = 0; wireless_id < WirelessReceiver::kMaxPorts; ++wireless_id)
+        {
+          lst.push_back(ControllerPtr(new Xbox360WirelessController(receiver, wireless_id)));
+        }
       }
       break;
 
     case GAMEPAD_FIRESTORM:
-      lst.push_back(ControllerPtr(new FirestormDualController(dev, false, opts.detach_kernel_driver)));
+      lst.push_back(ControllerPtr(new FirestormDualController(dev, false, opts.detach_kernel_driver, opts.usb_read_depth)));
       break;
 
     case GAMEPAD_FIRESTORM_VSB:
-      lst.push_back(ControllerPtr(new FirestormDualController(dev, true, opts.detach_kernel_driver)));
+      lst.push_back(ControllerPtr(new FirestormDualController(dev, true, opts.detach_kernel_driver, opts.usb_read_depth)));
       break;
 
     case GAMEPAD_SAITEK_P2500:
-      lst.push_back(ControllerPtr(new SaitekP2500Controller(dev, opts.detach_kernel_driver)));
+      lst.push_back(ControllerPtr(new SaitekP2500Controller(dev, opts.detach_kernel_driver, opts.usb_read_depth)));
       break;
     
     case GAMEPAD_SAITEK_P3600:
-      lst.push_back(ControllerPtr(new SaitekP3600Controller(dev, opts.detach_kernel_driver)));
+      lst.push_back(ControllerPtr(new SaitekP3600Controller(dev, opts.detach_kernel_driver, opts.usb_read_depth)));
       break;
 
     case GAMEPAD_PLAYSTATION3_USB:
-      lst.push_back(ControllerPtr(new Playstation3USBController(dev, opts.detach_kernel_driver)));
+      lst.push_back(ControllerPtr(new Playstation3USBController(dev, opts.detach_kernel_driver, opts.usb_read_depth)));
       break;
 
     case GAMEPAD_GENERIC_USB:
       {
         Options::GenericUSBSpec spec = opts.find_generic_usb_spec(dev_type.idVendor, dev_type.idProduct);
         lst.push_back(ControllerPtr(new GenericUSBController(dev, spec.m_interface, spec.m_endpoint,
-                                                             opts.detach_kernel_driver)));
+                                                             opts.detach_kernel_driver, opts.hid_map,
+                                                             opts.usb_read_depth)));
       }
       break;
 
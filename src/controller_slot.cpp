@@ -20,6 +20,11 @@
 
 #include <boost/format.hpp>
 
+#include "calibration_store.hpp"
+#include "clock.hpp"
+#include "controller.hpp"
+#include "options.hpp"
+#include "raise_exception.hpp"
 #include "uinput_message_processor.hpp"
 #include "dummy_message_processor.hpp"
 
@@ -34,15 +39,38 @@ ControllerSlot::ControllerSlot(int id_,
   m_rules(rules_),
   m_led_status(led_status_),
   m_thread(),
+  m_calibration_key(),
   m_opts(opts),
-  m_uinput(uinput)
+  m_uinput(uinput),
+  m_rumble_patterns(opts.rumble_patterns.begin(), opts.rumble_patterns.end()),
+  m_rumble_pattern(),
+  m_rumble_pattern_start(0),
+  m_rumble_pattern_timeout_id(0)
 {}
 
+ControllerSlot::~ControllerSlot()
+{
+  if (m_rumble_pattern_timeout_id)
+  {
+    g_source_remove(m_rumble_pattern_timeout_id);
+  }
+
+  if (m_thread)
+  {
+    CalibrationStore(m_opts.calibration_dir).save(m_calibration_key, *m_config);
+  }
+}
+
 void
 ControllerSlot::connect(ControllerPtr controller)
 {
   assert(!m_thread);
 
+  // the slot config outlives its controllers, learned calibrations
+  // are swapped with each one
+  m_calibration_key = CalibrationStore::device_key(*controller);
+  CalibrationStore(m_opts.calibration_dir).load(m_calibration_key, *m_config);
+
   std::auto_ptr<MessageProcessor> message_proc;
   if (m_uinput)
   {
@@ -60,9 +88,13 @@ ControllerSlot::disconnect()
 {
   assert(m_thread);
 
+  stop_rumble_pattern();
+
   ControllerPtr controller = m_thread->get_controller();
   m_thread.reset();
 
+  CalibrationStore(m_opts.calibration_dir).save(m_calibration_key, *m_config);
+
   return controller;
 }
 
@@ -72,4 +104,76 @@ ControllerSlot::is_connected() const
   return m_thread;
 }
 
+void
+ControllerSlot::add_rumble_pattern(const std::string& name, RumblePatternPtr pattern)
+{
+  m_rumble_patterns[name] = pattern;
+}
+
+void
+ControllerSlot::play_rumble_pattern(const std::string& name)
+{
+  RumblePatterns::iterator it = m_rumble_patterns.find(name);
+  if (it == m_rumble_patterns.end())
+  {
+    raise_exception(std::runtime_error, "unknown rumble pattern: " << name);
+  }
+  else if (!m_thread)
+  {
+    raise_exception(std::runtime_error, "no controller connected to slot " << m_id);
+  }
+  else
+  {
+    m_rumble_pattern = it->second;
+    m_rumble_pattern_start = Clock::now();
+
+    if (on_rumble_pattern_timeout() && !m_rumble_pattern_timeout_id)
+    {
+      // 100Hz is about as fast as the controllers take rumble messages
+      m_rumble_pattern_timeout_id = g_timeout_add(10, &ControllerSlot::on_rumble_pattern_timeout_wrap, this);
+    }
+  }
+}
+
+void
+ControllerSlot::stop_rumble_pattern()
+{
+  if (m_rumble_pattern_timeout_id)
+  {
+    g_source_remove(m_rumble_pattern_timeout_id);
+    m_rumble_pattern_timeout_id = 0;
+
+    if (m_thread)
+    {
+      m_thread->get_controller()->set_rumble(0, 0);
+    }
+  }
+
+  m_rumble_pattern.reset();
+}
+
+bool
+ControllerSlot::on_rumble_pattern_timeout()
+{
+  uint8_t strong;
+  uint8_t weak;
+  if (m_thread && m_rumble_pattern &&
+      m_rumble_pattern->get(Clock::now() - m_rumble_pattern_start, &strong, &weak))
+  {
+    m_thread->get_controller()->set_rumble(strong, weak);
+    return true;
+  }
+  else
+  {
+    // returning false removes the source
+    m_rumble_pattern_timeout_id = 0;
+    m_rumble_pattern.reset();
+    if (m_thread)
+    {
+      m_thread->get_controller()->set_rumble(0, 0);
+    }
+    return false;
+  }
+}
+
 /* EOF */
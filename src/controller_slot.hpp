@@ -19,10 +19,13 @@
 #ifndef HEADER_XBOXDRV_CONTROLLER_SLOT_HPP
 #define HEADER_XBOXDRV_CONTROLLER_SLOT_HPP
 
+#include <glib.h>
+#include <map>
 #include <vector>
 
 #include "controller_slot_config.hpp"
 #include "controller_thread.hpp"
+#include "rumble_pattern.hpp"
 
 class ControllerSlot
 {
@@ -33,9 +36,18 @@ private:
   int m_led_status;
   ControllerThreadPtr m_thread;
 
+  /** CalibrationStore key of the connected controller */
+  std::string m_calibration_key;
+
   const Options& m_opts;
   UInput* m_uinput;
 
+  typedef std::map<std::string, RumblePatternPtr> RumblePatterns;
+  RumblePatterns m_rumble_patterns;
+  RumblePatternPtr m_rumble_pattern;
+  int64_t m_rumble_pattern_start;
+  guint m_rumble_pattern_timeout_id;
+
 public:
   ControllerSlot(int id_,
                  ControllerSlotConfigPtr config_,
@@ -43,6 +55,7 @@ public:
                  int led_status_,
                  const Options& opts,
                  UInput* uinput);
+  ~ControllerSlot();
 
   bool is_connected() const;
   void connect(ControllerPtr controller);
@@ -56,6 +69,22 @@ public:
   ControllerThreadPtr get_thread() const { return m_thread; }
   ControllerPtr get_controller() const { return m_thread ? m_thread->get_controller() : ControllerPtr(); }
 
+  /** add or replace a pattern, the patterns from the configuration
+      are there from the start */
+  void add_rumble_pattern(const std::string& name, RumblePatternPtr pattern);
+
+  /** play a pattern on the connected controller from a timer, so
+      the envelope doesn't depend on the timing of whoever started it,
+      replaces a pattern that is already playing */
+  void play_rumble_pattern(const std::string& name);
+  void stop_rumble_pattern();
+
+private:
+  bool on_rumble_pattern_timeout();
+  static gboolean on_rumble_pattern_timeout_wrap(gpointer data) {
+    return static_cast<ControllerSlot*>(data)->on_rumble_pattern_timeout();
+  }
+
 private:
   ControllerSlot(const ControllerSlot&);
   ControllerSlot& operator=(const ControllerSlot&);
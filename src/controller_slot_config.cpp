@@ -26,6 +26,7 @@
 #include "modifier/dpad_rotation_modifier.hpp"
 #include "modifier/four_way_restrictor_modifier.hpp"
 #include "modifier/square_axis_modifier.hpp"
+#include "modifier/stick_modifier.hpp"
 
 #include "axisfilter/deadzone_axis_filter.hpp"
 
@@ -122,27 +123,6 @@ ControllerSlotConfig::create_modifier(const ControllerOptions& opts, std::vector
     modifier->push_back(axismap);
   }
 
-  if (opts.deadzone)
-  {
-    boost::shared_ptr<AxismapModifier> axismap(new AxismapModifier);
-
-    XboxAxis axes[] = { XBOX_AXIS_X1,
-                        XBOX_AXIS_Y1,
-
-                        XBOX_AXIS_X2,
-                        XBOX_AXIS_Y2 };
-
-    for(size_t i = 0; i < sizeof(axes)/sizeof(XboxAxis); ++i)
-    {
-      axismap->add_filter(axes[i],
-                          AxisFilterPtr(new DeadzoneAxisFilter(-opts.deadzone,
-                                                               opts.deadzone,
-                                                               true)));
-    }
-
-    modifier->push_back(axismap);
-  }
-
   if (opts.deadzone_trigger)
   {
     boost::shared_ptr<AxismapModifier> axismap(new AxismapModifier);
@@ -161,6 +141,16 @@ ControllerSlotConfig::create_modifier(const ControllerOptions& opts, std::vector
     modifier->push_back(axismap);
   }
 
+  // sticks come after the triggers, so the deadzone gets folded
+  // together with the other stick modifiers
+  if (opts.deadzone)
+  {
+    boost::shared_ptr<StickModifier> stick(new StickModifier);
+    stick->add_deadzone(XBOX_AXIS_X1, XBOX_AXIS_Y1, opts.deadzone);
+    stick->add_deadzone(XBOX_AXIS_X2, XBOX_AXIS_Y2, opts.deadzone);
+    modifier->push_back(stick);
+  }
+
   if (opts.square_axis)
   {
     modifier->push_back(ModifierPtr(new SquareAxisModifier(XBOX_AXIS_X1, XBOX_AXIS_Y1)));
@@ -229,6 +219,8 @@ ControllerSlotConfig::create_modifier(const ControllerOptions& opts, std::vector
   }
 
   modifier->insert(modifier->end(), opts.modifier.begin(), opts.modifier.end());
+
+  StickModifier::compile(modifier);
 }
 
 ControllerSlotConfig::ControllerSlotConfig() :
@@ -22,10 +22,12 @@
 #include <boost/bind.hpp>
 #include <glib.h>
 
+#include "clock.hpp"
 #include "helper.hpp"
 #include "log.hpp"
 #include "controller.hpp"
 #include "message_processor.hpp"
+#include "trace.hpp"
 
 extern bool global_exit_xboxdrv;
 
@@ -38,7 +40,7 @@ ControllerThread::ControllerThread(ControllerPtr controller,
   m_timeout(opts.timeout),
   m_print_messages(!opts.silent),
   m_timeout_id(),
-  m_timer(g_timer_new())
+  m_last_time(Clock::now())
 {
   memset(&m_oldrealmsg, 0, sizeof(m_oldrealmsg));
   m_timeout_id = g_timeout_add(m_timeout, &ControllerThread::on_timeout_wrap, this);
@@ -49,26 +51,37 @@ ControllerThread::ControllerThread(ControllerPtr controller,
 ControllerThread::~ControllerThread()
 {
   g_source_remove(m_timeout_id);
-  g_timer_destroy(m_timer);
 }
 
 bool
 ControllerThread::on_timeout()
 {
+  TRACE_SPAN("ControllerThread::on_timeout");
+
   if (m_processor.get())
   {
-    int msec_delta = static_cast<int>(g_timer_elapsed(m_timer, NULL) * 1000.0f);
-    g_timer_reset(m_timer);
-
-    m_processor->send(m_oldrealmsg, msec_delta);
+    m_processor->send(m_oldrealmsg, get_nsec_delta());
   }
 
   return true; // do not remove the callback
 }
 
+int64_t
+ControllerThread::get_nsec_delta()
+{
+  // deltas are taken between absolute timestamps, so nothing is lost
+  // to rounding no matter how often this gets called
+  int64_t now = Clock::now();
+  int64_t nsec_delta = now - m_last_time;
+  m_last_time = now;
+  return nsec_delta;
+}
+
 void
 ControllerThread::on_message(const XboxGenericMsg& msg)
 {
+  TRACE_SPAN("ControllerThread::on_message");
+
   if (m_print_messages)
   {
     std::cout << msg << std::endl;
@@ -76,12 +89,11 @@ ControllerThread::on_message(const XboxGenericMsg& msg)
 
   m_oldrealmsg = msg;
 
-  int msec_delta = static_cast<int>(g_timer_elapsed(m_timer, NULL) * 1000.0f);
-  g_timer_reset(m_timer);
+  int64_t nsec_delta = get_nsec_delta();
 
   if (m_processor.get())
   {
-    m_processor->send(msg, msec_delta);
+    m_processor->send(msg, nsec_delta);
   }
 }
 
@@ -45,7 +45,7 @@ private:
   int  m_timeout;
   bool m_print_messages;
   guint m_timeout_id;
-  GTimer* m_timer;
+  int64_t m_last_time;
 
 public:
   ControllerThread(ControllerPtr controller, std::auto_ptr<MessageProcessor> processor,
@@ -58,6 +58,9 @@ public:
 private:
   void on_message(const XboxGenericMsg& msg);
 
+  /** nsec passed since the last call */
+  int64_t get_nsec_delta();
+
   bool on_timeout();
   static gboolean on_timeout_wrap(gpointer data) {
     return static_cast<ControllerThread*>(data)->on_timeout();
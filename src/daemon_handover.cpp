@@ -0,0 +1,403 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "daemon_handover.hpp"
+
+#include <errno.h>
+#include <poll.h>
+#include <sstream>
+#include <stdexcept>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "clock.hpp"
+#include "log.hpp"
+#include "raise_exception.hpp"
+
+namespace {
+
+const char* const kMagic = "xboxdrv-handover 1";
+
+/** more than enough for four slots with a handful of devices each */
+const int kMaxFds = 64;
+const int kMaxMessage = 64 * 1024;
+
+const int kRequestTimeout = 1000;
+const int kConfirmTimeout = 5000;
+
+sockaddr_un make_address(const std::string& path)
+{
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path))
+  {
+    raise_exception(std::runtime_error, "handover socket path too long: " << path);
+  }
+  strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+  return addr;
+}
+
+/** wait up to \a timeout msec for \a fd to become readable */
+bool wait_readable(int fd, int timeout)
+{
+  pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+
+  int ret;
+  while((ret = poll(&pfd, 1, timeout)) < 0 && errno == EINTR) {}
+  return ret > 0;
+}
+
+/** send \a text with \a fds attached as SCM_RIGHTS */
+void send_message(int sock, const std::string& text, const std::vector<int>& fds)
+{
+  iovec iov;
+  iov.iov_base = const_cast<char*>(text.data());
+  iov.iov_len  = text.size();
+
+  msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+
+  std::vector<char> control;
+  if (!fds.empty())
+  {
+    control.resize(CMSG_SPACE(sizeof(int) * fds.size()));
+    msg.msg_control = &control[0];
+    msg.msg_controllen = control.size();
+
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type  = SCM_RIGHTS;
+    cmsg->cmsg_len   = CMSG_LEN(sizeof(int) * fds.size());
+    memcpy(CMSG_DATA(cmsg), &fds[0], sizeof(int) * fds.size());
+  }
+
+  if (sendmsg(sock, &msg, MSG_NOSIGNAL) < 0)
+  {
+    raise_exception(std::runtime_error, "handover: sendmsg() failed: " << strerror(errno));
+  }
+}
+
+/** receive a message, attached fds are appended to \a fds */
+std::string receive_message(int sock, int timeout, std::vector<int>* fds)
+{
+  if (!wait_readable(sock, timeout))
+  {
+    raise_exception(std::runtime_error, "handover: timeout");
+  }
+
+  std::vector<char> buffer(kMaxMessage);
+  iovec iov;
+  iov.iov_base = &buffer[0];
+  iov.iov_len  = buffer.size();
+
+  std::vector<char> control(CMSG_SPACE(sizeof(int) * kMaxFds));
+
+  msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = &control[0];
+  msg.msg_controllen = control.size();
+
+  ssize_t len = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+  if (len < 0)
+  {
+    raise_exception(std::runtime_error, "handover: recvmsg() failed: " << strerror(errno));
+  }
+
+  for(cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+  {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+    {
+      const size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      const int* data = reinterpret_cast<const int*>(CMSG_DATA(cmsg));
+      if (fds)
+      {
+        fds->insert(fds->end(), data, data + count);
+      }
+      else
+      {
+        for(size_t i = 0; i < count; ++i) close(data[i]);
+      }
+    }
+  }
+
+  if (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC))
+  {
+    raise_exception(std::runtime_error, "handover: message truncated");
+  }
+
+  return std::string(&buffer[0], len);
+}
+
+} // namespace
+
+HandoverServer::HandoverServer(const std::string& path,
+                               const boost::function<HandoverState ()>& get_state,
+                               const boost::function<void ()>& on_handover) :
+  m_path(path),
+  m_get_state(get_state),
+  m_on_handover(on_handover),
+  m_listen_fd(-1),
+  m_io_channel(),
+  m_source_id(),
+  m_client_fd(-1)
+{
+  sockaddr_un addr = make_address(m_path);
+
+  m_listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if (m_listen_fd < 0)
+  {
+    raise_exception(std::runtime_error, "handover: socket() failed: " << strerror(errno));
+  }
+
+  // a leftover from a previous daemon, a running one would have been
+  // taken over already
+  unlink(m_path.c_str());
+
+  // the successor gets the uinput fds, so nobody but our own user may
+  // connect, handle_client() checks the peer as well in case somebody
+  // got in before the chmod()
+  if (bind(m_listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+      chmod(m_path.c_str(), S_IRUSR | S_IWUSR) < 0 ||
+      listen(m_listen_fd, 1) < 0)
+  {
+    int err = errno;
+    close(m_listen_fd);
+    raise_exception(std::runtime_error, "handover: failed to listen on " << m_path << ": " << strerror(err));
+  }
+
+  m_io_channel = g_io_channel_unix_new(m_listen_fd);
+  m_source_id = g_io_add_watch(m_io_channel, G_IO_IN, &HandoverServer::on_accept_wrap, this);
+
+  log_info("waiting for successors on " << m_path);
+}
+
+HandoverServer::~HandoverServer()
+{
+  if (m_source_id)
+  {
+    g_source_remove(m_source_id);
+  }
+  g_io_channel_unref(m_io_channel);
+  close(m_listen_fd);
+
+  if (m_client_fd != -1)
+  {
+    // the successor binds the path itself once we are gone
+    close(m_client_fd);
+  }
+  else
+  {
+    unlink(m_path.c_str());
+  }
+}
+
+gboolean
+HandoverServer::on_accept(GIOChannel* source, GIOCondition condition)
+{
+  int fd = accept4(m_listen_fd, NULL, NULL, SOCK_CLOEXEC);
+  if (fd < 0)
+  {
+    log_error("handover: accept() failed: " << strerror(errno));
+    return TRUE;
+  }
+
+  try
+  {
+    handle_client(fd);
+  }
+  catch(const std::exception& err)
+  {
+    log_error(err.what() << ", continuing");
+    close(fd);
+    return TRUE;
+  }
+
+  // no further successors, the handover is done
+  m_source_id = 0;
+  return FALSE;
+}
+
+void
+HandoverServer::handle_client(int fd)
+{
+  const int64_t start = Clock::now();
+
+  struct ucred cred;
+  socklen_t cred_len = sizeof(cred);
+  if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &cred_len) < 0)
+  {
+    raise_exception(std::runtime_error, "handover: SO_PEERCRED failed: " << strerror(errno));
+  }
+  else if (cred.uid != geteuid() && cred.uid != 0)
+  {
+    raise_exception(std::runtime_error, "handover: rejected successor with uid " << cred.uid
+                    << " (pid " << cred.pid << ")");
+  }
+
+  if (receive_message(fd, kRequestTimeout, NULL) != "takeover")
+  {
+    raise_exception(std::runtime_error, "handover: invalid request");
+  }
+
+  HandoverState state = m_get_state();
+
+  std::ostringstream out;
+  std::vector<int> fds;
+  out << kMagic << "\n";
+  for(std::vector<UInput::HandoverDevice>::const_iterator i = state.devices.begin(); i != state.devices.end(); ++i)
+  {
+    out << "device " << i->device_id << " " << i->signature << "\n";
+    fds.push_back(i->fd);
+  }
+  for(std::vector<HandoverState::Slot>::const_iterator i = state.slots.begin(); i != state.slots.end(); ++i)
+  {
+    out << "slot " << i->id << " " << i->config << " " << i->usbpath << "\n";
+  }
+
+  if (static_cast<int>(fds.size()) > kMaxFds)
+  {
+    raise_exception(std::runtime_error, "handover: too many devices: " << fds.size());
+  }
+
+  send_message(fd, out.str(), fds);
+
+  if (receive_message(fd, kConfirmTimeout, NULL) != "ok")
+  {
+    raise_exception(std::runtime_error, "handover: successor didn't confirm");
+  }
+
+  m_client_fd = fd;
+
+  log_info("handed over " << state.devices.size() << " uinput devices in "
+           << nsec2msec(Clock::now() - start) << " msec");
+
+  if (m_on_handover)
+  {
+    m_on_handover();
+  }
+}
+
+HandoverClient::HandoverClient(const std::string& path) :
+  m_fd(-1)
+{
+  sockaddr_un addr = make_address(path);
+
+  m_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if (m_fd < 0)
+  {
+    raise_exception(std::runtime_error, "handover: socket() failed: " << strerror(errno));
+  }
+
+  if (connect(m_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+  {
+    int err = errno;
+    close(m_fd);
+    raise_exception(std::runtime_error, "no daemon to take over at " << path << ": " << strerror(err));
+  }
+}
+
+HandoverClient::~HandoverClient()
+{
+  close(m_fd);
+}
+
+HandoverState
+HandoverClient::receive()
+{
+  send_message(m_fd, "takeover", std::vector<int>());
+
+  std::vector<int> fds;
+  std::string text = receive_message(m_fd, kRequestTimeout, &fds);
+
+  HandoverState state;
+  std::istringstream in(text);
+  std::string line;
+  bool valid = std::getline(in, line) && line == kMagic;
+  size_t next_fd = 0;
+
+  while(valid && std::getline(in, line))
+  {
+    std::istringstream words(line);
+    std::string type;
+    words >> type;
+
+    if (type == "device")
+    {
+      UInput::HandoverDevice dev;
+      words >> dev.device_id >> dev.signature;
+      valid = words && next_fd < fds.size();
+      if (valid)
+      {
+        dev.fd = fds[next_fd++];
+        state.devices.push_back(dev);
+      }
+    }
+    else if (type == "slot")
+    {
+      HandoverState::Slot slot;
+      words >> slot.id >> slot.config >> slot.usbpath;
+      valid = words;
+      state.slots.push_back(slot);
+    }
+    else
+    {
+      log_warn("handover: ignoring unknown entry: " << line);
+    }
+  }
+
+  // close whatever fds we aren't going to use
+  for(size_t i = next_fd; i < fds.size(); ++i)
+  {
+    close(fds[i]);
+  }
+
+  if (!valid)
+  {
+    for(std::vector<UInput::HandoverDevice>::iterator i = state.devices.begin(); i != state.devices.end(); ++i)
+    {
+      close(i->fd);
+    }
+    raise_exception(std::runtime_error, "handover: invalid state received");
+  }
+
+  return state;
+}
+
+void
+HandoverClient::confirm(int timeout)
+{
+  send_message(m_fd, "ok", std::vector<int>());
+
+  // the old daemon closes the connection when it exits, only then are
+  // its USB devices free to be claimed
+  char c;
+  while(wait_readable(m_fd, timeout) && read(m_fd, &c, 1) > 0) {}
+}
+
+/* EOF */
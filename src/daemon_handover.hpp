@@ -0,0 +1,122 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_XBOXDRV_DAEMON_HANDOVER_HPP
+#define HEADER_XBOXDRV_DAEMON_HANDOVER_HPP
+
+#include <boost/function.hpp>
+#include <glib.h>
+#include <string>
+#include <vector>
+
+#include "uinput.hpp"
+
+/** State passed from a running daemon to its successor. The uinput
+    fds travel as SCM_RIGHTS over a SOCK_SEQPACKET unix socket, the
+    rest as a small line based text message:
+
+      xboxdrv-handover 1
+      device DEVICE_ID SIGNATURE
+      slot ID CONFIG USBPATH
+
+    The fds are attached in the order of the device lines. */
+struct HandoverState
+{
+  HandoverState() : devices(), slots() {}
+
+  struct Slot
+  {
+    Slot() : id(0), config(0), usbpath() {}
+
+    int id;
+    int config;
+
+    /** bus:dev of the controller in the slot, "-" when empty */
+    std::string usbpath;
+  };
+
+  std::vector<UInput::HandoverDevice> devices;
+  std::vector<Slot> slots;
+};
+
+/** Waits on a unix socket for a successor and hands it the state of
+    this daemon. After a successful handover the connection stays open
+    until the HandoverServer is destroyed, the successor waits for it
+    to close, which tells it that the USB devices have been released. */
+class HandoverServer
+{
+public:
+  HandoverServer(const std::string& path,
+                 const boost::function<HandoverState ()>& get_state,
+                 const boost::function<void ()>& on_handover);
+  ~HandoverServer();
+
+  bool is_handed_over() const { return m_client_fd != -1; }
+
+private:
+  void handle_client(int fd);
+
+  gboolean on_accept(GIOChannel* source, GIOCondition condition);
+  static gboolean on_accept_wrap(GIOChannel* source, GIOCondition condition, gpointer userdata)
+  {
+    return static_cast<HandoverServer*>(userdata)->on_accept(source, condition);
+  }
+
+private:
+  std::string m_path;
+  boost::function<HandoverState ()> m_get_state;
+  boost::function<void ()> m_on_handover;
+
+  int m_listen_fd;
+  GIOChannel* m_io_channel;
+  guint m_source_id;
+
+  /** connection to the successor, kept open until destruction */
+  int m_client_fd;
+
+private:
+  HandoverServer(const HandoverServer&);
+  HandoverServer& operator=(const HandoverServer&);
+};
+
+/** The successor side of the handover */
+class HandoverClient
+{
+public:
+  /** connect to the daemon at \a path, throws when there is none */
+  HandoverClient(const std::string& path);
+  ~HandoverClient();
+
+  /** request and receive the state, the caller owns the fds */
+  HandoverState receive();
+
+  /** tell the old daemon that its devices are adopted, so it can
+      exit, and wait up to \a timeout msec for it to do so */
+  void confirm(int timeout);
+
+private:
+  int m_fd;
+
+private:
+  HandoverClient(const HandoverClient&);
+  HandoverClient& operator=(const HandoverClient&);
+};
+
+#endif
+
+/* EOF */
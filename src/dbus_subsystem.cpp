@@ -16,8 +16,12 @@
 **  along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+
 #include "dbus_subsystem.hpp"
 
+#include <algorithm>
+#include <assert.h>
+#include <boost/bind.hpp>
 #include <boost/format.hpp>
 #include <dbus/dbus-glib-lowlevel.h>
 //#include <dbus/dbus-glib-binding.h>
@@ -25,33 +29,165 @@
 #include <sstream>
 #include <stdexcept>
 
+#include "command_queue.hpp"
+#include "controller.hpp"
+#include "controller_slot.hpp"
 #include "raise_exception.hpp"
+#include "xboxdrv_daemon.hpp"
 #include "xboxdrv_g_controller.hpp"
 #include "xboxdrv_g_daemon.hpp"
 #include "xboxdrv_daemon_glue.hpp"
 #include "xboxdrv_controller_glue.hpp"
 
+namespace {
+
+/** number of calls and replies that can be in flight each way */
+const int kQueueSize = 256;
+
+/** how often the state is published when signals are disabled */
+const int kDefaultStateRate = 10;
+
+} // namespace
+
+DBusSlotState::DBusSlotState() :
+  slot(-1),
+  connected(false),
+  active(false),
+  config(0),
+  config_count(0),
+  name(),
+  usbid(),
+  usbpath(),
+  serial(),
+  battery(-1),
+  led(0),
+  messages(0),
+  errors(0)
+{
+}
+
+DBusSlotState
+DBusSlotState::from_slot(const ControllerSlot& slot)
+{
+  DBusSlotState state;
+  ControllerPtr controller = slot.get_controller();
+  if (controller)
+  {
+    state = from_controller(controller);
+  }
+  state.slot = slot.get_id();
+  state.config = slot.get_config()->get_current_config();
+  state.config_count = slot.get_config()->config_count();
+  return state;
+}
+
+DBusSlotState
+DBusSlotState::from_controller(ControllerPtr controller)
+{
+  DBusSlotState state;
+  state.connected = true;
+  state.active    = controller->is_active();
+  state.name      = controller->get_name();
+  state.usbid     = controller->get_usbid();
+  state.usbpath   = controller->get_usbpath();
+  state.serial    = controller->get_serial();
+  state.battery   = controller->get_battery_status();
+  state.led       = controller->get_led();
+  state.messages  = controller->get_msg_count();
+  state.errors    = controller->get_error_count();
+  return state;
+}
+
+bool
+DBusSlotState::operator==(const DBusSlotState& rhs) const
+{
+  return
+    slot == rhs.slot &&
+    connected == rhs.connected &&
+    active == rhs.active &&
+    config == rhs.config &&
+    config_count == rhs.config_count &&
+    name == rhs.name &&
+    usbid == rhs.usbid &&
+    usbpath == rhs.usbpath &&
+    serial == rhs.serial &&
+    battery == rhs.battery &&
+    led == rhs.led &&
+    messages == rhs.messages &&
+    errors == rhs.errors;
+}
+
 DBusSubsystem::DBusSubsystem(const std::string& name, DBusBusType bus_type) :
-  m_connection()
+  m_context(),
+  m_loop(),
+  m_thread(),
+  m_connection(),
+  m_to_dbus(),
+  m_to_input(),
+  m_daemon(),
+  m_slots(),
+  m_published(),
+  m_state_timeout_id(0),
+  m_state(),
+  m_controllers(),
+  m_signals(false)
 {
-  GError* gerror = NULL;
+  // the connection is used from the D-Bus thread and the input side
+  dbus_threads_init_default();
 
-  // this calls automatically sets up connection to the main loop
-  m_connection = dbus_g_bus_get(bus_type, &gerror);
-  if (!m_connection)
+  DBusError error;
+  dbus_error_init(&error);
+
+  // a private connection, as the shared one might already be
+  // dispatched from the default context
+  DBusConnection* connection = dbus_bus_get_private(bus_type, &error);
+  if (!connection)
   {
     std::ostringstream out;
-    out << "failed to open connection to bus: " << gerror->message;
-    g_error_free(gerror);
+    out << "failed to open connection to bus: " << error.message;
+    dbus_error_free(&error);
     throw std::runtime_error(out.str());
   }
 
+  m_context = g_main_context_new();
+  m_loop = g_main_loop_new(m_context, FALSE);
+
+  dbus_connection_setup_with_g_main(connection, m_context);
+  m_connection = dbus_connection_get_g_connection(connection);
+
   request_name(name);
+
+  m_to_dbus.reset(new CommandQueue(m_context, kQueueSize));
+  m_to_input.reset(new CommandQueue(NULL, kQueueSize));
 }
 
 DBusSubsystem::~DBusSubsystem()
 {
+  if (m_state_timeout_id)
+  {
+    g_source_remove(m_state_timeout_id);
+  }
+
+  if (m_thread)
+  {
+    // queued behind the replies that are still pending
+    if (!m_to_dbus->push(boost::bind(&g_main_loop_quit, m_loop)))
+    {
+      g_main_loop_quit(m_loop);
+    }
+    g_thread_join(m_thread);
+  }
+
+  m_to_dbus.reset();
+  m_to_input.reset();
+
+  DBusConnection* connection = dbus_g_connection_get_connection(m_connection);
+  dbus_connection_flush(connection);
+  dbus_connection_close(connection);
   dbus_g_connection_unref(m_connection);
+
+  g_main_loop_unref(m_loop);
+  g_main_context_unref(m_context);
 }
 
 void
@@ -83,8 +219,12 @@ DBusSubsystem::request_name(const std::string& name)
 void
 DBusSubsystem::register_xboxdrv_daemon(XboxdrvDaemon* c_daemon)
 {
+  assert(!m_thread);
+
+  m_daemon = c_daemon;
+
   // FIXME: should unref() these somewhere
-  XboxdrvGDaemon* daemon = xboxdrv_g_daemon_new(c_daemon);
+  XboxdrvGDaemon* daemon = xboxdrv_g_daemon_new(c_daemon, this);
   dbus_g_object_type_install_info(XBOXDRV_TYPE_G_DAEMON, &dbus_glib_xboxdrv_daemon_object_info);
   dbus_g_connection_register_g_object(m_connection, "/org/seul/Xboxdrv/Daemon", G_OBJECT(daemon));
 }
@@ -92,15 +232,251 @@ DBusSubsystem::register_xboxdrv_daemon(XboxdrvDaemon* c_daemon)
 void
 DBusSubsystem::register_controller_slots(const std::vector<ControllerSlotPtr>& slots)
 {
+  assert(!m_thread);
+
+  m_slots = slots;
+
   for(std::vector<ControllerSlotPtr>::const_iterator i = slots.begin(); i != slots.end(); ++i)
   {
-    XboxdrvGController* controller = xboxdrv_g_controller_new(i->get());
+    XboxdrvGController* controller = xboxdrv_g_controller_new(i->get(), this);
     dbus_g_object_type_install_info(XBOXDRV_TYPE_G_CONTROLLER, &dbus_glib_xboxdrv_controller_object_info);
     dbus_g_connection_register_g_object(m_connection,
                                         (boost::format("/org/seul/Xboxdrv/ControllerSlots/%d")
                                          % (i - slots.begin())).str().c_str(),
                                         G_OBJECT(controller));
+    m_controllers.push_back(controller);
   }
 }
 
+void
+DBusSubsystem::start(int rate)
+{
+  assert(!m_thread);
+  assert(rate >= 0);
+
+  // both are handed over to the D-Bus thread by g_thread_new()
+  m_signals = rate > 0;
+  m_state = m_published = get_daemon_state();
+
+  m_thread = g_thread_new("dbus", &DBusSubsystem::thread_func, this);
+
+  m_state_timeout_id = g_timeout_add(std::max(1, 1000 / (rate > 0 ? rate : kDefaultStateRate)),
+                                     &DBusSubsystem::on_state_timeout_wrap, this);
+}
+
+gpointer
+DBusSubsystem::thread_func(gpointer data)
+{
+  DBusSubsystem* self = static_cast<DBusSubsystem*>(data);
+
+  g_main_context_push_thread_default(self->m_context);
+  g_main_loop_run(self->m_loop);
+  g_main_context_pop_thread_default(self->m_context);
+
+  return 0;
+}
+
+DBusState
+DBusSubsystem::get_daemon_state() const
+{
+  DBusState state;
+
+  for(std::vector<ControllerSlotPtr>::const_iterator i = m_slots.begin(); i != m_slots.end(); ++i)
+  {
+    state.slots.push_back(DBusSlotState::from_slot(**i));
+  }
+
+  if (m_daemon)
+  {
+    const std::vector<ControllerPtr>& inactive = m_daemon->get_inactive_controllers();
+    for(std::vector<ControllerPtr>::const_iterator i = inactive.begin(); i != inactive.end(); ++i)
+    {
+      if (*i)
+      {
+        state.inactive.push_back(DBusSlotState::from_controller(*i));
+      }
+    }
+  }
+
+  return state;
+}
+
+void
+DBusSubsystem::publish_state()
+{
+  DBusState state = get_daemon_state();
+  if (state != m_published)
+  {
+    // when the queue is full the state still differs next time
+    if (m_to_dbus->push(boost::bind(&DBusSubsystem::set_state, this, state)))
+    {
+      m_published = state;
+    }
+  }
+}
+
+bool
+DBusSubsystem::on_state_timeout()
+{
+  publish_state();
+  return true;
+}
+
+void
+DBusSubsystem::on_connect(int slot)
+{
+  if (m_thread)
+  {
+    DBusState state = get_daemon_state();
+    if (m_to_dbus->push(boost::bind(&DBusSubsystem::emit_connected, this, state, slot)))
+    {
+      m_published = state;
+    }
+    else
+    {
+      log_warn("D-Bus thread busy, dropping Connected signal");
+    }
+  }
+}
+
+void
+DBusSubsystem::on_disconnect(int slot)
+{
+  if (m_thread)
+  {
+    if (!m_to_dbus->push(boost::bind(&DBusSubsystem::emit_disconnected, this, slot)))
+    {
+      log_warn("D-Bus thread busy, dropping Disconnected signal");
+    }
+  }
+}
+
+void
+DBusSubsystem::set_state(const DBusState& state)
+{
+  m_state = state;
+
+  if (m_signals)
+  {
+    for(std::vector<DBusSlotState>::size_type i = 0; i < m_controllers.size() && i < m_state.slots.size(); ++i)
+    {
+      xboxdrv_g_controller_update_state(m_controllers[i], m_state.slots[i]);
+    }
+  }
+}
+
+void
+DBusSubsystem::emit_connected(const DBusState& state, int slot)
+{
+  if (m_signals && 0 <= slot &&
+      slot < static_cast<int>(m_controllers.size()) &&
+      slot < static_cast<int>(state.slots.size()))
+  {
+    xboxdrv_g_controller_emit_connected(m_controllers[slot], state.slots[slot]);
+  }
+
+  // changes of the other slots still need their StateChanged
+  set_state(state);
+}
+
+void
+DBusSubsystem::emit_disconnected(int slot)
+{
+  if (0 <= slot && slot < static_cast<int>(m_state.slots.size()))
+  {
+    // the slot gets emptied on the input side right after this
+    DBusSlotState empty;
+    empty.slot = m_state.slots[slot].slot;
+    empty.config = m_state.slots[slot].config;
+    empty.config_count = m_state.slots[slot].config_count;
+    m_state.slots[slot] = empty;
+  }
+
+  if (m_signals && 0 <= slot && slot < static_cast<int>(m_controllers.size()))
+  {
+    xboxdrv_g_controller_emit_disconnected(m_controllers[slot]);
+  }
+}
+
+void
+DBusSubsystem::call(GQuark domain, const boost::function<void ()>& func, DBusGMethodInvocation* context)
+{
+  if (!m_to_input->push(boost::bind(&DBusSubsystem::run_call, this, domain, func, context)))
+  {
+    reply(domain, context, "too many requests pending, try again later");
+  }
+}
+
+void
+DBusSubsystem::run_call(GQuark domain, const boost::function<void ()>& func, DBusGMethodInvocation* context)
+{
+  std::string error;
+  try
+  {
+    func();
+  }
+  catch(const std::exception& err)
+  {
+    error = err.what();
+  }
+
+  if (!m_to_dbus->push(boost::bind(&DBusSubsystem::reply, domain, context, error)))
+  {
+    log_error("D-Bus thread busy, dropping reply");
+  }
+}
+
+void
+DBusSubsystem::reply(GQuark domain, DBusGMethodInvocation* context, const std::string& error)
+{
+  if (error.empty())
+  {
+    dbus_g_method_return(context);
+  }
+  else
+  {
+    GError* gerror = g_error_new(domain, 0, "%s", error.c_str());
+    dbus_g_method_return_error(context, gerror);
+    g_error_free(gerror);
+  }
+}
+
+std::string
+DBusSubsystem::status() const
+{
+  std::ostringstream out;
+
+  out << boost::format("SLOT  CFG  NCFG    USBID    USBPATH  NAME\n");
+  for(std::vector<DBusSlotState>::const_iterator i = m_state.slots.begin(); i != m_state.slots.end(); ++i)
+  {
+    if (i->connected)
+    {
+      out << boost::format("%4d  %3d  %4d  %5s  %7s  %s\n")
+        % i->slot
+        % i->config
+        % i->config_count
+        % i->usbid
+        % i->usbpath
+        % i->name;
+    }
+    else
+    {
+      out << boost::format("%4d  %3d  %4d      -         -\n")
+        % i->slot
+        % i->config
+        % i->config_count;
+    }
+  }
+
+  for(std::vector<DBusSlotState>::const_iterator i = m_state.inactive.begin(); i != m_state.inactive.end(); ++i)
+  {
+    out << boost::format("   -             %5s  %7s  %s\n")
+      % i->usbid
+      % i->usbpath
+      % i->name;
+  }
+
+  return out.str();
+}
+
 /* EOF */
@@ -16,22 +16,96 @@
 **  along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+
 #ifndef HEADER_XBOXDRV_DBUS_SUBSYSTEM_HPP
 #define HEADER_XBOXDRV_DBUS_SUBSYSTEM_HPP
 
+#include <boost/function.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <dbus/dbus-glib.h>
+#include <glib.h>
+#include <stdint.h>
 #include <string>
 #include <vector>
 
+#include "controller_ptr.hpp"
 #include "controller_slot_ptr.hpp"
 
+class CommandQueue;
+class ControllerSlot;
 class XboxdrvDaemon;
+struct _XboxdrvGController;
+
+/** Snapshot of a controller slot, or of an inactive controller when
+    slot is -1. Strings are empty and numbers zero when no controller
+    is connected, battery is -1 when unknown. */
+struct DBusSlotState
+{
+  DBusSlotState();
+
+  static DBusSlotState from_slot(const ControllerSlot& slot);
+  static DBusSlotState from_controller(ControllerPtr controller);
+
+  int slot;
+  bool connected;
+  bool active;
+  int config;
+  int config_count;
+  std::string name;
+  std::string usbid;
+  std::string usbpath;
+  std::string serial;
+  int battery;
+  int led;
+  uint64_t messages;
+  uint64_t errors;
+
+  bool operator==(const DBusSlotState& rhs) const;
+  bool operator!=(const DBusSlotState& rhs) const { return !(*this == rhs); }
+};
+
+struct DBusState
+{
+  DBusState() : slots(), inactive() {}
+
+  std::vector<DBusSlotState> slots;
+  std::vector<DBusSlotState> inactive;
+
+  bool operator==(const DBusState& rhs) const { return slots == rhs.slots && inactive == rhs.inactive; }
+  bool operator!=(const DBusState& rhs) const { return !(*this == rhs); }
+};
+
+/** Serves D-Bus from a thread of its own with its own GMainContext,
+    so a slow or chatty client never delays input processing.
 
+    Methods that touch controllers are queued to the input side (the
+    default GMainContext) and answered once they ran there. Methods
+    that only read are answered on the D-Bus thread from a snapshot
+    of the daemon state, which the input side publishes whenever it
+    changed, at most signal-rate times a second. */
 class DBusSubsystem
 {
 private:
+  GMainContext* m_context;
+  GMainLoop* m_loop;
+  GThread* m_thread;
   DBusGConnection* m_connection;
 
+  /** input side to D-Bus thread and back */
+  boost::scoped_ptr<CommandQueue> m_to_dbus;
+  boost::scoped_ptr<CommandQueue> m_to_input;
+
+  // input side only
+  XboxdrvDaemon* m_daemon;
+  std::vector<ControllerSlotPtr> m_slots;
+  DBusState m_published;
+  guint m_state_timeout_id;
+
+  // D-Bus thread only
+  DBusState m_state;
+  std::vector<_XboxdrvGController*> m_controllers;
+  bool m_signals;
+
 public:
   DBusSubsystem(const std::string& name, DBusBusType bus_type);
   ~DBusSubsystem();
@@ -39,9 +113,48 @@ public:
   void register_xboxdrv_daemon(XboxdrvDaemon* c_daemon);
   void register_controller_slots(const std::vector<ControllerSlotPtr>& slots);
 
+  /** Start serving requests, the objects have to be registered
+      before. The state is published \a rate times a second, the
+      StateChanged, Connected and Disconnected signals are only sent
+      when \a rate is larger than zero, so a slot emits at most that
+      many StateChanged signals no matter how often its state
+      changes. */
+  void start(int rate);
+
+  /** called from the input side */
+  void on_connect(int slot);
+  void on_disconnect(int slot);
+
+  /** Called from the D-Bus thread: run \a func on the input side and
+      answer \a context once it returned, an exception thrown by \a
+      func becomes an error reply in \a domain. */
+  void call(GQuark domain, const boost::function<void ()>& func, DBusGMethodInvocation* context);
+
+  /** D-Bus thread only */
+  const DBusState& get_state() const { return m_state; }
+  std::string status() const;
+
 private:
   void request_name(const std::string& name);
 
+  DBusState get_daemon_state() const;
+  void publish_state();
+
+  // D-Bus thread side of publish_state(), on_connect(), on_disconnect()
+  void set_state(const DBusState& state);
+  void emit_connected(const DBusState& state, int slot);
+  void emit_disconnected(int slot);
+
+  void run_call(GQuark domain, const boost::function<void ()>& func, DBusGMethodInvocation* context);
+  static void reply(GQuark domain, DBusGMethodInvocation* context, const std::string& error);
+
+  static gpointer thread_func(gpointer data);
+
+  bool on_state_timeout();
+  static gboolean on_state_timeout_wrap(gpointer data) {
+    return static_cast<DBusSubsystem*>(data)->on_state_timeout();
+  }
+
 private:
   DBusSubsystem(const DBusSubsystem&);
   DBusSubsystem& operator=(const DBusSubsystem&);
@@ -23,6 +23,7 @@
 #include <fcntl.h>
 #include <iostream>
 #include <string.h>
+#include <time.h>
 
 #include "evdev_helper.hpp"
 #include "helper.hpp"
@@ -45,6 +46,7 @@ EvdevController::EvdevController(const std::string& filename,
   m_name(),
   m_grab(grab),
   m_debug(debug),
+  m_monotonic(false),
   m_absmap(absmap),
   m_keymap(keymap),
   m_absinfo(ABS_MAX),
@@ -68,6 +70,11 @@ EvdevController::EvdevController(const std::string& filename,
     log_debug("name: " << m_name);
   }
 
+  { // timestamp events with the same clock as the rest of xboxdrv
+    int clock = CLOCK_MONOTONIC;
+    m_monotonic = (ioctl(m_fd, EVIOCSCLOCKID, &clock) == 0);
+  }
+
   if (m_grab)
   { // grab the device, so it doesn't broadcast events into the wild
     int ret = ioctl(m_fd, EVIOCGRAB, 1);
@@ -243,6 +250,10 @@ EvdevController::on_read_data(GIOChannel* source, GIOCondition condition)
     {
       if (ev[i].type == EV_SYN)
       {
+        if (m_monotonic)
+        {
+          m_msg.time = static_cast<int64_t>(ev[i].time.tv_sec) * 1000000000 + ev[i].time.tv_usec * 1000;
+        }
         submit_msg(m_msg);
       }
       else
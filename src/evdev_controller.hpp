@@ -39,6 +39,9 @@ private:
   bool m_grab;
   bool m_debug;
 
+  /** true when the kernel timestamps events with CLOCK_MONOTONIC */
+  bool m_monotonic;
+
   EvdevAbsMap m_absmap;
 
   typedef std::map<int, XboxButton> KeyMap;
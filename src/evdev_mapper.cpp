@@ -0,0 +1,273 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "evdev_mapper.hpp"
+
+#include <string.h>
+
+#include "helper.hpp"
+
+namespace {
+
+struct input_event make_event(int type, int code, int value)
+{
+  struct input_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.type  = static_cast<uint16_t>(type);
+  ev.code  = static_cast<uint16_t>(code);
+  ev.value = value;
+  return ev;
+}
+
+} // namespace
+
+EvdevMapper::EvdevMapper(const EvdevRemap& remap, const FrameCallback& callback) :
+  m_remap(remap),
+  m_callback(callback),
+  m_absinfo(ABS_CNT),
+  m_has_abs(ABS_CNT),
+  m_abs_value(ABS_CNT),
+  m_abs_out(ABS_CNT),
+  m_key_value(KEY_CNT),
+  m_key_out(KEY_CNT),
+  m_frame(),
+  m_frame_size(0),
+  m_in_frame(false),
+  m_dropped(false),
+  m_needs_sync(false)
+{
+}
+
+void
+EvdevMapper::set_absinfo(int code, const struct input_absinfo& absinfo)
+{
+  m_absinfo[code] = absinfo;
+  m_has_abs[code] = true;
+
+  // the output starts out unfiltered, the first flush() sends the
+  // filtered value if it differs
+  m_abs_value[code] = Math::clamp(absinfo.minimum, absinfo.value, absinfo.maximum);
+  m_abs_out[code] = m_abs_value[code];
+}
+
+bool
+EvdevMapper::has_filters() const
+{
+  return !m_remap.get_filtered_abs().empty() || !m_remap.get_filtered_key().empty();
+}
+
+bool
+EvdevMapper::process(const struct input_event& ev)
+{
+  if (ev.type == EV_SYN)
+  {
+    if (ev.code == SYN_DROPPED)
+    {
+      m_frame_size = 0;
+      m_in_frame = true;
+      m_dropped = true;
+    }
+    else if (ev.code == SYN_REPORT)
+    {
+      m_in_frame = false;
+      if (m_dropped)
+      {
+        // the device state has to be read back, events in between
+        // are lost
+        m_dropped = false;
+        m_needs_sync = true;
+      }
+      else
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  m_in_frame = true;
+
+  if (m_dropped)
+  {
+    return false;
+  }
+
+  struct input_event out = ev;
+
+  switch(ev.type)
+  {
+    case EV_ABS:
+      {
+        const EvdevRemap::Entry& entry = m_remap.abs(ev.code);
+        if (entry.code == -1)
+          return false;
+
+        const struct input_absinfo& absinfo = m_absinfo[ev.code];
+        // some buggy USB devices report values outside the given
+        // range, so we clamp it
+        out.value = Math::clamp(absinfo.minimum, ev.value, absinfo.maximum);
+        m_abs_value[ev.code] = out.value;
+        if (!entry.axis_filters.empty())
+        {
+          // sent from flush()
+          return false;
+        }
+        out.code = entry.code;
+      }
+      break;
+
+    case EV_KEY:
+      {
+        const EvdevRemap::Entry& entry = m_remap.key(ev.code);
+        if (entry.code == -1)
+          return false;
+
+        m_key_value[ev.code] = (ev.value != 0);
+        if (!entry.button_filters.empty())
+        {
+          // autorepeat goes through as long as the filtered button
+          // is down, everything else is sent from flush()
+          if (ev.value != 2 || !m_key_out[ev.code])
+          {
+            return false;
+          }
+        }
+        out.code = entry.code;
+      }
+      break;
+
+    case EV_REL:
+      {
+        const EvdevRemap::Entry& entry = m_remap.rel(ev.code);
+        if (entry.code == -1)
+          return false;
+
+        out.code = entry.code;
+      }
+      break;
+
+    default:
+      // EV_MSC and friends don't have a counterpart on the uinput side
+      return false;
+  }
+
+  append(out);
+  return false;
+}
+
+void
+EvdevMapper::sync_key(int code, bool value)
+{
+  if (m_key_value[code] != value)
+  {
+    process(make_event(EV_KEY, code, value));
+  }
+}
+
+void
+EvdevMapper::sync_abs(int code, int value)
+{
+  if (m_has_abs[code])
+  {
+    const struct input_absinfo& absinfo = m_absinfo[code];
+    if (m_abs_value[code] != Math::clamp(absinfo.minimum, value, absinfo.maximum))
+    {
+      process(make_event(EV_ABS, code, value));
+    }
+  }
+}
+
+void
+EvdevMapper::flush(int64_t nsec_delta)
+{
+  m_needs_sync = false;
+  m_in_frame = false;
+
+  m_remap.update(nsec_delta);
+
+  const std::vector<int>& filtered_abs = m_remap.get_filtered_abs();
+  for(std::vector<int>::const_iterator i = filtered_abs.begin(); i != filtered_abs.end(); ++i)
+  {
+    const EvdevRemap::Entry& entry = m_remap.abs(*i);
+    if (entry.code != -1 && m_has_abs[*i])
+    {
+      const struct input_absinfo& absinfo = m_absinfo[*i];
+      int value = m_abs_value[*i];
+      for(std::vector<AxisFilterPtr>::const_iterator f = entry.axis_filters.begin();
+          f != entry.axis_filters.end(); ++f)
+      {
+        value = (*f)->filter(value, absinfo.minimum, absinfo.maximum);
+      }
+
+      if (value != m_abs_out[*i])
+      {
+        m_abs_out[*i] = value;
+        append(make_event(EV_ABS, entry.code, value));
+      }
+    }
+  }
+
+  const std::vector<int>& filtered_key = m_remap.get_filtered_key();
+  for(std::vector<int>::const_iterator i = filtered_key.begin(); i != filtered_key.end(); ++i)
+  {
+    const EvdevRemap::Entry& entry = m_remap.key(*i);
+    if (entry.code != -1)
+    {
+      // filters like autofire must be called exactly once per update()
+      bool value = m_key_value[*i];
+      for(std::vector<ButtonFilterPtr>::const_iterator f = entry.button_filters.begin();
+          f != entry.button_filters.end(); ++f)
+      {
+        value = (*f)->filter(value);
+      }
+
+      if (value != m_key_out[*i])
+      {
+        m_key_out[*i] = value;
+        append(make_event(EV_KEY, entry.code, value));
+      }
+    }
+  }
+
+  if (m_frame_size > 0)
+  {
+    struct input_event& syn = m_frame[m_frame_size++];
+    memset(&syn, 0, sizeof(syn));
+    syn.time = m_frame[0].time;
+    syn.type = EV_SYN;
+    syn.code = SYN_REPORT;
+
+    m_callback(m_frame, m_frame_size);
+    m_frame_size = 0;
+  }
+}
+
+void
+EvdevMapper::append(const struct input_event& ev)
+{
+  if (m_frame_size == kMaxFrame - 1)
+  { // frame too large, send what we have without sync
+    m_callback(m_frame, m_frame_size);
+    m_frame_size = 0;
+  }
+
+  m_frame[m_frame_size++] = ev;
+}
+
+/* EOF */
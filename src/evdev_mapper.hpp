@@ -0,0 +1,111 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef HEADER_XBOXDRV_EVDEV_MAPPER_HPP
+#define HEADER_XBOXDRV_EVDEV_MAPPER_HPP
+
+#include <boost/function.hpp>
+#include <linux/input.h>
+#include <stdint.h>
+#include <vector>
+
+#include "evdev_remap.hpp"
+
+/** The device independent half of the evdev passthrough: remaps and
+    filters the events of the source device with an EvdevRemap and
+    collects them into SYN_REPORT frames. Codes with filters are not
+    forwarded as they arrive, their last input value is run through
+    the filters once per flush() instead, so that time based filters
+    like autofire keep going while the source device is idle. */
+class EvdevMapper
+{
+public:
+  typedef boost::function<void (const struct input_event* events, int count)> FrameCallback;
+
+private:
+  enum { kMaxFrame = 256 };
+
+public:
+  EvdevMapper(const EvdevRemap& remap, const FrameCallback& callback);
+
+  const EvdevRemap& get_remap() const { return m_remap; }
+
+  /** range of the source axis \a code, axes without one are clamped
+      to 0 */
+  void set_absinfo(int code, const struct input_absinfo& absinfo);
+
+  /** true when there are filters that need flush() called regularly */
+  bool has_filters() const;
+
+  /** true while the events of a frame are coming in, flush() must
+      not be called from a timer then */
+  bool in_frame() const { return m_in_frame; }
+
+  /** add \a ev to the current frame, returns true when \a ev was the
+      SYN_REPORT that completes it and flush() should be called */
+  bool process(const struct input_event& ev);
+
+  /** true when events were lost to SYN_DROPPED, the caller has to
+      read the state of the device and pass it to sync_key() and
+      sync_abs(), then call flush() */
+  bool needs_sync() const { return m_needs_sync; }
+
+  /** bring the state of a source code up to date after a
+      SYN_DROPPED, a change is processed like a regular event */
+  void sync_key(int code, bool value);
+  void sync_abs(int code, int value);
+
+  /** advance the filters by \a nsec_delta, add the filtered codes
+      whose output changed and pass the frame to the callback */
+  void flush(int64_t nsec_delta);
+
+private:
+  void append(const struct input_event& ev);
+
+private:
+  EvdevRemap m_remap;
+  FrameCallback m_callback;
+
+  std::vector<struct input_absinfo> m_absinfo;
+  std::vector<bool> m_has_abs;
+
+  /** last input value of every code and the last output value of the
+      filtered ones, indexed by the source code */
+  std::vector<int> m_abs_value;
+  std::vector<int> m_abs_out;
+  std::vector<bool> m_key_value;
+  std::vector<bool> m_key_out;
+
+  struct input_event m_frame[kMaxFrame];
+  int m_frame_size;
+  bool m_in_frame;
+
+  /** set after SYN_DROPPED, events are discarded up to the next
+      SYN_REPORT, which sets m_needs_sync */
+  bool m_dropped;
+  bool m_needs_sync;
+
+private:
+  EvdevMapper(const EvdevMapper&);
+  EvdevMapper& operator=(const EvdevMapper&);
+};
+
+#endif
+
+/* EOF */
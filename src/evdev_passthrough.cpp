@@ -0,0 +1,314 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "evdev_passthrough.hpp"
+
+#include <boost/bind.hpp>
+#include <boost/format.hpp>
+#include <errno.h>
+#include <fcntl.h>
+#include <iostream>
+#include <stdexcept>
+#include <string.h>
+
+#include "clock.hpp"
+#include "evdev_helper.hpp"
+#include "helper.hpp"
+#include "linux_uinput.hpp"
+#include "log.hpp"
+#include "raise_exception.hpp"
+
+#define BITS_PER_LONG (sizeof(long) * 8)
+#define NBITS(x) ((((x)-1)/BITS_PER_LONG)+1)
+#define OFF(x)  ((x)%BITS_PER_LONG)
+#define LONG(x) ((x)/BITS_PER_LONG)
+#define test_bit(bit, array)	((array[LONG(bit)] >> OFF(bit)) & 1)
+
+EvdevPassthrough::EvdevPassthrough(const std::string& filename,
+                                   const EvdevRemap& remap,
+                                   bool grab,
+                                   bool debug,
+                                   int timeout) :
+  m_fd(-1),
+  m_io_channel(),
+  m_source_id(),
+  m_timeout_id(),
+  m_name(),
+  m_id(),
+  m_debug(debug),
+  m_mapper(remap, boost::bind(&EvdevPassthrough::send_frame, this, _1, _2)),
+  m_uinput(),
+  m_last_time(Clock::now()),
+  m_disconnect_cb()
+{
+  m_fd = open(filename.c_str(), O_RDONLY | O_NONBLOCK);
+  if (m_fd == -1)
+  {
+    raise_exception(std::runtime_error, filename << ": " << strerror(errno));
+  }
+
+  char c_name[1024] = "unknown";
+  ioctl(m_fd, EVIOCGNAME(sizeof(c_name)), c_name);
+  m_name = c_name;
+  ioctl(m_fd, EVIOCGID, &m_id);
+  log_debug("name: " << m_name);
+
+  if (grab && ioctl(m_fd, EVIOCGRAB, 1) == -1)
+  {
+    int err = errno;
+    close(m_fd);
+    raise_exception(std::runtime_error, filename << ": failed to grab device: " << strerror(err));
+  }
+
+  try
+  {
+    create_uinput();
+  }
+  catch(...)
+  {
+    close(m_fd);
+    throw;
+  }
+
+  m_io_channel = g_io_channel_unix_new(m_fd);
+
+  GError* error = NULL;
+  if (g_io_channel_set_encoding(m_io_channel, NULL, &error) != G_IO_STATUS_NORMAL)
+  {
+    log_error(error->message);
+    g_error_free(error);
+  }
+
+  g_io_channel_set_buffered(m_io_channel, false);
+
+  m_source_id = g_io_add_watch(m_io_channel,
+                               static_cast<GIOCondition>(G_IO_IN | G_IO_ERR | G_IO_HUP),
+                               &EvdevPassthrough::on_read_data_wrap, this);
+
+  if (m_mapper.has_filters())
+  {
+    m_timeout_id = g_timeout_add(timeout, &EvdevPassthrough::on_timeout_wrap, this);
+  }
+}
+
+EvdevPassthrough::~EvdevPassthrough()
+{
+  if (m_timeout_id)
+  {
+    g_source_remove(m_timeout_id);
+  }
+
+  if (m_source_id)
+  {
+    g_source_remove(m_source_id);
+  }
+  g_io_channel_unref(m_io_channel);
+  close(m_fd);
+}
+
+void
+EvdevPassthrough::set_disconnect_cb(const boost::function<void ()>& callback)
+{
+  m_disconnect_cb = callback;
+}
+
+void
+EvdevPassthrough::create_uinput()
+{
+  unsigned long abs_bit[NBITS(ABS_CNT)];
+  unsigned long rel_bit[NBITS(REL_CNT)];
+  unsigned long key_bit[NBITS(KEY_CNT)];
+
+  memset(abs_bit, 0, sizeof(abs_bit));
+  memset(rel_bit, 0, sizeof(rel_bit));
+  memset(key_bit, 0, sizeof(key_bit));
+
+  ioctl(m_fd, EVIOCGBIT(EV_ABS, sizeof(abs_bit)), abs_bit);
+  ioctl(m_fd, EVIOCGBIT(EV_REL, sizeof(rel_bit)), rel_bit);
+  ioctl(m_fd, EVIOCGBIT(EV_KEY, sizeof(key_bit)), key_bit);
+
+  // keep the bus and ids of the source, so that games still
+  // recognize wheels and the like by their vendor/product
+  m_uinput.reset(new LinuxUinput(LinuxUinput::kGenericDevice, m_name, m_id));
+
+  const EvdevRemap& remap = m_mapper.get_remap();
+
+  // several source axes can be mapped to the same output axis, the
+  // range of the first one is used for it
+  std::vector<bool> abs_registered(ABS_CNT);
+
+  for(int i = 0; i < ABS_CNT; ++i)
+  {
+    if (test_bit(i, abs_bit))
+    {
+      struct input_absinfo absinfo;
+      memset(&absinfo, 0, sizeof(absinfo));
+      ioctl(m_fd, EVIOCGABS(i), &absinfo);
+      m_mapper.set_absinfo(i, absinfo);
+
+      const int code = remap.abs(i).code;
+      log_debug(boost::format("abs: %-20s min: %6d max: %6d -> %s")
+                % abs2str(i) % absinfo.minimum % absinfo.maximum
+                % (code == -1 ? "void" : abs2str(code)));
+
+      if (code != -1 && !abs_registered[code])
+      {
+        abs_registered[code] = true;
+        m_uinput->add_abs(code, absinfo.minimum, absinfo.maximum, absinfo.fuzz, absinfo.flat);
+      }
+    }
+  }
+
+  for(int i = 0; i < REL_CNT; ++i)
+  {
+    if (test_bit(i, rel_bit) && remap.rel(i).code != -1)
+    {
+      m_uinput->add_rel(remap.rel(i).code);
+    }
+  }
+
+  for(int i = 0; i < KEY_CNT; ++i)
+  {
+    if (test_bit(i, key_bit) && remap.key(i).code != -1)
+    {
+      m_uinput->add_key(remap.key(i).code);
+    }
+  }
+
+  m_uinput->finish();
+}
+
+void
+EvdevPassthrough::process(const struct input_event& ev)
+{
+  if (m_debug)
+  {
+    switch(ev.type)
+    {
+      case EV_KEY: std::cout << "EV_KEY " << key2str(ev.code) << " " << ev.value << std::endl; break;
+      case EV_REL: std::cout << "EV_REL " << rel2str(ev.code) << " " << ev.value << std::endl; break;
+      case EV_ABS: std::cout << "EV_ABS " << abs2str(ev.code) << " " << ev.value << std::endl; break;
+      case EV_SYN: std::cout << "------------------- sync -------------------" << std::endl; break;
+      default: break;
+    }
+  }
+
+  if (ev.type == EV_SYN && ev.code == SYN_DROPPED)
+  {
+    log_warn("events dropped by the kernel, resyncing");
+  }
+
+  if (m_mapper.process(ev))
+  {
+    m_mapper.flush(get_nsec_delta());
+  }
+  else if (m_mapper.needs_sync())
+  {
+    sync();
+    m_mapper.flush(get_nsec_delta());
+  }
+}
+
+void
+EvdevPassthrough::sync()
+{
+  unsigned long key_state[NBITS(KEY_CNT)];
+  memset(key_state, 0, sizeof(key_state));
+  if (ioctl(m_fd, EVIOCGKEY(sizeof(key_state)), key_state) < 0)
+  {
+    log_error("EVIOCGKEY failed: " << strerror(errno));
+  }
+  else
+  {
+    for(int i = 0; i < KEY_CNT; ++i)
+    {
+      m_mapper.sync_key(i, test_bit(i, key_state));
+    }
+  }
+
+  for(int i = 0; i < ABS_CNT; ++i)
+  {
+    struct input_absinfo absinfo;
+    if (ioctl(m_fd, EVIOCGABS(i), &absinfo) == 0)
+    {
+      m_mapper.sync_abs(i, absinfo.value);
+    }
+  }
+}
+
+void
+EvdevPassthrough::send_frame(const struct input_event* events, int count)
+{
+  m_uinput->send_frame(events, count);
+}
+
+int64_t
+EvdevPassthrough::get_nsec_delta()
+{
+  int64_t now = Clock::now();
+  int64_t nsec_delta = now - m_last_time;
+  m_last_time = now;
+  return nsec_delta;
+}
+
+bool
+EvdevPassthrough::on_timeout()
+{
+  // a frame that is still coming in gets flushed by its SYN_REPORT
+  if (!m_mapper.in_frame())
+  {
+    m_mapper.flush(get_nsec_delta());
+  }
+
+  return true; // do not remove the callback
+}
+
+gboolean
+EvdevPassthrough::on_read_data(GIOChannel* source, GIOCondition condition)
+{
+  struct input_event ev[128];
+  int rd = 0;
+  while((rd = ::read(m_fd, ev, sizeof(ev))) > 0)
+  {
+    for(size_t i = 0; i < rd / sizeof(struct input_event); ++i)
+    {
+      process(ev[i]);
+    }
+  }
+
+  const int err = (rd < 0) ? errno : 0;
+  if (err && err != EAGAIN)
+  {
+    log_error("read failure: " << strerror(err));
+  }
+
+  if (condition & (G_IO_ERR | G_IO_HUP) || err == ENODEV)
+  {
+    log_info("evdev device disconnected: " << m_name);
+    m_source_id = 0;
+    if (m_disconnect_cb)
+    {
+      m_disconnect_cb();
+    }
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* EOF */
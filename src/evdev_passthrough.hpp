@@ -0,0 +1,101 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_XBOXDRV_EVDEV_PASSTHROUGH_HPP
+#define HEADER_XBOXDRV_EVDEV_PASSTHROUGH_HPP
+
+#include <boost/function.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <glib.h>
+#include <linux/input.h>
+#include <string>
+#include <vector>
+
+#include "evdev_mapper.hpp"
+
+class LinuxUinput;
+
+/** Forwards an evdev device to a uinput device without going through
+    XboxGenericMsg, so every ABS_*, KEY_* and REL_* code the device
+    has survives. Events are remapped and filtered through an
+    EvdevMapper and each SYN_REPORT frame is written to uinput with a
+    single write(). When filters are in use they are also run every
+    \a timeout msec, so autofire and friends don't depend on the
+    device sending events. */
+class EvdevPassthrough
+{
+public:
+  EvdevPassthrough(const std::string& filename,
+                   const EvdevRemap& remap,
+                   bool grab,
+                   bool debug,
+                   int timeout);
+  ~EvdevPassthrough();
+
+  std::string get_name() const { return m_name; }
+
+  void set_disconnect_cb(const boost::function<void ()>& callback);
+
+private:
+  void create_uinput();
+  void process(const struct input_event& ev);
+
+  /** read the key and axis state back from the device after events
+      were lost to SYN_DROPPED */
+  void sync();
+  void send_frame(const struct input_event* events, int count);
+  int64_t get_nsec_delta();
+
+  bool on_timeout();
+  static gboolean on_timeout_wrap(gpointer data) {
+    return static_cast<EvdevPassthrough*>(data)->on_timeout();
+  }
+
+  gboolean on_read_data(GIOChannel* source, GIOCondition condition);
+  static gboolean on_read_data_wrap(GIOChannel* source,
+                                    GIOCondition condition,
+                                    gpointer userdata)
+  {
+    return static_cast<EvdevPassthrough*>(userdata)->on_read_data(source, condition);
+  }
+
+private:
+  int m_fd;
+  GIOChannel* m_io_channel;
+  guint m_source_id;
+  guint m_timeout_id;
+
+  std::string m_name;
+  struct input_id m_id;
+  bool m_debug;
+
+  EvdevMapper m_mapper;
+  boost::scoped_ptr<LinuxUinput> m_uinput;
+
+  int64_t m_last_time;
+
+  boost::function<void ()> m_disconnect_cb;
+
+private:
+  EvdevPassthrough(const EvdevPassthrough&);
+  EvdevPassthrough& operator=(const EvdevPassthrough&);
+};
+
+#endif
+
+/* EOF */
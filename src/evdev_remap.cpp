@@ -0,0 +1,170 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "evdev_remap.hpp"
+
+#include <boost/tokenizer.hpp>
+#include <stdexcept>
+
+#include "evdev_helper.hpp"
+#include "raise_exception.hpp"
+
+namespace {
+
+std::vector<EvdevRemap::Entry> identity_table(int count)
+{
+  std::vector<EvdevRemap::Entry> table;
+  table.reserve(count);
+  for(int i = 0; i < count; ++i)
+  {
+    table.push_back(EvdevRemap::Entry(i));
+  }
+  return table;
+}
+
+} // namespace
+
+EvdevRemap::EvdevRemap() :
+  m_abs(identity_table(ABS_CNT)),
+  m_key(identity_table(KEY_CNT)),
+  m_rel(identity_table(REL_CNT)),
+  m_filtered_abs(),
+  m_filtered_key()
+{
+}
+
+std::vector<EvdevRemap::Entry>&
+EvdevRemap::get_table(int type)
+{
+  switch(type)
+  {
+    case EV_ABS: return m_abs;
+    case EV_KEY: return m_key;
+    case EV_REL: return m_rel;
+    default:
+      raise_exception(std::runtime_error, "unsupported event type: " << type);
+  }
+}
+
+void
+EvdevRemap::bind(int type, int code, int out_code)
+{
+  std::vector<Entry>& table = get_table(type);
+
+  if (code < 0 || code >= static_cast<int>(table.size()) ||
+      out_code >= static_cast<int>(table.size()))
+  {
+    raise_exception(std::runtime_error, "event code out of range: " << code << " -> " << out_code);
+  }
+
+  table[code].code = out_code;
+}
+
+void
+EvdevRemap::add_axis_filter(int code, const AxisFilterPtr& filter)
+{
+  if (m_abs[code].axis_filters.empty())
+  {
+    m_filtered_abs.push_back(code);
+  }
+  m_abs[code].axis_filters.push_back(filter);
+}
+
+void
+EvdevRemap::add_button_filter(int code, const ButtonFilterPtr& filter)
+{
+  if (m_key[code].button_filters.empty())
+  {
+    m_filtered_key.push_back(code);
+  }
+  m_key[code].button_filters.push_back(filter);
+}
+
+void
+EvdevRemap::add(const std::string& name, const std::string& value)
+{
+  typedef boost::tokenizer<boost::char_separator<char> > tokenizer;
+  tokenizer tokens(name, boost::char_separator<char>("^", "", boost::keep_empty_tokens));
+
+  int type = -1;
+  int code = -1;
+  int idx = 0;
+  for(tokenizer::iterator t = tokens.begin(); t != tokens.end(); ++t, ++idx)
+  {
+    if (idx == 0)
+    {
+      str2event(*t, type, code);
+      if (type == -1)
+      {
+        raise_exception(std::runtime_error, "invalid evdev-remap source: " << name);
+      }
+
+      if (!value.empty())
+      {
+        int out_type;
+        int out_code;
+        str2event(value, out_type, out_code);
+        if (out_type != -1 && out_type != type)
+        {
+          raise_exception(std::runtime_error, "evdev-remap can't change the event type: " << name << "=" << value);
+        }
+        bind(type, code, out_code);
+      }
+    }
+    else
+    {
+      switch(type)
+      {
+        case EV_ABS:
+          add_axis_filter(code, AxisFilter::from_string(*t));
+          break;
+
+        case EV_KEY:
+          add_button_filter(code, ButtonFilter::from_string(*t));
+          break;
+
+        default:
+          raise_exception(std::runtime_error, "filters are only supported on ABS and KEY events: " << name);
+      }
+    }
+  }
+}
+
+void
+EvdevRemap::update(int64_t nsec_delta)
+{
+  for(std::vector<int>::iterator i = m_filtered_abs.begin(); i != m_filtered_abs.end(); ++i)
+  {
+    std::vector<AxisFilterPtr>& filters = m_abs[*i].axis_filters;
+    for(std::vector<AxisFilterPtr>::iterator f = filters.begin(); f != filters.end(); ++f)
+    {
+      (*f)->update(nsec_delta);
+    }
+  }
+
+  for(std::vector<int>::iterator i = m_filtered_key.begin(); i != m_filtered_key.end(); ++i)
+  {
+    std::vector<ButtonFilterPtr>& filters = m_key[*i].button_filters;
+    for(std::vector<ButtonFilterPtr>::iterator f = filters.begin(); f != filters.end(); ++f)
+    {
+      (*f)->update(nsec_delta);
+    }
+  }
+}
+
+/* EOF */
@@ -0,0 +1,88 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_XBOXDRV_EVDEV_REMAP_HPP
+#define HEADER_XBOXDRV_EVDEV_REMAP_HPP
+
+#include <linux/input.h>
+#include <string>
+#include <vector>
+
+#include "axis_filter.hpp"
+#include "button_filter.hpp"
+
+/** Per code remap and filter table for the evdev passthrough, it is
+    indexed directly by the event code, so a lookup costs no more than
+    an array access. Codes without an explicit binding are passed
+    through unchanged. */
+class EvdevRemap
+{
+public:
+  struct Entry
+  {
+    Entry(int code_) : code(code_), axis_filters(), button_filters() {}
+
+    /** output code, -1 drops the event */
+    int code;
+
+    std::vector<AxisFilterPtr> axis_filters;
+    std::vector<ButtonFilterPtr> button_filters;
+  };
+
+public:
+  EvdevRemap();
+
+  /** bind the source event \a type/\a code to \a out_code of the same
+      type, -1 drops the event */
+  void bind(int type, int code, int out_code);
+
+  void add_axis_filter(int code, const AxisFilterPtr& filter);
+  void add_button_filter(int code, const ButtonFilterPtr& filter);
+
+  /** parse "SRC[^FILTER]..." = "DST" as given to --evdev-remap, an
+      empty \a value keeps the current binding and only adds filters */
+  void add(const std::string& name, const std::string& value);
+
+  const Entry& abs(int code) const { return m_abs[code]; }
+  const Entry& key(int code) const { return m_key[code]; }
+  const Entry& rel(int code) const { return m_rel[code]; }
+
+  /** codes that have filters attached */
+  const std::vector<int>& get_filtered_abs() const { return m_filtered_abs; }
+  const std::vector<int>& get_filtered_key() const { return m_filtered_key; }
+
+  /** advance the time based filters */
+  void update(int64_t nsec_delta);
+
+private:
+  std::vector<Entry>& get_table(int type);
+
+private:
+  std::vector<Entry> m_abs;
+  std::vector<Entry> m_key;
+  std::vector<Entry> m_rel;
+
+  /** codes that have filters, so update() doesn't need to walk the
+      whole table */
+  std::vector<int> m_filtered_abs;
+  std::vector<int> m_filtered_key;
+};
+
+#endif
+
+/* EOF */
@@ -81,8 +81,9 @@ struct FirestormMsg
   unsigned int y2 :8;
 } __attribute__((__packed__));
 
-FirestormDualController::FirestormDualController(libusb_device* dev, bool is_vsb_, bool try_detach) :
-  USBController(dev),
+FirestormDualController::FirestormDualController(libusb_device* dev, bool is_vsb_, bool try_detach,
+                                                 int read_queue_depth) :
+  USBController(dev, read_queue_depth),
   is_vsb(is_vsb_)
 {
   usb_claim_interface(0, try_detach);
@@ -29,7 +29,7 @@ private:
   bool is_vsb;
 
 public:
-  FirestormDualController(libusb_device* dev, bool is_vsb, bool try_detach);
+  FirestormDualController(libusb_device* dev, bool is_vsb, bool try_detach, int read_queue_depth);
   ~FirestormDualController();
 
   void set_rumble_real(uint8_t left, uint8_t right);
@@ -18,6 +18,12 @@
 
 #include "force_feedback_handler.hpp"
 
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "clock.hpp"
 #include "log.hpp"
 #include "options.hpp"
 
@@ -108,35 +114,115 @@ std::ostream& operator<<(std::ostream& out, const struct ff_effect& effect)
   return out;
 }
 
+namespace {
+
+/** one period of a sine in 256 steps, scaled to [-0x7fff, 0x7fff] */
+class SineTable
+{
+public:
+  SineTable()
+  {
+    for(int i = 0; i < 256; ++i)
+    {
+      m_table[i] = static_cast<int>(0x7fff * sin(2.0 * M_PI * i / 256.0));
+    }
+  }
+
+  int operator[](int i) const { return m_table[i & 0xff]; }
+
+private:
+  int m_table[256];
+};
+
+const SineTable g_sine_table;
+
+int clamp(int lhs, int rhs, int v)
+{
+  return std::max(lhs, std::min(v, rhs));
+}
+
+/** linear interpolation between \a start and \a end, \a pos in [0, len] */
+int get_pos(int start, int end, int pos, int len)
+{
+  if (len <= 0)
+  {
+    return start;
+  }
+  else
+  {
+    int rel = end - start;
+    return start + static_cast<int>(static_cast<int64_t>(rel) * pos / len);
+  }
+}
+
+/** looks up \a t in [0, len] in a table of kEnvelopeSteps+1 samples */
+int lookup(const int* table, int t, int len)
+{
+  if (len <= 0)
+  {
+    return table[ForceFeedbackEffect::kEnvelopeSteps];
+  }
+  else
+  {
+    int64_t x = static_cast<int64_t>(t) * ForceFeedbackEffect::kEnvelopeSteps;
+    int idx  = static_cast<int>(x / len);
+    int frac = static_cast<int>(x % len);
+
+    if (idx >= ForceFeedbackEffect::kEnvelopeSteps)
+    {
+      return table[ForceFeedbackEffect::kEnvelopeSteps];
+    }
+    else
+    {
+      return get_pos(table[idx], table[idx+1], frac, len);
+    }
+  }
+}
+
+} // namespace
+
 ForceFeedbackEffect::ForceFeedbackEffect() :
+  type(kNone),
+  waveform(),
   delay(),
   length(),
   start_strong_magnitude(),
   start_weak_magnitude(),
   end_strong_magnitude(),
   end_weak_magnitude(),
-  envelope(),
+  period(),
+  phase(),
+  offset(),
+  attack_length(),
+  fade_length(),
+  attack_table(),
+  fade_table(),
   playing(false),
+  repeat(0),
   count(0),
   weak_magnitude(0),
   strong_magnitude(0)
 {
 }
 
-static int clamp(int lhs, int rhs, int v)
-{
-  return std::max(lhs, std::min(v, rhs));
-}
-
 ForceFeedbackEffect::ForceFeedbackEffect(const struct ff_effect& effect) :
+  type(kNone),
+  waveform(),
   delay(),
   length(),
   start_strong_magnitude(),
   start_weak_magnitude(),
   end_strong_magnitude(),
   end_weak_magnitude(),
-  envelope(),
+  period(),
+  phase(),
+  offset(),
+  attack_length(),
+  fade_length(),
+  attack_table(),
+  fade_table(),
   playing(false),
+  repeat(0),
   count(0),
   weak_magnitude(0),
   strong_magnitude(0)
@@ -155,142 +241,274 @@ ForceFeedbackEffect::ForceFeedbackEffect(const struct ff_effect& effect) :
   delay  = effect.replay.delay;
   length = effect.replay.length;
 
+  struct ff_envelope envelope;
+  memset(&envelope, 0, sizeof(envelope));
+
   switch(effect.type)
   {
     case FF_CONSTANT:
-      start_weak_magnitude   = clamp(0, 0x7fff, abs(effect.u.constant.level));
-      start_strong_magnitude = clamp(0, 0x7fff, abs(effect.u.constant.level));
-      end_weak_magnitude     = clamp(0, 0x7fff, abs(effect.u.constant.level));
-      end_strong_magnitude   = clamp(0, 0x7fff, abs(effect.u.constant.level));
+      type = kConstant;
+      start_weak_magnitude   = clamp(-0x7fff, 0x7fff, effect.u.constant.level);
+      start_strong_magnitude = start_weak_magnitude;
+      end_weak_magnitude     = start_weak_magnitude;
+      end_strong_magnitude   = start_weak_magnitude;
 
       envelope = effect.u.constant.envelope;
       break;
 
     case FF_PERIODIC:
-      start_weak_magnitude   = clamp(0, 0x7fff, abs(effect.u.periodic.magnitude));
-      start_strong_magnitude = clamp(0, 0x7fff, abs(effect.u.periodic.magnitude));
-      end_weak_magnitude     = clamp(0, 0x7fff, abs(effect.u.periodic.magnitude));
-      end_strong_magnitude   = clamp(0, 0x7fff, abs(effect.u.periodic.magnitude));
+      type = kPeriodic;
+      waveform = effect.u.periodic.waveform;
+      period   = std::max(1, static_cast<int>(effect.u.periodic.period));
+      phase    = effect.u.periodic.phase;
+      offset   = effect.u.periodic.offset;
+
+      start_weak_magnitude   = clamp(-0x7fff, 0x7fff, effect.u.periodic.magnitude);
+      start_strong_magnitude = start_weak_magnitude;
+      end_weak_magnitude     = start_weak_magnitude;
+      end_strong_magnitude   = start_weak_magnitude;
 
       envelope = effect.u.periodic.envelope;
       break;
 
     case FF_RAMP:
-      start_weak_magnitude   = clamp(0, 0x7fff, abs(effect.u.ramp.start_level));
-      start_strong_magnitude = clamp(0, 0x7fff, abs(effect.u.ramp.start_level));
-      end_weak_magnitude     = clamp(0, 0x7fff, abs(effect.u.ramp.end_level));
-      end_strong_magnitude   = clamp(0, 0x7fff, abs(effect.u.ramp.end_level));
+      type = kRamp;
+      start_weak_magnitude   = clamp(-0x7fff, 0x7fff, effect.u.ramp.start_level);
+      start_strong_magnitude = start_weak_magnitude;
+      end_weak_magnitude     = clamp(-0x7fff, 0x7fff, effect.u.ramp.end_level);
+      end_strong_magnitude   = end_weak_magnitude;
 
       envelope = effect.u.ramp.envelope;
       break;
 
     case FF_RUMBLE:
+      type = kRumble;
       start_weak_magnitude   = clamp(0, 0x7fff, effect.u.rumble.weak_magnitude);
       start_strong_magnitude = clamp(0, 0x7fff, effect.u.rumble.strong_magnitude);
-      end_weak_magnitude     = clamp(0, 0x7fff, effect.u.rumble.weak_magnitude);
-      end_strong_magnitude   = clamp(0, 0x7fff, effect.u.rumble.strong_magnitude);
+      end_weak_magnitude     = start_weak_magnitude;
+      end_strong_magnitude   = start_strong_magnitude;
+      break;
+
+    case FF_SPRING:
+    case FF_FRICTION:
+    case FF_DAMPER:
+    case FF_INERTIA:
+      // Condition effects react to the position of the stick, which
+      // a rumble motor can't do, so approximate them as a steady
+      // rumble with the strength of the coefficient
+      type = kCondition;
+      start_strong_magnitude = clamp(0, 0x7fff, (abs(effect.u.condition[0].right_coeff) +
+                                                 abs(effect.u.condition[0].left_coeff)) / 2);
+      start_weak_magnitude   = clamp(0, 0x7fff, (abs(effect.u.condition[1].right_coeff) +
+                                                 abs(effect.u.condition[1].left_coeff)) / 2);
+      end_strong_magnitude   = start_strong_magnitude;
+      end_weak_magnitude     = start_weak_magnitude;
       break;
 
     default:
       // Unsupported effects
-      // case FF_SPRING:
-      // case FF_FRICTION:
-      // case FF_DAMPER
-      // case FF_INERTIA:
+      // case FF_CUSTOM:
       log_info("unsupported effect: " << effect);
-      start_weak_magnitude   = 0;
-      start_strong_magnitude = 0;
-      end_weak_magnitude     = 0;
-      end_strong_magnitude   = 0;
       break;
   }
+
+  build_envelope(envelope);
 }
 
-static int get_pos(int start, int end, int pos, int len)
+void
+ForceFeedbackEffect::build_envelope(const struct ff_envelope& envelope)
 {
-  int rel = end - start;
-  return start + (rel * pos / len);
+  attack_length = envelope.attack_length;
+  fade_length   = envelope.fade_length;
+
+  if (length > 0)
+  {
+    attack_length = std::min(attack_length, length);
+    fade_length   = std::min(fade_length, length - attack_length);
+  }
+
+  for(int i = 0; i <= kEnvelopeSteps; ++i)
+  {
+    // attack goes from attack_level to the effect level
+    int ta = attack_length * i / kEnvelopeSteps;
+    int level = get_level(ta);
+    int attack_level = (level < 0) ? -envelope.attack_level : envelope.attack_level;
+    attack_table[i] = get_pos(attack_level, level, i, kEnvelopeSteps);
+
+    // fade goes from the effect level to fade_level
+    int tf = length - fade_length + fade_length * i / kEnvelopeSteps;
+    level = get_level(tf);
+    int fade_level = (level < 0) ? -envelope.fade_level : envelope.fade_level;
+    fade_table[i] = get_pos(level, fade_level, i, kEnvelopeSteps);
+  }
+}
+
+int
+ForceFeedbackEffect::get_level(int t) const
+{
+  switch(type)
+  {
+    case kRamp:
+      return get_pos(start_weak_magnitude, end_weak_magnitude, t, length);
+
+    default:
+      return start_weak_magnitude;
+  }
+}
+
+int
+ForceFeedbackEffect::get_enveloped_level(int t) const
+{
+  if (t < attack_length)
+  {
+    return lookup(attack_table, t, attack_length);
+  }
+  else if (length > 0 && t >= length - fade_length)
+  {
+    return lookup(fade_table, t - (length - fade_length), fade_length);
+  }
+  else
+  {
+    return get_level(t);
+  }
+}
+
+int
+ForceFeedbackEffect::get_wave(int t) const
+{
+  // position inside the period as 16bit fraction
+  int pos = static_cast<int>((static_cast<int64_t>(t % period) * 0x10000) / period);
+  pos = (pos + phase) & 0xffff;
+
+  switch(waveform)
+  {
+    case FF_SQUARE:
+      return (pos < 0x8000) ? 0x7fff : -0x7fff;
+
+    case FF_TRIANGLE:
+      if (pos < 0x4000)
+        return pos * 0x7fff / 0x4000;
+      else if (pos < 0xc000)
+        return 0x7fff - (pos - 0x4000) * 0x7fff / 0x4000;
+      else
+        return -0x7fff + (pos - 0xc000) * 0x7fff / 0x4000;
+
+    case FF_SAW_UP:
+      return -0x7fff + pos * 0x7fff / 0x8000;
+
+    case FF_SAW_DOWN:
+      return 0x7fff - pos * 0x7fff / 0x8000;
+
+    case FF_SINE:
+    default: // FF_CUSTOM is played as sine
+      return g_sine_table[pos >> 8];
+  }
 }
 
 void
-ForceFeedbackEffect::update(int msec_delta)
+ForceFeedbackEffect::take_state(const ForceFeedbackEffect& effect)
+{
+  playing          = effect.playing;
+  repeat           = effect.repeat;
+  count            = effect.count;
+  weak_magnitude   = effect.weak_magnitude;
+  strong_magnitude = effect.strong_magnitude;
+}
+
+void
+ForceFeedbackEffect::update(int64_t nsec_delta)
 {
   if (playing)
   {
-    count += msec_delta;
+    count += nsec_delta;
 
-    if (count > delay)
+    if (count > msec2nsec(delay))
     {
-      int t = count - delay;
-      if (t < envelope.attack_length)
-      { // attack
-        strong_magnitude = get_pos(start_strong_magnitude, end_strong_magnitude, t, length);
-        weak_magnitude   = get_pos(start_weak_magnitude,   end_weak_magnitude,   t, length);
-
-        // apply envelope
-        strong_magnitude = ((envelope.attack_level * t) + strong_magnitude * (envelope.attack_length - t)) / envelope.attack_length;
-        weak_magnitude   = ((envelope.attack_level * t) + weak_magnitude   * (envelope.attack_length - t)) / envelope.attack_length;
-      }
-      else if  (t < length - envelope.fade_length)
-      { // sustain
-        strong_magnitude = get_pos(start_strong_magnitude, end_strong_magnitude, t, length);
-        weak_magnitude   = get_pos(start_weak_magnitude,   end_weak_magnitude,   t, length);
+      int t = nsec2msec(count) - delay;
+
+      if (length > 0 && t >= length)
+      {
+        if (repeat > 1)
+        { // start the next iteration
+          repeat -= 1;
+          count = 0;
+          t = 0;
+        }
+        else
+        { // effect ended
+          stop();
+          return;
+        }
       }
-      else if (t < length)
-      { // fade
-        strong_magnitude = get_pos(start_strong_magnitude, end_strong_magnitude, t, length);
-        weak_magnitude   = get_pos(start_weak_magnitude,   end_weak_magnitude,   t, length);
-
-        // apply envelope
-        int dt = t - (length - envelope.fade_length);
-        strong_magnitude = ((envelope.fade_level * dt) + strong_magnitude * (envelope.fade_length - dt)) / envelope.fade_length;
-        weak_magnitude   = ((envelope.fade_level * dt) + weak_magnitude   * (envelope.fade_length - dt)) / envelope.fade_length;
-      }
-      else
-      { // effect ended
-        stop();
+
+      switch(type)
+      {
+        case kRumble:
+        case kCondition:
+          strong_magnitude = start_strong_magnitude;
+          weak_magnitude   = start_weak_magnitude;
+          break;
+
+        case kPeriodic:
+          {
+            int magnitude = get_enveloped_level(t);
+            int level = clamp(-0x7fff, 0x7fff, offset + magnitude * get_wave(t) / 0x7fff);
+            strong_magnitude = abs(level);
+            weak_magnitude   = abs(level);
+          }
+          break;
+
+        case kConstant:
+        case kRamp:
+          strong_magnitude = abs(get_enveloped_level(t));
+          weak_magnitude   = strong_magnitude;
+          break;
+
+        case kNone:
+          break;
       }
     }
   }
 }
 
 void
-ForceFeedbackEffect::play()
+ForceFeedbackEffect::play(int repeat_)
 {
   playing = true;
+  repeat  = repeat_;
+  count   = 0;
 }
 
 void
 ForceFeedbackEffect::stop()
 {
   playing = false;
+  repeat = 0;
   count = 0;
   weak_magnitude   = 0;
   strong_magnitude = 0;
 }
-
+
 ForceFeedbackHandler::ForceFeedbackHandler() :
   gain(0xFFFF),
-  max_effects(16),
   effects(),
+  used(),
   weak_magnitude(0),
   strong_magnitude(0)
 {
-
 }
 
 ForceFeedbackHandler::~ForceFeedbackHandler()
 {
-
 }
 
 int
 ForceFeedbackHandler::get_max_effects()
 {
-  return max_effects;
+  return kMaxEffects;
 }
 
-void
+bool
 ForceFeedbackHandler::upload(const struct ff_effect& effect)
 {
   log_debug("FF_UPLOAD("
@@ -299,24 +517,25 @@ ForceFeedbackHandler::upload(const struct ff_effect& effect)
             << ",\n          "  << effect
             << ")");
 
-  std::map<int, ForceFeedbackEffect>::iterator i = effects.find(effect.id);
-  if (i == effects.end())
+  if (effect.id < 0 || effect.id >= kMaxEffects)
   {
-    effects[effect.id] = ForceFeedbackEffect(effect);
+    log_warn("effect id out of range: " << effect.id);
+    return false;
   }
   else
   {
-    ForceFeedbackEffect old_effect = i->second;
     ForceFeedbackEffect new_effect(effect);
 
-    // We the copy state variables of the effect , so we can update
-    // the effect while it is playing
-    new_effect.playing          = old_effect.playing;
-    new_effect.count            = old_effect.count;
-    new_effect.weak_magnitude   = old_effect.weak_magnitude;
-    new_effect.strong_magnitude = old_effect.strong_magnitude;
+    if (used[effect.id])
+    {
+      // We the copy state variables of the effect, so we can update
+      // the effect while it is playing
+      new_effect.take_state(effects[effect.id]);
+    }
 
-    effects[effect.id] = effect;
+    effects[effect.id] = new_effect;
+    used[effect.id] = true;
+    return true;
   }
 }
 
@@ -325,10 +544,10 @@ ForceFeedbackHandler::erase(int id)
 {
   log_debug("FF_ERASE(effect_id:" << id << ")");
 
-  std::map<int, ForceFeedbackEffect>::iterator i = effects.find(id);
-  if (i != effects.end())
+  if (id >= 0 && id < kMaxEffects && used[id])
   {
-    effects.erase(i);
+    effects[id] = ForceFeedbackEffect();
+    used[id] = false;
   }
   else
   {
@@ -337,14 +556,13 @@ ForceFeedbackHandler::erase(int id)
 }
 
 void
-ForceFeedbackHandler::play(int id)
+ForceFeedbackHandler::play(int id, int repeat)
 {
-  log_debug("FFPlay(effect_id:" << id << ")");
+  log_debug("FFPlay(effect_id:" << id << ", repeat:" << repeat << ")");
 
-  std::map<int, ForceFeedbackEffect>::iterator i = effects.find(id);
-  if (i != effects.end())
+  if (id >= 0 && id < kMaxEffects && used[id])
   {
-    i->second.play();
+    effects[id].play(repeat);
   }
   else
   {
@@ -357,10 +575,9 @@ ForceFeedbackHandler::stop(int id)
 {
   log_debug("FFStop(effect_id:" << id << ")");
 
-  std::map<int, ForceFeedbackEffect>::iterator i = effects.find(id);
-  if (i != effects.end())
+  if (id >= 0 && id < kMaxEffects && used[id])
   {
-    i->second.stop();
+    effects[id].stop();
   }
   else
   {
@@ -371,40 +588,57 @@ ForceFeedbackHandler::stop(int id)
 void
 ForceFeedbackHandler::set_gain(int g)
 {
-  gain = g;
+  gain = clamp(0, 0xffff, g);
 }
 
 void
-ForceFeedbackHandler::update(int msec_delta)
+ForceFeedbackHandler::update(int64_t nsec_delta)
 {
-  weak_magnitude   = 0;
-  strong_magnitude = 0;
+  // up to kMaxEffects magnitudes of 0x7fff each, times a gain of
+  // 0xffff, doesn't fit into an int
+  int64_t weak   = 0;
+  int64_t strong = 0;
 
-  if (!effects.empty())
+  for(int i = 0; i < kMaxEffects; ++i)
   {
-    for(Effects::iterator i = effects.begin(); i != effects.end(); ++i)
+    if (effects[i].is_playing())
     {
-      i->second.update(msec_delta);
+      effects[i].update(nsec_delta);
 
-      weak_magnitude   += i->second.get_weak_magnitude();
-      strong_magnitude += i->second.get_strong_magnitude();
+      weak   += effects[i].get_weak_magnitude();
+      strong += effects[i].get_strong_magnitude();
     }
+  }
+
+  // apply the gain before clamping, so a low gain doesn't turn a
+  // saturated mix into a constant value
+  weak_magnitude   = static_cast<int>(std::min(weak   * gain / 0xffff, static_cast<int64_t>(0x7fff)));
+  strong_magnitude = static_cast<int>(std::min(strong * gain / 0xffff, static_cast<int64_t>(0x7fff)));
+}
 
-    weak_magnitude   = std::min(weak_magnitude,   0x7fff);
-    strong_magnitude = std::min(strong_magnitude, 0x7fff);
+bool
+ForceFeedbackHandler::is_active() const
+{
+  for(int i = 0; i < kMaxEffects; ++i)
+  {
+    if (effects[i].is_playing())
+    {
+      return true;
+    }
   }
+  return false;
 }
 
 int
 ForceFeedbackHandler::get_weak_magnitude() const
 {
-  return weak_magnitude * gain / 0xffff;
+  return weak_magnitude;
 }
 
 int
 ForceFeedbackHandler::get_strong_magnitude() const
 {
-  return strong_magnitude * gain / 0xffff;
+  return strong_magnitude;
 }
-
+
 /* EOF */
@@ -20,74 +20,89 @@
 #define HEADER_FF_HANDLER_HPP
 
 #include <linux/input.h>
-#include <map>
-
+#include <stdint.h>
+
 class ForceFeedbackEffect
 {
+public:
+  /** number of steps in the precomputed attack and fade tables */
+  enum { kEnvelopeSteps = 32 };
+
 public:
   ForceFeedbackEffect();
   ForceFeedbackEffect(const struct ff_effect& e);
 
+  int  get_weak_magnitude()   const { return weak_magnitude; }
+  int  get_strong_magnitude() const { return strong_magnitude; }
+  bool is_playing() const { return playing; }
+
+  /** take over the playback state of \a effect, used when an effect
+      gets updated while it is playing */
+  void take_state(const ForceFeedbackEffect& effect);
+
+  void update(int64_t nsec_delta);
+  void play(int repeat);
+  void stop();
+
+private:
+  enum Type { kNone, kConstant, kPeriodic, kRamp, kRumble, kCondition };
+
+  /** signed level at time \a t without the envelope applied */
+  int get_level(int t) const;
+
+  /** level at time \a t with the envelope applied */
+  int get_enveloped_level(int t) const;
+
+  /** waveform value at time \a t in the range [-0x7fff, 0x7fff] */
+  int get_wave(int t) const;
+
+  void build_envelope(const struct ff_envelope& e);
+
+private:
+  Type type;
+  int  waveform;
+
   // Delay before the effect start
   int delay;
 
-  // Length of the effect
+  // Length of the effect, 0 means infinite
   int length;
 
-  // Rumble motor strength
+  // Rumble motor strength, or signed level for constant and ramp
   int start_strong_magnitude;
   int start_weak_magnitude;
-
-  // Rumble motor strength
   int end_strong_magnitude;
   int end_weak_magnitude;
 
-  // Envelope
-  struct Envelope
-  {
-    Envelope()
-      : attack_length(0),
-        attack_level(0),
-        fade_length(0),
-        fade_level(0)
-    {}
-
-    Envelope(const struct ff_envelope& e)
-      : attack_length(e.attack_length),
-        attack_level(e.attack_level),
-        fade_length(e.fade_length),
-        fade_level(e.fade_level)
-    {
-    }
-
-    int attack_length;
-    int attack_level;
-
-    int fade_length;
-    int fade_level;
-  } envelope;
+  // Periodic effects
+  int period;
+  int phase;
+  int offset;
+
+  // Envelope, the tables hold the enveloped level sampled in
+  // kEnvelopeSteps steps over the attack and fade time
+  int attack_length;
+  int fade_length;
+  int attack_table[kEnvelopeSteps + 1];
+  int fade_table[kEnvelopeSteps + 1];
 
   bool playing;
-  int  count;
+  int  repeat;
+  int64_t count; /// nsec since play()
   int  weak_magnitude;
   int  strong_magnitude;
-
-  int  get_weak_magnitude()   const { return weak_magnitude; }
-  int  get_strong_magnitude() const { return strong_magnitude; }
-
-  void update(int msec_delta);
-  void play();
-  void stop();
 };
-
-/** */
+
+/** Mixes the uploaded effects into the two rumble motor magnitudes */
 class ForceFeedbackHandler
 {
+public:
+  enum { kMaxEffects = 16 };
+
 private:
   int gain;
-  int max_effects;
-  typedef std::map<int, ForceFeedbackEffect> Effects;
-  Effects effects;
+  ForceFeedbackEffect effects[kMaxEffects];
+  bool used[kMaxEffects];
 
   int weak_magnitude;
   int strong_magnitude;
@@ -98,20 +113,25 @@ public:
 
   int get_max_effects();
 
-  void upload(const struct ff_effect& effect);
+  /** returns false if the effect could not be stored */
+  bool upload(const struct ff_effect& effect);
   void erase(int id);
 
-  void play(int id);
+  void play(int id, int repeat);
   void stop(int id);
 
-  void set_gain(int id);
+  void set_gain(int gain);
+
+  void update(int64_t nsec_delta);
 
-  void update(int msec_delta);
+  /** true while at least one effect is playing, update() only needs
+      to be called while this is the case */
+  bool is_active() const;
 
   int get_weak_magnitude() const;
   int get_strong_magnitude() const;
 };
-
+
 #endif
 
 /* EOF */
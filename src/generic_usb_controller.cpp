@@ -19,17 +19,27 @@
 #include "generic_usb_controller.hpp"
 
 #include <iostream>
+#include <string.h>
 
 #include "helper.hpp"
+#include "hid_report_plan.hpp"
 #include "raise_exception.hpp"
+#include "usb_helper.hpp"
 
 GenericUSBController::GenericUSBController(libusb_device* dev,
                                            int interface, int endpoint,
-                                           bool try_detach) :
-  USBController(dev),
+                                           bool try_detach,
+                                           const HidMap& map,
+                                           int read_queue_depth) :
+  USBController(dev, read_queue_depth),
   m_interface(interface),
-  m_endpoint(endpoint)
+  m_endpoint(endpoint),
+  m_plan(),
+  m_msg()
 {
+  memset(&m_msg, 0, sizeof(m_msg));
+  m_msg.type = XBOX_MSG_XBOX360;
+
   struct libusb_config_descriptor* config;
   if (libusb_get_active_config_descriptor(dev, &config) != LIBUSB_SUCCESS)
   {
@@ -56,6 +66,7 @@ GenericUSBController::GenericUSBController(libusb_device* dev,
 
     log_debug("wMaxPacketSize: " << wMaxPacketSize);
     usb_claim_interface(m_interface, try_detach);
+    read_report_descriptor(map);
     usb_submit_read(m_endpoint, wMaxPacketSize);
   }
 }
@@ -64,6 +75,42 @@ GenericUSBController::~GenericUSBController()
 {
 }
 
+void
+GenericUSBController::read_report_descriptor(const HidMap& map)
+{
+  uint8_t buf[4096];
+  int len = libusb_control_transfer(m_handle,
+                                    LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_STANDARD | LIBUSB_RECIPIENT_INTERFACE,
+                                    LIBUSB_REQUEST_GET_DESCRIPTOR,
+                                    LIBUSB_DT_REPORT << 8, static_cast<uint16_t>(m_interface),
+                                    buf, sizeof(buf), 1000);
+  if (len < 0)
+  {
+    log_warn("failed to read HID report descriptor: " << usb_strerror(len));
+    return;
+  }
+
+  try
+  {
+    std::vector<HidField> fields = HidReportDescriptor::parse(buf, len);
+    m_plan.reset(new HidReportPlan(fields, map.empty() ? HidMap::create_default() : map));
+    if (m_plan->empty())
+    {
+      log_warn("HID report descriptor contains no mapped usages");
+      m_plan.reset();
+    }
+    else
+    {
+      log_debug("HID report plan:\n" << m_plan->str());
+    }
+  }
+  catch(const std::exception& err)
+  {
+    log_warn("failed to parse HID report descriptor: " << err.what());
+    m_plan.reset();
+  }
+}
+
 void
 GenericUSBController::set_rumble_real(uint8_t left, uint8_t right)
 {
@@ -79,8 +126,20 @@ GenericUSBController::set_led_real(uint8_t status)
 bool
 GenericUSBController::parse(uint8_t* data, int len, XboxGenericMsg* msg_out)
 {
-  std::cout << "GenericUSBController:parse(): " << raw2str(data, len) << std::endl;
-  return false;
+  if (!m_plan)
+  {
+    std::cout << "GenericUSBController:parse(): " << raw2str(data, len) << std::endl;
+    return false;
+  }
+  else if (!m_plan->decode(data, len, m_msg))
+  {
+    return false;
+  }
+  else
+  {
+    *msg_out = m_msg;
+    return true;
+  }
 }
 
 /* EOF */
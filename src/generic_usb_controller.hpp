@@ -19,25 +19,38 @@
 #ifndef HEADER_XBOXDRV_GENERIC_USB_CONTROLLER_HPP
 #define HEADER_XBOXDRV_GENERIC_USB_CONTROLLER_HPP
 
+#include <boost/scoped_ptr.hpp>
 #include <libusb.h>
 
 #include "xboxmsg.hpp"
 #include "usb_controller.hpp"
 
+class HidMap;
+class HidReportPlan;
+
 class GenericUSBController : public USBController
 {
 private:
   int m_interface;
   int m_endpoint;
 
+  /** compiled from the HID report descriptor, NULL when the device
+      doesn't provide a usable one */
+  boost::scoped_ptr<HidReportPlan> m_plan;
+  XboxGenericMsg m_msg;
+
 public:
-  GenericUSBController(libusb_device* dev, int interface, int endpoint, bool try_detach);
+  GenericUSBController(libusb_device* dev, int interface, int endpoint, bool try_detach,
+                       const HidMap& map, int read_queue_depth);
   ~GenericUSBController();
 
   void set_rumble_real(uint8_t left, uint8_t right);
   void set_led_real(uint8_t status);
   bool parse(uint8_t* data, int len, XboxGenericMsg* msg_out);
 
+private:
+  void read_report_descriptor(const HidMap& map);
+
 private:
   GenericUSBController(const GenericUSBController&);
   GenericUSBController& operator=(const GenericUSBController&);
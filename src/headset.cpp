@@ -18,82 +18,219 @@
 
 #include "headset.hpp"
 
-#include <fstream>
-#include <errno.h>
 #include <boost/bind.hpp>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
 
 #include "helper.hpp"
 #include "raise_exception.hpp"
 #include "usb_helper.hpp"
 
+namespace {
+
+/** Opens \a filename non-blocking, "unix:PATH" connects to a Unix
+    socket. Returns -1 on error and sets errno, ENXIO means that a
+    named pipe has no reader yet. */
+int open_stream(const std::string& filename, bool output)
+{
+  if (filename.compare(0, 5, "unix:") == 0)
+  {
+    std::string path = filename.substr(5);
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+    {
+      errno = ENAMETOOLONG;
+      return -1;
+    }
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+      return -1;
+    }
+    else if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0)
+    {
+      int err = errno;
+      close(fd);
+      errno = err;
+      return -1;
+    }
+    else
+    {
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+      return fd;
+    }
+  }
+  else if (output)
+  {
+    return open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NONBLOCK, 0644);
+  }
+  else
+  {
+    return open(filename.c_str(), O_RDONLY | O_NONBLOCK);
+  }
+}
+
+/** Waits till \a fd is ready for \a events, returns false when the
+    wait was interrupted by the eventfd. A \a fd of -1 only waits for
+    the eventfd, \a timeout is in msec. */
+bool wait_for(int fd, short events, int event_fd, int timeout = -1)
+{
+  struct pollfd fds[2];
+  fds[0].fd = event_fd;
+  fds[0].events = POLLIN;
+  fds[0].revents = 0;
+  fds[1].fd = fd;
+  fds[1].events = events;
+  fds[1].revents = 0;
+
+  int ret = poll(fds, (fd < 0) ? 1 : 2, timeout);
+  if (ret > 0 && (fds[0].revents & POLLIN))
+  {
+    eventfd_t value;
+    eventfd_read(event_fd, &value);
+  }
+
+  return ret > 0 && fds[1].revents != 0;
+}
+
+} // namespace
+
+Headset::Stream::Stream() :
+  filename(),
+  output(false),
+  fd(-1),
+  buffer(kBufferSize),
+  thread(0),
+  event_fd(-1),
+  quit(0),
+  eof(0),
+  started(false),
+  xruns(0)
+{
+}
+
 Headset::Headset(libusb_device_handle* handle, bool debug) :
   m_handle(handle),
   m_interface(new USBInterface(m_handle, 1)),
-  m_fout(),
-  m_fin()
+  m_debug(debug),
+  m_play(),
+  m_record()
 {
 }
 
 Headset::~Headset()
 {
+  // stop the USB side first, so the streams are only used by their threads
   m_interface.reset();
+
+  if (m_play.get())
+  {
+    stop_stream(*m_play);
+    if (m_play->xruns > 0)
+    {
+      log_info("[headset] playback had " << m_play->xruns << " buffer underruns");
+    }
+  }
+
+  if (m_record.get())
+  {
+    stop_stream(*m_record);
+    if (m_record->xruns > 0)
+    {
+      log_info("[headset] recording had " << m_record->xruns << " buffer overruns");
+    }
+  }
 }
 
 void
 Headset::play_file(const std::string& filename)
 {
-  m_fin.reset(new std::ifstream(filename.c_str(), std::ios::binary));
+  assert(!m_play.get());
 
-  if (!*m_fin)
+  m_play.reset(new Stream);
+  m_play->filename = filename;
+  m_play->output = false;
+  m_play->fd = open_stream(filename, false);
+  if (m_play->fd < 0)
   {
-    std::ostringstream out;
-    out << "[headset] " << filename << ": " << strerror(errno);
-    throw std::runtime_error(out.str());
+    int err = errno;
+    m_play.reset();
+    raise_exception(std::runtime_error, "[headset] " << filename << ": " << strerror(err));
   }
-  else
+  start_stream(*m_play);
+
+  // start with silence, the transfers get refilled from the buffer
+  // as they complete
+  uint8_t silence[kPacketSize];
+  memset(silence, 0, sizeof(silence));
+  for(int i = 0; i < kTransfers; ++i)
   {
-    char data[32];
-    int len = m_fin->read(data, sizeof(data)).gcount();
-    if (len != 32)
-    {
-      log_error("short read");
-    }
-    else
-    {
-      m_interface->submit_write(4, reinterpret_cast<uint8_t*>(data), len,
-                                boost::bind(&Headset::send_data, this, _1));
-    }
+    m_interface->submit_write(4, silence, sizeof(silence),
+                              boost::bind(&Headset::send_data, this, _1));
   }
 }
 
 void
 Headset::record_file(const std::string& filename)
 {
-  m_fout.reset(new std::ofstream(filename.c_str(), std::ios::binary));
+  assert(!m_record.get());
 
-  if (!*m_fout)
+  m_record.reset(new Stream);
+  m_record->filename = filename;
+  m_record->output = true;
+  m_record->fd = open_stream(filename, true);
+  if (m_record->fd < 0 && errno != ENXIO)
   {
-    raise_exception(std::runtime_error, filename << ": " << strerror(errno));
-  }
-  else
-  {
-    m_interface->submit_read(3, 32, boost::bind(&Headset::receive_data, this, _1, _2));
+    // ENXIO is a named pipe without a reader, the thread waits for one
+    int err = errno;
+    m_record.reset();
+    raise_exception(std::runtime_error, "[headset] " << filename << ": " << strerror(err));
   }
+  start_stream(*m_record);
+
+  m_interface->submit_read(3, kPacketSize, boost::bind(&Headset::receive_data, this, _1, _2),
+                           kTransfers);
 }
 
 bool
 Headset::send_data(libusb_transfer* transfer)
 {
-  // fill the buffer with new data from the file
-  int len = m_fin->read(reinterpret_cast<char*>(transfer->buffer), transfer->length).gcount();
+  Stream& stream = *m_play;
 
-  if (len != 32)
+  if (stream.buffer.get_read_space() >= transfer->length)
   {
-    log_error("short read");
+    stream.buffer.read(transfer->buffer, transfer->length);
+    stream.started = true;
+    wakeup(stream);
+    return true;
+  }
+  else if (g_atomic_int_get(&stream.eof))
+  {
+    // all data is played, drop the remaining partial packet
     return false;
   }
   else
   {
+    // the file side didn't keep up, play silence
+    if (stream.started)
+    {
+      stream.xruns += 1;
+    }
+    memset(transfer->buffer, 0, transfer->length);
     return true;
   }
 }
@@ -101,13 +238,192 @@ Headset::send_data(libusb_transfer* transfer)
 bool
 Headset::receive_data(uint8_t* data, int len)
 {
-  if (m_fout.get())
+  Stream& stream = *m_record;
+
+  if (m_debug)
   {
-    m_fout->write(reinterpret_cast<char*>(data), len);
+    log_debug(raw2str(data, len));
+  }
+
+  if (stream.buffer.get_write_space() < len)
+  {
+    // the file side didn't keep up, drop the packet
+    stream.xruns += 1;
+  }
+  else
+  {
+    stream.buffer.write(data, len);
+    wakeup(stream);
   }
-  log_debug(raw2str(data, len));
 
   return true;
 }
 
+void
+Headset::start_stream(Stream& stream)
+{
+  stream.event_fd = eventfd(0, EFD_NONBLOCK);
+  if (stream.event_fd < 0)
+  {
+    raise_exception(std::runtime_error, "[headset] eventfd(): " << strerror(errno));
+  }
+
+  stream.thread = g_thread_new("headset", &Headset::stream_thread_wrap, &stream);
+}
+
+void
+Headset::stop_stream(Stream& stream)
+{
+  g_atomic_int_set(&stream.quit, 1);
+  wakeup(stream);
+  g_thread_join(stream.thread);
+  close(stream.event_fd);
+
+  if (stream.fd >= 0)
+  {
+    close(stream.fd);
+  }
+}
+
+void
+Headset::wakeup(Stream& stream)
+{
+  eventfd_write(stream.event_fd, 1);
+}
+
+gpointer
+Headset::stream_thread_wrap(gpointer userdata)
+{
+  Stream& stream = *static_cast<Stream*>(userdata);
+
+  // a reader closing the pipe or socket must not kill the process,
+  // with SIGPIPE blocked write() returns EPIPE instead
+  sigset_t sigset;
+  sigemptyset(&sigset);
+  sigaddset(&sigset, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &sigset, NULL);
+
+  if (stream.output)
+  {
+    record_thread(stream);
+  }
+  else
+  {
+    play_thread(stream);
+  }
+
+  g_atomic_int_set(&stream.eof, 1);
+  return 0;
+}
+
+void
+Headset::play_thread(Stream& stream)
+{
+  struct stat st;
+  const bool fifo = (fstat(stream.fd, &st) == 0 && S_ISFIFO(st.st_mode));
+
+  uint8_t data[kBufferSize / 4];
+  while (!g_atomic_int_get(&stream.quit))
+  {
+    int space = stream.buffer.get_write_space();
+    if (space < kPacketSize)
+    {
+      // wait for the USB side to make room
+      wait_for(-1, 0, stream.event_fd);
+    }
+    else if (wait_for(stream.fd, POLLIN, stream.event_fd))
+    {
+      ssize_t len = read(stream.fd, data, std::min(space, static_cast<int>(sizeof(data))));
+      if (len > 0)
+      {
+        stream.buffer.write(data, static_cast<int>(len));
+      }
+      else if (len == 0 && fifo)
+      {
+        // a named pipe reads as end of file while it has no writer,
+        // once a writer has been there poll() keeps reporting the
+        // hangup, reopening goes back to waiting for the next writer
+        close(stream.fd);
+        stream.fd = open_stream(stream.filename, false);
+        if (stream.fd < 0)
+        {
+          log_error("[headset] " << stream.filename << ": " << strerror(errno));
+          break;
+        }
+      }
+      else if (len == 0)
+      {
+        // end of file or the peer closed the socket
+        break;
+      }
+      else if (errno != EAGAIN && errno != EINTR)
+      {
+        log_error("[headset] " << stream.filename << ": " << strerror(errno));
+        break;
+      }
+    }
+  }
+}
+
+void
+Headset::record_thread(Stream& stream)
+{
+  while (stream.fd < 0)
+  {
+    stream.fd = open_stream(stream.filename, true);
+    if (stream.fd < 0)
+    {
+      if (errno == ENXIO)
+      {
+        // named pipe without a reader, try again later, till then
+        // the USB side drops the audio
+        wait_for(-1, 0, stream.event_fd, 100);
+
+        if (g_atomic_int_get(&stream.quit))
+        {
+          return;
+        }
+      }
+      else
+      {
+        log_error("[headset] " << stream.filename << ": " << strerror(errno));
+        return;
+      }
+    }
+  }
+
+  const int fd = stream.fd;
+
+  uint8_t data[kBufferSize / 4];
+  int len = 0;
+  int pos = 0;
+  while (!g_atomic_int_get(&stream.quit))
+  {
+    if (pos == len)
+    {
+      pos = 0;
+      len = stream.buffer.read(data, sizeof(data));
+      if (len == 0)
+      {
+        // wait for the USB side to deliver more data
+        wait_for(-1, 0, stream.event_fd);
+      }
+    }
+    else if (wait_for(fd, POLLOUT, stream.event_fd))
+    {
+      ssize_t ret = write(fd, data + pos, len - pos);
+      if (ret >= 0)
+      {
+        pos += static_cast<int>(ret);
+      }
+      else if (errno != EAGAIN && errno != EINTR)
+      {
+        // EPIPE when the reader of the pipe/socket went away
+        log_error("[headset] " << stream.filename << ": " << strerror(errno));
+        break;
+      }
+    }
+  }
+}
+
 /* EOF */
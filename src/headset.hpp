@@ -19,19 +19,63 @@
 #ifndef HEADER_XBOXDRV_HEADSET_HPP
 #define HEADER_XBOXDRV_HEADSET_HPP
 
+#include <glib.h>
 #include <libusb.h>
 #include <string>
 
+#include "ring_buffer.hpp"
 #include "usb_interface.hpp"
 
+/** Streams the headset audio between USB and a file. The file side
+    runs in its own thread and is connected to the USB transfers by a
+    lock-free RingBuffer, so slow I/O never blocks the main loop and
+    several transfers can be kept in flight. Besides regular files a
+    named pipe or a Unix socket ("unix:PATH") can be used, so that
+    another process can handle the audio in real time. */
 class Headset
 {
+private:
+  enum {
+    kPacketSize  = 32,
+    kTransfers   = 4,
+    kBufferSize  = 32 * 512
+  };
+
+  /** one direction of audio, the USB side runs in the main loop, the
+      file side in its own thread */
+  struct Stream
+  {
+    Stream();
+
+    std::string filename;
+    bool output;
+    int fd;
+    RingBuffer buffer;
+
+    GThread* thread;
+
+    /** eventfd to wake up the thread when data or space became
+        available or when it should quit */
+    int event_fd;
+    volatile gint quit;
+    volatile gint eof;
+
+    /** only touched from the USB side */
+    bool started;
+    unsigned int xruns;
+
+  private:
+    Stream(const Stream&);
+    Stream& operator=(const Stream&);
+  };
+
 private:
   libusb_device_handle* m_handle;
   std::auto_ptr<USBInterface> m_interface;
+  bool m_debug;
 
-  std::auto_ptr<std::ofstream> m_fout;
-  std::auto_ptr<std::ifstream> m_fin;
+  std::auto_ptr<Stream> m_play;
+  std::auto_ptr<Stream> m_record;
 
 public:
   Headset(libusb_device_handle* handle, bool debug);
@@ -44,6 +88,14 @@ private:
   bool send_data(libusb_transfer* transfer);
   bool receive_data(uint8_t* data, int len);
 
+  static void start_stream(Stream& stream);
+  static void stop_stream(Stream& stream);
+  static void wakeup(Stream& stream);
+
+  static void play_thread(Stream& stream);
+  static void record_thread(Stream& stream);
+  static gpointer stream_thread_wrap(gpointer userdata);
+
 private:
   Headset(const Headset&);
   Headset& operator=(const Headset&);
@@ -22,6 +22,7 @@
 #include <boost/format.hpp>
 #include <boost/tokenizer.hpp>
 #include <boost/lexical_cast.hpp>
+#include <spawn.h>
 #include <stdio.h>
 #include <sys/time.h>
 #include <sys/ioctl.h>
@@ -30,6 +31,8 @@
 #include <iostream>
 
 #include "raise_exception.hpp"
+
+extern char** environ;
 
 int hexstr2int(const std::string& str)
 {
@@ -231,24 +234,22 @@ pid_t spawn_exe(const std::vector<std::string>& args)
 {
   assert(!args.empty());
 
-  pid_t pid = fork();
-  if (pid == 0)
+  std::vector<char*> argv;
+  for(std::vector<std::string>::const_iterator i = args.begin(); i != args.end(); ++i)
   {
-    char** argv = static_cast<char**>(malloc(sizeof(char*) * (args.size() + 1)));
-    for(size_t i = 0; i < args.size(); ++i)
-    {
-      argv[i] = strdup(args[i].c_str());
-    }
-    argv[args.size()] = NULL;
+    argv.push_back(const_cast<char*>(i->c_str()));
+  }
+  argv.push_back(NULL);
 
-    if (execvp(args[0].c_str(), argv) == -1)
-    {
-      log_error(args[0] << ": exec failed: " << strerror(errno));
-      _exit(EXIT_FAILURE);
-    }
+  // posix_spawnp() avoids copying the page tables of the whole process
+  pid_t pid;
+  int err = posix_spawnp(&pid, argv[0], NULL, NULL, &argv[0], environ);
+  if (err != 0)
+  {
+    raise_exception(std::runtime_error, args[0] << ": exec failed: " << strerror(err));
   }
 
   return pid;
 }
-
+
 /* EOF */
@@ -0,0 +1,436 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "hid_report_descriptor.hpp"
+
+#include <algorithm>
+#include <boost/format.hpp>
+#include <map>
+#include <stdexcept>
+#include <stdlib.h>
+
+#include "helper.hpp"
+#include "log.hpp"
+#include "raise_exception.hpp"
+
+namespace {
+
+enum ItemType { kMain = 0, kGlobal = 1, kLocal = 2 };
+
+enum {
+  // main items
+  kInput         = 0x8,
+  kOutput        = 0x9,
+  kCollection    = 0xa,
+  kFeature       = 0xb,
+  kEndCollection = 0xc,
+
+  // global items
+  kUsagePage     = 0x0,
+  kLogicalMin    = 0x1,
+  kLogicalMax    = 0x2,
+  kReportSize    = 0x7,
+  kReportId      = 0x8,
+  kReportCount   = 0x9,
+  kPush          = 0xa,
+  kPop           = 0xb,
+
+  // local items
+  kUsage         = 0x0,
+  kUsageMin      = 0x1,
+  kUsageMax      = 0x2
+};
+
+enum {
+  kFlagConstant = 1 << 0,
+  kFlagVariable = 1 << 1
+};
+
+/** longest report the parser accepts, in bits, also bounds report
+    size and count so that the bit offsets can't overflow */
+enum { kMaxReportBits = 8 * 4096 };
+
+struct GlobalState
+{
+  GlobalState() :
+    usage_page(0),
+    logical_min(0),
+    logical_max(0),
+    logical_max_raw(0),
+    logical_max_size(0),
+    report_size(0),
+    report_id(0),
+    report_count(0)
+  {}
+
+  uint16_t usage_page;
+  int logical_min;
+  int logical_max;
+
+  // logical max is signed or not depending on logical min, which
+  // might come after it, so the raw value is kept
+  uint32_t logical_max_raw;
+  int logical_max_size;
+
+  int report_size;
+  int report_id;
+  int report_count;
+};
+
+struct LocalState
+{
+  LocalState() :
+    usages(),
+    usage_min(0),
+    usage_max(0),
+    has_range(false)
+  {}
+
+  std::vector<HidUsage> usages;
+  HidUsage usage_min;
+  HidUsage usage_max;
+  bool has_range;
+};
+
+int32_t sign_extend(uint32_t value, int size)
+{
+  switch(size)
+  {
+    case 1: return static_cast<int8_t>(value);
+    case 2: return static_cast<int16_t>(value);
+    default: return static_cast<int32_t>(value);
+  }
+}
+
+/** local usages only carry the page when they are 4 bytes long */
+HidUsage make_usage(uint32_t value, int size, uint16_t usage_page)
+{
+  if (size == 4)
+  {
+    return value;
+  }
+  else
+  {
+    return hid_usage(usage_page, static_cast<uint16_t>(value));
+  }
+}
+
+struct UsageName
+{
+  HidUsage usage;
+  const char* name;
+};
+
+const UsageName usage_names[] = {
+  { hid_usage(HID_PAGE_GENERIC_DESKTOP, 0x30), "X" },
+  { hid_usage(HID_PAGE_GENERIC_DESKTOP, 0x31), "Y" },
+  { hid_usage(HID_PAGE_GENERIC_DESKTOP, 0x32), "Z" },
+  { hid_usage(HID_PAGE_GENERIC_DESKTOP, 0x33), "RX" },
+  { hid_usage(HID_PAGE_GENERIC_DESKTOP, 0x34), "RY" },
+  { hid_usage(HID_PAGE_GENERIC_DESKTOP, 0x35), "RZ" },
+  { hid_usage(HID_PAGE_GENERIC_DESKTOP, 0x36), "SLIDER" },
+  { hid_usage(HID_PAGE_GENERIC_DESKTOP, 0x37), "DIAL" },
+  { hid_usage(HID_PAGE_GENERIC_DESKTOP, 0x38), "WHEEL" },
+  { hid_usage(HID_PAGE_GENERIC_DESKTOP, 0x39), "HAT" },
+  { hid_usage(HID_PAGE_SIMULATION, 0xba), "RUDDER" },
+  { hid_usage(HID_PAGE_SIMULATION, 0xbb), "THROTTLE" },
+  { hid_usage(HID_PAGE_SIMULATION, 0xc4), "ACCELERATOR" },
+  { hid_usage(HID_PAGE_SIMULATION, 0xc5), "BRAKE" },
+  { hid_usage(HID_PAGE_SIMULATION, 0xc8), "STEERING" }
+};
+
+const int usage_names_count = sizeof(usage_names) / sizeof(usage_names[0]);
+
+} // namespace
+
+std::vector<HidField>
+HidReportDescriptor::parse(const uint8_t* data, int len)
+{
+  std::vector<HidField> fields;
+
+  GlobalState global;
+  std::vector<GlobalState> global_stack;
+  LocalState local;
+
+  // bit position of the next field, per report id
+  std::map<int, int> offsets;
+
+  int i = 0;
+  while (i < len)
+  {
+    const uint8_t prefix = data[i];
+
+    if (prefix == 0xfe)
+    {
+      // long items are reserved and carry no information we use
+      if (i + 1 >= len)
+      {
+        raise_exception(std::runtime_error, "truncated long item at byte " << i);
+      }
+      i += 3 + data[i + 1];
+      continue;
+    }
+
+    const int size = (prefix & 0x3) == 3 ? 4 : (prefix & 0x3);
+    const int type = (prefix >> 2) & 0x3;
+    const int tag  = prefix >> 4;
+
+    if (i + 1 + size > len)
+    {
+      raise_exception(std::runtime_error, "truncated item at byte " << i);
+    }
+
+    uint32_t value = 0;
+    for(int b = 0; b < size; ++b)
+    {
+      value |= static_cast<uint32_t>(data[i + 1 + b]) << (8 * b);
+    }
+    i += 1 + size;
+
+    switch(type)
+    {
+      case kMain:
+        if (tag == kInput)
+        {
+          int& offset = offsets[global.report_id];
+
+          // report size and count are each bounded by kMaxReportBits,
+          // so the product can't overflow
+          const int bits = global.report_size * global.report_count;
+          if (bits > kMaxReportBits - offset)
+          {
+            raise_exception(std::runtime_error, "report " << global.report_id << " longer than "
+                            << kMaxReportBits << " bits at byte " << i);
+          }
+
+          // signedness of logical max follows logical min
+          const int logical_max = global.logical_min < 0
+            ? sign_extend(global.logical_max_raw, global.logical_max_size)
+            : static_cast<int>(global.logical_max_raw);
+
+          if ((value & kFlagConstant) ||
+              !(value & kFlagVariable) ||
+              global.report_size > 32 ||
+              global.report_size == 0)
+          {
+            if (!(value & kFlagConstant))
+            {
+              log_debug("skipping unsupported input item, flags " << value << ", size " << global.report_size);
+            }
+          }
+          else
+          {
+            for(int n = 0; n < global.report_count; ++n)
+            {
+              HidField field;
+              field.report_id   = global.report_id;
+              field.bit_offset  = offset + n * global.report_size;
+              field.bit_size    = global.report_size;
+              field.logical_min = global.logical_min;
+              field.logical_max = logical_max;
+
+              if (n < static_cast<int>(local.usages.size()))
+              {
+                field.usage = local.usages[n];
+              }
+              else if (local.has_range)
+              {
+                // usage ranges don't wrap into the next page
+                const int count = static_cast<int>(local.usages.size());
+                field.usage = std::min(local.usage_min + static_cast<HidUsage>(n - count), local.usage_max);
+              }
+              else if (!local.usages.empty())
+              {
+                field.usage = local.usages.back();
+              }
+              else
+              {
+                // a field without usage can't be mapped
+                continue;
+              }
+
+              fields.push_back(field);
+            }
+          }
+
+          offset += bits;
+        }
+
+        if (tag == kInput || tag == kOutput || tag == kFeature ||
+            tag == kCollection || tag == kEndCollection)
+        {
+          local = LocalState();
+        }
+        break;
+
+      case kGlobal:
+        switch(tag)
+        {
+          case kUsagePage:
+            global.usage_page = static_cast<uint16_t>(value);
+            break;
+
+          case kLogicalMin:
+            global.logical_min = sign_extend(value, size);
+            break;
+
+          case kLogicalMax:
+            global.logical_max_raw = value;
+            global.logical_max_size = size;
+            break;
+
+          case kReportSize:
+            if (value > kMaxReportBits)
+            {
+              raise_exception(std::runtime_error, "invalid report size " << value);
+            }
+            global.report_size = value;
+            break;
+
+          case kReportId:
+            if (value == 0 || value > 255)
+            {
+              raise_exception(std::runtime_error, "invalid report id " << value);
+            }
+            global.report_id = value;
+            break;
+
+          case kReportCount:
+            if (value > kMaxReportBits)
+            {
+              raise_exception(std::runtime_error, "invalid report count " << value);
+            }
+            global.report_count = value;
+            break;
+
+          case kPush:
+            global_stack.push_back(global);
+            break;
+
+          case kPop:
+            if (global_stack.empty())
+            {
+              raise_exception(std::runtime_error, "pop without push at byte " << i);
+            }
+            global = global_stack.back();
+            global_stack.pop_back();
+            break;
+
+          default:
+            // physical range and units aren't needed
+            break;
+        }
+        break;
+
+      case kLocal:
+        switch(tag)
+        {
+          case kUsage:
+            local.usages.push_back(make_usage(value, size, global.usage_page));
+            break;
+
+          case kUsageMin:
+            local.usage_min = make_usage(value, size, global.usage_page);
+            local.has_range = true;
+            break;
+
+          case kUsageMax:
+            local.usage_max = make_usage(value, size, global.usage_page);
+            local.has_range = true;
+            break;
+
+          default:
+            // designators and strings aren't needed
+            break;
+        }
+        break;
+
+      default:
+        raise_exception(std::runtime_error, "reserved item type at byte " << i);
+    }
+  }
+
+  return fields;
+}
+
+bool
+HidReportDescriptor::has_report_ids(const std::vector<HidField>& fields)
+{
+  for(std::vector<HidField>::const_iterator i = fields.begin(); i != fields.end(); ++i)
+  {
+    if (i->report_id != 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::string
+HidReportDescriptor::usage2string(HidUsage usage)
+{
+  for(int i = 0; i < usage_names_count; ++i)
+  {
+    if (usage_names[i].usage == usage)
+    {
+      return usage_names[i].name;
+    }
+  }
+
+  if ((usage >> 16) == HID_PAGE_BUTTON)
+  {
+    return (boost::format("BTN%d") % (usage & 0xffff)).str();
+  }
+  else
+  {
+    return (boost::format("0x%08x") % usage).str();
+  }
+}
+
+HidUsage
+HidReportDescriptor::string2usage(const std::string& str_)
+{
+  const std::string str = to_lower(str_);
+
+  for(int i = 0; i < usage_names_count; ++i)
+  {
+    if (str == to_lower(usage_names[i].name))
+    {
+      return usage_names[i].usage;
+    }
+  }
+
+  if (str.compare(0, 3, "btn") == 0 && str.size() > 3 && is_number(str.substr(3)))
+  {
+    return hid_usage(HID_PAGE_BUTTON, static_cast<uint16_t>(str2int(str.substr(3))));
+  }
+  else if (str.compare(0, 2, "0x") == 0 && str.size() > 2)
+  {
+    char* end;
+    HidUsage usage = static_cast<HidUsage>(strtoul(str.c_str(), &end, 16));
+    if (*end == '\0')
+    {
+      return usage;
+    }
+  }
+
+  raise_exception(std::runtime_error, "couldn't convert '" << str_ << "' to HID usage");
+}
+
+/* EOF */
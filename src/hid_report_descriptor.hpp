@@ -0,0 +1,90 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef HEADER_XBOXDRV_HID_REPORT_DESCRIPTOR_HPP
+#define HEADER_XBOXDRV_HID_REPORT_DESCRIPTOR_HPP
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/** HID usage with the usage page in the upper 16 bits */
+typedef uint32_t HidUsage;
+
+inline HidUsage hid_usage(uint16_t page, uint16_t id)
+{
+  return (static_cast<uint32_t>(page) << 16) | id;
+}
+
+enum {
+  HID_PAGE_GENERIC_DESKTOP = 0x01,
+  HID_PAGE_SIMULATION      = 0x02,
+  HID_PAGE_BUTTON          = 0x09
+};
+
+/** A single value of an input report */
+struct HidField
+{
+  HidField() :
+    report_id(0),
+    bit_offset(0),
+    bit_size(0),
+    logical_min(0),
+    logical_max(0),
+    usage(0)
+  {}
+
+  /** 0 when the device doesn't use report ids */
+  int report_id;
+
+  /** position in the report, not counting the report id byte */
+  int bit_offset;
+  int bit_size;
+
+  /** the field is signed when logical_min is negative */
+  int logical_min;
+  int logical_max;
+
+  HidUsage usage;
+};
+
+/** Parser for USB HID report descriptors, as defined in the Device
+    Class Definition for HID 1.11, chapter 6.2.2 */
+class HidReportDescriptor
+{
+public:
+  /** Returns the variable input fields of the descriptor, constant
+      fields (padding) and arrays, as used by keyboards, are left out,
+      but still take up their space in the report. Throws on malformed
+      descriptors. */
+  static std::vector<HidField> parse(const uint8_t* data, int len);
+
+  /** true when the fields are prefixed by a report id byte */
+  static bool has_report_ids(const std::vector<HidField>& fields);
+
+  /** a name like "X", "HAT" or "BTN3", or hex "0xPPPPUUUU" */
+  static std::string usage2string(HidUsage usage);
+
+  /** inverse of usage2string() */
+  static HidUsage string2usage(const std::string& str);
+};
+
+#endif
+
+/* EOF */
@@ -0,0 +1,282 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "hid_report_plan.hpp"
+
+#include <algorithm>
+#include <boost/format.hpp>
+#include <sstream>
+#include <stdexcept>
+
+#include "helper.hpp"
+#include "log.hpp"
+#include "raise_exception.hpp"
+
+namespace {
+
+bool report_id_less(const HidField& lhs, const HidField& rhs)
+{
+  return lhs.report_id < rhs.report_id;
+}
+
+} // namespace
+
+HidMap
+HidMap::create_default()
+{
+  HidMap map;
+
+  map.bind_axis("X",  "X1");
+  map.bind_axis("Y",  "-Y1");
+  map.bind_axis("Z",  "X2");
+  map.bind_axis("RZ", "-Y2");
+  map.bind_axis("RX", "LT");
+  map.bind_axis("RY", "RT");
+  map.bind_axis("BRAKE", "LT");
+  map.bind_axis("ACCELERATOR", "RT");
+
+  const XboxButton buttons[] = {
+    XBOX_BTN_A, XBOX_BTN_B, XBOX_BTN_X, XBOX_BTN_Y,
+    XBOX_BTN_LB, XBOX_BTN_RB,
+    XBOX_BTN_BACK, XBOX_BTN_START, XBOX_BTN_GUIDE,
+    XBOX_BTN_THUMB_L, XBOX_BTN_THUMB_R
+  };
+  for(int i = 0; i < static_cast<int>(sizeof(buttons) / sizeof(buttons[0])); ++i)
+  {
+    map.m_buttons[hid_usage(HID_PAGE_BUTTON, static_cast<uint16_t>(i + 1))] = buttons[i];
+  }
+
+  return map;
+}
+
+HidMap::HidMap() :
+  m_axes(),
+  m_buttons(),
+  m_hat(hid_usage(HID_PAGE_GENERIC_DESKTOP, 0x39))
+{
+}
+
+void
+HidMap::bind_axis(const std::string& usage, const std::string& value)
+{
+  AxisBinding binding;
+  binding.invert = !value.empty() && value[0] == '-';
+  binding.axis = string2axis(binding.invert ? value.substr(1) : value);
+  if (binding.axis == XBOX_AXIS_UNKNOWN)
+  {
+    raise_exception(std::runtime_error, "unknown axis: " << value);
+  }
+  m_axes[HidReportDescriptor::string2usage(usage)] = binding;
+}
+
+void
+HidMap::bind_button(const std::string& usage, const std::string& value)
+{
+  XboxButton button = string2btn(value);
+  if (button == XBOX_BTN_UNKNOWN)
+  {
+    raise_exception(std::runtime_error, "unknown button: " << value);
+  }
+  m_buttons[HidReportDescriptor::string2usage(usage)] = button;
+}
+
+HidReportPlan::HidReportPlan(const std::vector<HidField>& fields_, const HidMap& map) :
+  m_ops(),
+  m_reports(),
+  m_report_ids(HidReportDescriptor::has_report_ids(fields_))
+{
+  std::vector<HidField> fields = fields_;
+  std::stable_sort(fields.begin(), fields.end(), report_id_less);
+
+  for(std::vector<HidField>::const_iterator field = fields.begin(); field != fields.end(); ++field)
+  {
+    Op op;
+    op.kind = kButton;
+    op.target = 0;
+    op.bit_offset = field->bit_offset + (m_report_ids ? 8 : 0);
+    op.bit_size = field->bit_size;
+    op.is_signed = field->logical_min < 0;
+    op.end_byte = (op.bit_offset + op.bit_size + 7) / 8;
+    op.in_min = field->logical_min;
+    op.in_max = field->logical_max;
+    op.out_min = 0;
+    op.out_max = 0;
+    op.scale = 0;
+    op.invert = false;
+
+    HidMap::Axes::const_iterator axis = map.get_axes().find(field->usage);
+    HidMap::Buttons::const_iterator button = map.get_buttons().find(field->usage);
+
+    if (field->usage == map.get_hat())
+    {
+      op.kind = kHat;
+    }
+    else if (axis != map.get_axes().end())
+    {
+      if (op.in_max <= op.in_min)
+      {
+        log_warn("ignoring " << HidReportDescriptor::usage2string(field->usage)
+                 << ", invalid logical range " << op.in_min << ".." << op.in_max);
+        continue;
+      }
+
+      op.kind = kAxis;
+      op.target = axis->second.axis;
+      op.invert = axis->second.invert;
+      op.out_min = get_axis_min(axis->second.axis);
+      op.out_max = get_axis_max(axis->second.axis);
+
+      // rounded up, so that the logical maximum reaches out_max
+      const int64_t in_range = static_cast<int64_t>(op.in_max) - op.in_min;
+      const int64_t out_range = static_cast<int64_t>(op.out_max) - op.out_min;
+      op.scale = ((out_range << 16) + in_range - 1) / in_range;
+    }
+    else if (button != map.get_buttons().end())
+    {
+      op.kind = kButton;
+      op.target = button->second;
+    }
+    else
+    {
+      log_debug("unmapped HID usage " << HidReportDescriptor::usage2string(field->usage));
+      continue;
+    }
+
+    if (m_reports.empty() || m_reports.back().id != field->report_id)
+    {
+      Report report;
+      report.id = field->report_id;
+      report.begin = m_ops.size();
+      report.end = m_ops.size();
+      m_reports.push_back(report);
+    }
+
+    m_ops.push_back(op);
+    m_reports.back().end = m_ops.size();
+  }
+}
+
+bool
+HidReportPlan::decode(const uint8_t* data, int len, XboxGenericMsg& msg) const
+{
+  int id = 0;
+  if (m_report_ids)
+  {
+    if (len < 1)
+    {
+      return false;
+    }
+    id = data[0];
+  }
+
+  std::vector<Report>::const_iterator report = m_reports.begin();
+  while (report != m_reports.end() && report->id != id)
+  {
+    ++report;
+  }
+
+  if (report == m_reports.end())
+  {
+    return false;
+  }
+
+  for(std::vector<Op>::size_type i = report->begin; i != report->end; ++i)
+  {
+    const Op& op = m_ops[i];
+
+    if (op.end_byte > len)
+    {
+      continue;
+    }
+
+    // fields are little endian and can start at any bit, 32 bits
+    // plus the shift fit in 40 bits
+    const int first = op.bit_offset >> 3;
+    uint64_t raw = 0;
+    for(int b = first; b < op.end_byte; ++b)
+    {
+      raw |= static_cast<uint64_t>(data[b]) << (8 * (b - first));
+    }
+
+    const uint32_t mask = op.bit_size == 32 ? 0xffffffffu : ((1u << op.bit_size) - 1);
+    const uint32_t bits = static_cast<uint32_t>(raw >> (op.bit_offset & 7)) & mask;
+    const int value = (op.is_signed && ((bits >> (op.bit_size - 1)) & 1))
+      ? static_cast<int>(bits | ~mask)
+      : static_cast<int>(bits);
+
+    switch(op.kind)
+    {
+      case kButton:
+        set_button(msg, static_cast<XboxButton>(op.target), value != 0);
+        break;
+
+      case kAxis:
+        {
+          const int64_t scaled = (static_cast<int64_t>(Math::clamp(op.in_min, value, op.in_max) - op.in_min) * op.scale) >> 16;
+          const int64_t out = op.invert ? op.out_max - scaled : op.out_min + scaled;
+          set_axis(msg, static_cast<XboxAxis>(op.target),
+                   static_cast<int>(Math::clamp<int64_t>(op.out_min, out, op.out_max)));
+        }
+        break;
+
+      case kHat:
+        {
+          // values outside the logical range mean centered, four
+          // way hats count in steps of 90 degree
+          const bool valid = op.in_min <= value && value <= op.in_max;
+          const int dir = (value - op.in_min) * (op.in_max - op.in_min == 3 ? 2 : 1);
+
+          set_button(msg, XBOX_DPAD_UP,    valid && (dir == 7 || dir <= 1));
+          set_button(msg, XBOX_DPAD_RIGHT, valid && 1 <= dir && dir <= 3);
+          set_button(msg, XBOX_DPAD_DOWN,  valid && 3 <= dir && dir <= 5);
+          set_button(msg, XBOX_DPAD_LEFT,  valid && 5 <= dir && dir <= 7);
+        }
+        break;
+    }
+  }
+
+  return true;
+}
+
+std::string
+HidReportPlan::str() const
+{
+  std::ostringstream out;
+  for(std::vector<Report>::const_iterator report = m_reports.begin(); report != m_reports.end(); ++report)
+  {
+    for(std::vector<Op>::size_type i = report->begin; i != report->end; ++i)
+    {
+      const Op& op = m_ops[i];
+      out << boost::format("report %d: bits %3d-%-3d %c[%d..%d] -> ")
+        % report->id % op.bit_offset % (op.bit_offset + op.bit_size - 1)
+        % (op.is_signed ? 's' : 'u') % op.in_min % op.in_max;
+
+      switch(op.kind)
+      {
+        case kButton: out << btn2string(static_cast<XboxButton>(op.target)); break;
+        case kAxis:   out << (op.invert ? "-" : "") << axis2string(static_cast<XboxAxis>(op.target)); break;
+        case kHat:    out << "dpad"; break;
+      }
+      out << '\n';
+    }
+  }
+  return out.str();
+}
+
+/* EOF */
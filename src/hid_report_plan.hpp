@@ -0,0 +1,132 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef HEADER_XBOXDRV_HID_REPORT_PLAN_HPP
+#define HEADER_XBOXDRV_HID_REPORT_PLAN_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "hid_report_descriptor.hpp"
+#include "xboxmsg.hpp"
+
+/** Which HID usage ends up on which axis or button */
+class HidMap
+{
+public:
+  struct AxisBinding
+  {
+    XboxAxis axis;
+    bool invert;
+  };
+
+  typedef std::map<HidUsage, AxisBinding> Axes;
+  typedef std::map<HidUsage, XboxButton> Buttons;
+
+private:
+  Axes m_axes;
+  Buttons m_buttons;
+
+  /** the hat switch is always mapped to the dpad */
+  HidUsage m_hat;
+
+public:
+  /** X/Y and Z/RZ are the sticks, RX/RY or brake and accelerator the
+      triggers, buttons 1-11 are A, B, X, Y, LB, RB, Back, Start,
+      Guide, left and right stick */
+  static HidMap create_default();
+
+  HidMap();
+
+  /** \a value is an axis name, a leading '-' inverts it, HID Y axes
+      point down while Xbox360 ones point up */
+  void bind_axis(const std::string& usage, const std::string& value);
+  void bind_button(const std::string& usage, const std::string& value);
+
+  bool empty() const { return m_axes.empty() && m_buttons.empty(); }
+
+  const Axes& get_axes() const { return m_axes; }
+  const Buttons& get_buttons() const { return m_buttons; }
+  HidUsage get_hat() const { return m_hat; }
+};
+
+/** The fields of a report descriptor compiled down to a flat list of
+    extraction steps, sorted by report id. Decoding a report is a
+    single loop over the steps of its id, each one pulls its bits out
+    of the report and scales them with precomputed integer factors. */
+class HidReportPlan
+{
+private:
+  enum Kind { kAxis, kButton, kHat };
+
+  struct Op
+  {
+    Kind kind;
+    int target;
+
+    int bit_offset;
+    int bit_size;
+    bool is_signed;
+
+    /** first byte past the field, shorter reports skip it */
+    int end_byte;
+
+    int in_min;
+    int in_max;
+
+    /** out = out_min + ((in - in_min) * scale >> 16), swapped for
+        inverted axes */
+    int out_min;
+    int out_max;
+    int64_t scale;
+    bool invert;
+  };
+
+  struct Report
+  {
+    int id;
+    std::vector<Op>::size_type begin;
+    std::vector<Op>::size_type end;
+  };
+
+  std::vector<Op> m_ops;
+  std::vector<Report> m_reports;
+  bool m_report_ids;
+
+public:
+  HidReportPlan(const std::vector<HidField>& fields, const HidMap& map);
+
+  /** Update \a msg with the report in \a data, returns false when the
+      report carries nothing that is mapped */
+  bool decode(const uint8_t* data, int len, XboxGenericMsg& msg) const;
+
+  bool empty() const { return m_ops.empty(); }
+
+  /** one line per step, for --debug */
+  std::string str() const;
+
+private:
+  HidReportPlan(const HidReportPlan&);
+  HidReportPlan& operator=(const HidReportPlan&);
+};
+
+#endif
+
+/* EOF */
@@ -0,0 +1,249 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "launcher.hpp"
+
+#include <errno.h>
+#include <glib.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdexcept>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "clock.hpp"
+#include "helper.hpp"
+#include "log.hpp"
+
+extern char** environ;
+
+namespace {
+
+/** A message is the send time followed by the NUL terminated
+    arguments */
+struct LaunchHeader
+{
+  int64_t time;
+};
+
+const size_t kMaxMessage = 16384;
+
+void on_child_exit(GPid pid, gint status, gpointer userdata)
+{
+  g_spawn_close_pid(pid);
+}
+
+} // namespace
+
+Launcher* Launcher::s_current = 0;
+
+void
+Launcher::launch(const std::vector<std::string>& args)
+{
+  if (args.empty() || args[0].empty())
+  {
+    log_error("no command given");
+    return;
+  }
+
+  if (s_current && s_current->send(args))
+  {
+    return;
+  }
+
+  try
+  {
+    pid_t pid = spawn_exe(args);
+    g_child_watch_add(pid, &on_child_exit, NULL);
+  }
+  catch(const std::exception& err)
+  {
+    log_error(err.what());
+  }
+}
+
+Launcher::Launcher() :
+  m_fd(-1),
+  m_pid(-1)
+{
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) != 0)
+  {
+    log_warn("socketpair() failed, commands will be spawned directly: " << strerror(errno));
+    return;
+  }
+
+  pid_t pid = fork();
+  if (pid < 0)
+  {
+    log_warn("fork() failed, commands will be spawned directly: " << strerror(errno));
+    close(fds[0]);
+    close(fds[1]);
+  }
+  else if (pid == 0)
+  {
+    close(fds[0]);
+    run_helper(fds[1]);
+    _exit(EXIT_SUCCESS);
+  }
+  else
+  {
+    close(fds[1]);
+    m_fd = fds[0];
+    m_pid = pid;
+    s_current = this;
+    log_debug("launcher helper started with pid " << m_pid);
+  }
+}
+
+Launcher::~Launcher()
+{
+  if (s_current == this)
+  {
+    s_current = 0;
+  }
+
+  if (m_fd >= 0)
+  {
+    // the helper exits once it sees the end of the socket
+    close(m_fd);
+    waitpid(m_pid, NULL, 0);
+  }
+}
+
+bool
+Launcher::send(const std::vector<std::string>& args)
+{
+  char buf[kMaxMessage];
+
+  LaunchHeader header;
+  header.time = Clock::now();
+  memcpy(buf, &header, sizeof(header));
+
+  size_t len = sizeof(header);
+  for(std::vector<std::string>::const_iterator i = args.begin(); i != args.end(); ++i)
+  {
+    if (len + i->size() + 1 > sizeof(buf))
+    {
+      log_error(args[0] << ": command line too long for the launcher");
+      return false;
+    }
+
+    memcpy(buf + len, i->c_str(), i->size() + 1);
+    len += i->size() + 1;
+  }
+
+  ssize_t ret = ::send(m_fd, buf, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+  if (ret != static_cast<ssize_t>(len))
+  {
+    log_warn("launcher helper not responding, spawning directly: " << strerror(errno));
+    return false;
+  }
+  else
+  {
+    return true;
+  }
+}
+
+void
+Launcher::run_helper(int fd)
+{
+  // keep running through Ctrl-C so the on-disconnect scripts of a
+  // shutting down daemon still get launched, the helper exits when
+  // the socket is closed instead
+  signal(SIGINT, SIG_IGN);
+  signal(SIGTERM, SIG_IGN);
+  signal(SIGHUP, SIG_IGN);
+
+  // no nice() here, the launched commands would inherit it and
+  // unprivileged ones couldn't undo it, the helper spends its time
+  // blocked in recv() anyway
+  // reap the children automatically
+  signal(SIGCHLD, SIG_IGN);
+
+  // undo the above for the launched commands
+  posix_spawnattr_t attr;
+  posix_spawnattr_init(&attr);
+
+  sigset_t sigdefault;
+  sigemptyset(&sigdefault);
+  sigaddset(&sigdefault, SIGINT);
+  sigaddset(&sigdefault, SIGTERM);
+  sigaddset(&sigdefault, SIGHUP);
+  sigaddset(&sigdefault, SIGCHLD);
+  posix_spawnattr_setsigdefault(&attr, &sigdefault);
+
+  sigset_t sigmask;
+  sigemptyset(&sigmask);
+  posix_spawnattr_setsigmask(&attr, &sigmask);
+
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK);
+
+  char buf[kMaxMessage + 1];
+  std::vector<char*> argv;
+
+  while(true)
+  {
+    ssize_t len = recv(fd, buf, kMaxMessage, 0);
+    if (len < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    else if (len <= 0)
+    {
+      break;
+    }
+    else if (static_cast<size_t>(len) <= sizeof(LaunchHeader))
+    {
+      continue;
+    }
+
+    LaunchHeader header;
+    memcpy(&header, buf, sizeof(header));
+
+    // split the NUL terminated arguments
+    buf[len] = '\0';
+    argv.clear();
+    for(char* p = buf + sizeof(header); p < buf + len; p += strlen(p) + 1)
+    {
+      argv.push_back(p);
+    }
+    argv.push_back(NULL);
+
+    pid_t pid;
+    int err = posix_spawnp(&pid, argv[0], NULL, &attr, &argv[0], environ);
+    if (err != 0)
+    {
+      log_error(argv[0] << ": exec failed: " << strerror(err));
+    }
+    else
+    {
+      log_debug(argv[0] << ": launched as pid " << pid << " after "
+                << (Clock::now() - header.time) / 1000 << "usec");
+    }
+  }
+
+  posix_spawnattr_destroy(&attr);
+  close(fd);
+}
+
+/* EOF */
@@ -0,0 +1,63 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_XBOXDRV_LAUNCHER_HPP
+#define HEADER_XBOXDRV_LAUNCHER_HPP
+
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+/** Runs external commands for exec button bindings and the daemon's
+    connect scripts. A small helper process is forked once at startup,
+    while xboxdrv is still small, and receives the commands over a
+    socketpair. It starts them with posix_spawnp() and reaps them, so
+    a launch costs the main process a single send() instead of a
+    fork() of a large resident set. The helper logs the launch latency
+    at debug level. */
+class Launcher
+{
+public:
+  /** Hand the command over to the active Launcher, if there is none
+      or the helper doesn't respond, the command is spawned directly.
+      Never throws, failures are logged. */
+  static void launch(const std::vector<std::string>& args);
+
+public:
+  Launcher();
+  ~Launcher();
+
+private:
+  bool send(const std::vector<std::string>& args);
+
+  static void run_helper(int fd);
+
+private:
+  static Launcher* s_current;
+
+  int m_fd;
+  pid_t m_pid;
+
+private:
+  Launcher(const Launcher&);
+  Launcher& operator=(const Launcher&);
+};
+
+#endif
+
+/* EOF */
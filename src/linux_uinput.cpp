@@ -18,20 +18,31 @@
 
 #include "linux_uinput.hpp"
 
+#include <algorithm>
 #include <boost/format.hpp>
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
 
+#include "clock.hpp"
 #include "evdev_helper.hpp"
 #include "force_feedback_handler.hpp"
 #include "raise_exception.hpp"
+#include "trace.hpp"
 
 LinuxUinput::LinuxUinput(DeviceType device_type, const std::string& name_,
                          const struct input_id& usbid_) :
   m_device_type(device_type),
   name(name_),
   usbid(usbid_),
+  m_created(false),
   m_finished(false),
+  m_adopted(false),
+  m_detached(false),
+  m_signature(),
+  m_sysname(),
+  m_device_nodes(),
+  m_create_time(0),
   m_fd(-1),
   m_io_channel(),
   m_source_id(),
@@ -43,6 +54,10 @@ LinuxUinput::LinuxUinput(DeviceType device_type, const std::string& name_,
   ff_bit(false),
   m_ff_handler(0),
   m_ff_callback(),
+  m_ff_timeout_id(0),
+  m_ff_last_time(0),
+  m_ff_strong(0),
+  m_ff_weak(0),
   needs_sync(true)
 {
   log_debug(name << " " << usbid.vendor << ":" << usbid.product);
@@ -91,10 +106,20 @@ LinuxUinput::LinuxUinput(DeviceType device_type, const std::string& name_,
 
 LinuxUinput::~LinuxUinput()
 {
+  if (m_ff_timeout_id)
+  {
+    g_source_remove(m_ff_timeout_id);
+  }
+
   g_source_remove(m_source_id);
 
-  ioctl(m_fd, UI_DEV_DESTROY);
+  if (!m_detached)
+  {
+    ioctl(m_fd, UI_DEV_DESTROY);
+  }
   close(m_fd);
+
+  delete m_ff_handler;
 }
 
 void
@@ -185,9 +210,13 @@ LinuxUinput::set_ff_callback(const boost::function<void (uint8_t, uint8_t)>& cal
 }
 
 void
-LinuxUinput::finish()
+LinuxUinput::create()
 {
-  assert(!m_finished);
+  assert(!m_created);
+
+  const int64_t start = Clock::now();
+
+  m_signature = calc_signature();
 
   // Create some mandatory events that are needed for the kernel/Xorg
   // to register the device as its proper type
@@ -240,6 +269,11 @@ LinuxUinput::finish()
     user_dev.ff_effects_max = m_ff_handler->get_max_effects();
   }
 
+  if (m_adopted)
+  {
+    log_info("adopted uinput device: '" << name << "'");
+  }
+  else
   {
     int write_ret = write(m_fd, &user_dev, sizeof(user_dev));
     if (write_ret < 0)
@@ -250,15 +284,74 @@ LinuxUinput::finish()
     {
       log_debug("write return value: " << write_ret);
     }
+
+    // FIXME: check that the config isn't empty and give a more
+    // meaningful message when it is
+
+    log_debug("finish");
+    if (ioctl(m_fd, UI_DEV_CREATE))
+    {
+      raise_exception(std::runtime_error, "unable to create uinput device: '" << name << "': " << strerror(errno));
+    }
+  }
+
+  m_created = true;
+
+  find_device_nodes();
+
+  m_create_time = Clock::now() - start;
+}
+
+void
+LinuxUinput::find_device_nodes()
+{
+  m_sysname.clear();
+  m_device_nodes.clear();
+
+#ifdef UI_GET_SYSNAME
+  char sysname[64] = {};
+  if (ioctl(m_fd, UI_GET_SYSNAME(sizeof(sysname) - 1), sysname) < 0)
+  {
+    log_debug("UI_GET_SYSNAME failed for '" << name << "': " << strerror(errno));
+    return;
+  }
+  m_sysname = sysname;
+
+  // the input handlers have attached to the device by the time
+  // UI_DEV_CREATE returns, so their nodes are already listed in
+  // sysfs, even when udev hasn't created the files in /dev yet
+  const std::string sysfs_dir = "/sys/devices/virtual/input/" + m_sysname;
+  DIR* dir = opendir(sysfs_dir.c_str());
+  if (!dir)
+  {
+    log_debug(sysfs_dir << ": " << strerror(errno));
+    return;
+  }
+
+  while (struct dirent* entry = readdir(dir))
+  {
+    const std::string node = entry->d_name;
+    if (node.compare(0, 5, "event") == 0 ||
+        node.compare(0, 2, "js") == 0 ||
+        node.compare(0, 5, "mouse") == 0)
+    {
+      m_device_nodes.push_back("/dev/input/" + node);
+    }
   }
+  closedir(dir);
+
+  std::sort(m_device_nodes.begin(), m_device_nodes.end());
+#endif
+}
 
-  // FIXME: check that the config isn't empty and give a more
-  // meaningful message when it is
+void
+LinuxUinput::finish()
+{
+  assert(!m_finished);
 
-  log_debug("finish");
-  if (ioctl(m_fd, UI_DEV_CREATE))
+  if (!m_created)
   {
-    raise_exception(std::runtime_error, "unable to create uinput device: '" << name << "': " << strerror(errno));
+    create();
   }
 
   m_finished = true;
@@ -283,9 +376,94 @@ LinuxUinput::finish()
   }
 }
 
+std::string
+LinuxUinput::get_signature() const
+{
+  return m_created ? m_signature : calc_signature();
+}
+
+std::string
+LinuxUinput::calc_signature() const
+{
+  // FNV-1a
+  uint64_t hash = 14695981039346656037ULL;
+  struct Hasher
+  {
+    static void add(uint64_t& h, int64_t value)
+    {
+      for(int i = 0; i < 8; ++i)
+      {
+        h ^= static_cast<uint8_t>(value >> (i * 8));
+        h *= 1099511628211ULL;
+      }
+    }
+  };
+
+  for(std::string::const_iterator i = name.begin(); i != name.end(); ++i)
+  {
+    Hasher::add(hash, *i);
+  }
+
+  Hasher::add(hash, m_device_type);
+  Hasher::add(hash, usbid.bustype);
+  Hasher::add(hash, usbid.vendor);
+  Hasher::add(hash, usbid.product);
+  Hasher::add(hash, usbid.version);
+
+  for(int i = 0; i < ABS_CNT; ++i)
+  {
+    if (abs_lst[i])
+    {
+      Hasher::add(hash, i);
+      Hasher::add(hash, user_dev.absmin[i]);
+      Hasher::add(hash, user_dev.absmax[i]);
+      Hasher::add(hash, user_dev.absfuzz[i]);
+      Hasher::add(hash, user_dev.absflat[i]);
+    }
+  }
+
+  for(int i = 0; i < REL_CNT; ++i)
+  {
+    if (rel_lst[i]) Hasher::add(hash, REL_CNT + i);
+  }
+
+  for(int i = 0; i < KEY_CNT; ++i)
+  {
+    if (key_lst[i]) Hasher::add(hash, 0x10000 + i);
+  }
+
+  for(int i = 0; i < FF_CNT; ++i)
+  {
+    if (ff_lst[i]) Hasher::add(hash, 0x20000 + i);
+  }
+
+  return (boost::format("%016x") % hash).str();
+}
+
+bool
+LinuxUinput::adopt(int fd, const std::string& signature)
+{
+  assert(!m_created);
+
+  if (signature != get_signature())
+  {
+    return false;
+  }
+  else
+  {
+    // the ioctls done so far went to our own, never created, device
+    close(m_fd);
+    m_fd = fd;
+    m_adopted = true;
+    return true;
+  }
+}
+
 void
 LinuxUinput::send(uint16_t type, uint16_t code, int32_t value)
 {
+  TRACE_SPAN_ARG("LinuxUinput::send", code);
+
   needs_sync = true;
 
   struct input_event ev;
@@ -303,35 +481,86 @@ LinuxUinput::send(uint16_t type, uint16_t code, int32_t value)
     throw std::runtime_error(std::string("uinput:send_button: ") + strerror(errno));
 }
 
+void
+LinuxUinput::send_frame(const struct input_event* events, int count)
+{
+  TRACE_SPAN_ARG("LinuxUinput::send_frame", count);
+
+  if (count > 0)
+  {
+    if (write(m_fd, events, sizeof(struct input_event) * count) < 0)
+    {
+      raise_exception(std::runtime_error, "uinput:send_frame: " << strerror(errno));
+    }
+
+    needs_sync = false;
+  }
+}
+
 void
 LinuxUinput::sync()
 {
   if (needs_sync)
   {
+    TRACE_SPAN("LinuxUinput::sync");
     send(EV_SYN, SYN_REPORT, 0);
     needs_sync = false;
   }
 }
 
 void
-LinuxUinput::update(int msec_delta)
+LinuxUinput::ff_update()
 {
-  if (ff_bit)
-  {
-    assert(m_ff_handler);
+  assert(m_ff_handler);
 
-    m_ff_handler->update(msec_delta);
+  const int64_t now = Clock::now();
+  m_ff_handler->update(now - m_ff_last_time);
+  m_ff_last_time = now;
 
-    log_info(boost::format("%5d %5d") % m_ff_handler->get_strong_magnitude() % m_ff_handler->get_weak_magnitude());
+  uint8_t strong = static_cast<uint8_t>(m_ff_handler->get_strong_magnitude() / 128);
+  uint8_t weak   = static_cast<uint8_t>(m_ff_handler->get_weak_magnitude()   / 128);
+
+  if (strong != m_ff_strong || weak != m_ff_weak)
+  {
+    log_debug(boost::format("%5d %5d") % m_ff_handler->get_strong_magnitude() % m_ff_handler->get_weak_magnitude());
+
+    m_ff_strong = strong;
+    m_ff_weak   = weak;
 
     if (m_ff_callback)
     {
-      m_ff_callback(static_cast<unsigned char>(m_ff_handler->get_strong_magnitude() / 128),
-                    static_cast<unsigned char>(m_ff_handler->get_weak_magnitude()   / 128));
+      m_ff_callback(strong, weak);
     }
   }
 }
 
+void
+LinuxUinput::ff_start_timer()
+{
+  if (!m_ff_timeout_id && m_ff_handler->is_active())
+  {
+    // 5msec is below what the rumble motors can resolve, the timer is
+    // only running while an effect is playing
+    m_ff_timeout_id = g_timeout_add(5, &LinuxUinput::on_ff_timeout_wrap, this);
+  }
+}
+
+gboolean
+LinuxUinput::on_ff_timeout()
+{
+  ff_update();
+
+  if (m_ff_handler->is_active())
+  {
+    return TRUE;
+  }
+  else
+  {
+    m_ff_timeout_id = 0;
+    return FALSE;
+  }
+}
+
 gboolean
 LinuxUinput::on_read_data(GIOChannel* source, GIOCondition condition)
 {
@@ -354,14 +583,20 @@ LinuxUinput::on_read_data(GIOChannel* source, GIOCondition condition)
         switch(ev.code)
         {
           case FF_GAIN:
+            ff_update();
             m_ff_handler->set_gain(ev.value);
+            ff_update();
             break;
 
           default:
+            ff_update();
+            // ev.value is the number of times the effect is played
             if (ev.value)
-              m_ff_handler->play(ev.code);
+              m_ff_handler->play(ev.code, ev.value);
             else
               m_ff_handler->stop(ev.code);
+            ff_update();
+            ff_start_timer();
         }
         break;
 
@@ -379,8 +614,10 @@ LinuxUinput::on_read_data(GIOChannel* source, GIOCondition condition)
               upload.request_id = ev.value;
 
               ioctl(m_fd, UI_BEGIN_FF_UPLOAD, &upload);
-              m_ff_handler->upload(upload.effect);
-              upload.retval = 0;
+              ff_update();
+              upload.retval = m_ff_handler->upload(upload.effect) ? 0 : -EINVAL;
+              ff_update();
+              ff_start_timer();
 
               ioctl(m_fd, UI_END_FF_UPLOAD, &upload);
             }
@@ -397,7 +634,9 @@ LinuxUinput::on_read_data(GIOChannel* source, GIOCondition condition)
               erase.request_id = ev.value;
 
               ioctl(m_fd, UI_BEGIN_FF_ERASE, &erase);
+              ff_update();
               m_ff_handler->erase(erase.effect_id);
+              ff_update();
               erase.retval = 0;
 
               ioctl(m_fd, UI_END_FF_ERASE, &erase);
@@ -36,8 +36,28 @@ private:
   std::string name;
   struct input_id usbid;
 
+  /** the kernel device exists, finish() may still be pending */
+  bool m_created;
   bool m_finished;
 
+  /** the kernel device was created by a previous xboxdrv process */
+  bool m_adopted;
+
+  /** the fd was handed to another process, don't destroy the device */
+  bool m_detached;
+
+  /** signature as it was before finish() added mandatory events */
+  std::string m_signature;
+
+  /** the kernel's name for the device, e.g. "input42", and the
+      /dev/input nodes the input handlers created for it, both empty
+      when the kernel can't tell */
+  std::string m_sysname;
+  std::vector<std::string> m_device_nodes;
+
+  /** nsec spend in create() */
+  int64_t m_create_time;
+
   int m_fd;
   GIOChannel* m_io_channel;
   guint m_source_id;
@@ -56,6 +76,10 @@ private:
 
   ForceFeedbackHandler* m_ff_handler;
   boost::function<void (uint8_t, uint8_t)> m_ff_callback;
+  guint m_ff_timeout_id;
+  int64_t m_ff_last_time;
+  uint8_t m_ff_strong;
+  uint8_t m_ff_weak;
 
   bool needs_sync;
 
@@ -78,18 +102,67 @@ public:
 
   void set_ff_callback(const boost::function<void (uint8_t, uint8_t)>& callback);
 
-  /** Finalized the device creation */
+  /** Create the kernel device. This blocks until the kernel has
+      registered the device with all its input handlers and doesn't
+      touch the main loop, so devices can be created from multiple
+      threads at once, as long as each device is only used by one. */
+  void create();
+
+  /** Finalized the device creation, calls create() if that didn't
+      happen yet */
   void finish();
   /*@}*/
 
+  /** A hash over name, id and all capabilities, two devices with the
+      same signature are interchangeable */
+  std::string get_signature() const;
+
+  /** Use the already created uinput device behind \a fd instead of
+      creating a new one in create(), must be called before create().
+      Returns false and leaves \a fd alone when \a signature doesn't
+      match this device. */
+  bool adopt(int fd, const std::string& signature);
+
+  int get_fd() const { return m_fd; }
+
+  const std::string& get_name() const { return name; }
+  const std::string& get_sysname() const { return m_sysname; }
+  const std::vector<std::string>& get_device_nodes() const { return m_device_nodes; }
+  int64_t get_create_time() const { return m_create_time; }
+
+  /** Keep the kernel device alive when this object is destroyed,
+      used when the fd has been handed over to another process */
+  void detach() { m_detached = true; }
+
   void send(uint16_t type, uint16_t code, int32_t value);
 
+  /** Write \a count events with a single write(), the events are
+      passed on unmodified, so the caller has to end the frame with a
+      SYN_REPORT itself */
+  void send_frame(const struct input_event* events, int count);
+
   /** Sends out a sync event if there is a need for it. */
   void sync();
 
-  void update(int msec_delta);
-
 private:
+  std::string calc_signature() const;
+
+  /** look up m_sysname and m_device_nodes */
+  void find_device_nodes();
+
+  /** advance the force feedback effects to the current time and pass
+      the result on to the callback if it changed */
+  void ff_update();
+
+  /** start the timer that drives the effects while any is playing */
+  void ff_start_timer();
+
+  gboolean on_ff_timeout();
+  static gboolean on_ff_timeout_wrap(gpointer userdata)
+  {
+    return static_cast<LinuxUinput*>(userdata)->on_ff_timeout();
+  }
+
   gboolean on_read_data(GIOChannel* source,
                         GIOCondition condition);
   static gboolean on_read_data_wrap(GIOChannel* source,
@@ -0,0 +1,282 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "merged_controller.hpp"
+
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "clock.hpp"
+#include "log.hpp"
+
+namespace {
+
+const XboxAxis merged_axes[] = {
+  XBOX_AXIS_X1, XBOX_AXIS_Y1,
+  XBOX_AXIS_X2, XBOX_AXIS_Y2,
+  XBOX_AXIS_LT, XBOX_AXIS_RT
+};
+
+/** buttons compared when deciding whether a message has to be send
+    right away, the trigger buttons are covered by the trigger axes */
+bool buttons_equal(XboxGenericMsg& lhs, XboxGenericMsg& rhs)
+{
+  for(int btn = XBOX_BTN_START; btn < XBOX_BTN_MAX; ++btn)
+  {
+    if (btn != XBOX_BTN_LT && btn != XBOX_BTN_RT &&
+        get_button(lhs, static_cast<XboxButton>(btn)) != get_button(rhs, static_cast<XboxButton>(btn)))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+MergedController::MergedController(const std::vector<ControllerPtr>& sources, int merge_latency) :
+  m_sources(sources),
+  m_states(sources.size()),
+  m_connected(sources.size(), true),
+  m_merge_latency(merge_latency),
+  m_pending(),
+  m_timeout_id(0),
+  m_msg(),
+  m_sent_msg()
+{
+  m_pending.reserve(kMaxPending);
+
+  memset(&m_msg, 0, sizeof(m_msg));
+  m_msg.type = XBOX_MSG_XBOX360;
+  m_sent_msg = m_msg;
+
+  for(std::vector<XboxGenericMsg>::iterator i = m_states.begin(); i != m_states.end(); ++i)
+  {
+    *i = m_msg;
+  }
+
+  for(size_t i = 0; i < m_sources.size(); ++i)
+  {
+    m_sources[i]->set_message_cb(boost::bind(&MergedController::on_source_message, this, static_cast<int>(i), _1));
+    m_sources[i]->set_disconnect_cb(boost::bind(&MergedController::on_source_disconnect, this, static_cast<int>(i)));
+    m_sources[i]->set_activation_cb(boost::bind(&MergedController::on_source_activation, this));
+  }
+
+  on_source_activation();
+}
+
+MergedController::~MergedController()
+{
+  if (m_timeout_id)
+  {
+    g_source_remove(m_timeout_id);
+  }
+
+  for(std::vector<ControllerPtr>::iterator i = m_sources.begin(); i != m_sources.end(); ++i)
+  {
+    (*i)->set_message_cb(boost::function<void (const XboxGenericMsg&)>());
+    (*i)->set_disconnect_cb(boost::function<void ()>());
+    (*i)->set_activation_cb(boost::function<void ()>());
+  }
+}
+
+void
+MergedController::set_rumble_real(uint8_t left, uint8_t right)
+{
+  for(std::vector<ControllerPtr>::iterator i = m_sources.begin(); i != m_sources.end(); ++i)
+  {
+    (*i)->set_rumble(left, right);
+  }
+}
+
+void
+MergedController::set_led_real(uint8_t status)
+{
+  for(std::vector<ControllerPtr>::iterator i = m_sources.begin(); i != m_sources.end(); ++i)
+  {
+    (*i)->set_led(status);
+  }
+}
+
+std::string
+MergedController::get_usbpath() const
+{
+  return m_sources.front()->get_usbpath();
+}
+
+std::string
+MergedController::get_usbid() const
+{
+  return m_sources.front()->get_usbid();
+}
+
+std::string
+MergedController::get_name() const
+{
+  std::string name;
+  for(std::vector<ControllerPtr>::const_iterator i = m_sources.begin(); i != m_sources.end(); ++i)
+  {
+    if (!name.empty())
+    {
+      name += " + ";
+    }
+    name += (*i)->get_name();
+  }
+  return name;
+}
+
+void
+MergedController::on_source_message(int source, const XboxGenericMsg& msg)
+{
+  Input input;
+  // USB sources stamp their messages on completion, evdev ones don't
+  input.time = msg.time ? msg.time : Clock::now();
+  input.source = source;
+  input.msg = msg;
+  m_pending.push_back(input);
+
+  if (m_merge_latency <= 0 || static_cast<int>(m_pending.size()) >= kMaxPending)
+  {
+    flush();
+  }
+  else if (!m_timeout_id)
+  {
+    m_timeout_id = g_timeout_add(m_merge_latency, &MergedController::on_timeout_wrap, this);
+  }
+}
+
+void
+MergedController::on_source_disconnect(int source)
+{
+  log_info("merged source disconnected: " << m_sources[source]->get_name());
+
+  m_connected[source] = false;
+
+  // drop whatever the source was still holding down
+  memset(&m_states[source], 0, sizeof(XboxGenericMsg));
+  m_states[source].type = XBOX_MSG_XBOX360;
+  flush();
+
+  if (std::find(m_connected.begin(), m_connected.end(), true) == m_connected.end())
+  {
+    send_disconnect();
+  }
+}
+
+void
+MergedController::on_source_activation()
+{
+  bool active = false;
+  for(size_t i = 0; i < m_sources.size(); ++i)
+  {
+    if (m_connected[i] && m_sources[i]->is_active())
+    {
+      active = true;
+    }
+  }
+  set_active(active);
+}
+
+bool
+MergedController::on_timeout()
+{
+  m_timeout_id = 0;
+  flush();
+  return false;
+}
+
+void
+MergedController::flush()
+{
+  if (m_timeout_id)
+  {
+    g_source_remove(m_timeout_id);
+    m_timeout_id = 0;
+  }
+
+  // sources are read independently, so messages don't necessarily
+  // arrive in the order they were generated
+  std::stable_sort(m_pending.begin(), m_pending.end());
+
+  for(std::vector<Input>::iterator i = m_pending.begin(); i != m_pending.end(); ++i)
+  {
+    if (m_connected[i->source])
+    {
+      m_states[i->source] = i->msg;
+      merge();
+
+      if (!buttons_equal(m_msg, m_sent_msg))
+      {
+        m_msg.seq += 1;
+        m_msg.time = i->time;
+        m_sent_msg = m_msg;
+        submit_msg(m_msg);
+      }
+    }
+  }
+
+  m_pending.clear();
+
+  merge();
+  if (memcmp(&m_msg, &m_sent_msg, offsetof(XboxGenericMsg, seq)) != 0)
+  {
+    m_msg.seq += 1;
+    m_msg.time = Clock::now();
+    m_sent_msg = m_msg;
+    submit_msg(m_msg);
+  }
+}
+
+void
+MergedController::merge()
+{
+  XboxGenericMsg msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.type = XBOX_MSG_XBOX360;
+
+  for(std::vector<XboxGenericMsg>::iterator state = m_states.begin(); state != m_states.end(); ++state)
+  {
+    for(int btn = XBOX_BTN_START; btn < XBOX_BTN_MAX; ++btn)
+    {
+      if (btn != XBOX_BTN_LT && btn != XBOX_BTN_RT &&
+          get_button(*state, static_cast<XboxButton>(btn)))
+      {
+        set_button(msg, static_cast<XboxButton>(btn), true);
+      }
+    }
+
+    for(size_t i = 0; i < sizeof(merged_axes) / sizeof(merged_axes[0]); ++i)
+    {
+      const XboxAxis axis = merged_axes[i];
+      const int value = get_axis(*state, axis);
+      if (abs(value) > abs(get_axis(msg, axis)))
+      {
+        set_axis(msg, axis, value);
+      }
+    }
+  }
+
+  msg.seq  = m_msg.seq;
+  msg.time = m_msg.time;
+  m_msg = msg;
+}
+
+/* EOF */
@@ -0,0 +1,101 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_XBOXDRV_MERGED_CONTROLLER_HPP
+#define HEADER_XBOXDRV_MERGED_CONTROLLER_HPP
+
+#include <glib.h>
+#include <vector>
+
+#include "controller.hpp"
+#include "controller_ptr.hpp"
+#include "xboxmsg.hpp"
+
+/** Combines several controllers, i.e. a wheel, pedals and a shifter,
+    into a single Xbox360 controller. Buttons of all sources are or'ed
+    together, for each axis the source with the largest deflection
+    wins.
+
+    Input is timestamped when it arrives and collected for up to
+    \a merge_latency msec, then applied in timestamp order and sent
+    out as a single message. Axis movement inside that window is
+    coalesced, button changes are never lost, each one results in its
+    own message. A latency of 0 sends every change immediately. */
+class MergedController : public Controller
+{
+private:
+  struct Input
+  {
+    int64_t time;
+    int source;
+    XboxGenericMsg msg;
+
+    bool operator<(const Input& rhs) const { return time < rhs.time; }
+  };
+
+  /** flush the pending input when this many messages queue up,
+      regardless of latency */
+  enum { kMaxPending = 64 };
+
+public:
+  MergedController(const std::vector<ControllerPtr>& sources, int merge_latency);
+  ~MergedController();
+
+  void set_rumble_real(uint8_t left, uint8_t right);
+  void set_led_real(uint8_t status);
+
+  std::string get_usbpath() const;
+  std::string get_usbid() const;
+  std::string get_name() const;
+
+private:
+  void on_source_message(int source, const XboxGenericMsg& msg);
+  void on_source_disconnect(int source);
+  void on_source_activation();
+
+  /** apply all pending input in timestamp order and send the result */
+  void flush();
+
+  /** recompute m_msg from the state of all sources */
+  void merge();
+
+  bool on_timeout();
+  static gboolean on_timeout_wrap(gpointer data) {
+    return static_cast<MergedController*>(data)->on_timeout();
+  }
+
+private:
+  std::vector<ControllerPtr> m_sources;
+  std::vector<XboxGenericMsg> m_states;
+  std::vector<bool> m_connected;
+  int m_merge_latency;
+
+  std::vector<Input> m_pending;
+  guint m_timeout_id;
+
+  XboxGenericMsg m_msg;
+  XboxGenericMsg m_sent_msg;
+
+private:
+  MergedController(const MergedController&);
+  MergedController& operator=(const MergedController&);
+};
+
+#endif
+
+/* EOF */
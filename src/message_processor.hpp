@@ -30,7 +30,7 @@ public:
   MessageProcessor() {}
   virtual ~MessageProcessor() {}
 
-  virtual void send(const XboxGenericMsg& msg, int msec_delta) =0;
+  virtual void send(const XboxGenericMsg& msg, int64_t nsec_delta) =0;
   virtual void set_ff_callback(const boost::function<void (uint8_t, uint8_t)>& callback
                                = boost::function<void (uint8_t, uint8_t)>()) =0;
 
@@ -26,6 +26,7 @@
 #include "modifier/rotate_axis_modifier.hpp"
 #include "modifier/square_axis_modifier.hpp"
 #include "modifier/statistic_modifier.hpp"
+#include "modifier/stick_modifier.hpp"
 
 Modifier*
 Modifier::from_string(const std::string& name, const std::string& value)
@@ -63,6 +64,10 @@ Modifier::from_string(const std::string& name, const std::string& value)
     {
       return RotateAxisModifier::from_string(args);
     }
+    else if (name == "radial-deadzone")
+    {
+      return StickModifier::radial_deadzone_from_string(args);
+    }
     else if (name == "stat" || name == "statistic")
     {
       return StatisticModifier::from_string(args);
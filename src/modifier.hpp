@@ -20,6 +20,7 @@
 #define HEADER_MODIFIER_HPP
 
 #include <boost/shared_ptr.hpp>
+#include <stdint.h>
 
 #include "xboxmsg.hpp"
 
@@ -35,7 +36,7 @@ public:
 
 public:
   virtual ~Modifier() {}
-  virtual void update(int msec_delta, XboxGenericMsg& msg) = 0;
+  virtual void update(int64_t nsec_delta, XboxGenericMsg& msg) = 0;
 
   virtual std::string str() const = 0;
 };
@@ -76,7 +76,7 @@ AxismapModifier::AxismapModifier() :
 }
 
 void
-AxismapModifier::update(int msec_delta, XboxGenericMsg& msg)
+AxismapModifier::update(int64_t nsec_delta, XboxGenericMsg& msg)
 {
   XboxGenericMsg newmsg = msg;
 
@@ -85,7 +85,8 @@ AxismapModifier::update(int msec_delta, XboxGenericMsg& msg)
   {
     for(std::vector<AxisFilterPtr>::iterator j = i->filters.begin(); j != i->filters.end(); ++j)
     {
-      (*j)->update(msec_delta);
+      (*j)->update(nsec_delta);
+      (*j)->set_report_time(msg.time);
     }
   }
 
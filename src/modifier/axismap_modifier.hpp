@@ -44,7 +44,7 @@ class AxismapModifier : public Modifier
 public:
   AxismapModifier();
 
-  void update(int msec_delta, XboxGenericMsg& msg);
+  void update(int64_t nsec_delta, XboxGenericMsg& msg);
 
   void add(const AxisMapping& mapping);
   void add_filter(XboxAxis axis, AxisFilterPtr filter);
@@ -20,6 +20,9 @@
 
 #include <boost/tokenizer.hpp>
 #include <sstream>
+
+#include "buttonfilter/const_button_filter.hpp"
+#include "buttonfilter/invert_button_filter.hpp"
 
 ButtonMapping
 ButtonMapping::from_string(const std::string& lhs, const std::string& rhs)
@@ -54,52 +57,162 @@ ButtonMapping::from_string(const std::string& lhs, const std::string& rhs)
 }
 
 ButtonmapModifier::ButtonmapModifier() :
-  m_buttonmap()
+  m_buttonmap(),
+  m_clear_mask(0),
+  m_force_mask(0),
+  m_write_mask(0),
+  m_targets(),
+  m_stateful()
 {
 }
 
 void
-ButtonmapModifier::update(int msec_delta, XboxGenericMsg& msg)
+ButtonmapModifier::update(int64_t nsec_delta, XboxGenericMsg& msg)
 {
-  XboxGenericMsg newmsg = msg;
+  const uint32_t buttons = get_buttons(msg);
 
-  // update all filters in all mappings
-  for(std::vector<ButtonMapping>::iterator i = m_buttonmap.begin(); i != m_buttonmap.end(); ++i)
+  uint32_t result = (buttons & ~m_clear_mask) | m_force_mask;
+
+  for(std::vector<Target>::const_iterator i = m_targets.begin(); i != m_targets.end(); ++i)
   {
-    for(std::vector<ButtonFilterPtr>::iterator j = i->filters.begin(); j != i->filters.end(); ++j)
+    if ((buttons & i->sources) | (~buttons & i->inverted_sources))
     {
-      (*j)->update(msec_delta);
+      result |= i->bit;
     }
   }
 
-  // set all buttons to 0
-  for(std::vector<ButtonMapping>::iterator i = m_buttonmap.begin(); i != m_buttonmap.end(); ++i)
+  // update all filters first, a filter added with add_filter() can
+  // be shared by two mappings
+  for(std::vector<std::vector<ButtonMapping>::size_type>::const_iterator i = m_stateful.begin();
+      i != m_stateful.end(); ++i)
   {
-    set_button(newmsg, i->lhs, 0);
+    ButtonMapping& mapping = m_buttonmap[*i];
+    for(std::vector<ButtonFilterPtr>::iterator j = mapping.filters.begin(); j != mapping.filters.end(); ++j)
+    {
+      (*j)->update(nsec_delta);
+    }
   }
 
-  for(std::vector<ButtonMapping>::iterator i = m_buttonmap.begin(); i != m_buttonmap.end(); ++i)
+  for(std::vector<std::vector<ButtonMapping>::size_type>::const_iterator i = m_stateful.begin();
+      i != m_stateful.end(); ++i)
   {
-    // Take both lhs and rhs into account to allow multiple buttons
-    // mapping to the same button
-    bool value = get_button(msg, i->lhs);
+    ButtonMapping& mapping = m_buttonmap[*i];
 
-    // apply the button filter
-    for(std::vector<ButtonFilterPtr>::iterator j = i->filters.begin(); j != i->filters.end(); ++j)
+    bool value = buttons & (1u << mapping.lhs);
+    for(std::vector<ButtonFilterPtr>::iterator j = mapping.filters.begin(); j != mapping.filters.end(); ++j)
     {
       value = (*j)->filter(value);
     }
 
-    set_button(newmsg, i->rhs, value || get_button(newmsg, i->rhs));
+    if (value)
+    {
+      result |= 1u << mapping.rhs;
+    }
   }
 
-  msg = newmsg;
+  set_buttons(msg, result, m_write_mask);
+}
+
+bool
+ButtonmapModifier::fold_filters(const ButtonMapping& mapping, bool* invert, bool* is_const, bool* value)
+{
+  *invert = false;
+  *is_const = false;
+  *value = false;
+
+  for(std::vector<ButtonFilterPtr>::const_iterator i = mapping.filters.begin(); i != mapping.filters.end(); ++i)
+  {
+    if (dynamic_cast<const InvertButtonFilter*>(i->get()))
+    {
+      if (*is_const)
+      {
+        *value = !*value;
+      }
+      else
+      {
+        *invert = !*invert;
+      }
+    }
+    else if (const ConstButtonFilter* const_filter = dynamic_cast<const ConstButtonFilter*>(i->get()))
+    {
+      *is_const = true;
+      *value = const_filter->get_value();
+    }
+    else
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void
+ButtonmapModifier::compile()
+{
+  m_clear_mask = 0;
+  m_force_mask = 0;
+  m_write_mask = 0;
+  m_targets.clear();
+  m_stateful.clear();
+
+  for(std::vector<ButtonMapping>::size_type i = 0; i < m_buttonmap.size(); ++i)
+  {
+    const ButtonMapping& mapping = m_buttonmap[i];
+    const uint32_t lhs = 1u << mapping.lhs;
+    const uint32_t rhs = 1u << mapping.rhs;
+
+    m_clear_mask |= lhs;
+    m_write_mask |= lhs | rhs;
+
+    bool invert;
+    bool is_const;
+    bool value;
+    if (!fold_filters(mapping, &invert, &is_const, &value))
+    {
+      m_stateful.push_back(i);
+    }
+    else if (is_const)
+    {
+      if (value)
+      {
+        m_force_mask |= rhs;
+      }
+    }
+    else
+    {
+      std::vector<Target>::iterator target = m_targets.begin();
+      while (target != m_targets.end() && target->bit != rhs)
+      {
+        ++target;
+      }
+
+      if (target == m_targets.end())
+      {
+        Target t;
+        t.bit = rhs;
+        t.sources = 0;
+        t.inverted_sources = 0;
+        target = m_targets.insert(m_targets.end(), t);
+      }
+
+      if (invert)
+      {
+        target->inverted_sources |= lhs;
+      }
+      else
+      {
+        target->sources |= lhs;
+      }
+    }
+  }
 }
 
 void
 ButtonmapModifier::add(const ButtonMapping& mapping)
 {
   m_buttonmap.push_back(mapping);
+  compile();
 }
 
 void
@@ -39,12 +39,29 @@ struct ButtonMapping
   {}
 };
 
+/** Mappings whose filters are all stateless (invert, const) are
+    compiled into a table of source masks per target button plus a
+    force mask, which are applied to all buttons at once as a single
+    word. Only mappings with stateful filters (autofire, delay,
+    toggle, click, log) run their filters button by button. */
 class ButtonmapModifier : public Modifier
 {
+private:
+  struct Target
+  {
+    uint32_t bit;
+
+    /** the target is pressed when any of these is pressed */
+    uint32_t sources;
+
+    /** ...or when any of these is released */
+    uint32_t inverted_sources;
+  };
+
 public:
   ButtonmapModifier();
 
-  void update(int msec_delta, XboxGenericMsg& msg);
+  void update(int64_t nsec_delta, XboxGenericMsg& msg);
 
   void add(const ButtonMapping& mapping);
   void add_filter(XboxButton btn, ButtonFilterPtr filter);
@@ -53,8 +70,26 @@ public:
 
   bool empty() const { return m_buttonmap.empty(); }
 
-public:
+private:
+  /** rebuild the compiled form from m_buttonmap */
+  void compile();
+
+  /** reduce the filters of \a mapping to an invert or a constant,
+      returns false if one of them has state */
+  static bool fold_filters(const ButtonMapping& mapping, bool* invert, bool* is_const, bool* value);
+
+private:
   std::vector<ButtonMapping> m_buttonmap;
+
+  /** the sources of all mappings, they are released unless a mapping
+      presses them again */
+  uint32_t m_clear_mask;
+  uint32_t m_force_mask;
+  uint32_t m_write_mask;
+  std::vector<Target> m_targets;
+
+  /** indices into m_buttonmap */
+  std::vector<std::vector<ButtonMapping>::size_type> m_stateful;
 };
 
 #endif
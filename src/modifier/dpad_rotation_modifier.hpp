@@ -37,7 +37,7 @@ private:
 public:
   DpadRotationModifier(int dpad_rotation);
 
-  void update(int msec_delta, XboxGenericMsg& msg);
+  void update(int64_t nsec_delta, XboxGenericMsg& msg);
 
   std::string str() const;
 
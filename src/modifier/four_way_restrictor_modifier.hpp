@@ -31,7 +31,7 @@ public:
 public:
   FourWayRestrictorModifier(XboxAxis xaxis, XboxAxis yaxis);
 
-  void update(int msec_delta, XboxGenericMsg& msg);
+  void update(int64_t nsec_delta, XboxGenericMsg& msg);
 
   std::string str() const;
 
@@ -49,7 +49,7 @@ RotateAxisModifier::RotateAxisModifier(XboxAxis xaxis, XboxAxis yaxis, float ang
 }
 
 void
-RotateAxisModifier::update(int msec_delta, XboxGenericMsg& msg)
+RotateAxisModifier::update(int64_t nsec_delta, XboxGenericMsg& msg)
 {
   float x = get_axis_float(msg, m_xaxis);
   float y = get_axis_float(msg, m_yaxis);
@@ -31,9 +31,14 @@ public:
 public:
   RotateAxisModifier(XboxAxis xaxis, XboxAxis yaxis, float angle, bool mirror);
 
-  void update(int msec_delta, XboxGenericMsg& msg);
+  void update(int64_t nsec_delta, XboxGenericMsg& msg);
   std::string str() const;
 
+  XboxAxis get_xaxis() const { return m_xaxis; }
+  XboxAxis get_yaxis() const { return m_yaxis; }
+  float get_angle() const { return m_angle; }
+  bool get_mirror() const { return m_mirror; }
+
 private:
   XboxAxis m_xaxis;
   XboxAxis m_yaxis;
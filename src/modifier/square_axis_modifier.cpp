@@ -69,7 +69,7 @@ SquareAxisModifier::SquareAxisModifier(XboxAxis xaxis, XboxAxis yaxis) :
 }
 
 void
-SquareAxisModifier::update(int msec_delta, XboxGenericMsg& msg)
+SquareAxisModifier::update(int64_t nsec_delta, XboxGenericMsg& msg)
 {
   int x = get_axis(msg, m_xaxis);
   int y = get_axis(msg, m_yaxis);
@@ -31,10 +31,13 @@ public:
 public:
   SquareAxisModifier(XboxAxis x_axis, XboxAxis y_axis);
 
-  void update(int msec_delta, XboxGenericMsg& msg);
+  void update(int64_t nsec_delta, XboxGenericMsg& msg);
 
   std::string str() const;
 
+  XboxAxis get_xaxis() const { return m_xaxis; }
+  XboxAxis get_yaxis() const { return m_yaxis; }
+
 private:
   XboxAxis m_xaxis;
   XboxAxis m_yaxis;
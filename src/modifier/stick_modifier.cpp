@@ -0,0 +1,390 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "modifier/stick_modifier.hpp"
+
+#include <algorithm>
+#include <math.h>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <stdlib.h>
+
+#include "helper.hpp"
+#include "raise_exception.hpp"
+#include "modifier/rotate_axis_modifier.hpp"
+#include "modifier/square_axis_modifier.hpp"
+
+namespace {
+
+inline int clamp_axis(int64_t v)
+{
+  return static_cast<int>(Math::clamp(static_cast<int64_t>(-32768), v, static_cast<int64_t>(32767)));
+}
+
+/** the integer math assumes the range of a stick axis */
+bool is_stick_axis(XboxAxis axis)
+{
+  return
+    axis != XBOX_AXIS_UNKNOWN &&
+    get_axis_min(axis) == -32768 &&
+    get_axis_max(axis) == 32767;
+}
+
+inline int64_t isqrt(int64_t v)
+{
+  // exact for the range of two axis values
+  return static_cast<int64_t>(sqrt(static_cast<double>(v)));
+}
+
+} // namespace
+
+StickModifier*
+StickModifier::radial_deadzone_from_string(const std::vector<std::string>& args)
+{
+  if (args.size() != 3)
+  {
+    throw std::runtime_error("radial-deadzone requires three arguments");
+  }
+  else
+  {
+    std::auto_ptr<StickModifier> modifier(new StickModifier);
+    modifier->add_radial_deadzone(string2axis(args[0]),
+                                  string2axis(args[1]),
+                                  str2int(args[2]));
+    return modifier.release();
+  }
+}
+
+void
+StickModifier::compile(std::vector<ModifierPtr>* modifier)
+{
+  std::vector<ModifierPtr> result;
+  boost::shared_ptr<StickModifier> stage(new StickModifier);
+  int stage_size = 0;
+  ModifierPtr stage_first;
+
+  for(std::vector<ModifierPtr>::const_iterator i = modifier->begin(); i != modifier->end(); ++i)
+  {
+    if (!stage->add(**i))
+    {
+      // the stage ends here, a single modifier is left as it is
+      if (stage_size == 1)
+      {
+        result.push_back(stage_first);
+      }
+      else if (stage_size > 1)
+      {
+        result.push_back(stage);
+      }
+
+      stage.reset(new StickModifier);
+      stage_size = 0;
+
+      if (!stage->add(**i))
+      {
+        result.push_back(*i);
+        continue;
+      }
+    }
+
+    if (stage_size == 0)
+    {
+      stage_first = *i;
+    }
+    stage_size += 1;
+  }
+
+  if (stage_size == 1)
+  {
+    result.push_back(stage_first);
+  }
+  else if (stage_size > 1)
+  {
+    result.push_back(stage);
+  }
+
+  modifier->swap(result);
+}
+
+StickModifier::StickModifier() :
+  m_sticks()
+{
+}
+
+bool
+StickModifier::fits(XboxAxis xaxis, XboxAxis yaxis) const
+{
+  for(std::vector<Stick>::const_iterator i = m_sticks.begin(); i != m_sticks.end(); ++i)
+  {
+    if (i->xaxis == xaxis && i->yaxis == yaxis)
+    {
+      return true;
+    }
+    else if (i->xaxis == xaxis || i->xaxis == yaxis ||
+             i->yaxis == xaxis || i->yaxis == yaxis)
+    {
+      return false;
+    }
+  }
+
+  return
+    xaxis != yaxis &&
+    is_stick_axis(xaxis) &&
+    is_stick_axis(yaxis);
+}
+
+StickModifier::Stick&
+StickModifier::get_stick(XboxAxis xaxis, XboxAxis yaxis)
+{
+  if (!fits(xaxis, yaxis))
+  {
+    raise_exception(std::runtime_error, "axis " << axis2string(xaxis) << " and " << axis2string(yaxis)
+                    << " aren't a pair of stick axis");
+  }
+
+  for(std::vector<Stick>::iterator i = m_sticks.begin(); i != m_sticks.end(); ++i)
+  {
+    if (i->xaxis == xaxis && i->yaxis == yaxis)
+    {
+      return *i;
+    }
+  }
+
+  m_sticks.push_back(Stick(xaxis, yaxis));
+  return m_sticks.back();
+}
+
+void
+StickModifier::add_deadzone(XboxAxis xaxis, XboxAxis yaxis, int threshold)
+{
+  Op op = Op();
+  op.type = Op::kDeadzone;
+  op.threshold = threshold;
+  get_stick(xaxis, yaxis).ops.push_back(op);
+}
+
+void
+StickModifier::add_radial_deadzone(XboxAxis xaxis, XboxAxis yaxis, int threshold)
+{
+  if (threshold < 0 || threshold >= 32767)
+  {
+    raise_exception(std::runtime_error, "radial deadzone must be between 0 and 32766: " << threshold);
+  }
+
+  Op op = Op();
+  op.type = Op::kRadialDeadzone;
+  op.threshold = threshold;
+  get_stick(xaxis, yaxis).ops.push_back(op);
+}
+
+void
+StickModifier::add_square(XboxAxis xaxis, XboxAxis yaxis)
+{
+  Op op = Op();
+  op.type = Op::kSquare;
+  get_stick(xaxis, yaxis).ops.push_back(op);
+}
+
+void
+StickModifier::add_rotate(XboxAxis xaxis, XboxAxis yaxis, float angle, bool mirror)
+{
+  const int64_t c = static_cast<int64_t>(lround(cos(angle) * 65536.0));
+  const int64_t s = static_cast<int64_t>(lround(sin(angle) * 65536.0));
+  const int64_t m = mirror ? -1 : 1;
+
+  // x' = cos * x - sin * y, y' = sin * x + cos * y, with x mirrored
+  // beforehand
+  Op op = Op();
+  op.type = Op::kRotate;
+  op.matrix[0] = m * c;
+  op.matrix[1] = -s;
+  op.matrix[2] = m * s;
+  op.matrix[3] = c;
+  get_stick(xaxis, yaxis).ops.push_back(op);
+}
+
+bool
+StickModifier::add(const Modifier& modifier)
+{
+  if (const RotateAxisModifier* rotate = dynamic_cast<const RotateAxisModifier*>(&modifier))
+  {
+    if (!fits(rotate->get_xaxis(), rotate->get_yaxis()))
+    {
+      return false;
+    }
+    else
+    {
+      add_rotate(rotate->get_xaxis(), rotate->get_yaxis(), rotate->get_angle(), rotate->get_mirror());
+      return true;
+    }
+  }
+  else if (const SquareAxisModifier* square = dynamic_cast<const SquareAxisModifier*>(&modifier))
+  {
+    if (!fits(square->get_xaxis(), square->get_yaxis()))
+    {
+      return false;
+    }
+    else
+    {
+      add_square(square->get_xaxis(), square->get_yaxis());
+      return true;
+    }
+  }
+  else if (const StickModifier* other = dynamic_cast<const StickModifier*>(&modifier))
+  {
+    for(std::vector<Stick>::const_iterator i = other->m_sticks.begin(); i != other->m_sticks.end(); ++i)
+    {
+      if (!fits(i->xaxis, i->yaxis))
+      {
+        return false;
+      }
+    }
+
+    for(std::vector<Stick>::const_iterator i = other->m_sticks.begin(); i != other->m_sticks.end(); ++i)
+    {
+      Stick& stick = get_stick(i->xaxis, i->yaxis);
+      stick.ops.insert(stick.ops.end(), i->ops.begin(), i->ops.end());
+    }
+    return true;
+  }
+  else
+  {
+    return false;
+  }
+}
+
+void
+StickModifier::apply(const Op& op, int& x, int& y)
+{
+  switch(op.type)
+  {
+    case Op::kDeadzone:
+      // same math as DeadzoneAxisFilter::filter()
+      if (x < -op.threshold)
+      {
+        x = -32768 * (x + op.threshold) / (-32768 + op.threshold);
+      }
+      else if (x > op.threshold)
+      {
+        x = 32767 * (x - op.threshold) / (32767 - op.threshold);
+      }
+      else
+      {
+        x = 0;
+      }
+
+      if (y < -op.threshold)
+      {
+        y = -32768 * (y + op.threshold) / (-32768 + op.threshold);
+      }
+      else if (y > op.threshold)
+      {
+        y = 32767 * (y - op.threshold) / (32767 - op.threshold);
+      }
+      else
+      {
+        y = 0;
+      }
+      break;
+
+    case Op::kRadialDeadzone:
+      {
+        const int64_t r = isqrt(static_cast<int64_t>(x) * x + static_cast<int64_t>(y) * y);
+        if (r <= op.threshold)
+        {
+          x = 0;
+          y = 0;
+        }
+        else
+        {
+          const int64_t num = (r - op.threshold) * 32767;
+          const int64_t den = (32767 - op.threshold) * r;
+          x = clamp_axis(x * num / den);
+          y = clamp_axis(y * num / den);
+        }
+      }
+      break;
+
+    case Op::kSquare:
+      if (x != 0 || y != 0)
+      {
+        const int64_t r = isqrt(static_cast<int64_t>(x) * x + static_cast<int64_t>(y) * y);
+        const int64_t m = std::max(abs(x), abs(y));
+        x = clamp_axis(x * r / m);
+        y = clamp_axis(y * r / m);
+      }
+      break;
+
+    case Op::kRotate:
+      {
+        const int64_t rx = op.matrix[0] * x + op.matrix[1] * y;
+        const int64_t ry = op.matrix[2] * x + op.matrix[3] * y;
+        x = clamp_axis((rx + 32768) >> 16);
+        y = clamp_axis((ry + 32768) >> 16);
+      }
+      break;
+  }
+}
+
+void
+StickModifier::update(int64_t nsec_delta, XboxGenericMsg& msg)
+{
+  for(std::vector<Stick>::const_iterator i = m_sticks.begin(); i != m_sticks.end(); ++i)
+  {
+    int x = get_axis(msg, i->xaxis);
+    int y = get_axis(msg, i->yaxis);
+
+    for(std::vector<Op>::const_iterator op = i->ops.begin(); op != i->ops.end(); ++op)
+    {
+      apply(*op, x, y);
+    }
+
+    set_axis(msg, i->xaxis, x);
+    set_axis(msg, i->yaxis, y);
+  }
+}
+
+std::string
+StickModifier::str() const
+{
+  std::ostringstream out;
+  out << "stick";
+  for(std::vector<Stick>::const_iterator i = m_sticks.begin(); i != m_sticks.end(); ++i)
+  {
+    out << ":" << axis2string(i->xaxis) << "," << axis2string(i->yaxis) << "=";
+    for(std::vector<Op>::const_iterator op = i->ops.begin(); op != i->ops.end(); ++op)
+    {
+      if (op != i->ops.begin())
+      {
+        out << "^";
+      }
+
+      switch(op->type)
+      {
+        case Op::kDeadzone:       out << "deadzone:" << op->threshold; break;
+        case Op::kRadialDeadzone: out << "radial-deadzone:" << op->threshold; break;
+        case Op::kSquare:         out << "square"; break;
+        case Op::kRotate:         out << "rotate"; break;
+      }
+    }
+  }
+  return out.str();
+}
+
+/* EOF */
@@ -0,0 +1,106 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_XBOXDRV_MODIFIER_STICK_MODIFIER_HPP
+#define HEADER_XBOXDRV_MODIFIER_STICK_MODIFIER_HPP
+
+#include <vector>
+
+#include "modifier.hpp"
+
+/** Processes pairs of axes, i.e. both analog sticks, in a single
+    pass. Deadzones, square mapping and rotation are done in integer
+    math on the raw axis values, rotations use a precomputed matrix,
+    so no float conversion or trigonometry happens per message.
+    Consecutive RotateAxisModifier and SquareAxisModifier get folded
+    into a StickModifier by compile(). */
+class StickModifier : public Modifier
+{
+private:
+  struct Op
+  {
+    enum Type { kDeadzone, kRadialDeadzone, kSquare, kRotate };
+
+    Type type;
+
+    /** deadzone threshold */
+    int threshold;
+
+    /** rotation matrix in 16.16 fixed point */
+    int64_t matrix[4];
+  };
+
+  struct Stick
+  {
+    Stick(XboxAxis x, XboxAxis y) : xaxis(x), yaxis(y), ops() {}
+
+    XboxAxis xaxis;
+    XboxAxis yaxis;
+    std::vector<Op> ops;
+  };
+
+public:
+  /** radial-deadzone=XAXIS:YAXIS:THRESHOLD */
+  static StickModifier* radial_deadzone_from_string(const std::vector<std::string>& args);
+
+  /** replace runs of consecutive stick modifiers in \a modifier with
+      a single StickModifier each */
+  static void compile(std::vector<ModifierPtr>* modifier);
+
+public:
+  StickModifier();
+
+  /** same as a smooth DeadzoneAxisFilter on each axis */
+  void add_deadzone(XboxAxis xaxis, XboxAxis yaxis, int threshold);
+
+  /** deadzone on the distance from the center, rescaled so full
+      deflection stays full deflection */
+  void add_radial_deadzone(XboxAxis xaxis, XboxAxis yaxis, int threshold);
+
+  /** same as SquareAxisModifier */
+  void add_square(XboxAxis xaxis, XboxAxis yaxis);
+
+  /** same as RotateAxisModifier, \a angle is in radians */
+  void add_rotate(XboxAxis xaxis, XboxAxis yaxis, float angle, bool mirror);
+
+  /** append \a modifier if it is a stick modifier whose axes fit
+      into this one, returns false otherwise */
+  bool add(const Modifier& modifier);
+
+  bool empty() const { return m_sticks.empty(); }
+
+  void update(int64_t nsec_delta, XboxGenericMsg& msg);
+  std::string str() const;
+
+private:
+  /** false if the axes aren't stick axes or one of them already
+      belongs to a different pair */
+  bool fits(XboxAxis xaxis, XboxAxis yaxis) const;
+
+  /** the stick for the given axes, created if needed */
+  Stick& get_stick(XboxAxis xaxis, XboxAxis yaxis);
+
+  static void apply(const Op& op, int& x, int& y);
+
+private:
+  std::vector<Stick> m_sticks;
+};
+
+#endif
+
+/* EOF */
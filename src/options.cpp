@@ -77,6 +77,11 @@ Options::Options() :
   detach_kernel_driver(),
   timeout(10),
   priority(kPriorityNormal),
+  output_rate(100),
+  usb_read_depth(2),
+  trace_file(),
+  trace_size(65536),
+  calibration_dir(),
   gamepad_type(GAMEPAD_UNKNOWN),
   busid(),
   devid(),
@@ -87,6 +92,10 @@ Options::Options() :
   evdev_grab(true),
   evdev_debug(false),
   evdev_keymap(),
+  evdev_passthrough(false),
+  evdev_remap(),
+  merge_evdev_devices(),
+  merge_latency(2),
   controller_slots(),
   chatpad(false),
   chatpad_no_init(false),
@@ -97,9 +106,13 @@ Options::Options() :
   headset_play(),
   detach(false),
   dbus(kDBusAuto),
+  dbus_signal_rate(10),
   pid_file(),
   on_connect(),
   on_disconnect(),
+  handover_socket(),
+  takeover(false),
+  rumble_patterns(),
   exec(),
   list_enums(0),
   config_toggle_button(XBOX_BTN_UNKNOWN),
@@ -111,7 +124,8 @@ Options::Options() :
   uinput_device_names(),
   uinput_device_usbids(),
   usb_debug(false),
-  m_generic_usb_specs()
+  m_generic_usb_specs(),
+  hid_map()
 {
   // create the entry if not already available
   controller_slots[controller_slot].get_options(config_slot);
@@ -182,6 +196,102 @@ Options::set_priority(const std::string& value)
   }
 }
 
+void
+Options::set_output_rate(const std::string& value)
+{
+  int rate = str2int(value);
+  if (rate < 1 || rate > 1000)
+  {
+    raise_exception(std::runtime_error, "output rate must be between 1 and 1000 Hz: '" << value << "'");
+  }
+  else
+  {
+    output_rate = rate;
+  }
+}
+
+void
+Options::set_usb_read_depth(const std::string& value)
+{
+  int depth = str2int(value);
+  if (depth < 1 || depth > 16)
+  {
+    raise_exception(std::runtime_error, "USB read depth must be between 1 and 16: '" << value << "'");
+  }
+  else
+  {
+    usb_read_depth = depth;
+  }
+}
+
+void
+Options::set_trace_size(const std::string& value)
+{
+  int size = str2int(value);
+  if (size < 1024 || size > 16 * 1024 * 1024)
+  {
+    raise_exception(std::runtime_error, "trace size must be between 1024 and 16777216: '" << value << "'");
+  }
+  else
+  {
+    trace_size = size;
+  }
+}
+
+void
+Options::set_dbus_signal_rate(const std::string& value)
+{
+  int rate = str2int(value);
+  if (rate < 0 || rate > 1000)
+  {
+    raise_exception(std::runtime_error, "D-Bus signal rate must be between 0 and 1000: '" << value << "'");
+  }
+  else
+  {
+    dbus_signal_rate = rate;
+  }
+}
+
+void
+Options::add_rumble_pattern(const std::string& name, const std::string& value)
+{
+  rumble_patterns[name] = RumblePattern::from_string(value);
+}
+
+void
+Options::add_rumble_pattern_spec(const std::string& name_value)
+{
+  // the pattern itself contains commas, so only split at the first '='
+  std::string name;
+  std::string value;
+  split_string_at(name_value, '=', &name, &value);
+  if (name.empty() || value.empty())
+  {
+    raise_exception(std::runtime_error, "expected NAME=PATTERN: " << name_value);
+  }
+  add_rumble_pattern(name, value);
+}
+
+void
+Options::add_merge_evdev(const std::string& value)
+{
+  merge_evdev_devices.push_back(value);
+}
+
+void
+Options::set_merge_latency(const std::string& value)
+{
+  int latency = str2int(value);
+  if (latency < 0 || latency > 100)
+  {
+    raise_exception(std::runtime_error, "merge latency must be between 0 and 100 msec: '" << value << "'");
+  }
+  else
+  {
+    merge_latency = latency;
+  }
+}
+
 void
 Options::set_ui_clear()
 {
@@ -27,6 +27,9 @@
 #include "controller_options.hpp"
 #include "controller_slot_options.hpp"
 #include "evdev_absmap.hpp"
+#include "hid_report_plan.hpp"
+#include "evdev_remap.hpp"
+#include "rumble_pattern.hpp"
 #include "uinput_options.hpp"
 #include "xpad_device.hpp"
 
@@ -75,6 +78,19 @@ public:
   int  timeout;
   Priority priority;
 
+  /** rate in Hz at which relative motion is written to uinput */
+  int  output_rate;
+
+  /** number of interrupt IN transfers kept queued per endpoint */
+  int  usb_read_depth;
+
+  /** file the pipeline trace is written to, empty when not tracing */
+  std::string trace_file;
+  int  trace_size;
+
+  /** where calibration=learn keeps its results, empty for the default */
+  std::string calibration_dir;
+
   GamepadType gamepad_type;
 
   // device options
@@ -89,6 +105,12 @@ public:
   bool evdev_grab;
   bool evdev_debug;
   std::map<int, XboxButton> evdev_keymap;
+  bool evdev_passthrough;
+  EvdevRemap evdev_remap;
+
+  /** further evdev devices merged with the main controller */
+  std::vector<std::string> merge_evdev_devices;
+  int merge_latency;
 
   // controller options
   typedef std::map<int, ControllerSlotOptions> ControllerSlots;
@@ -114,10 +136,22 @@ public:
     kDBusSession   /// chose session bus
   };
   DBusSubsystemMode dbus;
+
+  /** how often per second StateChanged may be emitted per slot, 0
+      disables the D-Bus signals */
+  int dbus_signal_rate;
   std::string pid_file;
   std::string on_connect;
   std::string on_disconnect;
 
+  /** unix socket on which the daemon hands its devices to a successor */
+  std::string handover_socket;
+  bool takeover;
+
+  /** patterns every controller slot can play, more can be uploaded
+      via D-Bus */
+  std::map<std::string, RumblePatternPtr> rumble_patterns;
+
   std::vector<std::string> exec;
 
   uint32_t list_enums;
@@ -174,6 +208,10 @@ public:
 
   std::vector<GenericUSBSpec> m_generic_usb_specs;
 
+  /** HID usage mapping for generic USB devices, the default one is
+      used when empty */
+  HidMap hid_map;
+
 public:
   Options();
 
@@ -185,6 +223,11 @@ public:
   const ControllerOptions& get_controller_options() const;
 
   void set_priority(const std::string& value);
+  void set_output_rate(const std::string& value);
+  void set_usb_read_depth(const std::string& value);
+  void set_trace_size(const std::string& value);
+  void add_merge_evdev(const std::string& value);
+  void set_merge_latency(const std::string& value);
 
   void set_ui_clear();
 
@@ -197,6 +240,9 @@ public:
   void set_quiet();
 
   void set_dbus_mode(const std::string& value);
+  void set_dbus_signal_rate(const std::string& value);
+  void add_rumble_pattern(const std::string& name, const std::string& value);
+  void add_rumble_pattern_spec(const std::string& name_value);
   void set_led(const std::string& value);
   void set_device_name(const std::string& name);
   void set_device_usbid(const std::string& name);
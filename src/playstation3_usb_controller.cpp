@@ -26,8 +26,8 @@
 #include "usb_helper.hpp"
 #include "xboxmsg.hpp"
 
-Playstation3USBController::Playstation3USBController(libusb_device* dev, bool try_detach) :
-  USBController(dev),
+Playstation3USBController::Playstation3USBController(libusb_device* dev, bool try_detach, int read_queue_depth) :
+  USBController(dev, read_queue_depth),
   endpoint_in(1),
   endpoint_out(2)
 {
@@ -30,7 +30,7 @@ private:
   int endpoint_out;
 
 public:
-  Playstation3USBController(libusb_device* dev, bool try_detach);
+  Playstation3USBController(libusb_device* dev, bool try_detach, int read_queue_depth);
   ~Playstation3USBController();
 
   void set_rumble_real(uint8_t left, uint8_t right);
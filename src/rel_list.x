@@ -40,4 +40,12 @@
   add(REL_MISC, "REL_MISC");
 #endif
 
+#ifdef REL_WHEEL_HI_RES
+  add(REL_WHEEL_HI_RES, "REL_WHEEL_HI_RES");
+#endif
+
+#ifdef REL_HWHEEL_HI_RES
+  add(REL_HWHEEL_HI_RES, "REL_HWHEEL_HI_RES");
+#endif
+
 /* EOF */
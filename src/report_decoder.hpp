@@ -0,0 +1,58 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_XBOXDRV_REPORT_DECODER_HPP
+#define HEADER_XBOXDRV_REPORT_DECODER_HPP
+
+#include "report_layout.hpp"
+#include "xboxmsg.hpp"
+
+/** Decoders generated from the report layouts in the *_report.x
+    files, \a data has to point to at least kSize bytes. */
+namespace report {
+
+enum {
+  kXbox360ReportSize     = 20,
+  kXboxReportSize        = 20,
+  kSaitekP2500ReportSize = 7
+};
+
+inline void decode_xbox360(const uint8_t* data, Xbox360Msg& msg)
+{
+  enum { kSize = kXbox360ReportSize };
+#include "xbox360_report.x"
+}
+
+inline void decode_xbox(const uint8_t* data, XboxMsg& msg)
+{
+  enum { kSize = kXboxReportSize };
+#include "xbox_report.x"
+}
+
+/** fields not present in the report are left untouched */
+inline void decode_saitek_p2500(const uint8_t* data, Xbox360Msg& msg)
+{
+  enum { kSize = kSaitekP2500ReportSize };
+#include "saitek_p2500_report.x"
+}
+
+} // namespace report
+
+#endif
+
+/* EOF */
@@ -0,0 +1,157 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_XBOXDRV_REPORT_LAYOUT_HPP
+#define HEADER_XBOXDRV_REPORT_LAYOUT_HPP
+
+#include <stdint.h>
+
+#include "helper.hpp"
+
+/** Field readers for decoding USB reports straight out of the
+    transfer buffer. Offsets are template arguments, so each field
+    compiles down to a couple of loads and shifts, and reading past
+    the end of a report of \a Size bytes is a compile error. Multi
+    byte values are assembled bytewise, which works regardless of host
+    endianess and alignment.
+
+    The layout of a report is a list of REPORT_* lines in a .x file,
+    see report_decoder.hpp for how they get turned into code. */
+namespace report {
+
+/** C++98 has no static_assert, StaticAssert<false> is incomplete */
+template<bool> struct StaticAssert;
+template<> struct StaticAssert<true> { enum { value = 1 }; };
+
+template<int Offset, int Size>
+struct CheckExtent
+{
+  enum { value = StaticAssert<(Offset >= 0 && Offset < Size)>::value };
+};
+
+template<int Offset, int BitNo>
+struct Bit
+{
+  template<int Size>
+  static bool get(const uint8_t* data)
+  {
+    (void) CheckExtent<Offset, Size>::value;
+    return (data[Offset] >> BitNo) & 1;
+  }
+};
+
+/** a digital button reported as analog value, 0 or 255 */
+template<int Offset, int BitNo>
+struct BitU8
+{
+  template<int Size>
+  static int get(const uint8_t* data)
+  {
+    (void) CheckExtent<Offset, Size>::value;
+    return ((data[Offset] >> BitNo) & 1) * 255;
+  }
+};
+
+template<int Offset>
+struct U8
+{
+  template<int Size>
+  static int get(const uint8_t* data)
+  {
+    (void) CheckExtent<Offset, Size>::value;
+    return data[Offset];
+  }
+};
+
+/** a signed 8bit axis scaled to the 16bit range */
+template<int Offset>
+struct S8ToS16
+{
+  template<int Size>
+  static int get(const uint8_t* data)
+  {
+    (void) CheckExtent<Offset, Size>::value;
+    return scale_8to16(static_cast<int8_t>(data[Offset]));
+  }
+};
+
+template<int Offset>
+struct S16LE
+{
+  template<int Size>
+  static int get(const uint8_t* data)
+  {
+    (void) CheckExtent<Offset + 1, Size>::value;
+    return static_cast<int16_t>(data[Offset] | (data[Offset + 1] << 8));
+  }
+};
+
+template<int Offset>
+struct U16LE
+{
+  template<int Size>
+  static unsigned int get(const uint8_t* data)
+  {
+    (void) CheckExtent<Offset + 1, Size>::value;
+    return data[Offset] | (data[Offset + 1] << 8);
+  }
+};
+
+template<int Offset>
+struct U32LE
+{
+  template<int Size>
+  static uint32_t get(const uint8_t* data)
+  {
+    (void) CheckExtent<Offset + 3, Size>::value;
+    return (static_cast<uint32_t>(data[Offset]) |
+            (static_cast<uint32_t>(data[Offset + 1]) << 8) |
+            (static_cast<uint32_t>(data[Offset + 2]) << 16) |
+            (static_cast<uint32_t>(data[Offset + 3]) << 24));
+  }
+};
+
+/** 4bit hat switch, 0 is up, counting clockwise in steps of 45
+    degree, everything above 7 is centered. \a Dir selects the
+    direction: 0 up, 2 right, 4 down, 6 left */
+template<int Offset, int Shift, int Dir>
+struct Hat
+{
+  template<int Size>
+  static bool get(const uint8_t* data)
+  {
+    (void) CheckExtent<Offset, Size>::value;
+    int value = (data[Offset] >> Shift) & 0xf;
+    return value < 8 && ((value - Dir + 9) % 8) < 3;
+  }
+};
+
+} // namespace report
+
+#define REPORT_BIT(target, offset, bit)       msg.target = report::Bit<offset, bit>::get<kSize>(data);
+#define REPORT_BIT_U8(target, offset, bit)    msg.target = report::BitU8<offset, bit>::get<kSize>(data);
+#define REPORT_U8(target, offset)             msg.target = report::U8<offset>::get<kSize>(data);
+#define REPORT_S8_TO_S16(target, offset)      msg.target = report::S8ToS16<offset>::get<kSize>(data);
+#define REPORT_S16LE(target, offset)          msg.target = report::S16LE<offset>::get<kSize>(data);
+#define REPORT_U16LE(target, offset)          msg.target = report::U16LE<offset>::get<kSize>(data);
+#define REPORT_U32LE(target, offset)          msg.target = report::U32LE<offset>::get<kSize>(data);
+#define REPORT_HAT(target, offset, shift, dir) msg.target = report::Hat<offset, shift, dir>::get<kSize>(data);
+
+#endif
+
+/* EOF */
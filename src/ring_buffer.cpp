@@ -0,0 +1,78 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ring_buffer.hpp"
+
+#include <algorithm>
+#include <string.h>
+
+RingBuffer::RingBuffer(int capacity) :
+  m_buffer(capacity + 1),
+  m_size(capacity + 1),
+  m_read_pos(0),
+  m_write_pos(0)
+{
+}
+
+int
+RingBuffer::get_read_space() const
+{
+  int r = g_atomic_int_get(&m_read_pos);
+  int w = g_atomic_int_get(&m_write_pos);
+  return (w - r + m_size) % m_size;
+}
+
+int
+RingBuffer::get_write_space() const
+{
+  return m_size - 1 - get_read_space();
+}
+
+int
+RingBuffer::write(const uint8_t* data, int len)
+{
+  int w = g_atomic_int_get(&m_write_pos);
+  len = std::min(len, get_write_space());
+
+  // copy in at most two pieces, before and after the wrap around
+  int first = std::min(len, m_size - w);
+  memcpy(&m_buffer[w], data, first);
+  memcpy(&m_buffer[0], data + first, len - first);
+
+  // publishing the position makes the data visible to the consumer
+  g_atomic_int_set(&m_write_pos, (w + len) % m_size);
+
+  return len;
+}
+
+int
+RingBuffer::read(uint8_t* data, int len)
+{
+  int r = g_atomic_int_get(&m_read_pos);
+  len = std::min(len, get_read_space());
+
+  int first = std::min(len, m_size - r);
+  memcpy(data, &m_buffer[r], first);
+  memcpy(data + first, &m_buffer[0], len - first);
+
+  g_atomic_int_set(&m_read_pos, (r + len) % m_size);
+
+  return len;
+}
+
+/* EOF */
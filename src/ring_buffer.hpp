@@ -0,0 +1,67 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_XBOXDRV_RING_BUFFER_HPP
+#define HEADER_XBOXDRV_RING_BUFFER_HPP
+
+#include <glib.h>
+#include <stdint.h>
+#include <vector>
+
+/** Lock-free byte FIFO for exactly one producer and one consumer
+    thread. Each side only ever modifies its own position, the other
+    position is read with an atomic load, so neither side ever waits
+    for the other. */
+class RingBuffer
+{
+private:
+  std::vector<uint8_t> m_buffer;
+
+  /** one byte of the buffer stays unused to tell full from empty */
+  int m_size;
+
+  mutable volatile gint m_read_pos;
+  mutable volatile gint m_write_pos;
+
+public:
+  RingBuffer(int capacity);
+
+  int get_capacity() const { return m_size - 1; }
+
+  /** number of bytes that can be read */
+  int get_read_space() const;
+
+  /** number of bytes that can be written */
+  int get_write_space() const;
+
+  /** Write up to \a len bytes, returns the number of bytes written.
+      Must only be called from the producer thread. */
+  int write(const uint8_t* data, int len);
+
+  /** Read up to \a len bytes, returns the number of bytes read. Must
+      only be called from the consumer thread. */
+  int read(uint8_t* data, int len);
+
+private:
+  RingBuffer(const RingBuffer&);
+  RingBuffer& operator=(const RingBuffer&);
+};
+
+#endif
+
+/* EOF */
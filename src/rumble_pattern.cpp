@@ -0,0 +1,170 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "rumble_pattern.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <boost/tokenizer.hpp>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+
+#include "clock.hpp"
+#include "helper.hpp"
+#include "raise_exception.hpp"
+
+RumblePatternPtr
+RumblePattern::from_string(const std::string& str)
+{
+  std::vector<Keyframe> keyframes;
+  int loops = 1;
+
+  typedef boost::tokenizer<boost::char_separator<char> > tokenizer;
+  tokenizer tokens(str, boost::char_separator<char>(",", "", boost::drop_empty_tokens));
+  for(tokenizer::iterator t = tokens.begin(); t != tokens.end(); ++t)
+  {
+    std::vector<std::string> args;
+    tokenizer arg_tokens(*t, boost::char_separator<char>(":", "", boost::keep_empty_tokens));
+    std::copy(arg_tokens.begin(), arg_tokens.end(), std::back_inserter(args));
+
+    if (args[0] == "loop")
+    {
+      if (args.size() == 1)
+      {
+        loops = 0;
+      }
+      else if (args.size() == 2 && str2int(args[1]) > 0)
+      {
+        loops = str2int(args[1]);
+      }
+      else
+      {
+        raise_exception(std::runtime_error, "invalid loop in rumble pattern: " << *t);
+      }
+    }
+    else if (args.size() == 3 || (args.size() == 4 && args[3] == "step"))
+    {
+      Keyframe keyframe;
+      keyframe.msec   = str2int(args[0]);
+      keyframe.strong = str2int(args[1]);
+      keyframe.weak   = str2int(args[2]);
+      keyframe.step   = (args.size() == 4);
+
+      if (keyframe.strong < 0 || keyframe.strong > 255 ||
+          keyframe.weak < 0 || keyframe.weak > 255)
+      {
+        raise_exception(std::runtime_error, "rumble strength must be between 0 and 255: " << *t);
+      }
+      else if (keyframes.empty() ? keyframe.msec != 0 : keyframe.msec <= keyframes.back().msec)
+      {
+        raise_exception(std::runtime_error, "rumble pattern must start at 0 msec and keyframes must be ordered by time: " << *t);
+      }
+
+      keyframes.push_back(keyframe);
+    }
+    else
+    {
+      raise_exception(std::runtime_error, "invalid keyframe in rumble pattern, expected MSEC:STRONG:WEAK: " << *t);
+    }
+  }
+
+  if (keyframes.size() < 2)
+  {
+    raise_exception(std::runtime_error, "rumble pattern needs at least two keyframes: " << str);
+  }
+
+  return RumblePatternPtr(new RumblePattern(keyframes, loops));
+}
+
+RumblePattern::RumblePattern(const std::vector<Keyframe>& keyframes, int loops) :
+  m_keyframes(keyframes),
+  m_loops(loops)
+{
+  assert(m_keyframes.size() >= 2);
+}
+
+bool
+RumblePattern::get(int64_t nsec, uint8_t* strong, uint8_t* weak) const
+{
+  const int64_t duration = msec2nsec(m_keyframes.back().msec);
+
+  if (nsec < 0 || (m_loops != 0 && nsec >= duration * m_loops))
+  {
+    return false;
+  }
+
+  const int64_t t = nsec % duration;
+
+  // patterns are short, a linear search is fine
+  std::vector<Keyframe>::size_type i = 0;
+  while(msec2nsec(m_keyframes[i+1].msec) <= t)
+  {
+    i += 1;
+  }
+
+  const Keyframe& lhs = m_keyframes[i];
+  const Keyframe& rhs = m_keyframes[i+1];
+
+  if (lhs.step)
+  {
+    *strong = static_cast<uint8_t>(lhs.strong);
+    *weak   = static_cast<uint8_t>(lhs.weak);
+  }
+  else
+  {
+    const int64_t pos = t - msec2nsec(lhs.msec);
+    const int64_t len = msec2nsec(rhs.msec - lhs.msec);
+    *strong = static_cast<uint8_t>(lhs.strong + (rhs.strong - lhs.strong) * pos / len);
+    *weak   = static_cast<uint8_t>(lhs.weak   + (rhs.weak   - lhs.weak)   * pos / len);
+  }
+
+  return true;
+}
+
+std::string
+RumblePattern::str() const
+{
+  std::ostringstream out;
+  for(std::vector<Keyframe>::const_iterator i = m_keyframes.begin(); i != m_keyframes.end(); ++i)
+  {
+    if (i != m_keyframes.begin())
+    {
+      out << ",";
+    }
+    out << i->msec << ":" << i->strong << ":" << i->weak;
+    if (i->step)
+    {
+      out << ":step";
+    }
+  }
+
+  if (m_loops == 0)
+  {
+    out << ",loop";
+  }
+  else if (m_loops != 1)
+  {
+    out << ",loop:" << m_loops;
+  }
+
+  return out.str();
+}
+
+/* EOF */
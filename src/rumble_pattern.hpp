@@ -0,0 +1,74 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef HEADER_XBOXDRV_RUMBLE_PATTERN_HPP
+#define HEADER_XBOXDRV_RUMBLE_PATTERN_HPP
+
+#include <boost/shared_ptr.hpp>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class RumblePattern;
+
+typedef boost::shared_ptr<RumblePattern> RumblePatternPtr;
+
+/** A rumble envelope given as keyframes of strong and weak motor
+    strength, values between keyframes are interpolated linearly or
+    held until the next keyframe. The syntax is:
+
+    MSEC:STRONG:WEAK[:step],...[,loop[:COUNT]]
+
+    The first keyframe has to be at 0 msec, "loop" repeats the
+    pattern forever, "loop:COUNT" plays it COUNT times. */
+class RumblePattern
+{
+public:
+  struct Keyframe
+  {
+    int msec;
+    int strong;
+    int weak;
+
+    /** hold the value until the next keyframe instead of fading */
+    bool step;
+  };
+
+public:
+  static RumblePatternPtr from_string(const std::string& str);
+
+public:
+  /** \a loops is the number of times the pattern is played, 0 plays
+      it forever */
+  RumblePattern(const std::vector<Keyframe>& keyframes, int loops);
+
+  /** motor strength \a nsec after the pattern started, returns false
+      once the pattern is over */
+  bool get(int64_t nsec, uint8_t* strong, uint8_t* weak) const;
+
+  std::string str() const;
+
+private:
+  std::vector<Keyframe> m_keyframes;
+  int m_loops;
+};
+
+#endif
+
+/* EOF */
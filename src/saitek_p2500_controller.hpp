@@ -30,7 +30,7 @@ private:
   int right_rumble;
 
 public:
-  SaitekP2500Controller(libusb_device* dev, bool try_detach);
+  SaitekP2500Controller(libusb_device* dev, bool try_detach, int read_queue_depth);
   ~SaitekP2500Controller();
 
   void set_rumble_real(uint8_t left, uint8_t right);
@@ -0,0 +1,30 @@
+// Saitek P2500 state report, decoded into a Xbox360Msg
+
+REPORT_S8_TO_S16(x1,   1)
+REPORT_S8_TO_S16(y1,   2)
+
+REPORT_S8_TO_S16(x2,   3)
+REPORT_S8_TO_S16(y2,   4)
+
+REPORT_BIT(a,          5, 0)
+REPORT_BIT(x,          5, 1)
+REPORT_BIT(b,          5, 2)
+REPORT_BIT(y,          5, 3)
+
+REPORT_BIT(lb,         5, 4)
+REPORT_BIT_U8(lt,      5, 5)
+REPORT_BIT(rb,         5, 6)
+REPORT_BIT_U8(rt,      5, 7)
+
+REPORT_BIT(thumb_l,    6, 0)
+REPORT_BIT(thumb_r,    6, 1)
+
+REPORT_BIT(start,      6, 2)
+REPORT_BIT(back,       6, 3) // not supported
+
+REPORT_HAT(dpad_up,    6, 4, 0)
+REPORT_HAT(dpad_right, 6, 4, 2)
+REPORT_HAT(dpad_down,  6, 4, 4)
+REPORT_HAT(dpad_left,  6, 4, 6)
+
+/* EOF */
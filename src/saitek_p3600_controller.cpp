@@ -66,8 +66,8 @@ struct SaitekP3600Msg
 
 } __attribute__((__packed__));
 
-SaitekP3600Controller::SaitekP3600Controller(libusb_device* dev, bool try_detach) :
-  USBController(dev),
+SaitekP3600Controller::SaitekP3600Controller(libusb_device* dev, bool try_detach, int read_queue_depth) :
+  USBController(dev, read_queue_depth),
   left_rumble(-1),
   right_rumble(-1)
 {
@@ -30,7 +30,7 @@ private:
   int right_rumble;
 
 public:
-  SaitekP3600Controller(libusb_device* dev, bool try_detach);
+  SaitekP3600Controller(libusb_device* dev, bool try_detach, int read_queue_depth);
   ~SaitekP3600Controller();
 
   void set_rumble_real(uint8_t left, uint8_t right);
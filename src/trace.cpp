@@ -0,0 +1,206 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "trace.hpp"
+
+#include <algorithm>
+#include <errno.h>
+#include <fstream>
+#include <glib.h>
+#include <glib-unix.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+#include "log.hpp"
+
+namespace {
+
+struct Span
+{
+  const char* name;
+  int arg;
+  int64_t start;
+  int64_t duration;
+};
+
+/** Only the owning thread writes, m_count is published after the
+    span is complete so write_json() can read without locking */
+struct TraceBuffer
+{
+  TraceBuffer(int capacity_, int tid_) :
+    spans(capacity_),
+    mask(static_cast<guint>(capacity_ - 1)),
+    count(0),
+    tid(tid_)
+  {}
+
+  std::vector<Span> spans;
+  guint mask;
+  volatile gint count;
+  int tid;
+};
+
+__thread TraceBuffer* g_thread_buffer = 0;
+
+GMutex g_buffers_mutex;
+std::vector<TraceBuffer*> g_buffers;
+
+TraceBuffer* create_thread_buffer(int capacity)
+{
+  TraceBuffer* buffer = new TraceBuffer(capacity, static_cast<int>(syscall(SYS_gettid)));
+
+  g_mutex_lock(&g_buffers_mutex);
+  g_buffers.push_back(buffer);
+  g_mutex_unlock(&g_buffers_mutex);
+
+  return buffer;
+}
+
+gboolean on_sigusr1(gpointer userdata)
+{
+  Trace::dump(Trace::get_filename());
+  return TRUE;
+}
+
+/** print nsec as usec with three decimals, as Chrome expects */
+void write_usec(std::ostream& out, int64_t nsec)
+{
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%lld.%03d",
+           static_cast<long long>(nsec / 1000),
+           static_cast<int>(nsec % 1000));
+  out << buf;
+}
+
+} // namespace
+
+bool Trace::s_enabled = false;
+int Trace::s_capacity = 0;
+std::string Trace::s_filename;
+
+void
+Trace::enable(int capacity, const std::string& filename)
+{
+  s_capacity = 1;
+  while(s_capacity < capacity)
+  {
+    s_capacity *= 2;
+  }
+
+  s_filename = filename;
+  s_enabled = true;
+
+  g_unix_signal_add(SIGUSR1, &on_sigusr1, NULL);
+
+  log_info("tracing enabled, send SIGUSR1 to write the trace to " << s_filename);
+}
+
+void
+Trace::record(const char* name, int arg, int64_t start, int64_t end)
+{
+  if (!g_thread_buffer)
+  {
+    g_thread_buffer = create_thread_buffer(s_capacity);
+  }
+
+  TraceBuffer& buffer = *g_thread_buffer;
+  guint count = static_cast<guint>(buffer.count);
+
+  Span& span = buffer.spans[count & buffer.mask];
+  span.name = name;
+  span.arg = arg;
+  span.start = start;
+  span.duration = end - start;
+
+  g_atomic_int_set(&buffer.count, static_cast<gint>(count + 1));
+}
+
+void
+Trace::write_json(std::ostream& out)
+{
+  const int pid = static_cast<int>(getpid());
+
+  out << "{\"traceEvents\":[\n";
+
+  g_mutex_lock(&g_buffers_mutex);
+  bool first = true;
+  for(std::vector<TraceBuffer*>::const_iterator i = g_buffers.begin(); i != g_buffers.end(); ++i)
+  {
+    const TraceBuffer& buffer = **i;
+    const guint end = static_cast<guint>(g_atomic_int_get(&buffer.count));
+    const guint size = std::min(end, buffer.mask + 1);
+
+    for(guint n = end - size; n != end; ++n)
+    {
+      const Span& span = buffer.spans[n & buffer.mask];
+
+      if (!first)
+      {
+        out << ",\n";
+      }
+      first = false;
+
+      out << "{\"name\":\"" << span.name << "\",\"ph\":\"X\",\"pid\":" << pid
+          << ",\"tid\":" << buffer.tid << ",\"ts\":";
+      write_usec(out, span.start);
+      out << ",\"dur\":";
+      write_usec(out, span.duration);
+      if (span.arg >= 0)
+      {
+        out << ",\"args\":{\"n\":" << span.arg << "}";
+      }
+      out << "}";
+    }
+  }
+  g_mutex_unlock(&g_buffers_mutex);
+
+  out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+bool
+Trace::dump(const std::string& filename)
+{
+  std::ofstream out(filename.c_str());
+  if (!out)
+  {
+    log_error(filename << ": couldn't write trace: " << strerror(errno));
+    return false;
+  }
+  else
+  {
+    write_json(out);
+    out.close();
+
+    if (!out)
+    {
+      log_error(filename << ": couldn't write trace: " << strerror(errno));
+      return false;
+    }
+    else
+    {
+      log_info("trace written to " << filename);
+      return true;
+    }
+  }
+}
+
+/* EOF */
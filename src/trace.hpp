@@ -0,0 +1,106 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_XBOXDRV_TRACE_HPP
+#define HEADER_XBOXDRV_TRACE_HPP
+
+#include <iosfwd>
+#include <stdint.h>
+#include <string>
+
+#include "clock.hpp"
+
+/** Opt-in recording of pipeline timings. Spans are kept in a ring
+    buffer per thread, so recording never locks, and are written out
+    as Chrome trace event JSON, which chrome://tracing and Perfetto can
+    display. While tracing is disabled a span costs a single branch. */
+class Trace
+{
+public:
+  /** start recording, each thread keeps the last \a capacity spans,
+      rounded up to a power of two. SIGUSR1 writes the spans recorded
+      so far to \a filename. */
+  static void enable(int capacity, const std::string& filename);
+
+  static bool is_enabled() { return s_enabled; }
+
+  /** the file given to enable() */
+  static std::string get_filename() { return s_filename; }
+
+  /** record a span, \a name must be a string literal, \a arg is
+      shown in the trace when it isn't negative */
+  static void record(const char* name, int arg, int64_t start, int64_t end);
+
+  /** write all recorded spans of all threads as JSON, spans that get
+      overwritten while this runs may come out garbled */
+  static void write_json(std::ostream& out);
+
+  /** write the trace to \a filename, returns false on error */
+  static bool dump(const std::string& filename);
+
+private:
+  static bool s_enabled;
+  static int s_capacity;
+  static std::string s_filename;
+};
+
+/** Records the time between construction and destruction as a span */
+class TraceSpan
+{
+public:
+  TraceSpan(const char* name, int arg = -1) :
+    m_name(name),
+    m_arg(arg),
+    m_active(Trace::is_enabled()),
+    m_start(m_active ? Clock::now() : 0)
+  {}
+
+  ~TraceSpan()
+  {
+    if (m_active)
+    {
+      Trace::record(m_name, m_arg, m_start, Clock::now());
+    }
+  }
+
+private:
+  const char* m_name;
+  int m_arg;
+  bool m_active;
+  int64_t m_start;
+
+private:
+  TraceSpan(const TraceSpan&);
+  TraceSpan& operator=(const TraceSpan&);
+};
+
+#define TRACE_SPAN_CONCAT2(a, b) a##b
+#define TRACE_SPAN_CONCAT(a, b) TRACE_SPAN_CONCAT2(a, b)
+
+/** trace the rest of the enclosing scope */
+#define TRACE_SPAN(name) \
+  TraceSpan TRACE_SPAN_CONCAT(trace_span_, __LINE__)(name)
+
+/** trace the rest of the enclosing scope, tagged with \a arg, i.e. a
+    button or modifier number */
+#define TRACE_SPAN_ARG(name, arg) \
+  TraceSpan TRACE_SPAN_CONCAT(trace_span_, __LINE__)(name, arg)
+
+#endif
+
+/* EOF */
@@ -18,6 +18,8 @@
 
 #include "ui_abs_event_collector.hpp"
 
+#include <assert.h>
+
 #include "uinput.hpp"
 
 UIAbsEventCollector::UIAbsEventCollector(UInput& uinput, uint32_t device_id, int type, int code) :
@@ -37,7 +39,8 @@ UIAbsEventCollector::create_emitter()
 void
 UIAbsEventCollector::send(int value)
 {
-  m_uinput.send(get_device_id(), get_type(), get_code(), value);
+  assert(m_device);
+  m_device->send(get_type(), get_code(), value);
 }
 
 void
@@ -30,7 +30,8 @@ UIEventCollector::UIEventCollector(UInput& uinput,
   m_uinput(uinput),
   m_device_id(device_id),
   m_type(type),
-  m_code(code)
+  m_code(code),
+  m_device()
 {
   assert(m_code != -1);
 }
@@ -25,6 +25,7 @@
 
 #include "ui_event_emitter.hpp"
 
+class LinuxUinput;
 class UIEventCollector;
 class UInput;
 
@@ -38,6 +39,9 @@ protected:
   int m_type;
   int m_code;
 
+  /** the device the events go to, NULL until UInput::finish() */
+  LinuxUinput* m_device;
+
 public:
   UIEventCollector(UInput& uinput, uint32_t device_id, int type, int code);
   virtual ~UIEventCollector();
@@ -46,6 +50,8 @@ public:
   int      get_type() const { return m_type; }
   int      get_code() const { return m_code; }
 
+  void set_device(LinuxUinput* device) { m_device = device; }
+
   virtual UIEventEmitterPtr create_emitter() = 0;
   virtual void sync() = 0;
 
@@ -40,6 +40,7 @@ void
 UIKeyEventCollector::send(int value)
 {
   assert(value == 0 || value == 1);
+  assert(m_device);
 
   if (value)
   {
@@ -52,7 +53,7 @@ UIKeyEventCollector::send(int value)
 
     if (m_value == 1)
     {
-      m_uinput.send(get_device_id(), get_type(), get_code(), m_value);
+      m_device->send(get_type(), get_code(), m_value);
     }
   }
   else
@@ -66,7 +67,7 @@ UIKeyEventCollector::send(int value)
 
     if (m_value == 0)
     {
-      m_uinput.send(get_device_id(), get_type(), get_code(), 0);
+      m_device->send(get_type(), get_code(), 0);
     }
   }
 }
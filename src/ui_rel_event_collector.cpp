@@ -18,11 +18,37 @@
 
 #include "ui_rel_event_collector.hpp"
 
+#include <assert.h>
+#include <linux/input.h>
+
 #include "uinput.hpp"
 
+int
+UIRelEventCollector::get_lores_code(int code)
+{
+  switch(code)
+  {
+#ifdef REL_WHEEL_HI_RES
+    case REL_WHEEL_HI_RES:
+      return REL_WHEEL;
+#endif
+
+#ifdef REL_HWHEEL_HI_RES
+    case REL_HWHEEL_HI_RES:
+      return REL_HWHEEL;
+#endif
+
+    default:
+      return -1;
+  }
+}
+
 UIRelEventCollector::UIRelEventCollector(UInput& uinput, uint32_t device_id, int type, int code) :
   UIEventCollector(uinput, device_id, type, code),
-  m_emitters()
+  m_emitters(),
+  m_value(0),
+  m_lores_code(get_lores_code(code)),
+  m_lores_rest(0)
 {
 }
 
@@ -37,12 +63,38 @@ UIRelEventCollector::create_emitter()
 void
 UIRelEventCollector::send(int value)
 {
-  m_uinput.send(get_device_id(), get_type(), get_code(), value);
+  m_value += value;
 }
 
 void
 UIRelEventCollector::sync()
 {
+  // motion is written out by flush(), not on every frame
+}
+
+void
+UIRelEventCollector::flush()
+{
+  if (m_value != 0)
+  {
+    assert(m_device);
+    m_device->send(get_type(), get_code(), m_value);
+
+    if (m_lores_code != -1)
+    {
+      // hi-res wheel devices must also report the classic wheel
+      // event whenever a full detent has been scrolled
+      m_lores_rest += m_value;
+      int detents = m_lores_rest / kHiResPerDetent;
+      if (detents != 0)
+      {
+        m_device->send(get_type(), m_lores_code, detents);
+        m_lores_rest -= detents * kHiResPerDetent;
+      }
+    }
+
+    m_value = 0;
+  }
 }
 
 /* EOF */
@@ -22,12 +22,33 @@
 #include "ui_event_collector.hpp"
 #include "ui_rel_event_emitter.hpp"
 
+/** Relative motion is not written out right away, but summed up and
+    written as a single event per axis when UInput flushes its
+    relative axes at the configured output rate. */
 class UIRelEventCollector : public UIEventCollector
 {
 private:
   typedef std::vector<UIRelEventEmitterPtr> Emitters;
   Emitters m_emitters;
 
+  /** motion collected since the last flush() */
+  int m_value;
+
+  /** for REL_WHEEL_HI_RES and REL_HWHEEL_HI_RES: the matching
+      low-resolution code, -1 otherwise */
+  int m_lores_code;
+
+  /** high-resolution units not yet send as a low-resolution detent */
+  int m_lores_rest;
+
+public:
+  /** number of high-resolution units in one wheel detent */
+  static const int kHiResPerDetent = 120;
+
+  /** return the low-resolution code that has to be send alongside
+      \a code, -1 if \a code is not a high-resolution wheel */
+  static int get_lores_code(int code);
+
 public:
   UIRelEventCollector(UInput& uinput, uint32_t device_id, int type, int code);
 
@@ -35,6 +56,10 @@ public:
   void send(int value);
   void sync();
 
+  /** write out the accumulated motion, the caller has to sync the
+      device afterwards */
+  void flush();
+
 private:
   UIRelEventCollector(const UIRelEventCollector&);
   UIRelEventCollector& operator=(const UIRelEventCollector&);
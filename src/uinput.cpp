@@ -18,19 +18,116 @@
 
 #include "uinput.hpp"
 
+#include <algorithm>
+#include <boost/format.hpp>
 #include <boost/tokenizer.hpp>
 #include <iostream>
 #include <math.h>
 #include <stdexcept>
+#include <errno.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
 
 #include "ui_abs_event_collector.hpp"
 #include "ui_key_event_collector.hpp"
 #include "ui_rel_event_collector.hpp"
 
+#include "clock.hpp"
 #include "helper.hpp"
 #include "log.hpp"
 #include "raise_exception.hpp"
+#include "trace.hpp"
+
+namespace {
+
+/** UI_DEV_CREATE mostly waits for the kernel, so a few threads are
+    enough to overlap the creation of all devices */
+const int kMaxCreateThreads = 8;
+
+struct CreateJob
+{
+  CreateJob(const std::vector<LinuxUinput*>& devices_) :
+    devices(devices_),
+    errors(devices_.size()),
+    next(0)
+  {}
+
+  std::vector<LinuxUinput*> devices;
+  std::vector<std::string> errors;
+
+  /** index of the next device to create, shared by all workers */
+  volatile gint next;
+};
+
+gpointer create_devices_worker(gpointer data)
+{
+  CreateJob& job = *static_cast<CreateJob*>(data);
+
+  for(;;)
+  {
+    int i = g_atomic_int_add(&job.next, 1);
+    if (i >= static_cast<int>(job.devices.size()))
+    {
+      return 0;
+    }
+
+    try
+    {
+      job.devices[i]->create();
+    }
+    catch(const std::exception& err)
+    {
+      job.errors[i] = err.what();
+    }
+  }
+}
+
+/** create the kernel devices in parallel, returns the number of
+    threads used, throws the first error after all threads are done */
+int create_devices(const std::vector<LinuxUinput*>& devices)
+{
+  CreateJob job(devices);
+
+  const int thread_count = std::min(kMaxCreateThreads, static_cast<int>(devices.size()));
+  if (thread_count <= 1)
+  {
+    create_devices_worker(&job);
+  }
+  else
+  {
+    std::vector<GThread*> threads;
+    for(int i = 0; i < thread_count; ++i)
+    {
+      threads.push_back(g_thread_new("uinput-create", &create_devices_worker, &job));
+    }
+
+    for(std::vector<GThread*>::iterator i = threads.begin(); i != threads.end(); ++i)
+    {
+      g_thread_join(*i);
+    }
+  }
+
+  for(std::vector<std::string>::const_iterator i = job.errors.begin(); i != job.errors.end(); ++i)
+  {
+    if (!i->empty())
+    {
+      throw std::runtime_error(*i);
+    }
+  }
+
+  return thread_count;
+}
+
+/** creating a device often takes less than a msec */
+std::string format_msec(int64_t nsec)
+{
+  return (boost::format("%.1f") % (static_cast<double>(nsec) / 1000000.0)).str();
+}
+
+} // namespace
+
 
 struct input_id
 UInput::parse_input_id(const std::string& str)
@@ -103,33 +200,83 @@ UInput::parse_device_id(const std::string& str)
   return UInput::create_device_id(slot_id, device_id);
 }
 
-UInput::UInput(bool extra_events) :
+UInput::UInput(bool extra_events, int output_rate) :
   m_uinput_devs(),
   m_device_names(),
   m_device_usbids(),
   m_collectors(),
+  m_rel_collectors(),
   m_rel_repeat_lst(),
   m_extra_events(extra_events),
+  m_handover_devs(),
+  m_output_interval(std::max(1, 1000000000 / output_rate)),
+  m_timer_fd(-1),
+  m_io_channel(),
   m_timeout_id(),
-  m_timer(g_timer_new())
+  m_last_time(Clock::now())
 {
-  // FIXME: hardcoded timeout is kind of evil
+  m_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (m_timer_fd < 0)
+  {
+    raise_exception(std::runtime_error, "timerfd_create() failed: " << strerror(errno));
+  }
+
+  // the kernel advances the periodic timer, so late wakeups don't
+  // accumulate into drift
+  struct itimerspec spec;
+  spec.it_interval.tv_sec  = m_output_interval / 1000000000;
+  spec.it_interval.tv_nsec = m_output_interval % 1000000000;
+  spec.it_value = spec.it_interval;
+  if (timerfd_settime(m_timer_fd, 0, &spec, NULL) < 0)
+  {
+    close(m_timer_fd);
+    raise_exception(std::runtime_error, "timerfd_settime() failed: " << strerror(errno));
+  }
+
   // FIXME: would be nicer if UInput didn't depend on glib
-  m_timeout_id = g_timeout_add(10, &UInput::on_timeout_wrap, this);
+  m_io_channel = g_io_channel_unix_new(m_timer_fd);
+
+  // set encoding to binary
+  GError* error = NULL;
+  if (g_io_channel_set_encoding(m_io_channel, NULL, &error) != G_IO_STATUS_NORMAL)
+  {
+    log_error(error->message);
+    g_error_free(error);
+  }
+
+  g_io_channel_set_buffered(m_io_channel, false);
+
+  m_timeout_id = g_io_add_watch_full(m_io_channel, G_PRIORITY_HIGH, G_IO_IN,
+                                     &UInput::on_timeout_wrap, this, NULL);
 }
 
 UInput::~UInput()
 {
   g_source_remove(m_timeout_id);
-  g_timer_destroy(m_timer);
+  g_io_channel_unref(m_io_channel);
+  close(m_timer_fd);
 }
 
 bool
-UInput::on_timeout()
+UInput::on_timeout(GIOChannel* source, GIOCondition condition)
 {
-  int msec_delta = static_cast<int>(g_timer_elapsed(m_timer, NULL) * 1000.0f);
-  g_timer_reset(m_timer);
-  update(msec_delta);
+  TRACE_SPAN("UInput::on_timeout");
+
+  uint64_t expirations;
+  if (read(m_timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+  {
+    // spurious wakeup
+    return true;
+  }
+
+  int64_t now = Clock::now();
+  int64_t nsec_delta = now - m_last_time;
+  m_last_time = now;
+
+  update(nsec_delta);
+  flush_rel();
+  sync();
+
   return true;  // do not remove the callback
 }
 
@@ -338,6 +485,12 @@ UInput::add_rel(uint32_t device_id, int ev_code)
   LinuxUinput* dev = create_uinput_device(device_id);
   dev->add_rel(ev_code);
 
+  int lores_code = UIRelEventCollector::get_lores_code(ev_code);
+  if (lores_code != -1)
+  {
+    dev->add_rel(lores_code);
+  }
+
   return create_emitter(device_id, EV_REL, ev_code);
 }
 
@@ -390,8 +543,9 @@ UInput::create_emitter(int device_id, int type, int code)
 
     case EV_REL:
       {
-        UIEventCollectorPtr collector(new UIRelEventCollector(*this, device_id, type, code));
+        boost::shared_ptr<UIRelEventCollector> collector(new UIRelEventCollector(*this, device_id, type, code));
         m_collectors.push_back(collector);
+        m_rel_collectors.push_back(collector);
         return collector->create_emitter();
       }
 
@@ -404,10 +558,97 @@ UInput::create_emitter(int device_id, int type, int code)
 void
 UInput::finish()
 {
+  for(std::vector<HandoverDevice>::iterator h = m_handover_devs.begin(); h != m_handover_devs.end(); ++h)
+  {
+    UInputDevs::iterator it = m_uinput_devs.find(h->device_id);
+    if (it != m_uinput_devs.end() && it->second->adopt(h->fd, h->signature))
+    {
+      log_debug("adopting device " << h->device_id);
+    }
+    else
+    {
+      // closing the last reference destroys the old device
+      log_info("configuration of device " << h->device_id << " changed, recreating it");
+      close(h->fd);
+    }
+  }
+  m_handover_devs.clear();
+
+  const int64_t create_start = Clock::now();
+
+  std::vector<LinuxUinput*> devices;
+  for(UInputDevs::iterator i = m_uinput_devs.begin(); i != m_uinput_devs.end(); ++i)
+  {
+    devices.push_back(i->second.get());
+  }
+  const int thread_count = create_devices(devices);
+
+  const int64_t finish_start = Clock::now();
+
   for(UInputDevs::iterator i = m_uinput_devs.begin(); i != m_uinput_devs.end(); ++i)
   {
     i->second->finish();
   }
+
+  const int64_t finish_end = Clock::now();
+
+  // startup timing breakdown for --verbose
+  int64_t create_sum = 0;
+  for(UInputDevs::iterator i = m_uinput_devs.begin(); i != m_uinput_devs.end(); ++i)
+  {
+    const LinuxUinput& dev = *i->second;
+    std::ostringstream nodes;
+    for(std::vector<std::string>::const_iterator n = dev.get_device_nodes().begin(); n != dev.get_device_nodes().end(); ++n)
+    {
+      nodes << " " << *n;
+    }
+    log_info("uinput device '" << dev.get_name() << "': "
+             << (dev.get_sysname().empty() ? "-" : dev.get_sysname()) << nodes.str()
+             << ", created in " << format_msec(dev.get_create_time()) << " msec");
+    create_sum += dev.get_create_time();
+  }
+
+  log_info("created " << m_uinput_devs.size() << " uinput devices in "
+           << format_msec(finish_start - create_start) << " msec with "
+           << thread_count << " threads (" << format_msec(create_sum) << " msec when created one by one), "
+           << "main loop setup " << format_msec(finish_end - finish_start) << " msec");
+
+  // resolve the device once, so that the event path from the
+  // emitters down to write() doesn't need any lookups
+  for(Collectors::iterator i = m_collectors.begin(); i != m_collectors.end(); ++i)
+  {
+    (*i)->set_device(get_uinput((*i)->get_device_id()));
+  }
+}
+
+void
+UInput::set_handover_devices(const std::vector<HandoverDevice>& devices)
+{
+  m_handover_devs = devices;
+}
+
+std::vector<UInput::HandoverDevice>
+UInput::get_handover_devices() const
+{
+  std::vector<HandoverDevice> devices;
+  for(UInputDevs::const_iterator i = m_uinput_devs.begin(); i != m_uinput_devs.end(); ++i)
+  {
+    HandoverDevice dev;
+    dev.device_id = i->first;
+    dev.fd = i->second->get_fd();
+    dev.signature = i->second->get_signature();
+    devices.push_back(dev);
+  }
+  return devices;
+}
+
+void
+UInput::detach()
+{
+  for(UInputDevs::iterator i = m_uinput_devs.begin(); i != m_uinput_devs.end(); ++i)
+  {
+    i->second->detach();
+  }
 }
 
 void
@@ -417,30 +658,32 @@ UInput::send(uint32_t device_id, int ev_type, int ev_code, int value)
 }
 
 void
-UInput::update(int msec_delta)
+UInput::update(int64_t nsec_delta)
 {
-  for(std::map<UIEvent, RelRepeat>::iterator i = m_rel_repeat_lst.begin(); i != m_rel_repeat_lst.end(); ++i)
+  for(RelRepeats::iterator i = m_rel_repeat_lst.begin(); i != m_rel_repeat_lst.end(); ++i)
   {
-    i->second.time_count += msec_delta;
-
-    // FIXME: shouldn't send out events multiple times, but accumulate
-    // them instead and send out only once
-    while (i->second.time_count >= i->second.repeat_interval)
+    RelRepeat& rel_rep = *i;
+    if (!rel_rep.active)
     {
-      // value can be float, but be can only send out int, so keep
-      // track of the rest we don't send
-      int i_value = static_cast<int>(i->second.value + truncf(i->second.rest));
-      i->second.rest -= truncf(i->second.rest);
-      i->second.rest += i->second.value - truncf(i->second.value);
-
-      get_uinput(i->second.code.get_device_id())->send(EV_REL, i->second.code.code, i_value);
-      i->second.time_count -= i->second.repeat_interval;
+      continue;
     }
-  }
 
-  for(UInputDevs::iterator i = m_uinput_devs.begin(); i != m_uinput_devs.end(); ++i)
-  {
-    i->second->update(msec_delta);
+    rel_rep.time_count += nsec_delta;
+
+    const int64_t interval = msec2nsec(std::max(1, rel_rep.repeat_interval));
+    const int64_t count = rel_rep.time_count / interval;
+    if (count > 0)
+    {
+      // sum up all intervals that passed into a single value, value
+      // can be float, but we can only send out int, so keep track of
+      // the rest we don't send
+      float value = rel_rep.value * static_cast<float>(count) + rel_rep.rest;
+      int i_value = static_cast<int>(truncf(value));
+      rel_rep.rest = value - truncf(value);
+
+      rel_rep.collector->send(i_value);
+      rel_rep.time_count -= count * interval;
+    }
   }
 }
 
@@ -458,42 +701,87 @@ UInput::sync()
   }
 }
 
+int
+UInput::add_rel_repetitive(uint32_t device_id, int ev_code)
+{
+  UIRelEventCollector* collector = find_rel_collector(device_id, ev_code);
+
+  // handlers sharing an event share the repetition
+  for(RelRepeats::size_type i = 0; i < m_rel_repeat_lst.size(); ++i)
+  {
+    if (m_rel_repeat_lst[i].collector == collector)
+    {
+      return static_cast<int>(i);
+    }
+  }
+
+  RelRepeat rel_rep;
+  rel_rep.collector = collector;
+  rel_rep.active = false;
+  rel_rep.value = 0.0f;
+  rel_rep.rest  = 0.0f;
+  rel_rep.time_count = 0;
+  rel_rep.repeat_interval = 0;
+  m_rel_repeat_lst.push_back(rel_rep);
+
+  return static_cast<int>(m_rel_repeat_lst.size() - 1);
+}
+
 void
-UInput::send_rel_repetitive(const UIEvent& code, float value, int repeat_interval)
+UInput::send_rel_repetitive(int handle, float value, int repeat_interval)
 {
+  assert(0 <= handle && handle < static_cast<int>(m_rel_repeat_lst.size()));
+  RelRepeat& rel_rep = m_rel_repeat_lst[handle];
+
   if (repeat_interval < 0)
-  { // remove rel_repeats from list
+  { // stop the repetition
     // FIXME: should send the last value still in the repeater
-    m_rel_repeat_lst.erase(code);
+    rel_rep.active = false;
     // no need to send a event for rel, as it defaults to 0 anyway
   }
+  else if (!rel_rep.active)
+  { // start the repetition
+    rel_rep.active = true;
+    rel_rep.value = value;
+    rel_rep.time_count = 0;
+    rel_rep.repeat_interval = repeat_interval;
+
+    // Send the event once, the fraction that doesn't fit into an
+    // int is carried over to the repeats
+    rel_rep.rest = value - truncf(value);
+    rel_rep.collector->send(static_cast<int>(truncf(value)));
+  }
   else
-  { // add rel_repeats to list
-    std::map<UIEvent, RelRepeat>::iterator it = m_rel_repeat_lst.find(code);
+  {
+    // FIXME: send old value, store new value for rest
 
-    if (it == m_rel_repeat_lst.end())
-    {
-      RelRepeat rel_rep;
-      rel_rep.code  = code;
-      rel_rep.value = value;
-      rel_rep.rest  = 0.0f;
-      rel_rep.time_count = 0;
-      rel_rep.repeat_interval = repeat_interval;
-      m_rel_repeat_lst.insert(std::pair<UIEvent, RelRepeat>(code, rel_rep));
-
-      // Send the event once
-      get_uinput(code.get_device_id())->send(EV_REL, code.code, value);
-    }
-    else
-    {
-      // FIXME: send old value, store new value for rest
+    rel_rep.value = value;
+    // rel_rep.time_count = do not touch this
+    rel_rep.repeat_interval = repeat_interval;
+  }
+}
+
+void
+UInput::flush_rel()
+{
+  for(RelCollectors::iterator i = m_rel_collectors.begin(); i != m_rel_collectors.end(); ++i)
+  {
+    (*i)->flush();
+  }
+}
 
-      it->second.code  = code;
-      it->second.value = value;
-      // it->second.time_count = do not touch this
-      it->second.repeat_interval = repeat_interval;
+UIRelEventCollector*
+UInput::find_rel_collector(uint32_t device_id, int code) const
+{
+  for(RelCollectors::const_iterator i = m_rel_collectors.begin(); i != m_rel_collectors.end(); ++i)
+  {
+    if ((*i)->get_device_id() == device_id && (*i)->get_code() == code)
+    {
+      return i->get();
     }
   }
+
+  raise_exception(std::runtime_error, "no REL collector for " << device_id << "-" << code);
 }
 
 LinuxUinput*
@@ -531,6 +819,17 @@ UInput::set_ff_callback(int device_id, const boost::function<void (uint8_t, uint
   get_uinput(device_id)->set_ff_callback(callback);
 }
 
+std::vector<std::string>
+UInput::get_device_nodes() const
+{
+  std::vector<std::string> nodes;
+  for(UInputDevs::const_iterator i = m_uinput_devs.begin(); i != m_uinput_devs.end(); ++i)
+  {
+    nodes.insert(nodes.end(), i->second->get_device_nodes().begin(), i->second->get_device_nodes().end());
+  }
+  return nodes;
+}
+
 int
 UInput::find_jsdev_number()
 {
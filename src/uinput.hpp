@@ -30,6 +30,7 @@
 struct Xbox360Msg;
 struct XboxMsg;
 struct Xbox360GuitarMsg;
+class UIRelEventCollector;
 
 class UInput
 {
@@ -52,6 +53,16 @@ public:
     return ((device_id) >> 16) & 0xffff;
   }
 
+  /** a kernel device passed between two xboxdrv processes */
+  struct HandoverDevice
+  {
+    HandoverDevice() : device_id(0), fd(-1), signature() {}
+
+    uint32_t device_id;
+    int fd;
+    std::string signature;
+  };
+
 private:
   typedef std::map<uint32_t, boost::shared_ptr<LinuxUinput> > UInputDevs;
   UInputDevs m_uinput_devs;
@@ -65,32 +76,55 @@ private:
   typedef std::vector<UIEventCollectorPtr> Collectors;
   Collectors m_collectors;
 
+  /** subset of m_collectors, flushed at the output rate */
+  typedef std::vector<boost::shared_ptr<UIRelEventCollector> > RelCollectors;
+  RelCollectors m_rel_collectors;
+
   struct RelRepeat
   {
-    UIEvent code;
+    UIRelEventCollector* collector;
+    bool active;
     float value;
     float rest;
-    int time_count;
+    int64_t time_count; /// nsec
     int repeat_interval;
   };
 
-  std::map<UIEvent, RelRepeat> m_rel_repeat_lst;
+  /** one entry per collector registered with add_rel_repetitive(),
+      indexed by the handle, inactive entries stay in place */
+  typedef std::vector<RelRepeat> RelRepeats;
+  RelRepeats m_rel_repeat_lst;
 
   bool m_extra_events;
 
+  std::vector<HandoverDevice> m_handover_devs;
+
+  /** nsec between two flushes of the relative axes, driven by the
+      periodic m_timer_fd instead of a glib timeout, as those only
+      have msec resolution and would turn 300Hz into 333Hz */
+  int64_t m_output_interval;
+  int m_timer_fd;
+  GIOChannel* m_io_channel;
   guint m_timeout_id;
-  GTimer* m_timer;
+  int64_t m_last_time;
 
 public:
-  UInput(bool extra_events);
+  /** \a output_rate is the rate in Hz at which accumulated relative
+      motion is written to the devices */
+  UInput(bool extra_events, int output_rate = 100);
   ~UInput();
 
-  /** guess the number of the next unused /dev/input/jsX device */
+  /** guess the number of the next unused /dev/input/jsX device,
+      racy, only meant for kernels that don't support UI_GET_SYSNAME */
   static int  find_jsdev_number();
 
   /** guess the number of the next unused /dev/input/eventX device */
   static int  find_evdev_number();
 
+  /** the /dev/input nodes of all devices, valid after finish(), empty
+      when the kernel doesn't support UI_GET_SYSNAME (before 3.15) */
+  std::vector<std::string> get_device_nodes() const;
+
   void set_device_names(const std::map<uint32_t, std::string>& device_names);
   void set_device_usbids(const std::map<uint32_t, struct input_id>& device_usbids);
   void set_ff_callback(int device_id, const boost::function<void (uint8_t, uint8_t)>& callback);
@@ -98,19 +132,41 @@ public:
   /** Device construction functions
       @{*/
   UIEventEmitterPtr add_rel(uint32_t device_id, int ev_code);
+
+  /** register a REL event added with add_rel() for
+      send_rel_repetitive(), the collector is looked up here once,
+      returns the handle to pass to send_rel_repetitive() */
+  int add_rel_repetitive(uint32_t device_id, int ev_code);
   UIEventEmitterPtr add_abs(uint32_t device_id, int ev_code, int min, int max, int fuzz, int flat);
   UIEventEmitterPtr add_key(uint32_t device_id, int ev_code);
   void add_ff(uint32_t device_id, uint16_t code);
 
   /** needs to be called to finish device creation and create the
-      device in the kernel */
+      device in the kernel, binds the collectors to their devices. The
+      kernel devices are created in parallel. */
   void finish();
   /** @} */
 
+  /** Devices that finish() adopts instead of creating new ones, the
+      UInput takes ownership of the fds, fds that don't match a device
+      are closed */
+  void set_handover_devices(const std::vector<HandoverDevice>& devices);
+
+  /** the devices for passing on to another process, the fds stay
+      owned by the UInput */
+  std::vector<HandoverDevice> get_handover_devices() const;
+
+  /** keep the kernel devices alive after the UInput is destroyed */
+  void detach();
+
   /** Send events to the kernel
       @{*/
+  /** does a device lookup on each call, emitters returned by add_*()
+      should be preferred as they write to the device directly */
   void send(uint32_t device_id, int ev_type, int ev_code, int value);
-  void send_rel_repetitive(const UIEvent& code, float value, int repeat_interval);
+  /** send \a value every \a repeat_interval msec, a negative
+      interval stops the repetition */
+  void send_rel_repetitive(int handle, float value, int repeat_interval);
 
   /** should be called to signal that all events of the current frame
       have been send */
@@ -118,7 +174,12 @@ public:
   /** @} */
 
 private:
-  void update(int msec_delta);
+  void update(int64_t nsec_delta);
+
+  /** write out the relative motion collected since the last call */
+  void flush_rel();
+
+  UIRelEventCollector* find_rel_collector(uint32_t device_id, int code) const;
 
   /** create a LinuxUinput with the given device_id, if some already
       exist return a pointer to it */
@@ -130,9 +191,9 @@ private:
   std::string get_device_name(uint32_t device_id) const;
   struct input_id get_device_usbid(uint32_t device_id) const;
 
-  bool on_timeout();
-  static gboolean on_timeout_wrap(gpointer data) {
-    return static_cast<UInput*>(data)->on_timeout();
+  bool on_timeout(GIOChannel* source, GIOCondition condition);
+  static gboolean on_timeout_wrap(GIOChannel* source, GIOCondition condition, gpointer data) {
+    return static_cast<UInput*>(data)->on_timeout(source, condition);
   }
 
   UIEventEmitterPtr create_emitter(int device_id, int type, int code);
@@ -20,6 +20,7 @@
 
 #include "helper.hpp"
 #include "uinput.hpp"
+#include "trace.hpp"
 #include "uinput_options.hpp"
 
 namespace {
@@ -54,6 +55,8 @@ UInputConfig::UInputConfig(UInput& uinput, int slot, bool extra_devices, const U
 void
 UInputConfig::send(XboxGenericMsg& msg)
 {
+  TRACE_SPAN("UInputConfig::send");
+
   std::copy(button_state, button_state+XBOX_BTN_MAX, last_button_state);
 
   switch(msg.type)
@@ -252,10 +255,12 @@ UInputConfig::send(Playstation3USBMsg& msg)
 }
 
 void
-UInputConfig::update(int msec_delta)
+UInputConfig::update(int64_t nsec_delta)
 {
-  m_btn_map.update(m_uinput, msec_delta);
-  m_axis_map.update(m_uinput, msec_delta);
+  TRACE_SPAN("UInputConfig::update");
+
+  m_btn_map.update(m_uinput, nsec_delta);
+  m_axis_map.update(m_uinput, nsec_delta);
 
   m_uinput.sync();
 }
@@ -265,6 +270,8 @@ UInputConfig::send_button(XboxButton code, bool value)
 {
   if (button_state[code] != value)
   {
+    TRACE_SPAN_ARG("UInputConfig::send_button", code);
+
     button_state[code] = value;
 
     // in case a shift button was changed, we have to clear all
@@ -317,6 +324,8 @@ UInputConfig::reset_all_outputs()
 void
 UInputConfig::send_axis(XboxAxis code, int32_t value)
 {
+  TRACE_SPAN_ARG("UInputConfig::send_axis", code);
+
   AxisEventPtr ev = m_axis_map.lookup(code);
   AxisEventPtr last_ev = ev;
 
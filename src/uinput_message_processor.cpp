@@ -18,7 +18,10 @@
 
 #include "uinput_message_processor.hpp"
 
+#include <stddef.h>
+
 #include "log.hpp"
+#include "trace.hpp"
 #include "uinput.hpp"
 
 UInputMessageProcessor::UInputMessageProcessor(UInput& uinput,
@@ -40,8 +43,10 @@ UInputMessageProcessor::~UInputMessageProcessor()
 }
 
 void
-UInputMessageProcessor::send(const XboxGenericMsg& msg_in, int msec_delta)
+UInputMessageProcessor::send(const XboxGenericMsg& msg_in, int64_t nsec_delta)
 {
+  TRACE_SPAN("UInputMessageProcessor::send");
+
   if (!m_config->empty())
   {
     XboxGenericMsg msg = msg_in;
@@ -73,17 +78,17 @@ UInputMessageProcessor::send(const XboxGenericMsg& msg_in, int msec_delta)
     }
 
     // run the controller message through all modifier
-    for(std::vector<ModifierPtr>::iterator i = m_config->get_config()->get_modifier().begin();
-        i != m_config->get_config()->get_modifier().end();
-        ++i)
+    std::vector<ModifierPtr>& modifier = m_config->get_config()->get_modifier();
+    for(std::vector<ModifierPtr>::size_type i = 0; i < modifier.size(); ++i)
     {
-      (*i)->update(msec_delta, msg);
+      TRACE_SPAN_ARG("Modifier::update", static_cast<int>(i));
+      modifier[i]->update(nsec_delta, msg);
     }
 
-    m_config->get_config()->get_uinput().update(msec_delta);
+    m_config->get_config()->get_uinput().update(nsec_delta);
 
     // send current Xbox state to uinput
-    if (memcmp(&msg, &m_oldmsg, sizeof(XboxGenericMsg)) != 0)
+    if (memcmp(&msg, &m_oldmsg, offsetof(XboxGenericMsg, seq)) != 0)
     {
       // Only send a new event out if something has changed,
       // this is useful since some controllers send events
@@ -18,21 +18,27 @@
 
 #include "usb_controller.hpp"
 
+#include <boost/bind.hpp>
 #include <boost/format.hpp>
 
 #include "log.hpp"
 #include "raise_exception.hpp"
+#include "trace.hpp"
 #include "usb_helper.hpp"
+#include "usb_read_queue.hpp"
 #include "xboxmsg.hpp"
 
-USBController::USBController(libusb_device* dev) :
+USBController::USBController(libusb_device* dev, int read_queue_depth) :
   m_dev(dev),
   m_handle(0),
   m_transfers(),
   m_interfaces(),
+  m_read_queues(),
   m_usbpath(),
   m_usbid(),
-  m_name()
+  m_name(),
+  m_serial(),
+  m_read_queue_depth(read_queue_depth)
 {
   int ret = libusb_open(dev, &m_handle);
   if (ret != LIBUSB_SUCCESS)
@@ -73,6 +79,16 @@ USBController::USBController(libusb_device* dev) :
       {
         m_name.append(buf, len);
       }
+
+      if (desc.iSerialNumber)
+      {
+        len = libusb_get_string_descriptor_ascii(m_handle, desc.iSerialNumber,
+                                                 reinterpret_cast<unsigned char*>(buf), sizeof(buf));
+        if (len > 0)
+        {
+          m_serial.append(buf, len);
+        }
+      }
     }
   }
 }
@@ -95,6 +111,9 @@ USBController::~USBController()
     }
   }
 
+  // cancels the read transfers and waits for them
+  m_read_queues.clear();
+
   // release all claimed interfaces
   for(std::set<int>::iterator it = m_interfaces.begin(); it != m_interfaces.end(); ++it)
   {
@@ -123,29 +142,19 @@ USBController::get_name() const
   return m_name;
 }
 
+std::string
+USBController::get_serial() const
+{
+  return m_serial;
+}
+
 void
 USBController::usb_submit_read(int endpoint, int len)
 {
-  libusb_transfer* transfer = libusb_alloc_transfer(0);
-
-  uint8_t* data = static_cast<uint8_t*>(malloc(sizeof(uint8_t) * len));
-  transfer->flags |= LIBUSB_TRANSFER_FREE_BUFFER;
-  libusb_fill_interrupt_transfer(transfer, m_handle,
-                                 endpoint | LIBUSB_ENDPOINT_IN,
-                                 data, len,
-                                 &USBController::on_read_data_wrap, this,
-                                 0); // timeout
-  int ret;
-  ret = libusb_submit_transfer(transfer);
-  if (ret != LIBUSB_SUCCESS)
-  {
-    libusb_free_transfer(transfer);
-    raise_exception(std::runtime_error, "libusb_submit_transfer(): " << usb_strerror(ret));
-  }
-  else
-  {
-    m_transfers.insert(transfer);
-  }
+  m_read_queues.push_back(boost::shared_ptr<USBReadQueue>(
+                            new USBReadQueue(m_handle, endpoint, len, m_read_queue_depth,
+                                             boost::bind(&USBController::on_read_data, this, _1, _2, _3),
+                                             boost::bind(&USBController::on_read_error, this, _1))));
 }
 
 void
@@ -233,55 +242,59 @@ USBController::on_write_data(libusb_transfer* transfer)
   else
   {
     log_error("USB write failure: " << transfer->length << ": " << usb_transfer_strerror(transfer->status));
+    m_error_count += 1;
   }
 
   m_transfers.erase(transfer);
   libusb_free_transfer(transfer);
 }
 
-void
-USBController::on_read_data(libusb_transfer* transfer)
+bool
+USBController::on_read_data(libusb_transfer* transfer, uint32_t seq, int64_t nsec)
 {
   assert(transfer);
 
+  TRACE_SPAN("USBController::on_read_data");
+
   if (transfer->status == LIBUSB_TRANSFER_COMPLETED)
   {
     // process data
     XboxGenericMsg msg;
-    if (parse(transfer->buffer, transfer->actual_length, &msg))
+    bool parsed;
     {
-      submit_msg(msg);
+      TRACE_SPAN("USBController::parse");
+      parsed = parse(transfer->buffer, transfer->actual_length, &msg);
     }
 
-    int ret;
-    ret = libusb_submit_transfer(transfer);
-    if (ret != LIBUSB_SUCCESS) // could also check for LIBUSB_ERROR_NO_DEVICE
+    if (parsed)
     {
-      log_error("failed to resubmit USB transfer: " << usb_strerror(ret));
-      m_transfers.erase(transfer);
-      libusb_free_transfer(transfer);
-      send_disconnect();
+      msg.seq  = seq;
+      msg.time = nsec;
+      submit_msg(msg);
     }
-  }
-  else if (transfer->status == LIBUSB_TRANSFER_CANCELLED)
-  {
-    m_transfers.erase(transfer);
-    libusb_free_transfer(transfer);
+
+    return true;
   }
   else if (transfer->status == LIBUSB_TRANSFER_NO_DEVICE)
   {
-    m_transfers.erase(transfer);
-    libusb_free_transfer(transfer);
     send_disconnect();
+    return false;
   }
   else
   {
     log_error("USB read failure: " << transfer->length << ": " << usb_transfer_strerror(transfer->status));
-    m_transfers.erase(transfer);
-    libusb_free_transfer(transfer);
+    m_error_count += 1;
+    return false;
   }
 }
 
+void
+USBController::on_read_error(int err)
+{
+  // could also check for LIBUSB_ERROR_NO_DEVICE
+  send_disconnect();
+}
+
 void
 USBController::usb_claim_interface(int ifnum, bool try_detach)
 {
@@ -19,13 +19,17 @@
 #ifndef HEADER_XBOXDRV_USB_CONTROLLER_HPP
 #define HEADER_XBOXDRV_USB_CONTROLLER_HPP
 
+#include <boost/shared_ptr.hpp>
 #include <libusb.h>
 #include <string>
 #include <memory>
 #include <set>
+#include <vector>
 
 #include "controller.hpp"
 
+class USBReadQueue;
+
 class USBController : public Controller
 {
 protected:
@@ -35,17 +39,28 @@ protected:
   std::set<libusb_transfer*> m_transfers;
   std::set<int> m_interfaces;
 
+  typedef std::vector<boost::shared_ptr<USBReadQueue> > ReadQueues;
+  ReadQueues m_read_queues;
+
   std::string m_usbpath;
   std::string m_usbid;
   std::string m_name;
+  std::string m_serial;
+
+  /** number of interrupt IN transfers kept in flight per endpoint by
+      usb_submit_read() */
+  int m_read_queue_depth;
 
 public:
-  USBController(libusb_device* dev);
+  USBController(libusb_device* dev, int read_queue_depth);
   virtual ~USBController();
 
   virtual std::string get_usbpath() const;
   virtual std::string get_usbid() const;
   virtual std::string get_name() const;
+  virtual std::string get_serial() const;
+
+  int get_read_queue_depth() const { return m_read_queue_depth; }
 
   virtual bool parse(uint8_t* data, int len, XboxGenericMsg* msg_out) =0;
 
@@ -61,11 +76,8 @@ public:
                    uint8_t* data, uint16_t len);
 
 private:
-  void on_read_data(libusb_transfer *transfer);
-  static void on_read_data_wrap(libusb_transfer *transfer)
-  {
-    static_cast<USBController*>(transfer->user_data)->on_read_data(transfer);
-  }
+  bool on_read_data(libusb_transfer* transfer, uint32_t seq, int64_t nsec);
+  void on_read_error(int err);
 
   void on_write_data(libusb_transfer *transfer);
   static void on_write_data_wrap(libusb_transfer *transfer)
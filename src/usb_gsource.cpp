@@ -25,6 +25,7 @@
 
 #include "log.hpp"
 #include "usb_helper.hpp"
+#include "usb_read_queue.hpp"
 
 USBGSource::USBGSource() :
   m_source_funcs(),
@@ -174,7 +175,7 @@ USBGSource::on_source_dispatch(GSource* source, GSourceFunc callback, gpointer u
 gboolean
 USBGSource::on_source()
 {
-  libusb_handle_events(NULL);
+  USBReadQueue::handle_events();
   return TRUE;
 }
 
@@ -18,18 +18,24 @@
 
 #include "usb_interface.hpp"
 
+#include <boost/bind.hpp>
+
+#include "log.hpp"
 #include "raise_exception.hpp"
 #include "usb_helper.hpp"
+#include "usb_read_queue.hpp"
 
 struct USBReadCallback
 {
-  USBInterface* iface;
   boost::function<bool (uint8_t*, int)> callback;
 
-  USBReadCallback(USBInterface* iface_,
-                  boost::function<bool (uint8_t*, int)> callback_) :
-    iface(iface_),
-    callback(callback_)
+  /** set once the callback returned false, the transfers still in
+      the queue are then dropped without calling it again */
+  bool stopped;
+
+  USBReadCallback(boost::function<bool (uint8_t*, int)> callback_) :
+    callback(callback_),
+    stopped(false)
   {}
 
 private:
@@ -56,7 +62,8 @@ private:
 USBInterface::USBInterface(libusb_device_handle* handle, int interface, bool try_detach) :
   m_handle(handle),
   m_interface(interface),
-  m_endpoints()
+  m_write_transfers(),
+  m_read_queues()
 {
   int ret = libusb_claim_interface(handle, m_interface);
   if (ret == LIBUSB_SUCCESS)
@@ -91,47 +98,38 @@ USBInterface::USBInterface(libusb_device_handle* handle, int interface, bool try
 USBInterface::~USBInterface()
 {
   // cancel all transfer that might still be running
-  for(Endpoints::iterator it = m_endpoints.begin(); it != m_endpoints.end(); ++it)
+  for(std::set<libusb_transfer*>::iterator it = m_write_transfers.begin(); it != m_write_transfers.end(); ++it)
+  {
+    libusb_cancel_transfer(*it);
+  }
+
+  // wait for cancel to succeed
+  while (!m_write_transfers.empty())
   {
-    if (it->second)
+    int ret = libusb_handle_events(NULL);
+    if (ret != 0)
     {
-      libusb_cancel_transfer(it->second);
-      libusb_free_transfer(it->second);
+      log_error("libusb_handle_events() failure: " << ret);
     }
   }
-  m_endpoints.clear();
+
+  // cancels the read transfers and waits for them
+  m_read_queues.clear();
 
   libusb_release_interface(m_handle, m_interface);
 }
 
 void
 USBInterface::submit_read(int endpoint, int len,
-                          const boost::function<bool (uint8_t*, int)>& callback)
+                          const boost::function<bool (uint8_t*, int)>& callback,
+                          int depth)
 {
-  assert(m_endpoints.find(endpoint) == m_endpoints.end());
-  libusb_transfer* transfer = libusb_alloc_transfer(0);
-  transfer->flags |= LIBUSB_TRANSFER_FREE_BUFFER;
+  assert(m_read_queues.find(endpoint | LIBUSB_ENDPOINT_IN) == m_read_queues.end());
 
-  uint8_t* data = static_cast<uint8_t*>(malloc(sizeof(uint8_t) * len));
-
-  libusb_fill_interrupt_transfer(transfer, m_handle,
-                                 endpoint | LIBUSB_ENDPOINT_IN,
-                                 data, len,
-                                 &USBInterface::on_read_data_wrap,
-                                 new USBReadCallback(this, callback),
-                                 0); // timeout
-  int ret;
-  ret = libusb_submit_transfer(transfer);
-  if (ret != LIBUSB_SUCCESS)
-  {
-    libusb_free_transfer(transfer);
-    raise_exception(std::runtime_error, "libusb_submit_transfer(): " << usb_strerror(ret));
-  }
-  else
-  {
-    // transfer is send on its way, so store it
-    m_endpoints[endpoint | LIBUSB_ENDPOINT_IN] = transfer;
-  }
+  boost::shared_ptr<USBReadCallback> cb(new USBReadCallback(callback));
+  m_read_queues[endpoint | LIBUSB_ENDPOINT_IN] =
+    boost::shared_ptr<USBReadQueue>(new USBReadQueue(m_handle, endpoint, len, depth,
+                                                     boost::bind(&USBInterface::on_read_data, this, cb, _1)));
 }
 
 void
@@ -161,90 +159,90 @@ USBInterface::submit_write(int endpoint, uint8_t* data_in, int len,
   }
   else
   {
-    m_endpoints[endpoint | LIBUSB_ENDPOINT_OUT] = transfer;
+    m_write_transfers.insert(transfer);
   }
 }
 
 void
-USBInterface::cancel_transfer(int endpoint)
+USBInterface::cancel_read(int endpoint)
 {
-  Endpoints::iterator it = m_endpoints.find(endpoint);
-  if (it == m_endpoints.end())
+  ReadQueues::iterator it = m_read_queues.find(endpoint | LIBUSB_ENDPOINT_IN);
+  if (it == m_read_queues.end())
   {
-    raise_exception(std::runtime_error, "endpoint " << (endpoint & LIBUSB_ENDPOINT_ADDRESS_MASK) << "not found");
+    raise_exception(std::runtime_error, "endpoint " << endpoint << "not found");
   }
   else
   {
-    libusb_cancel_transfer(it->second);
-    libusb_free_transfer(it->second);
-    m_endpoints.erase(it);
+    m_read_queues.erase(it);
   }
 }
 
-void
-USBInterface::cancel_read(int endpoint)
-{
-  cancel_transfer(endpoint | LIBUSB_ENDPOINT_IN);
-}
-
 void
 USBInterface::cancel_write(int endpoint)
 {
-  cancel_transfer(endpoint | LIBUSB_ENDPOINT_OUT);
+  for(std::set<libusb_transfer*>::iterator it = m_write_transfers.begin(); it != m_write_transfers.end(); ++it)
+  {
+    if ((*it)->endpoint == (endpoint | LIBUSB_ENDPOINT_OUT))
+    {
+      libusb_cancel_transfer(*it);
+    }
+  }
 }
 
-void
-USBInterface::on_read_data(USBReadCallback* callback, libusb_transfer* transfer)
+bool
+USBInterface::on_read_data(boost::shared_ptr<USBReadCallback> callback, libusb_transfer* transfer)
 {
-  if (callback->callback(transfer->buffer, transfer->actual_length))
+  if (callback->stopped)
+  {
+    return false;
+  }
+  else if (transfer->status != LIBUSB_TRANSFER_COMPLETED)
+  {
+    log_error("USB read failure: " << usb_transfer_strerror(transfer->status));
+    callback->stopped = true;
+    return false;
+  }
+  else if (callback->callback(transfer->buffer, transfer->actual_length))
   {
     // callback returned true, thus resend the transfer
-    int ret;
-    ret = libusb_submit_transfer(transfer);
-    if (ret != LIBUSB_SUCCESS)
-    {
-      libusb_free_transfer(transfer);
-      raise_exception(std::runtime_error, "libusb_submit_transfer(): " << usb_strerror(ret));
-    }
+    return true;
   }
   else
   {
-    // callback returned false, thus doing cleanup
-    delete callback;
-    libusb_free_transfer(transfer);
-    m_endpoints.erase(transfer->endpoint);
+    // callback returned false, stop reading from the endpoint
+    callback->stopped = true;
+    return false;
   }
 }
 
 void
 USBInterface::on_write_data(USBWriteCallback* callback, libusb_transfer* transfer)
 {
-  if (callback->callback(transfer))
+  if (transfer->status == LIBUSB_TRANSFER_COMPLETED && callback->callback(transfer))
   {
     // callback returned true, thus resend the transfer (user is free
     // to fill it with new data)
     int ret;
     ret = libusb_submit_transfer(transfer);
-    if (ret != LIBUSB_SUCCESS)
+    if (ret == LIBUSB_SUCCESS)
+    {
+      return;
+    }
+    else
     {
-      libusb_free_transfer(transfer);
-      raise_exception(std::runtime_error, "libusb_submit_transfer(): " << usb_strerror(ret));
+      log_error("libusb_submit_transfer(): " << usb_strerror(ret));
     }
   }
-  else
+  else if (transfer->status != LIBUSB_TRANSFER_COMPLETED &&
+           transfer->status != LIBUSB_TRANSFER_CANCELLED)
   {
-    // callback returned false, thus doing cleanup
-    delete callback;
-    libusb_free_transfer(transfer);
-    m_endpoints.erase(transfer->endpoint);
+    log_error("USB write failure: " << usb_transfer_strerror(transfer->status));
   }
-}
-
-void
-USBInterface::on_read_data_wrap(libusb_transfer* transfer)
-{
-  USBReadCallback* cb = static_cast<USBReadCallback*>(transfer->user_data);
-  cb->iface->on_read_data(cb, transfer);
+
+  // callback returned false or the transfer failed, thus doing cleanup
+  m_write_transfers.erase(transfer);
+  delete callback;
+  libusb_free_transfer(transfer);
 }
 
 void
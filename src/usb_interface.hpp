@@ -21,8 +21,11 @@
 
 #include <libusb.h>
 #include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
 #include <map>
+#include <set>
 
+class USBReadQueue;
 struct USBReadCallback;
 struct USBWriteCallback;
 
@@ -31,15 +34,22 @@ class USBInterface
 private:
   libusb_device_handle* m_handle;
   int m_interface;
-  typedef std::map<int, libusb_transfer*> Endpoints;
-  Endpoints m_endpoints;
+  /** write transfers currently in flight */
+  std::set<libusb_transfer*> m_write_transfers;
+
+  typedef std::map<int, boost::shared_ptr<USBReadQueue> > ReadQueues;
+  ReadQueues m_read_queues;
 
 public:
   USBInterface(libusb_device_handle* handle, int interface, bool try_detach = false);
   ~USBInterface();
 
+  /** Keeps \a depth transfers queued on \a endpoint, \a callback
+      is called for every report in order, returning false stops the
+      reading */
   void submit_read(int endpoint, int len,
-                   const boost::function<bool (uint8_t*, int)>& callback);
+                   const boost::function<bool (uint8_t*, int)>& callback,
+                   int depth = 1);
   void cancel_read(int endpoint);
 
   // FIXME: could add a prepare_write() that does what submit_write()
@@ -47,16 +57,16 @@ public:
   // it as argument
   void submit_write(int endpoint, uint8_t* data, int len,
                     const boost::function<bool (libusb_transfer*)>& callback);
+
+  /** Cancel all write transfers on \a endpoint, the transfers are
+      freed once libusb returns them */
   void cancel_write(int endpoint);
 
 private:
-  void cancel_transfer(int endpoint);
-
-  void on_read_data(USBReadCallback* callback, libusb_transfer *transfer);
+  bool on_read_data(boost::shared_ptr<USBReadCallback> callback, libusb_transfer *transfer);
   void on_write_data(USBWriteCallback* callback, libusb_transfer *transfer);
 
 private:
-  static void on_read_data_wrap(libusb_transfer *transfer);
   static void on_write_data_wrap(libusb_transfer *transfer);
 
 private:
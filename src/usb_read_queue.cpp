@@ -0,0 +1,171 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "usb_read_queue.hpp"
+
+#include <algorithm>
+#include <stdlib.h>
+
+#include "clock.hpp"
+#include "log.hpp"
+#include "raise_exception.hpp"
+#include "usb_helper.hpp"
+
+int64_t USBReadQueue::s_event_time = 0;
+
+int
+USBReadQueue::handle_events()
+{
+  s_event_time = Clock::now();
+  int ret = libusb_handle_events(NULL);
+  s_event_time = 0;
+  return ret;
+}
+
+USBReadQueue::USBReadQueue(libusb_device_handle* handle, int endpoint, int len, int depth,
+                           const Callback& callback,
+                           const ErrorCallback& error_callback) :
+  m_handle(handle),
+  m_endpoint(endpoint),
+  m_depth(std::max(1, depth)),
+  m_callback(callback),
+  m_error_callback(error_callback),
+  m_transfers(),
+  m_cancelled(false),
+  m_seq(0),
+  m_dry_count(0)
+{
+  for(int i = 0; i < m_depth; ++i)
+  {
+    libusb_transfer* transfer = libusb_alloc_transfer(0);
+
+    uint8_t* data = static_cast<uint8_t*>(malloc(sizeof(uint8_t) * len));
+    transfer->flags |= LIBUSB_TRANSFER_FREE_BUFFER;
+    libusb_fill_interrupt_transfer(transfer, m_handle,
+                                   endpoint | LIBUSB_ENDPOINT_IN,
+                                   data, len,
+                                   &USBReadQueue::on_read_data_wrap, this,
+                                   0); // timeout
+
+    int ret = libusb_submit_transfer(transfer);
+    if (ret != LIBUSB_SUCCESS)
+    {
+      libusb_free_transfer(transfer);
+      // the transfers already submitted point to this object, so
+      // they have to be gone before the exception leaves
+      cancel();
+      raise_exception(std::runtime_error, "libusb_submit_transfer(): " << usb_strerror(ret));
+    }
+    else
+    {
+      m_transfers.push_back(transfer);
+    }
+  }
+}
+
+USBReadQueue::~USBReadQueue()
+{
+  cancel();
+
+  if (m_dry_count > 0)
+  {
+    log_info("endpoint " << m_endpoint << ": read queue of depth " << m_depth
+             << " ran dry " << m_dry_count << " times in " << m_seq << " transfers");
+  }
+}
+
+void
+USBReadQueue::cancel()
+{
+  m_cancelled = true;
+
+  for(std::deque<libusb_transfer*>::iterator it = m_transfers.begin(); it != m_transfers.end(); ++it)
+  {
+    libusb_cancel_transfer(*it);
+  }
+
+  // wait for cancel to succeed
+  while (!m_transfers.empty())
+  {
+    int ret = libusb_handle_events(NULL);
+    if (ret != 0)
+    {
+      log_error("libusb_handle_events() failure: " << ret);
+    }
+  }
+}
+
+void
+USBReadQueue::on_read_data(libusb_transfer* transfer)
+{
+  assert(transfer);
+
+  const int64_t nsec = (s_event_time != 0) ? s_event_time : Clock::now();
+
+  // libusb completes the transfers of an endpoint in submission
+  // order, so the finished transfer is normally the oldest one
+  if (!m_transfers.empty() && m_transfers.front() == transfer)
+  {
+    m_transfers.pop_front();
+  }
+  else
+  {
+    log_warn("endpoint " << m_endpoint << ": transfer completed out of order");
+    m_transfers.erase(std::remove(m_transfers.begin(), m_transfers.end(), transfer),
+                      m_transfers.end());
+  }
+
+  if (m_cancelled || transfer->status == LIBUSB_TRANSFER_CANCELLED)
+  {
+    libusb_free_transfer(transfer);
+  }
+  else
+  {
+    if (m_transfers.empty())
+    {
+      m_dry_count += 1;
+    }
+
+    const uint32_t seq = m_seq++;
+    if (!m_callback(transfer, seq, nsec))
+    {
+      libusb_free_transfer(transfer);
+    }
+    else
+    {
+      int ret = libusb_submit_transfer(transfer);
+      if (ret != LIBUSB_SUCCESS)
+      {
+        log_error("failed to resubmit USB transfer: " << usb_strerror(ret));
+        libusb_free_transfer(transfer);
+
+        if (m_error_callback)
+        {
+          m_error_callback(ret);
+        }
+      }
+      else
+      {
+        m_transfers.push_back(transfer);
+      }
+    }
+  }
+}
+
+/* EOF */
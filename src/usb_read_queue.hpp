@@ -0,0 +1,104 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef HEADER_XBOXDRV_USB_READ_QUEUE_HPP
+#define HEADER_XBOXDRV_USB_READ_QUEUE_HPP
+
+#include <boost/function.hpp>
+#include <deque>
+#include <libusb.h>
+#include <stdint.h>
+
+/** Keeps a fixed number of interrupt IN transfers queued on a single
+    endpoint, so that the device has a buffer to complete into even
+    when the main loop is late to dispatch the completions. Transfers
+    of one endpoint complete in the order they were submitted, every
+    completion gets a sequence number and the time libusb reported it. */
+class USBReadQueue
+{
+public:
+  /** Called for every finished transfer, the transfer status has to
+      be checked by the callback. Returning false stops the transfer
+      from being resubmitted. */
+  typedef boost::function<bool (libusb_transfer* transfer, uint32_t seq, int64_t nsec)> Callback;
+
+  /** Called when a transfer couldn't be resubmitted */
+  typedef boost::function<void (int libusb_error)> ErrorCallback;
+
+public:
+  USBReadQueue(libusb_device_handle* handle, int endpoint, int len, int depth,
+               const Callback& callback,
+               const ErrorCallback& error_callback = ErrorCallback());
+  ~USBReadQueue();
+
+  /** Cancel all transfers and wait till they are returned by libusb */
+  void cancel();
+
+  /** Wrapper around libusb_handle_events() for the main loop. All
+      completions reaped in one call get the time the call started,
+      instead of the time their callback ran, which would include the
+      time spent processing the completions before them. */
+  static int handle_events();
+
+  int get_endpoint() const { return m_endpoint; }
+  int get_depth() const { return m_depth; }
+
+  /** number of transfers currently queued on the endpoint */
+  int get_in_flight() const { return static_cast<int>(m_transfers.size()); }
+
+  /** number of completed transfers */
+  uint32_t get_count() const { return m_seq; }
+
+  /** number of times a transfer completed while no other transfer
+      was left queued, i.e. the device had nowhere to put the next
+      report till the completion was processed */
+  uint32_t get_dry_count() const { return m_dry_count; }
+
+private:
+  void on_read_data(libusb_transfer* transfer);
+  static void on_read_data_wrap(libusb_transfer* transfer)
+  {
+    static_cast<USBReadQueue*>(transfer->user_data)->on_read_data(transfer);
+  }
+
+private:
+  /** time handle_events() was entered, 0 outside of it */
+  static int64_t s_event_time;
+
+  libusb_device_handle* m_handle;
+  int m_endpoint;
+  int m_depth;
+  Callback m_callback;
+  ErrorCallback m_error_callback;
+
+  /** transfers in the order they were submitted */
+  std::deque<libusb_transfer*> m_transfers;
+  bool m_cancelled;
+
+  uint32_t m_seq;
+  uint32_t m_dry_count;
+
+private:
+  USBReadQueue(const USBReadQueue&);
+  USBReadQueue& operator=(const USBReadQueue&);
+};
+
+#endif
+
+/* EOF */
@@ -0,0 +1,262 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "wireless_receiver.hpp"
+
+#include <boost/bind.hpp>
+#include <boost/format.hpp>
+#include <sstream>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.hpp"
+#include "raise_exception.hpp"
+#include "usb_helper.hpp"
+#include "usb_read_queue.hpp"
+#include "xbox360_wireless_controller.hpp"
+#include "xboxmsg.hpp"
+
+WirelessReceiver::WirelessReceiver(libusb_device* dev, bool try_detach, int read_queue_depth) :
+  m_dev(dev),
+  m_handle(0),
+  m_try_detach(try_detach),
+  m_read_queue_depth(read_queue_depth),
+  m_usbpath(),
+  m_usbid(),
+  m_name(),
+  m_ports(),
+  m_read_queues(),
+  m_transfers()
+{
+  int ret = libusb_open(dev, &m_handle);
+  if (ret != LIBUSB_SUCCESS)
+  {
+    raise_exception(std::runtime_error, "libusb_open() failed: " << usb_strerror(ret));
+  }
+  else
+  {
+    m_usbpath = (boost::format("%03d:%03d")
+                 % static_cast<int>(libusb_get_bus_number(dev))
+                 % static_cast<int>(libusb_get_device_address(dev))).str();
+
+    libusb_device_descriptor desc;
+    ret = libusb_get_device_descriptor(dev, &desc);
+    if (ret == LIBUSB_SUCCESS)
+    {
+      m_usbid = (boost::format("%04x:%04x")
+                 % static_cast<int>(desc.idVendor)
+                 % static_cast<int>(desc.idProduct)).str();
+
+      char buf[1024];
+      int len = libusb_get_string_descriptor_ascii(m_handle, desc.iProduct,
+                                                   reinterpret_cast<unsigned char*>(buf), sizeof(buf));
+      if (len > 0)
+      {
+        m_name.append(buf, len);
+      }
+    }
+  }
+}
+
+WirelessReceiver::~WirelessReceiver()
+{
+  // the controllers keep the receiver alive, so all ports are
+  // detached at this point
+
+  // cancel all transfers
+  for(std::set<libusb_transfer*>::iterator it = m_transfers.begin(); it != m_transfers.end(); ++it)
+  {
+    libusb_cancel_transfer(*it);
+  }
+
+  // wait for cancel to succeed
+  while (!m_transfers.empty())
+  {
+    int ret = libusb_handle_events(NULL);
+    if (ret != 0)
+    {
+      log_error("libusb_handle_events() failure: " << ret);
+    }
+  }
+
+  libusb_close(m_handle);
+}
+
+void
+WirelessReceiver::attach(int port, Xbox360WirelessController* controller)
+{
+  assert(port >= 0 && port < kMaxPorts);
+  assert(!m_ports[port]);
+
+  int err = usb_claim_n_detach_interface(m_handle, get_interface(port), m_try_detach);
+  if (err != 0)
+  {
+    std::ostringstream out;
+    out << " Error couldn't claim the USB interface: " << usb_strerror(err) << std::endl
+        << "Try to run 'rmmod xpad' and then xboxdrv again or start xboxdrv with the option --detach-kernel-driver.";
+    throw std::runtime_error(out.str());
+  }
+
+  m_ports[port] = controller;
+
+  try
+  {
+    m_read_queues[port].reset(new USBReadQueue(m_handle, get_endpoint(port), 32,
+                                               m_read_queue_depth,
+                                               boost::bind(&WirelessReceiver::on_read_data, this, port, _1, _2, _3),
+                                               boost::bind(&WirelessReceiver::on_read_error, this, _1)));
+  }
+  catch(...)
+  {
+    m_ports[port] = 0;
+    libusb_release_interface(m_handle, get_interface(port));
+    throw;
+  }
+}
+
+void
+WirelessReceiver::detach(int port)
+{
+  assert(port >= 0 && port < kMaxPorts);
+
+  if (m_ports[port])
+  {
+    // cancels the read transfers and waits for them
+    m_read_queues[port].reset();
+    m_ports[port] = 0;
+
+    libusb_release_interface(m_handle, get_interface(port));
+  }
+}
+
+void
+WirelessReceiver::write(int port, uint8_t* data_in, int len)
+{
+  libusb_transfer* transfer = libusb_alloc_transfer(0);
+  transfer->flags |= LIBUSB_TRANSFER_FREE_BUFFER;
+
+  // copy data into a newly allocated buffer
+  uint8_t* data = static_cast<uint8_t*>(malloc(sizeof(uint8_t) * len));
+  memcpy(data, data_in, len);
+
+  libusb_fill_interrupt_transfer(transfer, m_handle,
+                                 get_endpoint(port) | LIBUSB_ENDPOINT_OUT,
+                                 data, len,
+                                 &WirelessReceiver::on_write_data_wrap, this,
+                                 0); // timeout
+
+  int ret;
+  ret = libusb_submit_transfer(transfer);
+  if (ret != LIBUSB_SUCCESS)
+  {
+    libusb_free_transfer(transfer);
+    raise_exception(std::runtime_error, "libusb_submit_transfer(): " << usb_strerror(ret));
+  }
+  else
+  {
+    m_transfers.insert(transfer);
+  }
+}
+
+bool
+WirelessReceiver::on_read_data(int port, libusb_transfer* transfer, uint32_t seq, int64_t nsec)
+{
+  if (transfer->status == LIBUSB_TRANSFER_COMPLETED)
+  {
+    Xbox360WirelessController* controller = m_ports[port];
+    if (controller)
+    {
+      XboxGenericMsg msg;
+      if (controller->parse(transfer->buffer, transfer->actual_length, &msg))
+      {
+        msg.seq  = seq;
+        msg.time = nsec;
+        controller->submit_msg(msg);
+      }
+    }
+    return true;
+  }
+  else if (transfer->status == LIBUSB_TRANSFER_NO_DEVICE)
+  {
+    send_disconnect();
+    return false;
+  }
+  else
+  {
+    log_error("USB read failure: " << transfer->length << ": " << usb_transfer_strerror(transfer->status));
+    if (m_ports[port])
+    {
+      m_ports[port]->submit_error();
+    }
+    return false;
+  }
+}
+
+void
+WirelessReceiver::on_read_error(int err)
+{
+  send_disconnect();
+}
+
+void
+WirelessReceiver::on_write_data(libusb_transfer* transfer)
+{
+  if (transfer->status == LIBUSB_TRANSFER_COMPLETED)
+  {
+    // ok
+  }
+  else if (transfer->status == LIBUSB_TRANSFER_CANCELLED)
+  {
+    // ok
+  }
+  else if (transfer->status == LIBUSB_TRANSFER_NO_DEVICE)
+  {
+    send_disconnect();
+  }
+  else
+  {
+    log_error("USB write failure: " << transfer->length << ": " << usb_transfer_strerror(transfer->status));
+
+    const int port = ((transfer->endpoint & ~LIBUSB_ENDPOINT_DIR_MASK) - 1) / 2;
+    if (port >= 0 && port < kMaxPorts && m_ports[port])
+    {
+      m_ports[port]->submit_error();
+    }
+  }
+
+  m_transfers.erase(transfer);
+  libusb_free_transfer(transfer);
+}
+
+void
+WirelessReceiver::send_disconnect()
+{
+  // the disconnect callbacks might detach controllers, so work on a copy
+  Xbox360WirelessController* ports[kMaxPorts];
+  std::copy(m_ports, m_ports + kMaxPorts, ports);
+
+  for(int port = 0; port < kMaxPorts; ++port)
+  {
+    if (ports[port] && !ports[port]->is_disconnected())
+    {
+      ports[port]->send_disconnect();
+    }
+  }
+}
+
+/* EOF */
@@ -0,0 +1,97 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_XBOXDRV_WIRELESS_RECEIVER_HPP
+#define HEADER_XBOXDRV_WIRELESS_RECEIVER_HPP
+
+#include <boost/shared_ptr.hpp>
+#include <libusb.h>
+#include <set>
+#include <stdint.h>
+#include <string>
+
+class USBReadQueue;
+class Xbox360WirelessController;
+
+/** The Xbox360 wireless receiver handles up to four controllers, one
+    interface with an IN and OUT endpoint per port. The receiver opens
+    the device once and demultiplexes the reports to the
+    Xbox360WirelessController attached to the port, the controllers
+    themselves don't touch USB. */
+class WirelessReceiver
+{
+public:
+  enum { kMaxPorts = 4 };
+
+private:
+  libusb_device* m_dev;
+  libusb_device_handle* m_handle;
+  bool m_try_detach;
+  int m_read_queue_depth;
+
+  std::string m_usbpath;
+  std::string m_usbid;
+  std::string m_name;
+
+  Xbox360WirelessController* m_ports[kMaxPorts];
+  boost::shared_ptr<USBReadQueue> m_read_queues[kMaxPorts];
+
+  /** write transfers currently in flight */
+  std::set<libusb_transfer*> m_transfers;
+
+public:
+  WirelessReceiver(libusb_device* dev, bool try_detach, int read_queue_depth);
+  ~WirelessReceiver();
+
+  std::string get_usbpath() const { return m_usbpath; }
+  std::string get_usbid() const { return m_usbid; }
+  std::string get_name() const { return m_name; }
+
+  /** Claim the interface of \a port and start passing its reports to
+      \a controller */
+  void attach(int port, Xbox360WirelessController* controller);
+
+  /** Stop reading from \a port and release its interface */
+  void detach(int port);
+
+  void write(int port, uint8_t* data, int len);
+
+private:
+  static int get_endpoint(int port) { return port*2 + 1; }
+  static int get_interface(int port) { return port*2; }
+
+  bool on_read_data(int port, libusb_transfer* transfer, uint32_t seq, int64_t nsec);
+  void on_read_error(int err);
+
+  void on_write_data(libusb_transfer* transfer);
+  static void on_write_data_wrap(libusb_transfer* transfer)
+  {
+    static_cast<WirelessReceiver*>(transfer->user_data)->on_write_data(transfer);
+  }
+
+  /** the receiver is gone, tell every attached controller */
+  void send_disconnect();
+
+private:
+  WirelessReceiver(const WirelessReceiver&);
+  WirelessReceiver& operator=(const WirelessReceiver&);
+};
+
+#endif
+
+/* EOF */
@@ -50,7 +50,8 @@ public:
                     bool headset_debug,
                     const std::string& headset_dump,
                     const std::string& headset_play,
-                    bool try_detach);
+                    bool try_detach,
+                    int read_queue_depth);
   ~Xbox360Controller();
 
   void set_rumble_real(uint8_t left, uint8_t right);
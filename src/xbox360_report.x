@@ -0,0 +1,39 @@
+// Xbox360 controller state report, send by the wired controller and,
+// four bytes into the report, by the wireless receiver
+
+REPORT_U8(type,       0)
+REPORT_U8(length,     1)
+
+REPORT_BIT(dpad_up,    2, 0)
+REPORT_BIT(dpad_down,  2, 1)
+REPORT_BIT(dpad_left,  2, 2)
+REPORT_BIT(dpad_right, 2, 3)
+
+REPORT_BIT(start,      2, 4)
+REPORT_BIT(back,       2, 5)
+REPORT_BIT(thumb_l,    2, 6)
+REPORT_BIT(thumb_r,    2, 7)
+
+REPORT_BIT(lb,         3, 0)
+REPORT_BIT(rb,         3, 1)
+REPORT_BIT(guide,      3, 2)
+REPORT_BIT(dummy1,     3, 3)
+
+REPORT_BIT(a,          3, 4)
+REPORT_BIT(b,          3, 5)
+REPORT_BIT(x,          3, 6)
+REPORT_BIT(y,          3, 7)
+
+REPORT_U8(lt,          4)
+REPORT_U8(rt,          5)
+
+REPORT_S16LE(x1,       6)
+REPORT_S16LE(y1,       8)
+
+REPORT_S16LE(x2,      10)
+REPORT_S16LE(y2,      12)
+
+REPORT_U32LE(dummy2,  14)
+REPORT_U16LE(dummy3,  18)
+
+/* EOF */
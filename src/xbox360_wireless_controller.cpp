@@ -23,33 +23,53 @@
 
 #include "helper.hpp"
 #include "raise_exception.hpp"
-#include "unpack.hpp"
+#include "report_decoder.hpp"
 #include "usb_helper.hpp"
+#include "wireless_receiver.hpp"
 #include "xboxmsg.hpp"
 
-Xbox360WirelessController::Xbox360WirelessController(libusb_device* dev, int controller_id,
-                                                     bool try_detach) :
-  USBController(dev),
-  m_endpoint(),
-  m_interface(),
-  m_battery_status(),
+Xbox360WirelessController::Xbox360WirelessController(const boost::shared_ptr<WirelessReceiver>& receiver,
+                                                     int controller_id) :
+  m_receiver(receiver),
+  m_port(controller_id),
+  m_battery_status(-1),
   m_serial()
 {
   // FIXME: A little bit of a hack
   m_is_active = false;
 
-  assert(controller_id >= 0 && controller_id < 4);
+  assert(controller_id >= 0 && controller_id < WirelessReceiver::kMaxPorts);
 
-  // FIXME: Is hardcoding those ok?
-  m_endpoint  = controller_id*2 + 1;
-  m_interface = controller_id*2;
-
-  usb_claim_interface(m_interface, try_detach);
-  usb_submit_read(m_endpoint, 32);
+  m_receiver->attach(m_port, this);
 }
 
 Xbox360WirelessController::~Xbox360WirelessController()
 {
+  m_receiver->detach(m_port);
+}
+
+std::string
+Xbox360WirelessController::get_usbpath() const
+{
+  return m_receiver->get_usbpath();
+}
+
+std::string
+Xbox360WirelessController::get_usbid() const
+{
+  return m_receiver->get_usbid();
+}
+
+std::string
+Xbox360WirelessController::get_name() const
+{
+  return m_receiver->get_name();
+}
+
+int
+Xbox360WirelessController::get_battery_status() const
+{
+  return m_battery_status;
 }
 
 void
@@ -58,7 +78,7 @@ Xbox360WirelessController::set_rumble_real(uint8_t left, uint8_t right)
   //                                       +-- typo? might be 0x0c, i.e. length
   //                                       v
   uint8_t rumblecmd[] = { 0x00, 0x01, 0x0f, 0xc0, 0x00, left, right, 0x00, 0x00, 0x00, 0x00, 0x00 };
-  usb_write(m_endpoint, rumblecmd, sizeof(rumblecmd));
+  m_receiver->write(m_port, rumblecmd, sizeof(rumblecmd));
 }
 
 void
@@ -67,7 +87,7 @@ Xbox360WirelessController::set_led_real(uint8_t status)
   //                                +--- Why not just status?
   //                                v
   uint8_t ledcmd[] = { 0x00, 0x00, 0x08, static_cast<uint8_t>(0x40 + (status % 0x0e)), 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
-  usb_write(m_endpoint, ledcmd, sizeof(ledcmd));
+  m_receiver->write(m_port, ledcmd, sizeof(ledcmd));
 }
 
 bool
@@ -132,44 +152,7 @@ Xbox360WirelessController::parse(uint8_t* data, int len, XboxGenericMsg* msg_out
       else if (data[0] == 0x00 && data[1] == 0x01 && data[2] == 0x00 && data[3] == 0xf0 && data[4] == 0x00 && data[5] == 0x13)
       { // Event message
         msg_out->type = XBOX_MSG_XBOX360;
-        Xbox360Msg& msg = msg_out->xbox360;
-
-        uint8_t* ptr = data+4;
-
-        msg.type   = ptr[0];
-        msg.length = ptr[1];
-
-        msg.dpad_up    = unpack::bit(ptr+2, 0);
-        msg.dpad_down  = unpack::bit(ptr+2, 1);
-        msg.dpad_left  = unpack::bit(ptr+2, 2);
-        msg.dpad_right = unpack::bit(ptr+2, 3);
-
-        msg.start   = unpack::bit(ptr+2, 4);
-        msg.back    = unpack::bit(ptr+2, 5);
-        msg.thumb_l = unpack::bit(ptr+2, 6);
-        msg.thumb_r = unpack::bit(ptr+2, 7);
-
-        msg.lb     = unpack::bit(ptr+3, 0);
-        msg.rb     = unpack::bit(ptr+3, 1);
-        msg.guide  = unpack::bit(ptr+3, 2);
-        msg.dummy1 = unpack::bit(ptr+3, 3);
-
-        msg.a = unpack::bit(ptr+3, 4);
-        msg.b = unpack::bit(ptr+3, 5);
-        msg.x = unpack::bit(ptr+3, 6);
-        msg.y = unpack::bit(ptr+3, 7);
-
-        msg.lt = ptr[4];
-        msg.rt = ptr[5];
-
-        msg.x1 = unpack::int16le(ptr+6);
-        msg.y1 = unpack::int16le(ptr+8);
-
-        msg.x2 = unpack::int16le(ptr+10);
-        msg.y2 = unpack::int16le(ptr+12);
-
-        msg.dummy2 = unpack::int32le(ptr+14);
-        msg.dummy3 = unpack::int16le(ptr+18);
+        report::decode_xbox360(data+4, msg_out->xbox360);
 
         return true;
       }
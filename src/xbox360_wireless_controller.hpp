@@ -19,31 +19,38 @@
 #ifndef HEADER_XBOX360_WIRELESS_CONTROLLER_HPP
 #define HEADER_XBOX360_WIRELESS_CONTROLLER_HPP
 
-#include <libusb.h>
+#include <boost/shared_ptr.hpp>
 #include <string>
 
-#include "usb_controller.hpp"
+#include "controller.hpp"
 
+class WirelessReceiver;
 struct XboxGenericMsg;
 struct XPadDevice;
 
-class Xbox360WirelessController : public USBController
+/** A single port of a WirelessReceiver, the receiver does the USB
+    communication and passes the reports of the port to parse() */
+class Xbox360WirelessController : public Controller
 {
 private:
-  int  m_endpoint;
-  int  m_interface;
+  boost::shared_ptr<WirelessReceiver> m_receiver;
+  int  m_port;
   int  m_battery_status;
   std::string m_serial;
 
 public:
-  Xbox360WirelessController(libusb_device* dev, int controller_id, bool try_detach);
+  Xbox360WirelessController(const boost::shared_ptr<WirelessReceiver>& receiver, int controller_id);
   virtual ~Xbox360WirelessController();
 
+  std::string get_usbpath() const;
+  std::string get_usbid() const;
+  std::string get_name() const;
+
   bool parse(uint8_t* data, int len, XboxGenericMsg* msg_out);
 
   void set_rumble_real(uint8_t left, uint8_t right);
   void set_led_real(uint8_t status);
-  uint8_t get_battery_status() const;
+  int get_battery_status() const;
 
 private:
   Xbox360WirelessController (const Xbox360WirelessController&);
@@ -24,10 +24,11 @@
 
 #include "usb_helper.hpp"
 #include "raise_exception.hpp"
+#include "report_decoder.hpp"
 #include "xboxmsg.hpp"
 
-XboxController::XboxController(libusb_device* dev, bool try_detach) :
-  USBController(dev),
+XboxController::XboxController(libusb_device* dev, bool try_detach, int read_queue_depth) :
+  USBController(dev, read_queue_depth),
   m_endpoint_in(1),
   m_endpoint_out(2)
 {
@@ -62,7 +63,7 @@ XboxController::parse(uint8_t* data, int len, XboxGenericMsg* msg_out)
   if (len == 20 && data[0] == 0x00 && data[1] == 0x14)
   {
     msg_out->type = XBOX_MSG_XBOX;
-    memcpy(&msg_out->xbox, data, sizeof(XboxMsg));
+    report::decode_xbox(data, msg_out->xbox);
     return true;
   }
   else
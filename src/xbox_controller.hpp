@@ -32,7 +32,7 @@ private:
   int m_endpoint_out;
 
 public:
-  XboxController(libusb_device* dev, bool try_detach);
+  XboxController(libusb_device* dev, bool try_detach, int read_queue_depth);
   virtual ~XboxController();
 
   void set_rumble_real(uint8_t left, uint8_t right);
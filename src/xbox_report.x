@@ -0,0 +1,32 @@
+// Original Xbox controller state report
+
+REPORT_U8(type,        0)
+REPORT_U8(length,      1)
+
+REPORT_BIT(dpad_up,    2, 0)
+REPORT_BIT(dpad_down,  2, 1)
+REPORT_BIT(dpad_left,  2, 2)
+REPORT_BIT(dpad_right, 2, 3)
+
+REPORT_BIT(start,      2, 4)
+REPORT_BIT(back,       2, 5)
+REPORT_BIT(thumb_l,    2, 6)
+REPORT_BIT(thumb_r,    2, 7)
+
+REPORT_U8(dummy,       3)
+REPORT_U8(a,           4)
+REPORT_U8(b,           5)
+REPORT_U8(x,           6)
+REPORT_U8(y,           7)
+REPORT_U8(black,       8)
+REPORT_U8(white,       9)
+REPORT_U8(lt,         10)
+REPORT_U8(rt,         11)
+
+REPORT_S16LE(x1,      12)
+REPORT_S16LE(y1,      14)
+
+REPORT_S16LE(x2,      16)
+REPORT_S16LE(y2,      18)
+
+/* EOF */
@@ -36,7 +36,9 @@
 #include "evdev_controller.hpp"
 #include "evdev_helper.hpp"
 #include "helper.hpp"
+#include "launcher.hpp"
 #include "raise_exception.hpp"
+#include "trace.hpp"
 #include "uinput_message_processor.hpp"
 #include "usb_gsource.hpp"
 #include "usb_helper.hpp"
@@ -197,6 +199,7 @@ Xboxdrv::run_main(const Options& opts)
     print_copyright();
   }
 
+  Launcher launcher;
   USBSubsystem usb_subsystem;
   XboxdrvMain xboxdrv_main(opts);
   xboxdrv_main.run();
@@ -217,6 +220,7 @@ Xboxdrv::run_daemon(const Options& opts)
 
   if (!opts.detach)
   {
+    Launcher launcher;
     USBSubsystem usb_subsystem;
     XboxdrvDaemon daemon(opts);
     daemon.run();
@@ -249,6 +253,7 @@ Xboxdrv::run_daemon(const Options& opts)
         }
         else
         {
+          Launcher launcher;
           USBSubsystem usb_subsystem;
           XboxdrvDaemon daemon(opts);
           daemon.run();
@@ -370,6 +375,11 @@ Xboxdrv::main(int argc, char** argv)
 
     set_scheduling(opts);
 
+    if (!opts.trace_file.empty())
+    {
+      Trace::enable(opts.trace_size, opts.trace_file);
+    }
+
     switch(opts.mode)
     {
       case Options::PRINT_HELP_DEVICES:
@@ -412,6 +422,11 @@ Xboxdrv::main(int argc, char** argv)
         run_list_controller();
         break;
     }
+
+    if (Trace::is_enabled())
+    {
+      Trace::dump(Trace::get_filename());
+    }
   }
   catch(const std::exception& err)
   {
@@ -27,7 +27,10 @@
 #include <dbus/dbus.h>
 #include <errno.h>
 
+#include "clock.hpp"
+#include "daemon_handover.hpp"
 #include "helper.hpp"
+#include "launcher.hpp"
 #include "raise_exception.hpp"
 #include "select.hpp"
 #include "uinput.hpp"
@@ -102,7 +105,10 @@ XboxdrvDaemon::XboxdrvDaemon(const Options& opts) :
   m_gmain(),
   m_controller_slots(),
   m_inactive_controllers(),
-  m_uinput()
+  m_uinput(),
+  m_slot_usbpaths(),
+  m_handed_over(false),
+  m_dbus_subsystem()
 {
   assert(!s_current);
   s_current = this;
@@ -133,14 +139,57 @@ XboxdrvDaemon::run()
 {
   try
   {
+    const int64_t startup_start = Clock::now();
+
     create_pid_file();
 
-    init_uinput();
+    const int64_t takeover_start = Clock::now();
+    boost::scoped_ptr<HandoverClient> handover_client;
+    HandoverState handover;
+    if (m_opts.takeover)
+    {
+      if (m_opts.handover_socket.empty())
+      {
+        raise_exception(std::runtime_error, "--takeover requires --handover-socket");
+      }
+
+      try
+      {
+        handover_client.reset(new HandoverClient(m_opts.handover_socket));
+        handover = handover_client->receive();
+      }
+      catch(const std::exception& err)
+      {
+        log_warn(err.what() << ", starting from scratch");
+        handover_client.reset();
+      }
+    }
+
+    init_uinput(handover);
+
+    if (handover_client)
+    {
+      // the old daemon exits now and releases the USB devices, which
+      // the udev subsystem will pick up again below
+      handover_client->confirm(5000);
+      handover_client.reset();
+      log_info("took over " << handover.devices.size() << " uinput devices in "
+               << nsec2msec(Clock::now() - takeover_start) << " msec");
+    }
+
+    boost::scoped_ptr<HandoverServer> handover_server;
+    if (!m_opts.handover_socket.empty())
+    {
+      handover_server.reset(new HandoverServer(m_opts.handover_socket,
+                                               boost::bind(&XboxdrvDaemon::get_handover_state, this),
+                                               boost::bind(&XboxdrvDaemon::on_handover, this)));
+    }
 
+    const int64_t udev_start = Clock::now();
     UdevSubsystem udev_subsystem;
     udev_subsystem.set_device_callback(boost::bind(&XboxdrvDaemon::process_match, this, _1));
+    log_info("connected the present controllers in " << nsec2msec(Clock::now() - udev_start) << " msec");
 
-    boost::scoped_ptr<DBusSubsystem> dbus_subsystem;
     if (m_opts.dbus != Options::kDBusDisabled)
     {
       DBusBusType dbus_bus_type;
@@ -179,15 +228,21 @@ XboxdrvDaemon::run()
           break;
       }
 
-      dbus_subsystem.reset(new DBusSubsystem("org.seul.Xboxdrv", dbus_bus_type));
-      dbus_subsystem->register_xboxdrv_daemon(this);
-      dbus_subsystem->register_controller_slots(m_controller_slots);
+      m_dbus_subsystem.reset(new DBusSubsystem("org.seul.Xboxdrv", dbus_bus_type));
+      m_dbus_subsystem->register_xboxdrv_daemon(this);
+      m_dbus_subsystem->register_controller_slots(m_controller_slots);
+      m_dbus_subsystem->start(m_opts.dbus_signal_rate);
     }
 
+    log_info("startup took " << nsec2msec(Clock::now() - startup_start) << " msec");
+
     log_debug("launching into main loop");
     g_main_loop_run(m_gmain);
     log_debug("main loop exited");
 
+    // the D-Bus objects refer to the slots, so they have to go first
+    m_dbus_subsystem.reset();
+
     // get rid of active ControllerThreads before the subsystems shutdown
     m_inactive_controllers.clear();
     m_controller_slots.clear();
@@ -242,8 +297,45 @@ XboxdrvDaemon::process_match(struct udev_device* device)
   }
 }
 
+HandoverState
+XboxdrvDaemon::get_handover_state()
+{
+  HandoverState state;
+
+  if (m_uinput.get())
+  {
+    state.devices = m_uinput->get_handover_devices();
+  }
+
+  for(ControllerSlots::iterator i = m_controller_slots.begin(); i != m_controller_slots.end(); ++i)
+  {
+    HandoverState::Slot slot;
+    slot.id = (*i)->get_id();
+    slot.config = (*i)->get_config() ? (*i)->get_config()->get_current_config() : 0;
+    slot.usbpath = (*i)->get_controller() ? (*i)->get_controller()->get_usbpath() : "-";
+    state.slots.push_back(slot);
+  }
+
+  return state;
+}
+
+void
+XboxdrvDaemon::on_handover()
+{
+  log_info("handed over to successor, exiting");
+
+  m_handed_over = true;
+  if (m_uinput.get())
+  {
+    m_uinput->detach();
+  }
+
+  // no LED off, the controllers continue to be used by the successor
+  g_main_loop_quit(m_gmain);
+}
+
 void
-XboxdrvDaemon::init_uinput()
+XboxdrvDaemon::init_uinput(const HandoverState& handover)
 {
   // Setup uinput
   if (m_opts.no_uinput)
@@ -257,11 +349,13 @@ XboxdrvDaemon::init_uinput()
   {
     log_info("starting with UInput");
 
-    m_uinput.reset(new UInput(m_opts.extra_events));
+    m_uinput.reset(new UInput(m_opts.extra_events, m_opts.output_rate));
     m_uinput->set_device_names(m_opts.uinput_device_names);
     m_uinput->set_device_usbids(m_opts.uinput_device_usbids);
+    m_uinput->set_handover_devices(handover.devices);
 
     // create controller slots
+    const int64_t slots_start = Clock::now();
     int slot_count = 0;
 
     for(Options::ControllerSlots::const_iterator controller = m_opts.controller_slots.begin();
@@ -280,7 +374,22 @@ XboxdrvDaemon::init_uinput()
       slot_count += 1;
     }
 
-    log_info("created " << m_controller_slots.size() << " controller slots");
+    log_info("created " << m_controller_slots.size() << " controller slots in "
+             << nsec2msec(Clock::now() - slots_start) << " msec");
+
+    m_slot_usbpaths.resize(m_controller_slots.size(), "-");
+    for(std::vector<HandoverState::Slot>::const_iterator i = handover.slots.begin(); i != handover.slots.end(); ++i)
+    {
+      if (0 <= i->id && i->id < static_cast<int>(m_controller_slots.size()))
+      {
+        ControllerSlotConfigPtr config = m_controller_slots[i->id]->get_config();
+        if (i->config < config->config_count())
+        {
+          config->set_current_config(i->config);
+        }
+        m_slot_usbpaths[i->id] = i->usbpath;
+      }
+    }
 
     // After all the ControllerConfig registered their events, finish up
     // the device creation
@@ -309,6 +418,22 @@ XboxdrvDaemon::create_pid_file()
 ControllerSlotPtr
 XboxdrvDaemon::find_free_slot(udev_device* dev)
 {
+  // zeroth pass, put controllers back into the slot they had before a
+  // daemon restart
+  int bus;
+  int devnum;
+  if (!m_slot_usbpaths.empty() && get_usb_path(dev, &bus, &devnum))
+  {
+    const std::string usbpath = (boost::format("%03d:%03d") % bus % devnum).str();
+    for(ControllerSlots::iterator i = m_controller_slots.begin(); i != m_controller_slots.end(); ++i)
+    {
+      if (!(*i)->is_connected() && m_slot_usbpaths[(*i)->get_id()] == usbpath)
+      {
+        return *i;
+      }
+    }
+  }
+
   // first pass, look for slots where the rules match the given vendor:product, bus:dev
   for(ControllerSlots::iterator i = m_controller_slots.begin(); i != m_controller_slots.end(); ++i)
   {
@@ -434,6 +559,12 @@ XboxdrvDaemon::connect(ControllerSlotPtr slot, ControllerPtr controller)
   slot->connect(controller);
   on_connect(slot);
 
+  if (slot->get_id() < static_cast<int>(m_slot_usbpaths.size()))
+  {
+    // the reservation is used up
+    m_slot_usbpaths[slot->get_id()] = "-";
+  }
+
   log_info("controller connected: "
            << controller->get_usbpath() << " "
            << controller->get_usbid() << " "
@@ -466,7 +597,12 @@ XboxdrvDaemon::on_connect(ControllerSlotPtr slot)
     args.push_back(controller->get_usbpath());
     args.push_back(controller->get_usbid());
     args.push_back(controller->get_name());
-    spawn_exe(args);
+    Launcher::launch(args);
+  }
+
+  if (m_dbus_subsystem)
+  {
+    m_dbus_subsystem->on_connect(slot->get_id());
   }
 }
 
@@ -476,6 +612,11 @@ XboxdrvDaemon::on_disconnect(ControllerSlotPtr slot)
   ControllerPtr controller = slot->get_controller();
   assert(controller);
 
+  if (m_dbus_subsystem)
+  {
+    m_dbus_subsystem->on_disconnect(slot->get_id());
+  }
+
   log_info("controller disconnected: "
            << controller->get_usbpath() << " "
            << controller->get_usbid() << " "
@@ -490,7 +631,7 @@ XboxdrvDaemon::on_disconnect(ControllerSlotPtr slot)
     args.push_back(controller->get_usbpath());
     args.push_back(controller->get_usbid());
     args.push_back(controller->get_name());
-    spawn_exe(args);
+    Launcher::launch(args);
   }
 }
 
@@ -564,44 +705,6 @@ XboxdrvDaemon::on_controller_activate()
                                m_inactive_controllers.end());
 }
 
-std::string
-XboxdrvDaemon::status()
-{
-  std::ostringstream out;
-
-  out << boost::format("SLOT  CFG  NCFG    USBID    USBPATH  NAME\n");
-  for(ControllerSlots::iterator i = m_controller_slots.begin(); i != m_controller_slots.end(); ++i)
-  {
-    if ((*i)->get_controller())
-    {
-      out << boost::format("%4d  %3d  %4d  %5s  %7s  %s\n")
-        % (i - m_controller_slots.begin())
-        % (*i)->get_config()->get_current_config()
-        % (*i)->get_config()->config_count()
-        % (*i)->get_controller()->get_usbid()
-        % (*i)->get_controller()->get_usbpath()
-        % (*i)->get_controller()->get_name();
-    }
-    else
-    {
-      out << boost::format("%4d  %3d  %4d      -         -\n")
-        % (i - m_controller_slots.begin())
-        % (*i)->get_config()->get_current_config()
-        % (*i)->get_config()->config_count();
-    }
-  }
-
-  for(Controllers::iterator i = m_inactive_controllers.begin(); i != m_inactive_controllers.end(); ++i)
-  {
-    out << boost::format("   -             %5s  %7s  %s\n")
-      % (*i)->get_usbid()
-      % (*i)->get_usbpath()
-      % (*i)->get_name();
-  }
-
-  return out.str();
-}
-
 void
 XboxdrvDaemon::shutdown()
 {
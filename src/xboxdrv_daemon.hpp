@@ -29,8 +29,10 @@ extern "C" {
 #include "controller_slot_ptr.hpp"
 #include "controller_ptr.hpp"
 
+class DBusSubsystem;
 class Options;
 class UInput;
+struct HandoverState;
 class USBGSource;
 struct XPadDevice;
 
@@ -51,6 +53,14 @@ private:
 
   std::auto_ptr<UInput> m_uinput;
 
+  /** bus:dev of the controller each slot had in the previous daemon,
+      so that controllers end up in the same slot again */
+  std::vector<std::string> m_slot_usbpaths;
+
+  bool m_handed_over;
+
+  boost::scoped_ptr<DBusSubsystem> m_dbus_subsystem;
+
 private:
   static void on_sigint(int);
   static XboxdrvDaemon* current() { return s_current; }
@@ -61,12 +71,19 @@ public:
 
   void run();
 
-  std::string status();
+  const std::vector<ControllerPtr>& get_inactive_controllers() const { return m_inactive_controllers; }
   void shutdown();
 
 private:
   void create_pid_file();
-  void init_uinput();
+  void init_uinput(const HandoverState& handover);
+
+  /** take over the devices from the daemon listening on
+      --handover-socket, returns false if there is none */
+  bool takeover(HandoverState* state);
+
+  HandoverState get_handover_state();
+  void on_handover();
 
   ControllerSlotPtr find_free_slot(udev_device* dev);
 
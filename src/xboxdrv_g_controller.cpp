@@ -18,9 +18,14 @@
 
 #include "xboxdrv_g_controller.hpp"
 
+#include <boost/bind.hpp>
+#include <stdexcept>
+
 #include "controller.hpp"
 #include "controller_slot.hpp"
 #include "controller_thread.hpp"
+#include "dbus_subsystem.hpp"
+#include "rumble_pattern.hpp"
 #include "uinput_message_processor.hpp"
 #include "log.hpp"
 
@@ -32,6 +37,78 @@ xboxdrv_controller_error_quark()
   return g_quark_from_static_string("xboxdrv-controller-error-quark");
 }
 
+enum {
+  STATE_CHANGED,
+  CONNECTED,
+  DISCONNECTED,
+  LAST_SIGNAL
+};
+
+static guint xboxdrv_g_controller_signals[LAST_SIGNAL] = { 0 };
+
+namespace {
+
+void remember_state(XboxdrvGController* self, const DBusSlotState& state)
+{
+  self->connected = state.connected;
+  self->active    = state.active;
+  self->config    = state.config;
+  self->battery   = state.battery;
+  self->led       = state.led;
+}
+
+// the functions below run on the input side
+
+ControllerPtr get_controller(ControllerSlot* slot)
+{
+  ControllerPtr controller = slot->get_controller();
+  if (!controller)
+  {
+    throw std::runtime_error("could't access controller");
+  }
+  return controller;
+}
+
+void set_led(ControllerSlot* slot, int status)
+{
+  get_controller(slot)->set_led(status);
+}
+
+void set_rumble(ControllerSlot* slot, int strong, int weak)
+{
+  get_controller(slot)->set_rumble(strong, weak);
+}
+
+void set_config(ControllerSlot* slot, int config_num)
+{
+  if (!slot->get_thread() ||
+      !slot->get_thread()->get_controller())
+  {
+    throw std::runtime_error("could't access controller");
+  }
+
+  MessageProcessor* gen_msg_proc = slot->get_thread()->get_message_proc();
+  UInputMessageProcessor* msg_proc = dynamic_cast<UInputMessageProcessor*>(gen_msg_proc);
+  msg_proc->set_config(config_num);
+}
+
+void upload_pattern(ControllerSlot* slot, const std::string& name, const std::string& pattern)
+{
+  slot->add_rumble_pattern(name, RumblePattern::from_string(pattern));
+}
+
+void play_pattern(ControllerSlot* slot, const std::string& name)
+{
+  slot->play_rumble_pattern(name);
+}
+
+void stop_pattern(ControllerSlot* slot)
+{
+  slot->stop_rumble_pattern();
+}
+
+} // namespace
+
 /* will create xboxdrv_g_controller_get_type and set xboxdrv_g_controller_parent_class */
 G_DEFINE_TYPE(XboxdrvGController, xboxdrv_g_controller, G_TYPE_OBJECT)
 
@@ -50,90 +127,190 @@ xboxdrv_g_controller_class_init(XboxdrvGControllerClass* klass)
 {
   GObjectClass* gobject_class = G_OBJECT_CLASS(klass);
   gobject_class->constructor = xboxdrv_g_controller_constructor;
+
+  // dbus-glib exports these as StateChanged, Connected and Disconnected
+  xboxdrv_g_controller_signals[STATE_CHANGED] =
+    g_signal_new("state-changed", G_TYPE_FROM_CLASS(klass), G_SIGNAL_RUN_LAST,
+                 0, NULL, NULL, g_cclosure_marshal_generic,
+                 G_TYPE_NONE, 7,
+                 G_TYPE_BOOLEAN, G_TYPE_BOOLEAN, G_TYPE_INT, G_TYPE_INT, G_TYPE_INT,
+                 G_TYPE_UINT64, G_TYPE_UINT64);
+
+  xboxdrv_g_controller_signals[CONNECTED] =
+    g_signal_new("connected", G_TYPE_FROM_CLASS(klass), G_SIGNAL_RUN_LAST,
+                 0, NULL, NULL, g_cclosure_marshal_generic,
+                 G_TYPE_NONE, 4,
+                 G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING);
+
+  xboxdrv_g_controller_signals[DISCONNECTED] =
+    g_signal_new("disconnected", G_TYPE_FROM_CLASS(klass), G_SIGNAL_RUN_LAST,
+                 0, NULL, NULL, g_cclosure_marshal_VOID__VOID,
+                 G_TYPE_NONE, 0);
 }
 
 static void
 xboxdrv_g_controller_init(XboxdrvGController* self)
 {
   self->controller = NULL;
+  self->subsystem = NULL;
+  self->slot = -1;
+  self->connected = FALSE;
+  self->active = FALSE;
+  self->config = 0;
+  self->battery = -1;
+  self->led = 0;
 }
 
 XboxdrvGController*
-xboxdrv_g_controller_new(ControllerSlot* controller)
+xboxdrv_g_controller_new(ControllerSlot* controller, DBusSubsystem* subsystem)
 {
   XboxdrvGController* self = static_cast<XboxdrvGController*>(g_object_new(XBOXDRV_TYPE_G_CONTROLLER, NULL));
   self->controller = controller;
+  self->subsystem = subsystem;
+  self->slot = controller->get_id();
+  remember_state(self, DBusSlotState::from_slot(*controller));
   return self;
 }
 
-gboolean
-xboxdrv_g_controller_set_led(XboxdrvGController* self, int status, GError** error)
+void
+xboxdrv_g_controller_set_led(XboxdrvGController* self, int status, DBusGMethodInvocation* context)
 {
   log_info("D-Bus: xboxdrv_g_controller_set_led(" << self << ", " << status << ")");
 
-  if (self->controller &&
-      self->controller->get_controller())
-  {
-    self->controller->get_controller()->set_led(status);
-    return TRUE;
-  }
-  else
-  {
-    g_set_error(error, XBOXDRV_CONTROLLER_ERROR, XBOXDRV_CONTROLLER_ERROR_FAILED,
-                "could't access controller");
-    return FALSE;
-  }
+  self->subsystem->call(XBOXDRV_CONTROLLER_ERROR,
+                        boost::bind(&set_led, self->controller, status),
+                        context);
 }
 
-gboolean
-xboxdrv_g_controller_set_rumble(XboxdrvGController* self, int strong, int weak, GError** error)
+void
+xboxdrv_g_controller_set_rumble(XboxdrvGController* self, int strong, int weak, DBusGMethodInvocation* context)
 {
   log_info("D-Bus: xboxdrv_g_controller_set_rumble(" << self << ", " << strong << ", " << weak << ")");
 
-  if (self->controller &&
-      self->controller->get_controller())
-  {
-    self->controller->get_controller()->set_rumble(strong, weak);
-    return TRUE;
-  }
-  else
+  self->subsystem->call(XBOXDRV_CONTROLLER_ERROR,
+                        boost::bind(&set_rumble, self->controller, strong, weak),
+                        context);
+}
+
+void
+xboxdrv_g_controller_set_config(XboxdrvGController* self, int config_num, DBusGMethodInvocation* context)
+{
+  log_info("D-Bus: xboxdrv_g_controller_set_config(" << self << ", " << config_num << ")");
+
+  self->subsystem->call(XBOXDRV_CONTROLLER_ERROR,
+                        boost::bind(&set_config, self->controller, config_num),
+                        context);
+}
+
+void
+xboxdrv_g_controller_upload_pattern(XboxdrvGController* self, const char* name, const char* pattern,
+                                    DBusGMethodInvocation* context)
+{
+  log_info("D-Bus: xboxdrv_g_controller_upload_pattern(" << self << ", " << name << ", " << pattern << ")");
+
+  // the strings are copied, the call outlives the message
+  self->subsystem->call(XBOXDRV_CONTROLLER_ERROR,
+                        boost::bind(&upload_pattern, self->controller, std::string(name), std::string(pattern)),
+                        context);
+}
+
+void
+xboxdrv_g_controller_play_pattern(XboxdrvGController* self, const char* name, DBusGMethodInvocation* context)
+{
+  log_info("D-Bus: xboxdrv_g_controller_play_pattern(" << self << ", " << name << ")");
+
+  self->subsystem->call(XBOXDRV_CONTROLLER_ERROR,
+                        boost::bind(&play_pattern, self->controller, std::string(name)),
+                        context);
+}
+
+void
+xboxdrv_g_controller_stop_pattern(XboxdrvGController* self, DBusGMethodInvocation* context)
+{
+  log_info("D-Bus: xboxdrv_g_controller_stop_pattern(" << self << ")");
+
+  self->subsystem->call(XBOXDRV_CONTROLLER_ERROR,
+                        boost::bind(&stop_pattern, self->controller),
+                        context);
+}
+
+gboolean
+xboxdrv_g_controller_get_state(XboxdrvGController* self,
+                               gint* slot, gboolean* connected, gboolean* active,
+                               gint* config, gint* config_count,
+                               gchar** name, gchar** usbid, gchar** usbpath, gchar** serial,
+                               gint* battery, gint* led,
+                               guint64* messages, guint64* errors,
+                               GError** error)
+{
+  log_debug("D-Bus: xboxdrv_g_controller_get_state(" << self << ")");
+
+  const std::vector<DBusSlotState>& slots = self->subsystem->get_state().slots;
+  if (self->slot < 0 || self->slot >= static_cast<int>(slots.size()))
   {
     g_set_error(error, XBOXDRV_CONTROLLER_ERROR, XBOXDRV_CONTROLLER_ERROR_FAILED,
-                "could't access controller");
+                "could't access controller slot");
     return FALSE;
   }
+
+  const DBusSlotState& state = slots[self->slot];
+
+  *slot         = state.slot;
+  *connected    = state.connected;
+  *active       = state.active;
+  *config       = state.config;
+  *config_count = state.config_count;
+  *name         = g_strdup(state.name.c_str());
+  *usbid        = g_strdup(state.usbid.c_str());
+  *usbpath      = g_strdup(state.usbpath.c_str());
+  *serial       = g_strdup(state.serial.c_str());
+  *battery      = state.battery;
+  *led          = state.led;
+  *messages     = state.messages;
+  *errors       = state.errors;
+
+  return TRUE;
 }
 
-gboolean
-xboxdrv_g_controller_set_config(XboxdrvGController* self, int config_num, GError** error)
+void
+xboxdrv_g_controller_update_state(XboxdrvGController* self, const DBusSlotState& state)
 {
-  log_info("D-Bus: xboxdrv_g_controller_set_config(" << self << ", " << config_num << ")");
-
-  if (self->controller &&
-      self->controller->get_thread() &&
-      self->controller->get_thread()->get_controller())
+  if (state.connected != static_cast<bool>(self->connected) ||
+      state.active    != static_cast<bool>(self->active) ||
+      state.config    != self->config ||
+      state.battery   != self->battery ||
+      state.led       != self->led)
   {
-    MessageProcessor* gen_msg_proc = self->controller->get_thread()->get_message_proc();
-    UInputMessageProcessor* msg_proc = dynamic_cast<UInputMessageProcessor*>(gen_msg_proc);
-
-    try
-    {
-      msg_proc->set_config(config_num);
-      return TRUE;
-    }
-    catch(const std::exception& err)
-    {
-      g_set_error(error, XBOXDRV_CONTROLLER_ERROR, XBOXDRV_CONTROLLER_ERROR_FAILED,
-                  "%s", err.what());
-      return FALSE;
-    }
+    remember_state(self, state);
+    g_signal_emit(self, xboxdrv_g_controller_signals[STATE_CHANGED], 0,
+                  static_cast<gboolean>(state.connected), static_cast<gboolean>(state.active),
+                  state.config, state.battery, state.led,
+                  static_cast<guint64>(state.messages), static_cast<guint64>(state.errors));
   }
-  else
+}
+
+void
+xboxdrv_g_controller_emit_connected(XboxdrvGController* self, const DBusSlotState& state)
+{
+  if (state.connected)
   {
-    g_set_error(error, XBOXDRV_CONTROLLER_ERROR, XBOXDRV_CONTROLLER_ERROR_FAILED,
-                "could't access controller");
-    return FALSE;
+    remember_state(self, state);
+    g_signal_emit(self, xboxdrv_g_controller_signals[CONNECTED], 0,
+                  state.usbid.c_str(),
+                  state.usbpath.c_str(),
+                  state.name.c_str(),
+                  state.serial.c_str());
   }
 }
 
+void
+xboxdrv_g_controller_emit_disconnected(XboxdrvGController* self)
+{
+  self->connected = FALSE;
+  self->active = FALSE;
+  self->battery = -1;
+  self->led = 0;
+  g_signal_emit(self, xboxdrv_g_controller_signals[DISCONNECTED], 0);
+}
+
 /* EOF */
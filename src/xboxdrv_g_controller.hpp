@@ -19,11 +19,14 @@
 #ifndef HEADER_XBOXDRV_XBOXDRV_G_CONTROLLER_HPP
 #define HEADER_XBOXDRV_XBOXDRV_G_CONTROLLER_HPP
 
+#include <dbus/dbus-glib.h>
 #include <glib-object.h>
 
 #pragma GCC diagnostic ignored "-Wold-style-cast"
 
 class ControllerSlot;
+class DBusSubsystem;
+struct DBusSlotState;
 
 #define XBOXDRV_TYPE_G_CONTROLLER                  (xboxdrv_g_controller_get_type ())
 #define XBOXDRV_G_CONTROLLER(obj)                  (G_TYPE_CHECK_INSTANCE_CAST ((obj), XBOXDRV_TYPE_G_CONTROLLER, XboxdrvGController))
@@ -39,7 +42,18 @@ struct _XboxdrvGController
 {
   GObject parent_instance;
 
+  // only touched from the input side
   ControllerSlot* controller;
+
+  DBusSubsystem* subsystem;
+  gint slot;
+
+  // state last send with StateChanged
+  gboolean connected;
+  gboolean active;
+  gint config;
+  gint battery;
+  gint led;
 };
 
 struct _XboxdrvGControllerClass
@@ -48,11 +62,32 @@ struct _XboxdrvGControllerClass
 };
 
 GType xboxdrv_g_controller_get_type();
-XboxdrvGController* xboxdrv_g_controller_new(ControllerSlot* controller);
+XboxdrvGController* xboxdrv_g_controller_new(ControllerSlot* controller, DBusSubsystem* subsystem);
+
+/* these run on the input side, the reply follows once they are done */
+void xboxdrv_g_controller_set_config(XboxdrvGController* self, int config_num, DBusGMethodInvocation* context);
+void xboxdrv_g_controller_set_led(XboxdrvGController* self, int status, DBusGMethodInvocation* context);
+void xboxdrv_g_controller_set_rumble(XboxdrvGController* self, int strong, int weak, DBusGMethodInvocation* context);
+void xboxdrv_g_controller_upload_pattern(XboxdrvGController* self, const char* name, const char* pattern,
+                                         DBusGMethodInvocation* context);
+void xboxdrv_g_controller_play_pattern(XboxdrvGController* self, const char* name, DBusGMethodInvocation* context);
+void xboxdrv_g_controller_stop_pattern(XboxdrvGController* self, DBusGMethodInvocation* context);
+
+/* answered from the state last published to the D-Bus thread */
+gboolean xboxdrv_g_controller_get_state(XboxdrvGController* self,
+                                        gint* slot, gboolean* connected, gboolean* active,
+                                        gint* config, gint* config_count,
+                                        gchar** name, gchar** usbid, gchar** usbpath, gchar** serial,
+                                        gint* battery, gint* led,
+                                        guint64* messages, guint64* errors,
+                                        GError** error);
+
+/** emit StateChanged if \a state differs from the last one send */
+void xboxdrv_g_controller_update_state(XboxdrvGController* self, const DBusSlotState& state);
 
-gboolean xboxdrv_g_controller_set_config(XboxdrvGController* self, int config_num, GError** error);
-gboolean xboxdrv_g_controller_set_led(XboxdrvGController* self, int status, GError** error);
-gboolean xboxdrv_g_controller_set_rumble(XboxdrvGController* self, int strong, int weak, GError** error);
+/** emit Connected/Disconnected, the state they imply counts as send */
+void xboxdrv_g_controller_emit_connected(XboxdrvGController* self, const DBusSlotState& state);
+void xboxdrv_g_controller_emit_disconnected(XboxdrvGController* self);
 
 #endif
 
@@ -18,9 +18,21 @@
 
 #include "xboxdrv_g_daemon.hpp"
 
+#include <boost/bind.hpp>
+
+#include "dbus_subsystem.hpp"
 #include "log.hpp"
+#include "trace.hpp"
 #include "xboxdrv_daemon.hpp"
 
+#define XBOXDRV_DAEMON_ERROR xboxdrv_daemon_error_quark()
+#define XBOXDRV_DAEMON_ERROR_FAILED 0
+GQuark
+xboxdrv_daemon_error_quark()
+{
+  return g_quark_from_static_string("xboxdrv-daemon-error-quark");
+}
+
 /* will create xboxdrv_g_daemon_get_type and set xboxdrv_g_daemon_parent_class */
 G_DEFINE_TYPE(XboxdrvGDaemon, xboxdrv_g_daemon, G_TYPE_OBJECT)
 
@@ -45,13 +57,15 @@ static void
 xboxdrv_g_daemon_init(XboxdrvGDaemon* self)
 {
   self->daemon = NULL;
+  self->subsystem = NULL;
 }
 
 XboxdrvGDaemon*
-xboxdrv_g_daemon_new(XboxdrvDaemon* daemon)
+xboxdrv_g_daemon_new(XboxdrvDaemon* daemon, DBusSubsystem* subsystem)
 {
   XboxdrvGDaemon* self = static_cast<XboxdrvGDaemon*>(g_object_new(XBOXDRV_TYPE_G_DAEMON, NULL));
   self->daemon = daemon;
+  self->subsystem = subsystem;
   return self;
 }
 
@@ -60,16 +74,52 @@ xboxdrv_g_daemon_status(XboxdrvGDaemon* self, gchar** ret, GError** error)
 {
   log_info("D-Bus: xboxdrv_g_daemon_status(" << self << ")");
 
-  *ret = g_strdup(self->daemon->status().c_str());
+  *ret = g_strdup(self->subsystem->status().c_str());
   return TRUE;
 }
 
-gboolean xboxdrv_g_daemon_shutdown(XboxdrvGDaemon* self, GError** error)
+void
+xboxdrv_g_daemon_shutdown(XboxdrvGDaemon* self, DBusGMethodInvocation* context)
 {
   log_info("D-Bus: xboxdrv_g_daemon_shutdown(" << self << ")");
 
-  self->daemon->shutdown();
+  self->subsystem->call(XBOXDRV_DAEMON_ERROR,
+                        boost::bind(&XboxdrvDaemon::shutdown, self->daemon),
+                        context);
+}
+
+gboolean
+xboxdrv_g_daemon_get_slot_count(XboxdrvGDaemon* self, gint* count, GError** error)
+{
+  log_debug("D-Bus: xboxdrv_g_daemon_get_slot_count(" << self << ")");
+
+  *count = static_cast<gint>(self->subsystem->get_state().slots.size());
   return TRUE;
 }
 
+/* The daemon usually runs as root, so bus clients don't get to pick
+   the file, the trace always goes to the one given with --trace */
+gboolean
+xboxdrv_g_daemon_dump_trace(XboxdrvGDaemon* self, GError** error)
+{
+  log_info("D-Bus: xboxdrv_g_daemon_dump_trace(" << self << ")");
+
+  if (!Trace::is_enabled())
+  {
+    g_set_error(error, XBOXDRV_DAEMON_ERROR, XBOXDRV_DAEMON_ERROR_FAILED,
+                "tracing not enabled, start the daemon with --trace");
+    return FALSE;
+  }
+  else if (!Trace::dump(Trace::get_filename()))
+  {
+    g_set_error(error, XBOXDRV_DAEMON_ERROR, XBOXDRV_DAEMON_ERROR_FAILED,
+                "couldn't write trace to '%s'", Trace::get_filename().c_str());
+    return FALSE;
+  }
+  else
+  {
+    return TRUE;
+  }
+}
+
 /* EOF */
@@ -19,10 +19,12 @@
 #ifndef HEADER_XBOXDRV_XBOXDRV_G_DAEMON_HPP
 #define HEADER_XBOXDRV_XBOXDRV_G_DAEMON_HPP
 
+#include <dbus/dbus-glib.h>
 #include <glib-object.h>
 
 #pragma GCC diagnostic ignored "-Wold-style-cast"
 
+class DBusSubsystem;
 class XboxdrvDaemon;
 
 #define XBOXDRV_TYPE_G_DAEMON                  (xboxdrv_g_daemon_get_type ())
@@ -39,7 +41,10 @@ struct _XboxdrvGDaemon
 {
   GObject parent_instance;
 
+  // only touched from the input side
   XboxdrvDaemon* daemon;
+
+  DBusSubsystem* subsystem;
 };
 
 struct _XboxdrvGDaemonClass
@@ -48,10 +53,12 @@ struct _XboxdrvGDaemonClass
 };
 
 GType xboxdrv_g_daemon_get_type();
-XboxdrvGDaemon* xboxdrv_g_daemon_new(XboxdrvDaemon* daemon);
+XboxdrvGDaemon* xboxdrv_g_daemon_new(XboxdrvDaemon* daemon, DBusSubsystem* subsystem);
 
 gboolean xboxdrv_g_daemon_status(XboxdrvGDaemon* self, gchar** ret, GError** error);
-gboolean xboxdrv_g_daemon_shutdown(XboxdrvGDaemon* self, GError** error);
+void xboxdrv_g_daemon_shutdown(XboxdrvGDaemon* self, DBusGMethodInvocation* context);
+gboolean xboxdrv_g_daemon_get_slot_count(XboxdrvGDaemon* self, gint* count, GError** error);
+gboolean xboxdrv_g_daemon_dump_trace(XboxdrvGDaemon* self, GError** error);
 
 #endif
 
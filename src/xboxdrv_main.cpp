@@ -26,8 +26,11 @@
 #include <boost/format.hpp>
 #include <boost/bind.hpp>
 
+#include "calibration_store.hpp"
 #include "controller_factory.hpp"
 #include "evdev_controller.hpp"
+#include "evdev_passthrough.hpp"
+#include "merged_controller.hpp"
 #include "message_processor.hpp"
 #include "uinput_message_processor.hpp"
 #include "dummy_message_processor.hpp"
@@ -113,6 +116,32 @@ XboxdrvMain::create_controller()
   }
 }
 
+ControllerPtr
+XboxdrvMain::create_merged_controller()
+{
+  std::vector<ControllerPtr> sources;
+  sources.push_back(create_controller());
+
+  for(std::vector<std::string>::const_iterator i = m_opts.merge_evdev_devices.begin();
+      i != m_opts.merge_evdev_devices.end(); ++i)
+  {
+    sources.push_back(ControllerPtr(new EvdevController(*i,
+                                                        m_opts.evdev_absmap,
+                                                        m_opts.evdev_keymap,
+                                                        m_opts.evdev_grab,
+                                                        m_opts.evdev_debug)));
+  }
+
+  if (sources.size() == 1)
+  {
+    return sources.front();
+  }
+  else
+  {
+    return ControllerPtr(new MergedController(sources, m_opts.merge_latency));
+  }
+}
+
 void
 XboxdrvMain::init_controller(const ControllerPtr& controller)
 {
@@ -134,18 +163,94 @@ XboxdrvMain::init_controller(const ControllerPtr& controller)
   }
 }
 
+void
+XboxdrvMain::update_device_numbers()
+{
+  // the numbers guessed in init_controller() are off when other
+  // devices got created in the meantime, the kernel knows better
+  int jsdev_number = -1;
+  int evdev_number = -1;
+  const std::vector<std::string> nodes = m_uinput->get_device_nodes();
+  for(std::vector<std::string>::const_iterator i = nodes.begin(); i != nodes.end(); ++i)
+  {
+    if (jsdev_number == -1)
+    {
+      sscanf(i->c_str(), "/dev/input/js%d", &jsdev_number);
+    }
+
+    if (evdev_number == -1)
+    {
+      sscanf(i->c_str(), "/dev/input/event%d", &evdev_number);
+    }
+  }
+
+  if (evdev_number != -1)
+  {
+    m_evdev_number = evdev_number;
+  }
+
+  if (jsdev_number != -1 && jsdev_number != m_jsdev_number)
+  {
+    m_jsdev_number = jsdev_number;
+
+    if (m_opts.get_controller_slot().get_led_status() == -1)
+    {
+      m_controller->set_led(2 + m_jsdev_number % 4);
+    }
+  }
+}
+
 void
 XboxdrvMain::on_controller_disconnect()
 {
   shutdown();
 }
 
+void
+XboxdrvMain::run_passthrough()
+{
+  if (m_opts.evdev_device.empty())
+  {
+    raise_exception(std::runtime_error, "--evdev-passthrough requires --evdev DEVICE");
+  }
+
+  EvdevPassthrough passthrough(m_opts.evdev_device,
+                               m_opts.evdev_remap,
+                               m_opts.evdev_grab,
+                               m_opts.evdev_debug,
+                               m_opts.timeout);
+  passthrough.set_disconnect_cb(boost::bind(&XboxdrvMain::shutdown, this));
+
+  if (!m_opts.quiet)
+  {
+    std::cout << "Forwarding '" << passthrough.get_name() << "' in passthrough mode" << std::endl;
+    std::cout << "\nPress Ctrl-C to quit" << std::endl;
+  }
+
+  if (!m_opts.instant_exit)
+  {
+    g_main_loop_run(m_gmain);
+  }
+
+  if (!m_opts.quiet)
+  {
+    std::cout << "Shutdown complete" << std::endl;
+  }
+}
+
 void
 XboxdrvMain::run()
 {
-  m_controller = create_controller();
+  if (m_opts.evdev_passthrough)
+  {
+    run_passthrough();
+    return;
+  }
+
+  m_controller = create_merged_controller();
   m_controller->set_disconnect_cb(boost::bind(&XboxdrvMain::on_controller_disconnect, this));
   std::auto_ptr<MessageProcessor> message_proc;
+  ControllerSlotConfigPtr config_set;
   init_controller(m_controller);
 
   if (m_opts.instant_exit)
@@ -166,19 +271,21 @@ XboxdrvMain::run()
     else
     {
       log_debug("creating UInput");
-      m_uinput.reset(new UInput(m_opts.extra_events));
+      m_uinput.reset(new UInput(m_opts.extra_events, m_opts.output_rate));
       m_uinput->set_device_names(m_opts.uinput_device_names);
       m_uinput->set_device_usbids(m_opts.uinput_device_usbids);
 
       log_debug("creating ControllerSlotConfig");
-      ControllerSlotConfigPtr config_set = ControllerSlotConfig::create(*m_uinput,
-                                                                        0, m_opts.extra_devices,
-                                                                        m_opts.get_controller_slot());
+      config_set = ControllerSlotConfig::create(*m_uinput,
+                                                0, m_opts.extra_devices,
+                                                m_opts.get_controller_slot());
+      CalibrationStore(m_opts.calibration_dir).load(CalibrationStore::device_key(*m_controller), *config_set);
 
       // After all the ControllerConfig registered their events, finish up
       // the device creation
       log_debug("finish UInput creation");
       m_uinput->finish();
+      update_device_numbers();
 
       message_proc.reset(new UInputMessageProcessor(*m_uinput, config_set, m_opts));
     }
@@ -203,15 +310,33 @@ XboxdrvMain::run()
       ControllerThread thread(m_controller, message_proc, m_opts);
       log_debug("launching thread");
 
-      pid_t pid = 0;
+      bool exec_failed = false;
       if (!m_opts.exec.empty())
       {
-        pid = spawn_exe(m_opts.exec);
-        g_child_watch_add(pid, &XboxdrvMain::on_child_watch_wrap, this);
+        try
+        {
+          pid_t pid = spawn_exe(m_opts.exec);
+          g_child_watch_add(pid, &XboxdrvMain::on_child_watch_wrap, this);
+        }
+        catch(const std::exception& err)
+        {
+          // handled like a child that exited right away, xboxdrv
+          // shuts down cleanly instead of dying on the exception
+          log_error(err.what());
+          exec_failed = true;
+        }
       }
 
-      log_debug("launching main loop");
-      g_main_loop_run(m_gmain);
+      if (!exec_failed)
+      {
+        log_debug("launching main loop");
+        g_main_loop_run(m_gmain);
+      }
+
+      if (config_set)
+      {
+        CalibrationStore(m_opts.calibration_dir).save(CalibrationStore::device_key(*m_controller), *config_set);
+      }
 
       m_controller.reset();
     }
@@ -258,7 +383,7 @@ XboxdrvMain::shutdown()
 {
   log_info("shutdown requested");
 
-  if (!m_controller->is_disconnected())
+  if (m_controller && !m_controller->is_disconnected())
   {
     m_controller->set_led(0);
 
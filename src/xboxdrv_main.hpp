@@ -65,8 +65,19 @@ public:
 private:
   ControllerPtr create_controller();
 
+  /** the main controller, combined with the --merge-evdev devices */
+  ControllerPtr create_merged_controller();
+
+  /** forward the evdev device to uinput without going through the
+      Xbox360 controller model */
+  void run_passthrough();
+
   void init_controller(const ControllerPtr& controller);
 
+  /** replace the guessed device numbers with the ones of the created
+      devices */
+  void update_device_numbers();
+
   void print_info(libusb_device* dev,
                   const XPadDevice& dev_type,
                   const Options& opts) const;
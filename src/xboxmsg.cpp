@@ -476,7 +476,201 @@ void set_button(XboxGenericMsg& msg, XboxButton button, bool v)
       break;
   }
 }
-
+
+namespace {
+
+inline uint32_t move_bit(uint32_t word, int from, int to)
+{
+  return ((word >> from) & 1u) << to;
+}
+
+inline uint32_t button_bit(XboxButton button)
+{
+  return 1u << button;
+}
+
+/** the two button bytes at data[2] of a Xbox360Msg, XboxMsg and
+    Playstation3USBMsg, bit n of the word is bit n%8 of byte 2+n/8 */
+template<class Msg>
+uint32_t get_button_word(const Msg& msg)
+{
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(&msg);
+  return data[2] | (data[3] << 8);
+}
+
+template<class Msg>
+void set_button_word(Msg& msg, uint32_t word, uint32_t mask)
+{
+  uint8_t* data = reinterpret_cast<uint8_t*>(&msg);
+  word = ((data[2] | (data[3] << 8)) & ~mask) | (word & mask);
+  data[2] = static_cast<uint8_t>(word);
+  data[3] = static_cast<uint8_t>(word >> 8);
+}
+
+// The Xbox360 and Xbox button words keep most buttons in the same
+// order as XboxButton, so they are moved in groups:
+//
+//   bit  0-3:  dpad up, down, left, right -> XBOX_DPAD_UP..XBOX_DPAD_RIGHT
+//   bit  4:    start                      -> XBOX_BTN_START
+//   bit  5:    back                       -> XBOX_BTN_BACK
+//   bit  6-7:  thumb_l, thumb_r           -> XBOX_BTN_THUMB_L..XBOX_BTN_THUMB_R
+//   bit  8-9:  lb, rb                     -> XBOX_BTN_LB..XBOX_BTN_RB (Xbox360 only)
+//   bit 10:    guide                      -> XBOX_BTN_GUIDE (Xbox360 only)
+//   bit 12-15: a, b, x, y                 -> XBOX_BTN_A..XBOX_BTN_Y (Xbox360 only)
+
+uint32_t xbox360_word_to_buttons(uint32_t word)
+{
+  return
+    ((word & 0x000fu) << XBOX_DPAD_UP) |
+    move_bit(word, 4, XBOX_BTN_START) |
+    move_bit(word, 5, XBOX_BTN_BACK) |
+    (((word >> 6) & 0x3u) << XBOX_BTN_THUMB_L) |
+    (((word >> 8) & 0x3u) << XBOX_BTN_LB) |
+    move_bit(word, 10, XBOX_BTN_GUIDE) |
+    (((word >> 12) & 0xfu) << XBOX_BTN_A);
+}
+
+uint32_t xbox360_buttons_to_word(uint32_t buttons)
+{
+  return
+    ((buttons >> XBOX_DPAD_UP) & 0x000fu) |
+    move_bit(buttons, XBOX_BTN_START, 4) |
+    move_bit(buttons, XBOX_BTN_BACK, 5) |
+    (((buttons >> XBOX_BTN_THUMB_L) & 0x3u) << 6) |
+    (((buttons >> XBOX_BTN_LB) & 0x3u) << 8) |
+    move_bit(buttons, XBOX_BTN_GUIDE, 10) |
+    (((buttons >> XBOX_BTN_A) & 0xfu) << 12);
+}
+
+uint32_t ps3usb_word_to_buttons(uint32_t word)
+{
+  return
+    move_bit(word,  0, XBOX_BTN_BACK) |
+    move_bit(word,  1, XBOX_BTN_THUMB_L) |
+    move_bit(word,  2, XBOX_BTN_THUMB_R) |
+    move_bit(word,  3, XBOX_BTN_START) |
+    move_bit(word,  4, XBOX_DPAD_UP) |
+    move_bit(word,  5, XBOX_DPAD_RIGHT) |
+    move_bit(word,  6, XBOX_DPAD_DOWN) |
+    move_bit(word,  7, XBOX_DPAD_LEFT) |
+    move_bit(word,  8, XBOX_BTN_LT) |
+    move_bit(word,  9, XBOX_BTN_RT) |
+    move_bit(word, 10, XBOX_BTN_LB) |
+    move_bit(word, 11, XBOX_BTN_RB) |
+    move_bit(word, 12, XBOX_BTN_Y) |
+    move_bit(word, 13, XBOX_BTN_B) |
+    move_bit(word, 14, XBOX_BTN_A) |
+    move_bit(word, 15, XBOX_BTN_X);
+}
+
+uint32_t ps3usb_buttons_to_word(uint32_t buttons)
+{
+  return
+    move_bit(buttons, XBOX_BTN_BACK,     0) |
+    move_bit(buttons, XBOX_BTN_THUMB_L,  1) |
+    move_bit(buttons, XBOX_BTN_THUMB_R,  2) |
+    move_bit(buttons, XBOX_BTN_START,    3) |
+    move_bit(buttons, XBOX_DPAD_UP,      4) |
+    move_bit(buttons, XBOX_DPAD_RIGHT,   5) |
+    move_bit(buttons, XBOX_DPAD_DOWN,    6) |
+    move_bit(buttons, XBOX_DPAD_LEFT,    7) |
+    move_bit(buttons, XBOX_BTN_LT,       8) |
+    move_bit(buttons, XBOX_BTN_RT,       9) |
+    move_bit(buttons, XBOX_BTN_LB,      10) |
+    move_bit(buttons, XBOX_BTN_RB,      11) |
+    move_bit(buttons, XBOX_BTN_Y,       12) |
+    move_bit(buttons, XBOX_BTN_B,       13) |
+    move_bit(buttons, XBOX_BTN_A,       14) |
+    move_bit(buttons, XBOX_BTN_X,       15);
+}
+
+/** the analog Xbox buttons, a set bit in \a mask assigns its bit in
+    \a buttons to \a byte */
+inline void set_byte_button(uint8_t& byte, XboxButton button, uint32_t buttons, uint32_t mask)
+{
+  if (mask & button_bit(button))
+  {
+    byte = (buttons & button_bit(button)) ? 1 : 0;
+  }
+}
+
+} // namespace
+
+uint32_t get_buttons(XboxGenericMsg& msg)
+{
+  switch(msg.type)
+  {
+    case XBOX_MSG_XBOX360:
+      return
+        xbox360_word_to_buttons(get_button_word(msg.xbox360)) |
+        (msg.xbox360.lt ? button_bit(XBOX_BTN_LT) : 0) |
+        (msg.xbox360.rt ? button_bit(XBOX_BTN_RT) : 0);
+
+    case XBOX_MSG_XBOX:
+      // only the low byte are bits, the rest of the buttons are analog
+      return
+        xbox360_word_to_buttons(get_button_word(msg.xbox) & 0x00ffu) |
+        (msg.xbox.a     ? button_bit(XBOX_BTN_A)  : 0) |
+        (msg.xbox.b     ? button_bit(XBOX_BTN_B)  : 0) |
+        (msg.xbox.x     ? button_bit(XBOX_BTN_X)  : 0) |
+        (msg.xbox.y     ? button_bit(XBOX_BTN_Y)  : 0) |
+        (msg.xbox.white ? button_bit(XBOX_BTN_LB) : 0) |
+        (msg.xbox.black ? button_bit(XBOX_BTN_RB) : 0) |
+        (msg.xbox.lt    ? button_bit(XBOX_BTN_LT) : 0) |
+        (msg.xbox.rt    ? button_bit(XBOX_BTN_RT) : 0);
+
+    case XBOX_MSG_PS3USB:
+      return
+        ps3usb_word_to_buttons(get_button_word(msg.ps3usb)) |
+        (msg.ps3usb.playstation ? button_bit(XBOX_BTN_GUIDE) : 0);
+  }
+
+  return 0;
+}
+
+void set_buttons(XboxGenericMsg& msg, uint32_t buttons, uint32_t mask)
+{
+  switch(msg.type)
+  {
+    case XBOX_MSG_XBOX360:
+      set_button_word(msg.xbox360, xbox360_buttons_to_word(buttons), xbox360_buttons_to_word(mask));
+      if (mask & button_bit(XBOX_BTN_LT))
+      {
+        msg.xbox360.lt = (buttons & button_bit(XBOX_BTN_LT)) ? 255 : 0;
+      }
+      if (mask & button_bit(XBOX_BTN_RT))
+      {
+        msg.xbox360.rt = (buttons & button_bit(XBOX_BTN_RT)) ? 255 : 0;
+      }
+      break;
+
+    case XBOX_MSG_XBOX:
+      set_button_word(msg.xbox, xbox360_buttons_to_word(buttons), xbox360_buttons_to_word(mask) & 0x00ffu);
+      {
+        // the analog buttons are whole bytes at data[4], written as
+        // set_button() does
+        uint8_t* data = reinterpret_cast<uint8_t*>(&msg.xbox);
+        set_byte_button(data[4],  XBOX_BTN_A,  buttons, mask);
+        set_byte_button(data[5],  XBOX_BTN_B,  buttons, mask);
+        set_byte_button(data[6],  XBOX_BTN_X,  buttons, mask);
+        set_byte_button(data[7],  XBOX_BTN_Y,  buttons, mask);
+        set_byte_button(data[8],  XBOX_BTN_RB, buttons, mask); // black
+        set_byte_button(data[9],  XBOX_BTN_LB, buttons, mask); // white
+        set_byte_button(data[10], XBOX_BTN_LT, buttons, mask);
+        set_byte_button(data[11], XBOX_BTN_RT, buttons, mask);
+      }
+      break;
+
+    case XBOX_MSG_PS3USB:
+      set_button_word(msg.ps3usb, ps3usb_buttons_to_word(buttons), ps3usb_buttons_to_word(mask));
+      if (mask & button_bit(XBOX_BTN_GUIDE))
+      {
+        msg.ps3usb.playstation = (buttons & button_bit(XBOX_BTN_GUIDE)) ? 1 : 0;
+      }
+      break;
+  }
+}
+
 int get_axis(XboxGenericMsg& msg, XboxAxis axis)
 {
   switch(msg.type)
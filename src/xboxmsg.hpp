@@ -20,6 +20,7 @@
 #define HEADER_XBOXMSG_HPP
 
 #include <iosfwd>
+#include <stdint.h>
 
 enum GamepadType {
   GAMEPAD_UNKNOWN,
@@ -219,6 +220,12 @@ struct XboxGenericMsg
     struct XboxMsg    xbox;
     struct Playstation3USBMsg ps3usb;
   };
+
+  /** sequence number and processing time in nsec of the USB transfer
+      the message was parsed from, filled in by USBController, not
+      part of the controller state */
+  uint32_t seq;
+  int64_t  time;
 };
 
 std::ostream& operator<<(std::ostream& out, const GamepadType& type);
@@ -285,6 +292,12 @@ enum XboxAxis {
 
 int  get_button(XboxGenericMsg& msg, XboxButton button);
 void set_button(XboxGenericMsg& msg, XboxButton button, bool v);
+
+/** all buttons as one word, bit n is the XboxButton n */
+uint32_t get_buttons(XboxGenericMsg& msg);
+
+/** set the buttons that are in \a mask to their bit in \a buttons */
+void set_buttons(XboxGenericMsg& msg, uint32_t buttons, uint32_t mask);
 int  get_axis(XboxGenericMsg& msg, XboxAxis axis);
 void set_axis(XboxGenericMsg& msg, XboxAxis axis, int v);
 float get_axis_float(XboxGenericMsg& msg, XboxAxis axis);
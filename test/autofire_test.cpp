@@ -0,0 +1,66 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <iostream>
+
+#include "buttonfilter/autofire_button_filter.hpp"
+#include "clock.hpp"
+
+// Run an autofire filter off a manual clock, with 10msec between
+// shots 10 seconds should give 1000 shots, independent of how the time
+// is sliced into frames.
+int main(int argc, char** argv)
+{
+  ManualClock clock;
+  Clock::set(&clock);
+
+  const int64_t frame_lengths[] = { 1000000, 999999, 1000001, 333333 };
+  for(int i = 0; i < 4; ++i)
+  {
+    AutofireButtonFilter autofire(10, 0);
+
+    int64_t start = Clock::now();
+    int64_t last  = start;
+    bool old_state = false;
+    int shots = 0;
+    while(Clock::now() - start < msec2nsec(10000))
+    {
+      clock.advance(frame_lengths[i]);
+
+      int64_t now = Clock::now();
+      autofire.update(now - last);
+      last = now;
+
+      bool state = autofire.filter(true);
+      if (state && !old_state)
+      {
+        shots += 1;
+      }
+      old_state = state;
+    }
+
+    std::cout << "frame: " << frame_lengths[i] << "nsec  shots: " << shots << std::endl;
+  }
+
+  Clock::set(NULL);
+
+  return 0;
+}
+
+/* EOF */
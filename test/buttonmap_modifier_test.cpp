@@ -0,0 +1,126 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+
+#include "modifier/buttonmap_modifier.hpp"
+
+namespace {
+
+const char* const kMappings[][2] = {
+  { "A", "B" },
+  { "B", "A" },
+  { "X^invert", "Y" },
+  { "Y^invert^invert", "X" },
+  { "LB", "A" },
+  { "RB^const:1", "RB" },
+  { "BACK^const:0^invert", "START" },
+  { "START^toggle", "GUIDE" },
+  { "DU^autofire:30", "DD" },
+  { "DL^invert^toggle", "DR" },
+  { "LT", "RT" }
+};
+
+const int kMappingCount = sizeof(kMappings) / sizeof(kMappings[0]);
+
+/** the loop over the mappings as ButtonmapModifier did it before the
+    mappings were compiled */
+void reference_update(std::vector<ButtonMapping>& buttonmap, int64_t nsec_delta, XboxGenericMsg& msg)
+{
+  XboxGenericMsg newmsg = msg;
+
+  for(std::vector<ButtonMapping>::iterator i = buttonmap.begin(); i != buttonmap.end(); ++i)
+  {
+    for(std::vector<ButtonFilterPtr>::iterator j = i->filters.begin(); j != i->filters.end(); ++j)
+    {
+      (*j)->update(nsec_delta);
+    }
+  }
+
+  for(std::vector<ButtonMapping>::iterator i = buttonmap.begin(); i != buttonmap.end(); ++i)
+  {
+    set_button(newmsg, i->lhs, 0);
+  }
+
+  for(std::vector<ButtonMapping>::iterator i = buttonmap.begin(); i != buttonmap.end(); ++i)
+  {
+    bool value = get_button(msg, i->lhs);
+    for(std::vector<ButtonFilterPtr>::iterator j = i->filters.begin(); j != i->filters.end(); ++j)
+    {
+      value = (*j)->filter(value);
+    }
+    set_button(newmsg, i->rhs, value || get_button(newmsg, i->rhs));
+  }
+
+  msg = newmsg;
+}
+
+} // namespace
+
+// Feed random button states through the compiled ButtonmapModifier
+// and the old per mapping loop, both have to agree on every frame
+int main(int argc, char** argv)
+{
+  ButtonmapModifier modifier;
+  std::vector<ButtonMapping> reference;
+  for(int i = 0; i < kMappingCount; ++i)
+  {
+    modifier.add(ButtonMapping::from_string(kMappings[i][0], kMappings[i][1]));
+    reference.push_back(ButtonMapping::from_string(kMappings[i][0], kMappings[i][1]));
+  }
+
+  std::cout << modifier.str();
+
+  srand(1234);
+  int errors = 0;
+  const int kFrames = 100000;
+  for(int frame = 0; frame < kFrames; ++frame)
+  {
+    XboxGenericMsg msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.type = XBOX_MSG_XBOX360;
+    set_buttons(msg, static_cast<uint32_t>(rand()), 0xffffffffu);
+    msg.xbox360.lt = static_cast<uint8_t>(rand() % 3 == 0 ? rand() : 0);
+    msg.xbox360.rt = static_cast<uint8_t>(rand() % 3 == 0 ? rand() : 0);
+
+    XboxGenericMsg expected = msg;
+    const int64_t nsec_delta = 1000000 + rand() % 10000000;
+
+    modifier.update(nsec_delta, msg);
+    reference_update(reference, nsec_delta, expected);
+
+    if (memcmp(&msg.xbox360, &expected.xbox360, sizeof(msg.xbox360)) != 0)
+    {
+      if (errors < 10)
+      {
+        std::cout << "frame " << frame << ": " << std::hex
+                  << get_buttons(msg) << " != " << get_buttons(expected) << std::dec << std::endl;
+      }
+      errors += 1;
+    }
+  }
+
+  std::cout << "frames: " << kFrames << " errors: " << errors << std::endl;
+
+  return errors != 0;
+}
+
+/* EOF */
@@ -0,0 +1,160 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <iostream>
+#include <stdlib.h>
+
+#include "axisfilter/calibration_axis_filter.hpp"
+#include "helper.hpp"
+
+namespace {
+
+/** the division CalibrationAxisFilter used to do per sample */
+int reference(int value, int cal_min, int cal_center, int cal_max, int min, int max)
+{
+  if (value < cal_center)
+    value = -min * (value - cal_center) / (cal_center - cal_min);
+  else if (value > cal_center)
+    value = max * (value - cal_center) / (cal_max - cal_center);
+  else
+    value = 0;
+
+  return Math::clamp(min, value, max);
+}
+
+} // namespace
+
+// A fixed calibration has to match the old per sample division, a
+// learning one has to find the range and resting position of a worn
+// stick and of a trigger, which rests at its minimum.
+int main(int argc, char** argv)
+{
+  int errors = 0;
+
+  {
+    CalibrationAxisFilter filter(-30000, 1200, 28000);
+    for(int value = -32768; value <= 32767; value += 7)
+    {
+      int lhs = filter.filter(value, -32768, 32767);
+      int rhs = reference(value, -30000, 1200, 28000, -32768, 32767);
+      if (abs(lhs - rhs) > 1)
+      {
+        std::cout << "error: " << value << ": " << lhs << " != " << rhs << std::endl;
+        errors += 1;
+      }
+    }
+  }
+
+  {
+    // worn stick, rests at 900 and only reaches -27000 and 25000
+    CalibrationAxisFilter filter;
+
+    for(int i = 0; i < 1000; ++i)
+    {
+      filter.filter(900 + (i % 5) - 2, -32768, 32767);
+    }
+
+    for(int value = -27000; value <= 25000; value += 100)
+    {
+      filter.filter(value, -32768, 32767);
+    }
+
+    for(int i = 0; i < 1000; ++i)
+    {
+      filter.filter(900 + (i % 5) - 2, -32768, 32767);
+    }
+
+    std::cout << "learned: " << filter.get_min() << ":" << filter.get_center() << ":" << filter.get_max() << std::endl;
+
+    if (filter.get_min() != -27000 || filter.get_max() != 25000 || abs(filter.get_center() - 900) > 2)
+    {
+      std::cout << "error: wrong calibration learned" << std::endl;
+      errors += 1;
+    }
+
+    if (filter.filter(-27000, -32768, 32767) != -32768 ||
+        filter.filter(25000, -32768, 32767) != 32767 ||
+        abs(filter.filter(900, -32768, 32767)) > 4)
+    {
+      std::cout << "error: learned calibration not applied" << std::endl;
+      errors += 1;
+    }
+
+    // a profile loaded from disk replaces what was learned so far
+    filter.set_calibration(-20000, 0, 20000);
+    if (filter.filter(-20000, -32768, 32767) != -32768 ||
+        filter.filter(20000, -32768, 32767) != 32767)
+    {
+      std::cout << "error: set_calibration() not applied" << std::endl;
+      errors += 1;
+    }
+  }
+
+  {
+    // trigger, rests at its minimum and uses the whole travel
+    CalibrationAxisFilter filter;
+
+    for(int i = 0; i < 1000; ++i)
+    {
+      filter.filter(0, 0, 255);
+    }
+
+    for(int value = 0; value <= 255; ++value)
+    {
+      filter.filter(value, 0, 255);
+    }
+
+    for(int i = 0; i < 1000; ++i)
+    {
+      filter.filter(0, 0, 255);
+    }
+
+    std::cout << "learned trigger: " << filter.get_min() << ":" << filter.get_center() << ":" << filter.get_max() << std::endl;
+
+    if (filter.get_min() != 0 || filter.get_center() != 0 || filter.get_max() != 255)
+    {
+      std::cout << "error: wrong trigger calibration learned" << std::endl;
+      errors += 1;
+    }
+
+    for(int value = 0; value <= 255; ++value)
+    {
+      if (filter.filter(value, 0, 255) != value)
+      {
+        std::cout << "error: trigger " << value << ": " << filter.filter(value, 0, 255) << std::endl;
+        errors += 1;
+        break;
+      }
+    }
+
+    // a trigger profile has the center at the minimum
+    filter.set_calibration(0, 0, 200);
+    if (filter.filter(0, 0, 255) != 0 ||
+        abs(filter.filter(100, 0, 255) - 128) > 1 ||
+        filter.filter(200, 0, 255) != 255)
+    {
+      std::cout << "error: trigger set_calibration() not applied" << std::endl;
+      errors += 1;
+    }
+  }
+
+  return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* EOF */
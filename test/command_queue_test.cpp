@@ -0,0 +1,89 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <boost/bind.hpp>
+#include <glib.h>
+#include <iostream>
+
+#include "command_queue.hpp"
+
+namespace {
+
+const int kTotal = 100000;
+
+struct Context
+{
+  CommandQueue* queue;
+  int received;
+  int errors;
+};
+
+void receive(Context* context, int value)
+{
+  if (value != context->received)
+  {
+    context->errors += 1;
+  }
+  context->received += 1;
+}
+
+gpointer producer(gpointer userdata)
+{
+  Context& context = *static_cast<Context*>(userdata);
+
+  for(int i = 0; i < kTotal; ++i)
+  {
+    while (!context.queue->push(boost::bind(&receive, &context, i)))
+    {
+      g_thread_yield();
+    }
+  }
+
+  return 0;
+}
+
+} // namespace
+
+// Push commands through a small queue from a second thread, every
+// command has to run exactly once and in order. The queue is drained
+// by hand, the main loop isn't needed for that.
+int main(int argc, char** argv)
+{
+  CommandQueue queue(NULL, 16);
+  Context context = { &queue, 0, 0 };
+
+  GThread* thread = g_thread_new("producer", &producer, &context);
+
+  while (context.received < kTotal)
+  {
+    if (queue.process() == 0)
+    {
+      g_thread_yield();
+    }
+  }
+
+  g_thread_join(thread);
+
+  std::cout << "received: " << context.received << " errors: " << context.errors
+            << " left: " << queue.process() << std::endl;
+
+  return context.errors != 0;
+}
+
+/* EOF */
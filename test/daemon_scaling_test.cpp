@@ -0,0 +1,357 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+#include <errno.h>
+#include <glib.h>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "clock.hpp"
+#include "controller.hpp"
+#include "controller_slot.hpp"
+#include "options.hpp"
+#include "uinput.hpp"
+#include "xboxmsg.hpp"
+
+namespace {
+
+struct Stats
+{
+  Stats() : latencies(), reports(0), overruns(0), recording(false) {}
+
+  std::vector<int64_t> latencies;
+  int64_t reports;
+  int64_t overruns;
+  bool recording;
+};
+
+/** Stands in for a USB controller: a timerfd fires at the report
+    rate, like the transfer completions of a real device, and every
+    expiration submits one report. The latency of a report is taken
+    from the moment it was due until the pipeline, including the
+    uinput write, returns. */
+class FakeController : public Controller
+{
+private:
+  Stats& m_stats;
+  int m_timer_fd;
+  GIOChannel* m_io_channel;
+  guint m_source_id;
+  int64_t m_interval;
+  int64_t m_deadline;
+  int m_seq;
+
+public:
+  FakeController(Stats& stats, int64_t first_deadline, int64_t interval) :
+    m_stats(stats),
+    m_timer_fd(-1),
+    m_io_channel(),
+    m_source_id(),
+    m_interval(interval),
+    m_deadline(first_deadline),
+    m_seq(0)
+  {
+    m_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (m_timer_fd < 0)
+    {
+      throw std::runtime_error(std::string("timerfd_create() failed: ") + strerror(errno));
+    }
+
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.it_value.tv_sec  = first_deadline / 1000000000;
+    spec.it_value.tv_nsec = first_deadline % 1000000000;
+    spec.it_interval.tv_sec  = interval / 1000000000;
+    spec.it_interval.tv_nsec = interval % 1000000000;
+    timerfd_settime(m_timer_fd, TFD_TIMER_ABSTIME, &spec, NULL);
+
+    m_io_channel = g_io_channel_unix_new(m_timer_fd);
+    g_io_channel_set_encoding(m_io_channel, NULL, NULL);
+    g_io_channel_set_buffered(m_io_channel, false);
+    m_source_id = g_io_add_watch(m_io_channel, G_IO_IN, &FakeController::on_timer_wrap, this);
+  }
+
+  ~FakeController()
+  {
+    g_source_remove(m_source_id);
+    g_io_channel_unref(m_io_channel);
+    close(m_timer_fd);
+  }
+
+  void set_rumble_real(uint8_t left, uint8_t right) {}
+  void set_led_real(uint8_t status) {}
+
+private:
+  gboolean on_timer()
+  {
+    uint64_t expirations;
+    if (read(m_timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+    {
+      return TRUE;
+    }
+
+    // only the newest report is sent, the ones before it are lost
+    // like a late USB transfer would lose them
+    const int64_t due = m_deadline + static_cast<int64_t>(expirations - 1) * m_interval;
+    m_deadline += static_cast<int64_t>(expirations) * m_interval;
+
+    XboxGenericMsg msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.type = XBOX_MSG_XBOX360;
+    m_seq += 1;
+    msg.xbox360.x1 = static_cast<int16_t>((m_seq * 257) & 0x7fff);
+    msg.xbox360.lt = static_cast<uint8_t>(m_seq);
+    msg.xbox360.a  = m_seq & 1;
+    submit_msg(msg);
+
+    if (m_stats.recording)
+    {
+      m_stats.latencies.push_back(Clock::now() - due);
+      m_stats.reports  += 1;
+      m_stats.overruns += static_cast<int64_t>(expirations - 1);
+    }
+
+    return TRUE;
+  }
+
+  static gboolean on_timer_wrap(GIOChannel* source, GIOCondition condition, gpointer userdata)
+  {
+    return static_cast<FakeController*>(userdata)->on_timer();
+  }
+
+private:
+  FakeController(const FakeController&);
+  FakeController& operator=(const FakeController&);
+};
+
+int64_t cpu_time()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return (static_cast<int64_t>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 +
+          usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000;
+}
+
+double percentile(const std::vector<int64_t>& sorted, double p)
+{
+  if (sorted.empty())
+  {
+    return 0.0;
+  }
+  else
+  {
+    std::vector<int64_t>::size_type idx = static_cast<std::vector<int64_t>::size_type>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return static_cast<double>(sorted[idx]) / 1000.0;
+  }
+}
+
+/** iterate the main loop until \a end, returns the number of wakeups */
+int64_t run_until(int64_t end)
+{
+  int64_t wakeups = 0;
+  while (Clock::now() < end)
+  {
+    g_main_context_iteration(NULL, TRUE);
+    wakeups += 1;
+  }
+  return wakeups;
+}
+
+/** Sets up \a num_slots daemon slots the way XboxdrvDaemon does,
+    connects a fake controller to each and drives them for \a seconds,
+    returns the result as JSON object */
+std::string run_benchmark(int num_slots, int rate, int seconds, bool use_uinput)
+{
+  Options opts;
+  for(int i = 1; i < num_slots; ++i)
+  {
+    opts.next_controller();
+  }
+
+  std::auto_ptr<UInput> uinput;
+  if (use_uinput)
+  {
+    uinput.reset(new UInput(opts.extra_events, opts.output_rate));
+  }
+
+  std::vector<ControllerSlotPtr> slots;
+  for(Options::ControllerSlots::const_iterator i = opts.controller_slots.begin();
+      i != opts.controller_slots.end(); ++i)
+  {
+    ControllerSlotConfigPtr config = uinput.get()
+      ? ControllerSlotConfig::create(*uinput, static_cast<int>(slots.size()), opts.extra_devices, i->second)
+      : ControllerSlotConfigPtr(new ControllerSlotConfig);
+
+    slots.push_back(ControllerSlotPtr(new ControllerSlot(static_cast<int>(slots.size()), config,
+                                                         i->second.get_match_rules(),
+                                                         i->second.get_led_status(),
+                                                         opts, uinput.get())));
+  }
+
+  if (uinput.get())
+  {
+    uinput->finish();
+  }
+
+  Stats stats;
+  stats.latencies.reserve(static_cast<std::vector<int64_t>::size_type>(num_slots) * rate * seconds * 2);
+
+  // controllers are spread evenly over the report interval, real
+  // devices don't report in lockstep either
+  const int64_t interval = 1000000000 / rate;
+  const int64_t start = Clock::now() + msec2nsec(10);
+  for(int i = 0; i < num_slots; ++i)
+  {
+    slots[i]->connect(ControllerPtr(new FakeController(stats, start + interval * i / num_slots, interval)));
+  }
+
+  // warm up, so that page faults and cache misses of the first
+  // reports don't end up in the numbers
+  run_until(Clock::now() + msec2nsec(250));
+
+  stats.recording = true;
+  const int64_t cpu_start = cpu_time();
+  const int64_t bench_start = Clock::now();
+  const int64_t wakeups = run_until(bench_start + msec2nsec(seconds * 1000));
+  const int64_t duration = Clock::now() - bench_start;
+  const int64_t cpu = cpu_time() - cpu_start;
+  stats.recording = false;
+
+  for(std::vector<ControllerSlotPtr>::iterator i = slots.begin(); i != slots.end(); ++i)
+  {
+    (*i)->disconnect();
+  }
+  slots.clear();
+  uinput.reset();
+
+  std::sort(stats.latencies.begin(), stats.latencies.end());
+
+  const double reports = static_cast<double>(std::max(static_cast<int64_t>(1), stats.reports));
+  const double secs = static_cast<double>(duration) / 1.0e9;
+
+  std::ostringstream out;
+  out << "{ \"slots\": " << num_slots
+      << ", \"reports\": " << stats.reports
+      << ", \"overruns\": " << stats.overruns
+      << ", \"reports_per_sec\": " << static_cast<double>(stats.reports) / secs
+      << ", \"cpu_percent\": " << 100.0 * static_cast<double>(cpu) / static_cast<double>(duration)
+      << ", \"cpu_usec_per_report\": " << static_cast<double>(cpu) / 1000.0 / reports
+      << ", \"wakeups_per_sec\": " << static_cast<double>(wakeups) / secs
+      << ", \"wakeups_per_report\": " << static_cast<double>(wakeups) / reports
+      << ", \"latency_usec\": { "
+      << "\"p50\": "   << percentile(stats.latencies, 0.50) << ", "
+      << "\"p90\": "   << percentile(stats.latencies, 0.90) << ", "
+      << "\"p99\": "   << percentile(stats.latencies, 0.99) << ", "
+      << "\"p99.9\": " << percentile(stats.latencies, 0.999) << ", "
+      << "\"max\": "   << percentile(stats.latencies, 1.0) << " } }";
+  return out.str();
+}
+
+std::vector<int> parse_list(const std::string& str)
+{
+  std::vector<int> lst;
+  std::istringstream in(str);
+  std::string item;
+  while (std::getline(in, item, ','))
+  {
+    lst.push_back(atoi(item.c_str()));
+  }
+  return lst;
+}
+
+} // namespace
+
+// Measures how the daemon scales with the number of occupied slots,
+// every slot gets a fake controller reporting at --rate Hz that runs
+// through the regular ControllerSlot/ControllerThread pipeline. The
+// results are written to stdout as JSON:
+//
+//   daemon_scaling_test [--slots 1,2,4,...] [--rate HZ] [--seconds N] [--no-uinput]
+//
+// --no-uinput leaves out the uinput devices, so the benchmark runs
+// without access to /dev/uinput, it then only measures the dispatch.
+int main(int argc, char** argv)
+{
+  std::vector<int> slot_counts = parse_list("1,2,4,8,16,32,64");
+  int rate = 250;
+  int seconds = 2;
+  bool use_uinput = true;
+
+  for(int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    if (arg == "--no-uinput")
+    {
+      use_uinput = false;
+    }
+    else if (i + 1 < argc && arg == "--slots")
+    {
+      slot_counts = parse_list(argv[++i]);
+    }
+    else if (i + 1 < argc && arg == "--rate")
+    {
+      rate = atoi(argv[++i]);
+    }
+    else if (i + 1 < argc && arg == "--seconds")
+    {
+      seconds = atoi(argv[++i]);
+    }
+    else
+    {
+      std::cerr << "usage: " << argv[0] << " [--slots 1,2,4,...] [--rate HZ] [--seconds N] [--no-uinput]" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (rate <= 0 || seconds <= 0)
+  {
+    std::cerr << "rate and seconds must be positive" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  try
+  {
+    std::cout << "{ \"rate\": " << rate
+              << ", \"seconds\": " << seconds
+              << ", \"uinput\": " << (use_uinput ? "true" : "false")
+              << ", \"results\": [\n";
+    for(std::vector<int>::size_type i = 0; i < slot_counts.size(); ++i)
+    {
+      std::cout << "  " << run_benchmark(slot_counts[i], rate, seconds, use_uinput)
+                << (i + 1 < slot_counts.size() ? ",\n" : "\n") << std::flush;
+    }
+    std::cout << "] }" << std::endl;
+  }
+  catch(const std::exception& err)
+  {
+    std::cerr << "error: " << err.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return 0;
+}
+
+/* EOF */
@@ -0,0 +1,228 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <boost/bind.hpp>
+#include <iostream>
+#include <string.h>
+#include <vector>
+
+#include "evdev_helper.hpp"
+#include "evdev_mapper.hpp"
+#include "clock.hpp"
+
+namespace {
+
+typedef std::vector<struct input_event> Frame;
+
+struct FrameLog
+{
+  FrameLog() : frames() {}
+
+  void on_frame(const struct input_event* events, int count)
+  {
+    frames.push_back(Frame(events, events + count));
+  }
+
+  /** value of \a type/\a code in the last frame, -1 if it isn't in there */
+  int last_value(int type, int code) const
+  {
+    int value = -1;
+    if (!frames.empty())
+    {
+      const Frame& frame = frames.back();
+      for(Frame::const_iterator ev = frame.begin(); ev != frame.end(); ++ev)
+      {
+        if (ev->type == type && ev->code == code)
+        {
+          value = ev->value;
+        }
+      }
+    }
+    return value;
+  }
+
+  std::vector<Frame> frames;
+};
+
+struct input_event make_event(int type, int code, int value)
+{
+  struct input_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.type  = static_cast<uint16_t>(type);
+  ev.code  = static_cast<uint16_t>(code);
+  ev.value = value;
+  return ev;
+}
+
+/** feed \a count events followed by a SYN_REPORT and flush the frame */
+void send(EvdevMapper& mapper, const struct input_event* events, int count, int64_t nsec_delta)
+{
+  for(int i = 0; i < count; ++i)
+  {
+    mapper.process(events[i]);
+  }
+
+  if (mapper.process(make_event(EV_SYN, SYN_REPORT, 0)))
+  {
+    mapper.flush(nsec_delta);
+  }
+}
+
+int errors = 0;
+
+void check(bool ok, const std::string& what)
+{
+  if (!ok)
+  {
+    std::cout << "error: " << what << std::endl;
+    errors += 1;
+  }
+}
+
+} // namespace
+
+// Run events through an EvdevMapper and check the frames it would
+// write to uinput, time based filters are driven by flush() alone
+// without any input from the device
+int main(int argc, char** argv)
+{
+  EvdevRemap remap;
+  remap.add("ABS_X", "ABS_RX");
+  remap.add("BTN_A", "BTN_B");
+  remap.add("BTN_C", "void");
+  remap.add("BTN_X^autofire:50", "");
+  remap.add("BTN_Y^delay:100", "");
+
+  FrameLog log;
+  EvdevMapper mapper(remap, boost::bind(&FrameLog::on_frame, &log, _1, _2));
+  check(mapper.has_filters(), "has_filters()");
+
+  struct input_absinfo absinfo;
+  memset(&absinfo, 0, sizeof(absinfo));
+  absinfo.minimum = -100;
+  absinfo.maximum = 100;
+  mapper.set_absinfo(ABS_X, absinfo);
+
+  { // remapping and clamping
+    struct input_event events[] = {
+      make_event(EV_ABS, ABS_X, 150),
+      make_event(EV_KEY, BTN_A, 1),
+      make_event(EV_KEY, BTN_C, 1)
+    };
+    mapper.process(events[0]);
+    check(mapper.in_frame(), "in_frame() after an event");
+    send(mapper, events + 1, 2, msec2nsec(10));
+    check(!mapper.in_frame(), "in_frame() after SYN_REPORT");
+
+    check(log.frames.size() == 1, "one frame");
+    check(log.frames.back().size() == 3, "ABS_RX, BTN_B and SYN_REPORT in the frame");
+    check(log.last_value(EV_ABS, ABS_RX) == 100, "ABS_X is mapped to ABS_RX and clamped");
+    check(log.last_value(EV_ABS, ABS_X) == -1, "ABS_X isn't sent");
+    check(log.last_value(EV_KEY, BTN_B) == 1, "BTN_A is mapped to BTN_B");
+    check(log.last_value(EV_KEY, BTN_C) == -1, "BTN_C is dropped");
+    check(log.frames.back().back().type == EV_SYN, "frame ends with SYN_REPORT");
+  }
+
+  { // autorepeat goes through unchanged
+    struct input_event ev = make_event(EV_KEY, BTN_A, 2);
+    send(mapper, &ev, 1, msec2nsec(10));
+    check(log.last_value(EV_KEY, BTN_B) == 2, "autorepeat of BTN_A");
+  }
+
+  { // events lost to SYN_DROPPED are recovered from the device state
+    const size_t frames = log.frames.size();
+    mapper.process(make_event(EV_ABS, ABS_X, 20));
+    mapper.process(make_event(EV_SYN, SYN_DROPPED, 0));
+    mapper.process(make_event(EV_KEY, BTN_A, 0));
+    check(!mapper.process(make_event(EV_SYN, SYN_REPORT, 0)), "no flush after SYN_DROPPED");
+    check(log.frames.size() == frames, "dropped frame isn't sent");
+    check(mapper.needs_sync(), "needs_sync() after SYN_DROPPED");
+
+    // BTN_A was released and ABS_X moved while events were lost
+    mapper.sync_key(BTN_A, false);
+    mapper.sync_key(BTN_C, false);
+    mapper.sync_abs(ABS_X, -50);
+    mapper.flush(msec2nsec(10));
+    check(!mapper.needs_sync(), "needs_sync() after flush()");
+    check(log.frames.size() == frames + 1, "resync is sent as one frame");
+    check(log.frames.back().size() == 3, "only the changed codes are in the resync frame");
+    check(log.last_value(EV_KEY, BTN_B) == 0, "lost BTN_A release is sent");
+    check(log.last_value(EV_ABS, ABS_RX) == -50, "lost ABS_X motion is sent");
+
+    // nothing changed, nothing to send
+    mapper.sync_key(BTN_A, false);
+    mapper.sync_abs(ABS_X, -50);
+    mapper.flush(msec2nsec(10));
+    check(log.frames.size() == frames + 1, "resync without changes sends nothing");
+  }
+
+  { // autofire keeps firing while the device is idle
+    struct input_event ev = make_event(EV_KEY, BTN_X, 1);
+    send(mapper, &ev, 1, msec2nsec(10));
+    check(log.last_value(EV_KEY, BTN_X) == 1, "autofire press is sent right away");
+
+    int shots = 0;
+    bool state = true;
+    for(int i = 0; i < 100; ++i)
+    {
+      const size_t frames = log.frames.size();
+      mapper.flush(msec2nsec(10));
+      if (log.frames.size() != frames)
+      {
+        int value = log.last_value(EV_KEY, BTN_X);
+        if (value == 1 && !state)
+        {
+          shots += 1;
+        }
+        state = (value == 1);
+      }
+    }
+    std::cout << "autofire shots in 1000msec: " << shots << std::endl;
+    check(shots >= 18 && shots <= 20, "autofire:50 fires about every 50msec");
+
+    ev.value = 0;
+    send(mapper, &ev, 1, msec2nsec(10));
+    check(!state || log.last_value(EV_KEY, BTN_X) == 0, "autofire release");
+  }
+
+  { // delay holds the press back till enough time passed
+    struct input_event ev = make_event(EV_KEY, BTN_Y, 1);
+    send(mapper, &ev, 1, msec2nsec(10));
+    check(log.last_value(EV_KEY, BTN_Y) == -1, "delay press isn't sent right away");
+
+    int64_t t = 0;
+    while(t < msec2nsec(200) && log.last_value(EV_KEY, BTN_Y) != 1)
+    {
+      mapper.flush(msec2nsec(10));
+      t += msec2nsec(10);
+    }
+    std::cout << "delay:100 press after " << nsec2msec(t) << "msec" << std::endl;
+    check(t >= msec2nsec(80) && t <= msec2nsec(100), "delay:100 press after 100msec");
+
+    const size_t frames = log.frames.size();
+    mapper.flush(msec2nsec(10));
+    check(log.frames.size() == frames, "nothing is sent while the state doesn't change");
+  }
+
+  std::cout << "errors: " << errors << std::endl;
+
+  return errors != 0;
+}
+
+/* EOF */
@@ -0,0 +1,130 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <iostream>
+#include <string.h>
+
+#include "clock.hpp"
+#include "force_feedback_handler.hpp"
+
+namespace {
+
+int g_errors = 0;
+
+void expect(const char* what, int value, int expected)
+{
+  if (value != expected)
+  {
+    std::cout << what << ": " << value << " != " << expected << std::endl;
+    g_errors += 1;
+  }
+}
+
+struct ff_effect make_rumble(int id, int strong, int weak, int length)
+{
+  struct ff_effect rumble;
+  memset(&rumble, 0, sizeof(rumble));
+  rumble.type = FF_RUMBLE;
+  rumble.id = static_cast<int16_t>(id);
+  rumble.replay.length = static_cast<uint16_t>(length);
+  rumble.u.rumble.strong_magnitude = static_cast<uint16_t>(strong);
+  rumble.u.rumble.weak_magnitude   = static_cast<uint16_t>(weak);
+  return rumble;
+}
+
+/** all effects playing at \a magnitude with the given gain */
+void mix_all(int magnitude, int gain, int expected)
+{
+  ForceFeedbackHandler handler;
+  handler.set_gain(gain);
+
+  for(int i = 0; i < handler.get_max_effects(); ++i)
+  {
+    handler.upload(make_rumble(i, magnitude, magnitude, 1000));
+    handler.play(i, 1);
+  }
+
+  handler.update(msec2nsec(10));
+  expect("strong", handler.get_strong_magnitude(), expected);
+  expect("weak",   handler.get_weak_magnitude(), expected);
+}
+
+} // namespace
+
+// Mixing effects has to saturate instead of overflowing, and a rumble
+// and a square wave effect have to stop after their replay length.
+int main(int argc, char** argv)
+{
+  // sixteen effects at full strength, with full and half gain
+  mix_all(0xffff, 0xffff, 0x7fff);
+  mix_all(0xffff, 0x8000, 0x7fff);
+  mix_all(0xffff, 0, 0);
+
+  { // a single effect is scaled by the gain
+    ForceFeedbackHandler handler;
+    handler.set_gain(0x8000);
+    handler.upload(make_rumble(0, 0x4000, 0x2000, 100));
+    handler.play(0, 1);
+    handler.update(msec2nsec(10));
+    expect("single strong", handler.get_strong_magnitude(), 0x2000);
+    expect("single weak",   handler.get_weak_magnitude(), 0x1000);
+  }
+
+  { // the rumble is repeated twice, the periodic effect stops after
+    // its replay length
+    ForceFeedbackHandler handler;
+
+    struct ff_effect periodic;
+    memset(&periodic, 0, sizeof(periodic));
+    periodic.type = FF_PERIODIC;
+    periodic.id = 1;
+    periodic.replay.delay  = 50;
+    periodic.replay.length = 100;
+    periodic.u.periodic.waveform  = FF_SQUARE;
+    periodic.u.periodic.period    = 40;
+    periodic.u.periodic.magnitude = 0x2000;
+
+    handler.upload(make_rumble(0, 0x4000, 0x2000, 100));
+    handler.upload(periodic);
+
+    handler.play(0, 2);
+    handler.play(1, 1);
+
+    int t = 0;
+    while (t < 1000 && handler.is_active())
+    {
+      handler.update(msec2nsec(10));
+      t += 10;
+
+      if (t == 10)
+      {
+        expect("rumble strong", handler.get_strong_magnitude(), 0x4000);
+        expect("rumble weak",   handler.get_weak_magnitude(), 0x2000);
+      }
+    }
+
+    expect("stopped after", t, 200);
+  }
+
+  std::cout << "errors: " << g_errors << std::endl;
+
+  return g_errors != 0;
+}
+
+/* EOF */
@@ -0,0 +1,158 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <iostream>
+#include <stdexcept>
+#include <string.h>
+
+#include "hid_report_plan.hpp"
+
+namespace {
+
+// A typical cheap gamepad: report id 1, twelve buttons, an eight way
+// hat and four 8 bit axis
+const uint8_t kDescriptor[] = {
+  0x05, 0x01,       // Usage Page (Generic Desktop)
+  0x09, 0x05,       // Usage (Game Pad)
+  0xa1, 0x01,       // Collection (Application)
+  0x85, 0x01,       //   Report ID (1)
+  0x05, 0x09,       //   Usage Page (Button)
+  0x19, 0x01,       //   Usage Minimum (1)
+  0x29, 0x0c,       //   Usage Maximum (12)
+  0x15, 0x00,       //   Logical Minimum (0)
+  0x25, 0x01,       //   Logical Maximum (1)
+  0x75, 0x01,       //   Report Size (1)
+  0x95, 0x0c,       //   Report Count (12)
+  0x81, 0x02,       //   Input (Data,Var,Abs)
+  0x95, 0x04,       //   Report Count (4)
+  0x81, 0x03,       //   Input (Const)
+  0x05, 0x01,       //   Usage Page (Generic Desktop)
+  0x09, 0x39,       //   Usage (Hat switch)
+  0x25, 0x07,       //   Logical Maximum (7)
+  0x75, 0x04,       //   Report Size (4)
+  0x95, 0x01,       //   Report Count (1)
+  0x81, 0x42,       //   Input (Data,Var,Abs,Null)
+  0x81, 0x03,       //   Input (Const)
+  0x09, 0x30,       //   Usage (X)
+  0x09, 0x31,       //   Usage (Y)
+  0x09, 0x32,       //   Usage (Z)
+  0x09, 0x35,       //   Usage (Rz)
+  0x26, 0xff, 0x00, //   Logical Maximum (255)
+  0x75, 0x08,       //   Report Size (8)
+  0x95, 0x04,       //   Report Count (4)
+  0x81, 0x02,       //   Input (Data,Var,Abs)
+  0xc0              // End Collection
+};
+
+// Report Count (-1), as a 4 byte item
+const uint8_t kNegativeCount[] = {
+  0x75, 0x08,                   // Report Size (8)
+  0x97, 0xff, 0xff, 0xff, 0xff, // Report Count (-1)
+  0x81, 0x02                    // Input (Data,Var,Abs)
+};
+
+// 2000 fields of 32 bit, longer than any report
+const uint8_t kOversizedReport[] = {
+  0x09, 0x30,       // Usage (X)
+  0x75, 0x20,       // Report Size (32)
+  0x96, 0xd0, 0x07, // Report Count (2000)
+  0x81, 0x02        // Input (Data,Var,Abs)
+};
+
+int g_errors = 0;
+
+void expect(const char* what, int value, int expected)
+{
+  if (value != expected)
+  {
+    std::cout << what << ": " << value << " != " << expected << std::endl;
+    g_errors += 1;
+  }
+}
+
+void expect_parse_error(const char* what, const uint8_t* data, int len)
+{
+  try
+  {
+    HidReportDescriptor::parse(data, len);
+    std::cout << what << ": parsed" << std::endl;
+    g_errors += 1;
+  }
+  catch(const std::exception& err)
+  {
+  }
+}
+
+} // namespace
+
+// Compile the descriptor with the default mapping and decode a few
+// reports, the sticks have to cover the full range with Y pointing up
+int main(int argc, char** argv)
+{
+  std::vector<HidField> fields = HidReportDescriptor::parse(kDescriptor, sizeof(kDescriptor));
+  HidReportPlan plan(fields, HidMap::create_default());
+  std::cout << plan.str();
+
+  XboxGenericMsg msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.type = XBOX_MSG_XBOX360;
+
+  // A and Start pressed, hat right, X at minimum, Y at maximum
+  const uint8_t report1[] = { 0x01, 0x81, 0x00, 0x02, 0x00, 0xff, 0x80, 0x7f };
+  expect("decode", plan.decode(report1, sizeof(report1), msg), 1);
+  expect("A",     get_button(msg, XBOX_BTN_A), 1);
+  expect("B",     get_button(msg, XBOX_BTN_B), 0);
+  expect("START", get_button(msg, XBOX_BTN_START), 1);
+  expect("RIGHT", get_button(msg, XBOX_DPAD_RIGHT), 1);
+  expect("UP",    get_button(msg, XBOX_DPAD_UP), 0);
+  expect("X1",    get_axis(msg, XBOX_AXIS_X1), -32768);
+  expect("Y1",    get_axis(msg, XBOX_AXIS_Y1), -32768);
+  expect("X2",    get_axis(msg, XBOX_AXIS_X2), 128);
+  expect("Y2",    get_axis(msg, XBOX_AXIS_Y2), 128);
+
+  // hat null state, axis the other way around
+  const uint8_t report2[] = { 0x01, 0x00, 0x00, 0x0f, 0xff, 0x00, 0x00, 0xff };
+  expect("decode", plan.decode(report2, sizeof(report2), msg), 1);
+  expect("A",     get_button(msg, XBOX_BTN_A), 0);
+  expect("RIGHT", get_button(msg, XBOX_DPAD_RIGHT), 0);
+  expect("X1",    get_axis(msg, XBOX_AXIS_X1), 32767);
+  expect("Y1",    get_axis(msg, XBOX_AXIS_Y1), 32767);
+  expect("X2",    get_axis(msg, XBOX_AXIS_X2), -32768);
+  expect("Y2",    get_axis(msg, XBOX_AXIS_Y2), -32768);
+
+  // hat up-left
+  const uint8_t report3[] = { 0x01, 0x00, 0x00, 0x07, 0x80, 0x80, 0x80, 0x80 };
+  expect("decode", plan.decode(report3, sizeof(report3), msg), 1);
+  expect("UP",    get_button(msg, XBOX_DPAD_UP), 1);
+  expect("LEFT",  get_button(msg, XBOX_DPAD_LEFT), 1);
+  expect("DOWN",  get_button(msg, XBOX_DPAD_DOWN), 0);
+
+  // unknown report id
+  const uint8_t report4[] = { 0x02, 0x00 };
+  expect("decode", plan.decode(report4, sizeof(report4), msg), 0);
+
+  expect_parse_error("negative count", kNegativeCount, sizeof(kNegativeCount));
+  expect_parse_error("oversized report", kOversizedReport, sizeof(kOversizedReport));
+
+  std::cout << "errors: " << g_errors << std::endl;
+
+  return g_errors != 0;
+}
+
+/* EOF */
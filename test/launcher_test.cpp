@@ -0,0 +1,116 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "clock.hpp"
+#include "launcher.hpp"
+
+namespace {
+
+const int kLaunches = 200;
+const size_t kResidentSize = 512 * 1024 * 1024;
+
+/** the way exec bindings used to start commands */
+void double_fork(const std::vector<std::string>& args)
+{
+  pid_t tmp_pid = fork();
+  if (tmp_pid == 0)
+  {
+    if (fork() == 0)
+    {
+      execlp(args[0].c_str(), args[0].c_str(), static_cast<char*>(NULL));
+      _exit(EXIT_FAILURE);
+    }
+    _exit(EXIT_SUCCESS);
+  }
+  waitpid(tmp_pid, NULL, 0);
+}
+
+} // namespace
+
+// Compare the cost of launching a command on the caller side between
+// fork() of a process with a large resident set and the launcher
+// helper, then check that launched commands really run.
+int main(int argc, char** argv)
+{
+  Launcher launcher;
+
+  // grow the process after the helper got forked, like the daemon does
+  char* ballast = static_cast<char*>(malloc(kResidentSize));
+  memset(ballast, 1, kResidentSize);
+
+  std::vector<std::string> args;
+  args.push_back("true");
+
+  int64_t start = Clock::now();
+  for(int i = 0; i < kLaunches; ++i)
+  {
+    double_fork(args);
+  }
+  int64_t fork_time = Clock::now() - start;
+
+  start = Clock::now();
+  for(int i = 0; i < kLaunches; ++i)
+  {
+    Launcher::launch(args);
+  }
+  int64_t launch_time = Clock::now() - start;
+
+  std::cout << "fork():     " << fork_time / kLaunches / 1000 << " usec per launch" << std::endl;
+  std::cout << "Launcher:   " << launch_time / kLaunches / 1000 << " usec per launch" << std::endl;
+
+  char filename[] = "/tmp/launcher_testXXXXXX";
+  int fd = mkstemp(filename);
+  close(fd);
+  unlink(filename);
+
+  args.clear();
+  args.push_back("touch");
+  args.push_back(filename);
+  Launcher::launch(args);
+
+  struct stat buf;
+  bool found = false;
+  for(int i = 0; i < 500 && !found; ++i)
+  {
+    found = (stat(filename, &buf) == 0);
+    usleep(10 * 1000);
+  }
+  unlink(filename);
+
+  free(ballast);
+
+  if (!found)
+  {
+    std::cout << "error: launched command didn't run" << std::endl;
+    return EXIT_FAILURE;
+  }
+  else
+  {
+    return EXIT_SUCCESS;
+  }
+}
+
+/* EOF */
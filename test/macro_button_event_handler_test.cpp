@@ -0,0 +1,261 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <glib.h>
+#include <iostream>
+#include <linux/input.h>
+#include <sstream>
+#include <stdexcept>
+
+#include "buttonevent/macro_button_event_handler.hpp"
+#include "uinput.hpp"
+
+namespace {
+
+int g_errors = 0;
+
+struct Event
+{
+  int code;
+  int value;
+  gint64 time;
+};
+
+void record(std::vector<Event>* events, const UIEvent& ev, int value)
+{
+  Event event = { ev.code, value, g_get_monotonic_time() };
+  events->push_back(event);
+}
+
+MacroButtonEventHandler* compile(const std::string& source)
+{
+  std::istringstream in(source);
+  return MacroButtonEventHandler::from_stream(in, "<test>");
+}
+
+void expect_code(const std::string& source, const std::string& expected)
+{
+  boost::scoped_ptr<MacroButtonEventHandler> macro(compile(source));
+  if (macro->dump_code() != expected)
+  {
+    std::cout << "code mismatch for:\n" << source
+              << "got:\n" << macro->dump_code()
+              << "expected:\n" << expected << std::endl;
+    g_errors += 1;
+  }
+}
+
+void expect_error(const std::string& source)
+{
+  try
+  {
+    boost::scoped_ptr<MacroButtonEventHandler> macro(compile(source));
+    std::cout << "no error for:\n" << source << std::endl;
+    g_errors += 1;
+  }
+  catch(const std::exception& err)
+  {
+    // expected
+  }
+}
+
+void expect(const char* what, bool value)
+{
+  if (!value)
+  {
+    std::cout << "failed: " << what << std::endl;
+    g_errors += 1;
+  }
+}
+
+void run_for(int msec)
+{
+  const gint64 end = g_get_monotonic_time() + msec * 1000;
+  while (g_get_monotonic_time() < end)
+  {
+    g_main_context_iteration(NULL, FALSE);
+    g_usleep(200);
+  }
+}
+
+void run_until_stopped(MacroButtonEventHandler& macro, int timeout_msec)
+{
+  const gint64 end = g_get_monotonic_time() + timeout_msec * 1000;
+  while (macro.is_playing() && g_get_monotonic_time() < end)
+  {
+    g_main_context_iteration(NULL, TRUE);
+  }
+}
+
+} // namespace
+
+// Compile macros and check the bytecode, then play them back off the
+// timerfd with the events going to a callback instead of uinput
+int main(int argc, char** argv)
+{
+  // only needed for the send() signature, it never gets a device as
+  // the events go to the callback
+  UInput uinput(false);
+
+  // nested repeats and a loop, the jump targets point behind the
+  // opening instruction
+  expect_code("send KEY_A 1\n"
+              "wait 10\n"
+              "repeat 2\n"
+              "  repeat 3\n"
+              "    send KEY_B 1\n"
+              "    send KEY_B 0\n"
+              "  end\n"
+              "  wait 2.5\n"
+              "end\n"
+              "loop\n"
+              "  send KEY_A 0\n"
+              "  wait 1\n"
+              "end\n",
+              "0: send KEY_A 1\n"
+              "3: wait 10000\n"
+              "5: repeat 2\n"
+              "7: repeat 3\n"
+              "9: send KEY_B 1\n"
+              "12: send KEY_B 0\n"
+              "15: end 9\n"
+              "17: wait 2500\n"
+              "19: end 7\n"
+              "21: repeat 0\n"
+              "23: send KEY_A 0\n"
+              "26: wait 1000\n"
+              "28: end 23\n"
+              "30: halt\n");
+
+  // comments, zero waits and cancel-on-release leave no code behind
+  expect_code("# comment\n"
+              "cancel-on-release\n"
+              "send KEY_A 1\n"
+              "wait 0\n",
+              "0: send KEY_A 1\n"
+              "3: halt\n");
+
+  expect_error("end\n");
+  expect_error("repeat 2\nsend KEY_A 1\n");
+  expect_error("repeat 0\nend\n");
+  expect_error("loop\nsend KEY_A 1\nend\n");
+  expect_error("wait -1\n");
+  expect_error("frobnicate\n");
+  expect_error("repeat 1\nrepeat 1\nrepeat 1\nrepeat 1\nrepeat 1\nrepeat 1\nrepeat 1\nrepeat 1\nrepeat 1\n"
+               "wait 1\nend\nend\nend\nend\nend\nend\nend\nend\nend\n");
+
+  { // repeat plays to the end, no matter when the button is released
+    boost::scoped_ptr<MacroButtonEventHandler> macro(compile("repeat 3\n"
+                                                             "  send KEY_A 1\n"
+                                                             "  wait 5\n"
+                                                             "  send KEY_A 0\n"
+                                                             "  wait 5\n"
+                                                             "end\n"));
+    std::vector<Event> events;
+    macro->set_send_callback(boost::bind(&record, &events, _1, _2));
+
+    const gint64 start = g_get_monotonic_time();
+    macro->send(uinput, true);
+    macro->send(uinput, false);
+    run_until_stopped(*macro, 1000);
+
+    expect("repeat: stopped", !macro->is_playing());
+    expect("repeat: six events", events.size() == 6);
+    expect("repeat: takes 30 msec", !events.empty() && events.back().time - start >= 25000);
+  }
+
+  { // cancel-on-release stops a loop right away and releases its keys
+    boost::scoped_ptr<MacroButtonEventHandler> macro(compile("cancel-on-release\n"
+                                                             "loop\n"
+                                                             "  send KEY_A 1\n"
+                                                             "  wait 5\n"
+                                                             "  send KEY_A 0\n"
+                                                             "  wait 5\n"
+                                                             "end\n"));
+    std::vector<Event> events;
+    macro->set_send_callback(boost::bind(&record, &events, _1, _2));
+
+    macro->send(uinput, true);
+    run_for(32);
+    expect("cancel: playing", macro->is_playing());
+
+    macro->send(uinput, false);
+    expect("cancel: stopped", !macro->is_playing());
+    expect("cancel: key released", !events.empty() && events.back().value == 0);
+
+    std::vector<Event>::size_type count = events.size();
+    run_for(20);
+    expect("cancel: no events after release", events.size() == count);
+  }
+
+  { // without cancel-on-release a loop runs out at its next 'end'
+    boost::scoped_ptr<MacroButtonEventHandler> macro(compile("loop\n"
+                                                             "  send KEY_A 1\n"
+                                                             "  wait 5\n"
+                                                             "  send KEY_A 0\n"
+                                                             "  wait 5\n"
+                                                             "end\n"
+                                                             "send KEY_B 1\n"));
+    std::vector<Event> events;
+    macro->set_send_callback(boost::bind(&record, &events, _1, _2));
+
+    macro->send(uinput, true);
+    run_for(12);
+    macro->send(uinput, false);
+    expect("release: still playing", macro->is_playing());
+    run_until_stopped(*macro, 1000);
+
+    expect("release: stopped", !macro->is_playing());
+    expect("release: loop finished", events.size() >= 3 && events[events.size() - 2].value == 0);
+    expect("release: tail played", !events.empty() && events.back().code == KEY_B);
+  }
+
+  { // pressing again before the loop ran out keeps it looping
+    boost::scoped_ptr<MacroButtonEventHandler> macro(compile("loop\n"
+                                                             "  send KEY_A 1\n"
+                                                             "  wait 5\n"
+                                                             "  send KEY_A 0\n"
+                                                             "  wait 5\n"
+                                                             "end\n"
+                                                             "send KEY_B 1\n"));
+    std::vector<Event> events;
+    macro->set_send_callback(boost::bind(&record, &events, _1, _2));
+
+    macro->send(uinput, true);
+    run_for(12);
+    macro->send(uinput, false);
+    macro->send(uinput, true);
+    run_for(30);
+    expect("repress: still playing", macro->is_playing());
+    expect("repress: no tail", !events.empty() && events.back().code == KEY_A);
+
+    macro->send(uinput, false);
+    run_until_stopped(*macro, 1000);
+    expect("repress: stopped", !macro->is_playing());
+    expect("repress: tail played", !events.empty() && events.back().code == KEY_B);
+  }
+
+  std::cout << "errors: " << g_errors << std::endl;
+
+  return g_errors != 0;
+}
+
+/* EOF */
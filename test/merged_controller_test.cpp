@@ -0,0 +1,88 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <boost/bind.hpp>
+#include <iostream>
+#include <string.h>
+
+#include "merged_controller.hpp"
+
+class FakeController : public Controller
+{
+public:
+  FakeController() {}
+
+  void set_rumble_real(uint8_t left, uint8_t right) {}
+  void set_led_real(uint8_t status) {}
+
+  void send(int x1, int lt, bool a, bool dpad_up)
+  {
+    XboxGenericMsg msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.type = XBOX_MSG_XBOX360;
+    msg.xbox360.x1 = x1;
+    msg.xbox360.lt = lt;
+    msg.xbox360.a  = a;
+    msg.xbox360.dpad_up = dpad_up;
+    submit_msg(msg);
+  }
+};
+
+void print_msg(const XboxGenericMsg& msg)
+{
+  std::cout << "x1: " << msg.xbox360.x1
+            << " lt: " << static_cast<int>(msg.xbox360.lt)
+            << " a: " << msg.xbox360.a
+            << " dpad_up: " << msg.xbox360.dpad_up << std::endl;
+}
+
+void on_disconnect()
+{
+  std::cout << "disconnected" << std::endl;
+}
+
+// a wheel and a pedal merged without latency, every change results
+// in exactly one message
+int main(int argc, char** argv)
+{
+  boost::shared_ptr<FakeController> wheel(new FakeController);
+  boost::shared_ptr<FakeController> pedals(new FakeController);
+
+  std::vector<ControllerPtr> sources;
+  sources.push_back(wheel);
+  sources.push_back(pedals);
+
+  MergedController merged(sources, 0);
+  merged.set_message_cb(&print_msg);
+  merged.set_disconnect_cb(&on_disconnect);
+
+  wheel->send(-12000, 0, false, false);
+  pedals->send(300, 200, false, false);
+  wheel->send(-12000, 0, true, false);
+  pedals->send(300, 200, false, true);
+  wheel->send(-12000, 0, true, false); // no change, no message
+  wheel->send(0, 0, false, false);
+
+  pedals->send_disconnect();
+  wheel->send_disconnect();
+
+  return 0;
+}
+
+/* EOF */
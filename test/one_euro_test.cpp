@@ -0,0 +1,285 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <fstream>
+#include <iostream>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "axisfilter/deadzone_axis_filter.hpp"
+#include "axisfilter/one_euro_axis_filter.hpp"
+#include "clock.hpp"
+#include "helper.hpp"
+
+namespace {
+
+struct Sample
+{
+  int64_t time;
+  int value;
+  int truth;
+};
+
+typedef std::vector<Sample> Trace;
+
+const int64_t kReportInterval = 4 * 1000 * 1000; // 250Hz
+
+/** deterministic noise in [-amplitude, amplitude] */
+int noise(unsigned int& state, int amplitude)
+{
+  state = state * 1103515245u + 12345u;
+  return static_cast<int>((state >> 16) % (2 * amplitude + 1)) - amplitude;
+}
+
+/** stick held still, slow aiming and fast flicks, with sensor noise */
+Trace make_trace(const std::string& name)
+{
+  Trace trace;
+  unsigned int state = 1;
+
+  for(int i = 0; i < 500; ++i)
+  {
+    Sample sample;
+    sample.time = 1000000000 + i * kReportInterval;
+
+    if (name == "hold")
+    {
+      sample.truth = 1200;
+    }
+    else if (name == "slow")
+    {
+      // 0.2 full range per second
+      sample.truth = -10000 + static_cast<int>(i * kReportInterval * 13107 / 1000000000);
+    }
+    else // flick
+    {
+      const int t = i % 125;
+      sample.truth = (t < 50) ? 0 : (t < 55) ? (t - 50) * 6000 : 30000;
+    }
+
+    sample.value = Math::clamp(-32768, sample.truth + noise(state, 600), 32767);
+    trace.push_back(sample);
+  }
+
+  return trace;
+}
+
+/** read a trace recorded as lines of "NSEC VALUE" */
+Trace read_trace(const std::string& filename)
+{
+  Trace trace;
+  std::ifstream in(filename.c_str());
+  Sample sample;
+  int64_t time;
+  while(in >> time >> sample.value)
+  {
+    sample.time = time;
+    sample.truth = sample.value;
+    trace.push_back(sample);
+  }
+  return trace;
+}
+
+std::vector<int> run(AxisFilter& filter, const Trace& trace)
+{
+  std::vector<int> output;
+  int64_t last_time = trace.empty() ? 0 : trace.front().time;
+  for(Trace::const_iterator i = trace.begin(); i != trace.end(); ++i)
+  {
+    filter.update(i->time - last_time);
+    filter.set_report_time(i->time);
+    output.push_back(filter.filter(i->value, -32768, 32767));
+    last_time = i->time;
+  }
+  return output;
+}
+
+/** value of \a trace at \a time, linearly interpolated */
+double value_at(const Trace& trace, const std::vector<int>& values, double time)
+{
+  if (time <= trace.front().time) return values.front();
+  for(size_t i = 1; i < trace.size(); ++i)
+  {
+    if (time <= trace[i].time)
+    {
+      double t = (time - trace[i-1].time) / (trace[i].time - trace[i-1].time);
+      return values[i-1] + t * (values[i] - values[i-1]);
+    }
+  }
+  return values.back();
+}
+
+/** the delay in msec at which the input best matches the output */
+double latency(const Trace& trace, const std::vector<int>& output)
+{
+  std::vector<int> input;
+  for(Trace::const_iterator i = trace.begin(); i != trace.end(); ++i)
+  {
+    input.push_back(i->truth);
+  }
+
+  double best_lag = 0.0;
+  double best_error = -1.0;
+  for(double lag = 0.0; lag <= 50.0; lag += 0.25)
+  {
+    double error = 0.0;
+    for(size_t i = 0; i < trace.size(); ++i)
+    {
+      double d = output[i] - value_at(trace, input, trace[i].time - lag * 1000000.0);
+      error += d * d;
+    }
+
+    if (best_error < 0.0 || error < best_error)
+    {
+      best_error = error;
+      best_lag = lag;
+    }
+  }
+  return best_lag;
+}
+
+/** RMS of the output around the true value, for recorded traces
+    without a known truth the RMS of the change between samples */
+double jitter(const Trace& trace, const std::vector<int>& output, bool recorded)
+{
+  double sum = 0.0;
+  for(size_t i = 1; i < trace.size(); ++i)
+  {
+    double d = recorded ? output[i] - output[i-1] : output[i] - trace[i].truth;
+    sum += d * d;
+  }
+  return sqrt(sum / static_cast<double>(trace.size() - 1));
+}
+
+struct Result
+{
+  double latency;
+  double jitter;
+};
+
+Result measure(AxisFilter& filter, const Trace& trace, bool recorded)
+{
+  std::vector<int> output = run(filter, trace);
+  Result result;
+  result.latency = latency(trace, output);
+  result.jitter = jitter(trace, output, recorded);
+  return result;
+}
+
+void print(const std::string& trace, const std::string& filter, const Result& result)
+{
+  printf("%-10s %-22s latency: %6.2fms  jitter: %8.1f\n",
+         trace.c_str(), filter.c_str(), result.latency, result.jitter);
+}
+
+} // namespace
+
+// Report the latency the filter adds and the jitter it leaves, on
+// synthetic traces or on recorded ones given as arguments, compared to
+// the raw input and to a plain deadzone.
+int main(int argc, char** argv)
+{
+  int errors = 0;
+
+  if (argc > 1)
+  {
+    for(int i = 1; i < argc; ++i)
+    {
+      Trace trace = read_trace(argv[i]);
+      if (trace.size() < 2)
+      {
+        std::cerr << argv[i] << ": not enough samples" << std::endl;
+        return EXIT_FAILURE;
+      }
+
+      DeadzoneAxisFilter raw(0, 0, false);
+      DeadzoneAxisFilter dead(-4000, 4000, true);
+      OneEuroAxisFilter euro(1.0f, 5.0f, 1.0f);
+
+      print(argv[i], "raw", measure(raw, trace, true));
+      print(argv[i], "dead:4000", measure(dead, trace, true));
+      print(argv[i], euro.str(), measure(euro, trace, true));
+    }
+    return EXIT_SUCCESS;
+  }
+
+  const char* names[] = { "hold", "slow", "flick" };
+  for(int n = 0; n < 3; ++n)
+  {
+    Trace trace = make_trace(names[n]);
+
+    DeadzoneAxisFilter raw(0, 0, false);
+    DeadzoneAxisFilter dead(-4000, 4000, true);
+    OneEuroAxisFilter euro(1.0f, 5.0f, 1.0f);
+
+    Result raw_result = measure(raw, trace, false);
+    Result euro_result = measure(euro, trace, false);
+
+    print(names[n], "raw", raw_result);
+    print(names[n], "dead:4000", measure(dead, trace, false));
+    print(names[n], euro.str(), euro_result);
+
+    if (std::string(names[n]) == "hold" && euro_result.jitter * 4 > raw_result.jitter)
+    {
+      std::cout << "error: jitter not smoothed away" << std::endl;
+      errors += 1;
+    }
+
+    if (std::string(names[n]) == "flick" && euro_result.latency > 8.0)
+    {
+      std::cout << "error: flicks delayed by more than 8ms" << std::endl;
+      errors += 1;
+    }
+  }
+
+  { // a report send again without time passing is not a new sample,
+    // with time passing the output has to settle on it
+    OneEuroAxisFilter euro(1.0f, 5.0f, 1.0f);
+    euro.set_report_time(1000);
+    euro.filter(0, -32768, 32767);
+
+    euro.update(kReportInterval);
+    euro.set_report_time(1000 + kReportInterval);
+    int value = euro.filter(20000, -32768, 32767);
+
+    if (euro.filter(20000, -32768, 32767) != value)
+    {
+      std::cout << "error: repeated report changed the output" << std::endl;
+      errors += 1;
+    }
+
+    for(int i = 0; i < 500; ++i)
+    {
+      euro.update(kReportInterval);
+      value = euro.filter(20000, -32768, 32767);
+    }
+
+    if (value != 20000)
+    {
+      std::cout << "error: output didn't settle: " << value << std::endl;
+      errors += 1;
+    }
+  }
+
+  return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* EOF */
@@ -0,0 +1,182 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+
+#include "clock.hpp"
+#include "report_decoder.hpp"
+#include "unpack.hpp"
+
+namespace {
+
+// field by field unpacking as done before the report layouts
+void unpack_xbox360(uint8_t* data, Xbox360Msg& msg)
+{
+  msg.type   = data[0];
+  msg.length = data[1];
+
+  msg.dpad_up    = unpack::bit(data+2, 0);
+  msg.dpad_down  = unpack::bit(data+2, 1);
+  msg.dpad_left  = unpack::bit(data+2, 2);
+  msg.dpad_right = unpack::bit(data+2, 3);
+
+  msg.start   = unpack::bit(data+2, 4);
+  msg.back    = unpack::bit(data+2, 5);
+  msg.thumb_l = unpack::bit(data+2, 6);
+  msg.thumb_r = unpack::bit(data+2, 7);
+
+  msg.lb     = unpack::bit(data+3, 0);
+  msg.rb     = unpack::bit(data+3, 1);
+  msg.guide  = unpack::bit(data+3, 2);
+  msg.dummy1 = unpack::bit(data+3, 3);
+
+  msg.a = unpack::bit(data+3, 4);
+  msg.b = unpack::bit(data+3, 5);
+  msg.x = unpack::bit(data+3, 6);
+  msg.y = unpack::bit(data+3, 7);
+
+  msg.lt = data[4];
+  msg.rt = data[5];
+
+  msg.x1 = unpack::int16le(data+6);
+  msg.y1 = unpack::int16le(data+8);
+
+  msg.x2 = unpack::int16le(data+10);
+  msg.y2 = unpack::int16le(data+12);
+
+  msg.dummy2 = unpack::int32le(data+14);
+  msg.dummy3 = unpack::int16le(data+18);
+}
+
+const int kReports = 256;
+const int kRounds  = 20000;
+
+template<typename Msg, void (*decode)(const uint8_t*, Msg&)>
+void benchmark(const char* name, uint8_t data[kReports][20])
+{
+  Msg msg;
+  memset(&msg, 0, sizeof(msg));
+  int sum = 0;
+
+  int64_t start = Clock::now();
+  for(int round = 0; round < kRounds; ++round)
+  {
+    for(int i = 0; i < kReports; ++i)
+    {
+      decode(data[i], msg);
+      sum += msg.x1 + msg.y2 + msg.lt + msg.a + msg.dpad_up;
+    }
+  }
+  int64_t duration = Clock::now() - start;
+
+  std::cout << name << ": "
+            << static_cast<double>(duration) / (kReports * kRounds) << " nsec/report"
+            << " (" << sum << ")" << std::endl;
+}
+
+} // namespace
+
+void unpack_xbox360_wrap(const uint8_t* data, Xbox360Msg& msg)
+{
+  unpack_xbox360(const_cast<uint8_t*>(data), msg);
+}
+
+int main(int argc, char** argv)
+{
+  uint8_t data[kReports][20];
+  srand(0);
+  for(int i = 0; i < kReports; ++i)
+  {
+    for(int j = 0; j < 20; ++j)
+    {
+      data[i][j] = rand() & 0xff;
+    }
+  }
+
+  int errors = 0;
+
+  for(int i = 0; i < kReports; ++i)
+  {
+    Xbox360Msg expected;
+    Xbox360Msg result;
+    memset(&expected, 0, sizeof(expected));
+    memset(&result, 0, sizeof(result));
+    unpack_xbox360(data[i], expected);
+    report::decode_xbox360(data[i], result);
+    if (memcmp(&expected, &result, sizeof(result)) != 0)
+    {
+      std::cout << "xbox360 mismatch in report " << i << std::endl;
+      errors += 1;
+    }
+
+    if (!unpack::is_big_endian())
+    {
+      // the XboxMsg struct mirrors the wire format on little endian hosts
+      XboxMsg expected_xbox;
+      XboxMsg result_xbox;
+      memcpy(&expected_xbox, data[i], sizeof(expected_xbox));
+      memset(&result_xbox, 0, sizeof(result_xbox));
+      report::decode_xbox(data[i], result_xbox);
+      if (memcmp(&expected_xbox, &result_xbox, sizeof(result_xbox)) != 0)
+      {
+        std::cout << "xbox mismatch in report " << i << std::endl;
+        errors += 1;
+      }
+    }
+  }
+
+  // Saitek P2500 dpad hat: 0 is up, clockwise, 15 is centered
+  const char* hat[] = { "U", "UR", "R", "DR", "D", "DL", "L", "UL" };
+  for(int i = 0; i < 16; ++i)
+  {
+    uint8_t p2500[report::kSaitekP2500ReportSize] = { 0, 0x80, 0x7f, 0, 0xff, 0xa0, 0 };
+    p2500[6] = static_cast<uint8_t>(i << 4);
+
+    Xbox360Msg msg;
+    memset(&msg, 0, sizeof(msg));
+    report::decode_saitek_p2500(p2500, msg);
+
+    std::string dirs;
+    if (msg.dpad_up)    dirs += "U";
+    if (msg.dpad_down)  dirs += "D";
+    if (msg.dpad_right) dirs += "R";
+    if (msg.dpad_left)  dirs += "L";
+
+    std::string expected = (i < 8) ? hat[i] : "";
+    if (dirs != expected || msg.x1 != -32768 || msg.y1 != 32767 ||
+        msg.x2 != 0 || msg.y2 != scale_8to16(-1) ||
+        msg.lt != 255 || msg.rt != 255 || msg.lb || msg.rb)
+    {
+      std::cout << "p2500 mismatch for hat " << i << ": " << dirs << std::endl;
+      errors += 1;
+    }
+  }
+
+  benchmark<Xbox360Msg, &unpack_xbox360_wrap>("xbox360 unpack", data);
+  benchmark<Xbox360Msg, &report::decode_xbox360>("xbox360 layout", data);
+  benchmark<XboxMsg, &report::decode_xbox>("xbox layout", data);
+
+  std::cout << (errors ? "FAILED" : "OK") << std::endl;
+
+  return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* EOF */
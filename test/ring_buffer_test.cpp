@@ -0,0 +1,98 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+#include <glib.h>
+#include <iostream>
+
+#include "ring_buffer.hpp"
+
+namespace {
+
+const int kTotal = 100000;
+
+gpointer producer(gpointer userdata)
+{
+  RingBuffer& buffer = *static_cast<RingBuffer*>(userdata);
+
+  uint8_t data[37];
+  int count = 0;
+  while (count < kTotal)
+  {
+    int len = std::min(static_cast<int>(sizeof(data)), kTotal - count);
+    for(int i = 0; i < len; ++i)
+    {
+      data[i] = static_cast<uint8_t>(count + i);
+    }
+
+    int written = 0;
+    while (written < len)
+    {
+      int ret = buffer.write(data + written, len - written);
+      if (ret == 0)
+      {
+        g_thread_yield();
+      }
+      written += ret;
+    }
+    count += len;
+  }
+
+  return 0;
+}
+
+} // namespace
+
+// Push data through a small ring buffer from a second thread, every
+// byte has to arrive in order.
+int main(int argc, char** argv)
+{
+  RingBuffer buffer(100);
+
+  GThread* thread = g_thread_new("producer", &producer, &buffer);
+
+  uint8_t data[64];
+  int count = 0;
+  int errors = 0;
+  while (count < kTotal)
+  {
+    int len = buffer.read(data, sizeof(data));
+    if (len == 0)
+    {
+      g_thread_yield();
+    }
+    for(int i = 0; i < len; ++i)
+    {
+      if (data[i] != static_cast<uint8_t>(count + i))
+      {
+        errors += 1;
+      }
+    }
+    count += len;
+  }
+
+  g_thread_join(thread);
+
+  std::cout << "received: " << count << " errors: " << errors
+            << " left: " << buffer.get_read_space() << std::endl;
+
+  return errors != 0;
+}
+
+/* EOF */
@@ -0,0 +1,100 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <iostream>
+#include <stdexcept>
+#include <stdlib.h>
+
+#include "clock.hpp"
+#include "rumble_pattern.hpp"
+
+namespace {
+
+int errors = 0;
+
+void expect(const RumblePattern& pattern, int msec, bool playing, int strong, int weak)
+{
+  uint8_t s = 0;
+  uint8_t w = 0;
+  bool ret = pattern.get(msec2nsec(msec), &s, &w);
+  if (ret != playing || (playing && (s != strong || w != weak)))
+  {
+    std::cout << "error: " << pattern.str() << " at " << msec << "ms: "
+              << ret << " " << static_cast<int>(s) << " " << static_cast<int>(w) << std::endl;
+    errors += 1;
+  }
+}
+
+void expect_invalid(const std::string& str)
+{
+  try
+  {
+    RumblePattern::from_string(str);
+    std::cout << "error: accepted invalid pattern: " << str << std::endl;
+    errors += 1;
+  }
+  catch(const std::exception& err)
+  {
+  }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  { // fade in and out, played once
+    RumblePatternPtr pattern = RumblePattern::from_string("0:0:0,100:255:128,200:0:0");
+    expect(*pattern, 0, true, 0, 0);
+    expect(*pattern, 50, true, 127, 64);
+    expect(*pattern, 100, true, 255, 128);
+    expect(*pattern, 150, true, 128, 64);
+    expect(*pattern, 199, true, 3, 2);
+    expect(*pattern, 200, false, 0, 0);
+  }
+
+  { // held values, looped
+    RumblePatternPtr pattern = RumblePattern::from_string("0:255:0:step,50:0:255:step,100:0:0,loop:2");
+    expect(*pattern, 10, true, 255, 0);
+    expect(*pattern, 60, true, 0, 255);
+    expect(*pattern, 110, true, 255, 0);
+    expect(*pattern, 199, true, 0, 255);
+    expect(*pattern, 200, false, 0, 0);
+  }
+
+  { // forever
+    RumblePatternPtr pattern = RumblePattern::from_string("0:10:20,10:10:20,loop");
+    expect(*pattern, 1000 * 1000, true, 10, 20);
+    if (pattern->str() != "0:10:20,10:10:20,loop")
+    {
+      std::cout << "error: str(): " << pattern->str() << std::endl;
+      errors += 1;
+    }
+  }
+
+  expect_invalid("0:255:255");
+  expect_invalid("10:255:255,20:0:0");
+  expect_invalid("0:255:255,0:0:0");
+  expect_invalid("0:256:0,10:0:0");
+  expect_invalid("0:0:0,10:0:0,loop:0");
+  expect_invalid("0:0,10:0:0");
+
+  return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* EOF */
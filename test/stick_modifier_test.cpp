@@ -0,0 +1,182 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <iostream>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "axisfilter/deadzone_axis_filter.hpp"
+#include "clock.hpp"
+#include "modifier/axismap_modifier.hpp"
+#include "modifier/rotate_axis_modifier.hpp"
+#include "modifier/square_axis_modifier.hpp"
+#include "modifier/stick_modifier.hpp"
+
+namespace {
+
+const int kDeadzone = 4000;
+
+XboxGenericMsg make_msg(int x1, int y1, int x2, int y2)
+{
+  XboxGenericMsg msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.type = XBOX_MSG_XBOX360;
+  msg.xbox360.x1 = static_cast<int16_t>(x1);
+  msg.xbox360.y1 = static_cast<int16_t>(y1);
+  msg.xbox360.x2 = static_cast<int16_t>(x2);
+  msg.xbox360.y2 = static_cast<int16_t>(y2);
+  return msg;
+}
+
+/** the modifiers as they were set up before being compiled */
+std::vector<ModifierPtr> create_modifier()
+{
+  std::vector<ModifierPtr> modifier;
+
+  boost::shared_ptr<AxismapModifier> axismap(new AxismapModifier);
+  axismap->add_filter(XBOX_AXIS_X1, AxisFilterPtr(new DeadzoneAxisFilter(-kDeadzone, kDeadzone, true)));
+  axismap->add_filter(XBOX_AXIS_Y1, AxisFilterPtr(new DeadzoneAxisFilter(-kDeadzone, kDeadzone, true)));
+  axismap->add_filter(XBOX_AXIS_X2, AxisFilterPtr(new DeadzoneAxisFilter(-kDeadzone, kDeadzone, true)));
+  axismap->add_filter(XBOX_AXIS_Y2, AxisFilterPtr(new DeadzoneAxisFilter(-kDeadzone, kDeadzone, true)));
+  modifier.push_back(axismap);
+
+  modifier.push_back(ModifierPtr(new SquareAxisModifier(XBOX_AXIS_X1, XBOX_AXIS_Y1)));
+  modifier.push_back(ModifierPtr(new SquareAxisModifier(XBOX_AXIS_X2, XBOX_AXIS_Y2)));
+  modifier.push_back(ModifierPtr(new RotateAxisModifier(XBOX_AXIS_X1, XBOX_AXIS_Y1, 30.0f * static_cast<float>(M_PI) / 180.0f, false)));
+  modifier.push_back(ModifierPtr(new RotateAxisModifier(XBOX_AXIS_X2, XBOX_AXIS_Y2, -45.0f * static_cast<float>(M_PI) / 180.0f, true)));
+
+  return modifier;
+}
+
+void run(const std::vector<ModifierPtr>& modifier, XboxGenericMsg& msg)
+{
+  for(std::vector<ModifierPtr>::const_iterator i = modifier.begin(); i != modifier.end(); ++i)
+  {
+    (*i)->update(0, msg);
+  }
+}
+
+} // namespace
+
+// Compare the fused stick stage against the modifiers it replaces
+// over a grid of stick positions and time both.
+int main(int argc, char** argv)
+{
+  std::vector<ModifierPtr> legacy = create_modifier();
+
+  // the deadzone as ControllerSlotConfig creates it now
+  std::vector<ModifierPtr> fused = create_modifier();
+  boost::shared_ptr<StickModifier> deadzone(new StickModifier);
+  deadzone->add_deadzone(XBOX_AXIS_X1, XBOX_AXIS_Y1, kDeadzone);
+  deadzone->add_deadzone(XBOX_AXIS_X2, XBOX_AXIS_Y2, kDeadzone);
+  fused[0] = deadzone;
+  StickModifier::compile(&fused);
+
+  int errors = 0;
+
+  if (fused.size() != 1)
+  {
+    std::cout << "error: expected a single modifier, got " << fused.size() << std::endl;
+    errors += 1;
+  }
+  else
+  {
+    std::cout << fused[0]->str() << std::endl;
+  }
+
+  // the trigonometry and float conversions of the old modifiers
+  // round differently, allow for that
+  const int tolerance = 4;
+  int max_error = 0;
+  for(int y = -32768; y <= 32767; y += 1111)
+  {
+    for(int x = -32768; x <= 32767; x += 1111)
+    {
+      XboxGenericMsg lhs = make_msg(x, y, y, x);
+      XboxGenericMsg rhs = lhs;
+
+      run(legacy, lhs);
+      run(fused, rhs);
+
+      const int error = std::max(std::max(abs(lhs.xbox360.x1 - rhs.xbox360.x1),
+                                          abs(lhs.xbox360.y1 - rhs.xbox360.y1)),
+                                 std::max(abs(lhs.xbox360.x2 - rhs.xbox360.x2),
+                                          abs(lhs.xbox360.y2 - rhs.xbox360.y2)));
+      max_error = std::max(max_error, error);
+
+      if (error > tolerance)
+      {
+        std::cout << "error: " << x << ", " << y << ": "
+                  << lhs.xbox360.x1 << "," << lhs.xbox360.y1 << " " << lhs.xbox360.x2 << "," << lhs.xbox360.y2 << " != "
+                  << rhs.xbox360.x1 << "," << rhs.xbox360.y1 << " " << rhs.xbox360.x2 << "," << rhs.xbox360.y2
+                  << std::endl;
+        errors += 1;
+      }
+    }
+  }
+  std::cout << "max difference: " << max_error << std::endl;
+
+  // radial deadzone keeps the direction and full deflection
+  {
+    StickModifier radial;
+    radial.add_radial_deadzone(XBOX_AXIS_X1, XBOX_AXIS_Y1, kDeadzone);
+
+    XboxGenericMsg inside = make_msg(2800, 2800, 0, 0);
+    XboxGenericMsg edge = make_msg(32767, 0, 0, 0);
+    radial.update(0, inside);
+    radial.update(0, edge);
+
+    if (inside.xbox360.x1 != 0 || inside.xbox360.y1 != 0 ||
+        edge.xbox360.x1 != 32767 || edge.xbox360.y1 != 0)
+    {
+      std::cout << "error: radial deadzone" << std::endl;
+      errors += 1;
+    }
+  }
+
+  const int kIterations = 200000;
+  int64_t checksum = 0;
+
+  int64_t start = Clock::now();
+  for(int i = 0; i < kIterations; ++i)
+  {
+    XboxGenericMsg msg = make_msg(i * 7, i * 13, i * 17, i * 23);
+    run(legacy, msg);
+    checksum += msg.xbox360.x1 + msg.xbox360.y2;
+  }
+  int64_t legacy_time = Clock::now() - start;
+
+  start = Clock::now();
+  for(int i = 0; i < kIterations; ++i)
+  {
+    XboxGenericMsg msg = make_msg(i * 7, i * 13, i * 17, i * 23);
+    run(fused, msg);
+    checksum += msg.xbox360.x1 + msg.xbox360.y2;
+  }
+  int64_t fused_time = Clock::now() - start;
+
+  std::cout << "modifiers:   " << legacy_time / kIterations << " nsec per message\n"
+            << "StickModifier: " << fused_time / kIterations << " nsec per message\n"
+            << "(checksum " << checksum << ")" << std::endl;
+
+  return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* EOF */
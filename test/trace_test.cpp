@@ -0,0 +1,112 @@
+/*
+**  Xbox360 USB Gamepad Userspace Driver
+**  Copyright (C) 2011 Ingo Ruhnke <grumbel@gmail.com>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <glib.h>
+#include <iostream>
+#include <sstream>
+#include <stdlib.h>
+
+#include "trace.hpp"
+
+namespace {
+
+int count_spans(const std::string& json, const std::string& name)
+{
+  int count = 0;
+  const std::string pattern = "\"name\":\"" + name + "\"";
+  for(std::string::size_type pos = json.find(pattern);
+      pos != std::string::npos;
+      pos = json.find(pattern, pos + 1))
+  {
+    count += 1;
+  }
+  return count;
+}
+
+gpointer worker(gpointer userdata)
+{
+  for(int i = 0; i < 100; ++i)
+  {
+    TRACE_SPAN("worker");
+  }
+  return 0;
+}
+
+} // namespace
+
+// Record spans from two threads, overflow the ring buffer of one of
+// them and check what ends up in the Chrome trace JSON.
+int main(int argc, char** argv)
+{
+  Trace::enable(1000, "/dev/null"); // rounded up to 1024
+
+  GThread* thread = g_thread_new("worker", &worker, NULL);
+  g_thread_join(thread);
+
+  for(int i = 0; i < 3000; ++i)
+  {
+    TRACE_SPAN_ARG("main", i);
+  }
+
+  Trace::record("manual", -1, 1500, 4250);
+
+  std::ostringstream out;
+  Trace::write_json(out);
+  const std::string json = out.str();
+
+  int errors = 0;
+
+  if (count_spans(json, "worker") != 100)
+  {
+    std::cout << "error: expected 100 worker spans, got " << count_spans(json, "worker") << std::endl;
+    errors += 1;
+  }
+
+  // 3001 spans were recorded on the main thread, only the last 1024 are kept
+  if (count_spans(json, "main") != 1023 || count_spans(json, "manual") != 1)
+  {
+    std::cout << "error: expected 1023 main spans, got " << count_spans(json, "main") << std::endl;
+    errors += 1;
+  }
+
+  if (json.find("\"args\":{\"n\":2999}") == std::string::npos ||
+      json.find("\"args\":{\"n\":1976}") != std::string::npos)
+  {
+    std::cout << "error: ring buffer didn't keep the latest spans" << std::endl;
+    errors += 1;
+  }
+
+  if (json.find("\"ts\":1.500,\"dur\":2.750") == std::string::npos)
+  {
+    std::cout << "error: timestamps not written in usec" << std::endl;
+    errors += 1;
+  }
+
+  if (errors)
+  {
+    std::cout << json.substr(0, 400) << std::endl;
+    return EXIT_FAILURE;
+  }
+  else
+  {
+    return EXIT_SUCCESS;
+  }
+}
+
+/* EOF */
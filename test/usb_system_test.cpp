@@ -89,7 +89,8 @@ int main()
                                                         false,
                                                         "",
                                                         "",
-                                                        false);
+                                                        false,
+                                                        2);
   controller->set_led(2);
   g_main_loop_run(m_gmain);
 